@@ -6,6 +6,8 @@ from localization_filter import LocalizationFilter
 from typing import List
 from models import Position
 from config import Config
+from collections import deque
+from itertools import islice
 import time
 
 app = FastAPI(title="Swarm Sound Localization API",
@@ -23,8 +25,8 @@ app.add_middleware(
 # Initialize components
 localizer = IntensityLocalizer()
 kalman_filter = LocalizationFilter()
-target_history = []
 MAX_HISTORY = 1000  # Prevent memory overflow
+target_history = deque(maxlen=MAX_HISTORY)  # oldest results drop off the front in O(1)
 
 @app.post("/localize", 
          response_model=LocalizationResult,
@@ -66,8 +68,6 @@ async def localize(measurements: List[SoundIntensityReading]):
 
         # Maintain history
         target_history.append(result)
-        if len(target_history) > MAX_HISTORY:
-            target_history.pop(0)
 
         return result
 
@@ -80,7 +80,8 @@ async def localize(measurements: List[SoundIntensityReading]):
         description="Returns most recent localization results")
 async def get_history(limit: int = 50):
     """Retrieve historical localization data"""
-    return target_history[-limit:]
+    # walk back from the newest, only the results asked for
+    return list(islice(reversed(target_history), max(limit, 0)))[::-1]
 
 @app.get("/config",
         summary="Get current configuration",
@@ -0,0 +1,192 @@
+# a small client for the kernel's Bluetooth management interface (the mgmt control
+# channel of an HCI socket, the same interface bluetoothd and btmgmt use). only the
+# commands the beacon tools need are here, see doc/mgmt-api.txt in the BlueZ tree
+# for the rest. opening the channel needs CAP_NET_ADMIN.
+
+import collections
+import ctypes
+import os
+import select
+import struct
+import time
+
+AF_BLUETOOTH = 31
+BTPROTO_HCI = 1
+HCI_CHANNEL_CONTROL = 3
+HCI_DEV_NONE = 0xFFFF
+
+# commands
+READ_INDEX_LIST = 0x0003
+SET_POWERED = 0x0005
+SET_LE = 0x000D
+START_DISCOVERY = 0x0023
+STOP_DISCOVERY = 0x0024
+START_SERVICE_DISCOVERY = 0x003A
+READ_ADV_FEATURES = 0x003D
+REMOVE_ADVERTISING = 0x003F
+ADD_EXT_ADV_PARAMS = 0x0054
+ADD_EXT_ADV_DATA = 0x0055
+
+# events
+EV_CMD_COMPLETE = 0x0001
+EV_CMD_STATUS = 0x0002
+EV_DEVICE_FOUND = 0x0012
+EV_DISCOVERING = 0x0013
+
+# Add Extended Advertising Parameters flags: which of the optional parameters are set
+ADV_PARAM_DURATION = 1 << 12
+ADV_PARAM_TIMEOUT = 1 << 13
+ADV_PARAM_INTERVALS = 1 << 14
+
+# discovery address types
+ADDRESS_TYPE_LE = 0x06 # public and random
+
+# advertising intervals are in 0.625 ms units
+INTERVAL_UNIT_MS = 0.625
+
+STATUS_NAMES = {
+    0x01: "unknown command", 0x03: "failed", 0x0A: "busy", 0x0B: "rejected",
+    0x0C: "not supported", 0x0D: "invalid parameters", 0x0F: "not powered",
+    0x11: "invalid index", 0x14: "permission denied",
+}
+
+class MgmtError(Exception):
+    def __init__(self, opcode, status):
+        super().__init__(f"mgmt command 0x{opcode:04x} failed: {STATUS_NAMES.get(status, hex(status))}")
+        self.opcode = opcode
+        self.status = status
+
+class _SockaddrHci(ctypes.Structure):
+    _fields_ = [("family", ctypes.c_ushort), ("dev", ctypes.c_ushort), ("channel", ctypes.c_ushort)]
+
+class Mgmt:
+    def __init__(self):
+        # python's socket module can not bind an HCI socket to a channel, so it is opened through libc
+        libc = ctypes.CDLL(None, use_errno=True)
+        fd = libc.socket(AF_BLUETOOTH, 3 | os.O_CLOEXEC, BTPROTO_HCI) # SOCK_RAW
+        if fd < 0:
+            raise OSError(ctypes.get_errno(), "can not open an HCI socket: " + os.strerror(ctypes.get_errno()))
+        address = _SockaddrHci(AF_BLUETOOTH, HCI_DEV_NONE, HCI_CHANNEL_CONTROL)
+        if libc.bind(fd, ctypes.byref(address), ctypes.sizeof(address)) < 0:
+            error = ctypes.get_errno()
+            os.close(fd)
+            raise OSError(error, "can not bind the mgmt channel: " + os.strerror(error))
+        self.fd = fd
+        # events that arrived while waiting for a command to complete
+        self.pending = collections.deque()
+
+    def close(self):
+        if self.fd is not None:
+            os.close(self.fd)
+            self.fd = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def _read(self, timeout):
+        readable, _, _ = select.select([self.fd], [], [], timeout)
+        if not readable:
+            return None
+        packet = os.read(self.fd, 65535)
+        code, index, length = struct.unpack_from("<HHH", packet)
+        return code, index, packet[6:6 + length]
+
+    def command(self, opcode, index, params=b"", timeout=2.0):
+        # sends a command and returns its return parameters, raises MgmtError on a failure status
+        os.write(self.fd, struct.pack("<HHH", opcode, index, len(params)) + params)
+        deadline = time.monotonic() + timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            event = self._read(max(remaining, 0)) if remaining > 0 else None
+            if event is None:
+                raise TimeoutError(f"mgmt command 0x{opcode:04x} got no reply")
+            code, event_index, data = event
+            if code in (EV_CMD_COMPLETE, EV_CMD_STATUS) and event_index == index:
+                replied, status = struct.unpack_from("<HB", data)
+                if replied == opcode:
+                    if status != 0:
+                        raise MgmtError(opcode, status)
+                    return data[3:]
+            self.pending.append(event)
+
+    def events(self, timeout):
+        # yields (code, index, params) of the events that arrive within timeout seconds
+        deadline = time.monotonic() + timeout
+        while True:
+            if self.pending:
+                yield self.pending.popleft()
+                continue
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return
+            event = self._read(remaining)
+            if event is not None:
+                yield event
+
+    # ############ commands ############
+
+    def controllers(self):
+        data = self.command(READ_INDEX_LIST, HCI_DEV_NONE)
+        count, = struct.unpack_from("<H", data)
+        return list(struct.unpack_from(f"<{count}H", data, 2))
+
+    def set_powered(self, index, on):
+        self.command(SET_POWERED, index, bytes([1 if on else 0]))
+
+    def set_le(self, index, on):
+        self.command(SET_LE, index, bytes([1 if on else 0]))
+
+    def advertising_features(self, index):
+        # supported flags, largest advertising data, largest scan response, most instances, instances in use
+        flags, max_data, max_scan, max_instances, instances = struct.unpack_from("<IBBBB", self.command(READ_ADV_FEATURES, index))
+        return {"flags": flags, "max_data": max_data, "max_scan_response": max_scan,
+                "max_instances": max_instances, "instances": instances}
+
+    def add_advertising(self, index, instance, data, interval_ms, timeout=0):
+        # a non-connectable advertising set sending data every interval_ms. returns the tx power
+        # the controller chose (dBm)
+        units = round(interval_ms / INTERVAL_UNIT_MS)
+        flags = ADV_PARAM_INTERVALS | (ADV_PARAM_TIMEOUT if timeout else 0)
+        params = struct.pack("<BIHHIIb", instance, flags, 0, timeout, units, units, 127)
+        reply = self.command(ADD_EXT_ADV_PARAMS, index, params)
+        _, tx_power, max_data, _ = struct.unpack_from("<BbBB", reply)
+        if len(data) > max_data:
+            raise ValueError(f"{len(data)} bytes of advertising data, the controller takes {max_data}")
+        self.command(ADD_EXT_ADV_DATA, index, struct.pack("<BBB", instance, len(data), 0) + data)
+        return tx_power
+
+    def remove_advertising(self, index, instance=0):
+        # instance 0 removes every set
+        self.command(REMOVE_ADVERTISING, index, bytes([instance]))
+
+    def start_discovery(self, index, address_type=ADDRESS_TYPE_LE):
+        self.command(START_DISCOVERY, index, bytes([address_type]))
+
+    def stop_discovery(self, index, address_type=ADDRESS_TYPE_LE):
+        self.command(STOP_DISCOVERY, index, bytes([address_type]))
+
+    def start_service_discovery(self, index, rssi_threshold=-127, address_type=ADDRESS_TYPE_LE):
+        # discovery with an rssi threshold and no uuid filter: the kernel then turns the
+        # controller's duplicate filter off and reports every advert, not one per device
+        self.command(START_SERVICE_DISCOVERY, index, struct.pack("<BbH", address_type, rssi_threshold, 0))
+
+def parse_device_found(data):
+    # address, address type, rssi and the advertising data of a Device Found event
+    address, address_type, rssi, _, length = struct.unpack_from("<6sBbIH", data)
+    return address[::-1].hex(":"), address_type, rssi, data[14:14 + length]
+
+def parse_discovering(data):
+    # whether discovery is running, from a Discovering event
+    _, discovering = struct.unpack_from("<BB", data)
+    return bool(discovering)
+
+def ad_structures(data):
+    # (type, value) of each structure in advertising data
+    i = 0
+    while i < len(data) and data[i] != 0:
+        length = data[i]
+        yield data[i + 1], data[i + 2:i + 1 + length]
+        i += 1 + length
@@ -0,0 +1,105 @@
+# a python script that has the beacon listen for the bots as well: every advert a bot
+# sends is measured here, and each report window the beacon sends the command server
+# each bot's rssi statistics, so the server can fuse them with what the bots hear of
+# the beacons. runs beside setup.py (same controller, needs mgmt.py and root or
+# CAP_NET_ADMIN):
+#
+#   sudo python3 scanner.py --id 4 --server 192.168.1.10
+#
+# the reports are udp datagrams (command server/beacon_reports.py reads them): version,
+# beacon id, bot count, then per bot its address (6 bytes, most significant first), mean
+# rssi in 0.1 dBm (int16), its standard deviation in 0.1 dB and the sample count, little endian
+
+import math
+import signal
+import socket
+import struct
+import argparse
+
+import mgmt
+
+REPORT_VERSION = 1
+BOT_NAME = "BristleBot"
+DEFAULT_PORT = 8001
+# bots per datagram, keeps a report under a typical mtu
+MAX_BOTS_PER_REPORT = 120
+
+class BotStats:
+    def __init__(self):
+        self.count = 0
+        self.sum = 0.0
+        self.sum2 = 0.0
+
+    def add(self, rssi):
+        self.count += 1
+        self.sum += rssi
+        self.sum2 += rssi * rssi
+
+    def mean_std(self):
+        mean = self.sum / self.count
+        if self.count < 2:
+            return mean, 0.0
+        return mean, math.sqrt(max(self.sum2 - self.sum * mean, 0.0) / (self.count - 1))
+
+def local_name(advertising):
+    for ad_type, value in mgmt.ad_structures(advertising):
+        if ad_type in (0x08, 0x09): # shortened or complete local name
+            return value.decode(errors="replace")
+    return None
+
+def encode_reports(beacon_id, bots):
+    # bots: address -> BotStats, split over as many datagrams as needed
+    entries = []
+    for address, stats in bots.items():
+        mean, std = stats.mean_std()
+        entries.append(bytes.fromhex(address.replace(":", "")) +
+                       struct.pack("<hBB", round(mean * 10), min(round(std * 10), 255), min(stats.count, 255)))
+    for start in range(0, len(entries), MAX_BOTS_PER_REPORT):
+        chunk = entries[start:start + MAX_BOTS_PER_REPORT]
+        yield struct.pack("<BBB", REPORT_VERSION, beacon_id, len(chunk)) + b"".join(chunk)
+
+def stop_on_sigterm(signum, frame):
+    raise KeyboardInterrupt
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="BLE Beacon Scanner")
+    parser.add_argument("--id", type=int, required=True, help="Beacon id (0-255), the one setup.py advertises (RasPi1 is 0)")
+    parser.add_argument("--server", type=str, required=True, help="Command server address")
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT, help="Command server beacon report port")
+    parser.add_argument("--window", type=float, default=0.25, help="Report window in seconds")
+    parser.add_argument("--rssi-offset", type=float, default=0.0,
+                        help="Added to every rssi, calibrates this receiver against the bots' (dB)")
+    parser.add_argument("--index", type=int, help="Controller to use (0 for hci0), the first one by default")
+    args = parser.parse_args()
+    if not 0 <= args.id <= 255:
+        parser.error("--id must be between 0 and 255")
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    signal.signal(signal.SIGTERM, stop_on_sigterm)
+
+    with mgmt.Mgmt() as client:
+        index = args.index if args.index is not None else client.controllers()[0]
+        client.set_le(index, True)
+        client.set_powered(index, True)
+        client.start_service_discovery(index)
+        print(f"Listening for bots on hci{index}, reporting to {args.server}:{args.port} every {args.window} s")
+
+        try:
+            while True:
+                bots = {}
+                for code, event_index, data in client.events(args.window):
+                    if event_index != index:
+                        continue
+                    if code == mgmt.EV_DISCOVERING and not mgmt.parse_discovering(data):
+                        # the kernel ends discovery after a while, start it again
+                        client.start_service_discovery(index)
+                    elif code == mgmt.EV_DEVICE_FOUND:
+                        address, _, rssi, advertising = mgmt.parse_device_found(data)
+                        # 127 is an advert the controller gave no rssi for
+                        if rssi != 127 and local_name(advertising) == BOT_NAME:
+                            bots.setdefault(address.upper(), BotStats()).add(rssi + args.rssi_offset)
+                for report in encode_reports(args.id, bots):
+                    sock.sendto(report, (args.server, args.port))
+        except KeyboardInterrupt:
+            client.stop_discovery(index)
+            print("Beacon scanner stopped.")
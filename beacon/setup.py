@@ -1,28 +1,119 @@
-# a python script to setup the beacon by running a series of bluetoothctl commands in a terminal 
+# a python script to setup the beacon: advertising sets are added straight through the
+# kernel's Bluetooth management interface (mgmt.py), so it has to run as root or with
+# CAP_NET_ADMIN. the old bluetoothctl path (one advert every 100 ms) stays as a fallback
+# until the mgmt one has been measured on real controllers, see --backend
 
 import time
+import signal
+import struct
 import subprocess
 import argparse
 
+import mgmt
+
+# the beacon frame the bots read (src/BeaconRegistry.h in the firmware): company id
+# 0xFFFD, then version, id, x and y in cm, rssi at 1 m in 0.01 dBm and the path loss
+# exponent in 0.01, little endian
+BEACON_COMPANY_ID = 0xFFFD
+BEACON_FRAME_VERSION = 1
+
+# the shortest interval a non-connectable advertiser may use (Bluetooth 5.0 on, 100 ms before)
+MIN_INTERVAL_MS = 20
+# advertising sets per beacon, fewer if the controller can not run as many
+DEFAULT_SETS = 4
+# the interval the bluetoothctl path has always used
+BLUETOOTHCTL_INTERVAL_MS = 100
+
+def beacon_frame(beacon_id, x, y, rssi_at_1m, path_loss_exponent):
+    return struct.pack("<BBhhhH", BEACON_FRAME_VERSION, beacon_id, round(x * 100), round(y * 100),
+                       round(rssi_at_1m * 100), round(path_loss_exponent * 100))
+
+# advertising data: the complete local name, then the beacon frame if there is one
+def advertising_data(name, frame=None):
+    encoded = name.encode()
+    data = bytes([1 + len(encoded), 0x09]) + encoded
+    if frame is not None:
+        data += bytes([3 + len(frame), 0xFF]) + struct.pack("<H", BEACON_COMPANY_ID) + frame
+    return data
+
 class BLEBeacon:
 
-    def __init__(self, name="RasPiX", duration=9999, interval=100):
-        self.process = None
+    def __init__(self, name="RasPiX", duration=0, interval=MIN_INTERVAL_MS, frame=None, sets=DEFAULT_SETS, index=None):
+        self.mgmt = None
         self.name = name
         self.duration = duration
         self.interval = interval
+        # manufacturer data payload after the company id, None to advertise the name only
+        self.frame = frame
+        self.sets = sets
+        # controller index (hci0 is 0), None for the first one
+        self.index = index
+        self.instances = []
 
     def start_beacon(self):
 
         print("Starting BLE beacon...")
 
+        self.mgmt = mgmt.Mgmt()
+        if self.index is None:
+            controllers = self.mgmt.controllers()
+            if not controllers:
+                raise RuntimeError("no Bluetooth controller")
+            self.index = controllers[0]
+        self.mgmt.set_le(self.index, True)
+        self.mgmt.set_powered(self.index, True)
+
+        # every set is the same beacon from its own random address, so a scanner that drops
+        # repeated adverts from an address still hears the beacon once per set
+        features = self.mgmt.advertising_features(self.index)
+        sets = min(self.sets, features["max_instances"])
+        data = advertising_data(self.name, self.frame)
+        # the timeout is in seconds and 16 bit, 0 advertises until the sets are removed
+        timeout = min(self.duration, 0xFFFF)
+        for instance in range(1, sets + 1):
+            tx_power = self.mgmt.add_advertising(self.index, instance, data, self.interval, timeout)
+            self.instances.append(instance)
+            print(f"Advertising set {instance}: every {self.interval} ms, tx power {tx_power} dBm")
+
+        print(f"BLE beacon started on hci{self.index} with {sets} advertising sets.")
+
+    def stop_beacon(self):
+        # also after a start that failed part way
+        if self.mgmt is None:
+            return
+        print("Stopping BLE beacon...")
+        for instance in self.instances:
+            self.mgmt.remove_advertising(self.index, instance)
+        self.instances = []
+        self.mgmt.close()
+        self.mgmt = None
+
+# the beacon as it was set up before mgmt.py: one advertisement through a bluetoothctl session
+class BluetoothctlBeacon:
+
+    def __init__(self, name="RasPiX", duration=9999, interval=BLUETOOTHCTL_INTERVAL_MS, frame=None):
+        self.process = None
+        self.name = name
+        self.duration = duration
+        self.interval = interval
+        self.frame = frame
+
+    def start_beacon(self):
+
+        print("Starting BLE beacon through bluetoothctl...")
+
         commands = [
             "power on",
             "agent on",
             "menu advertise",
             "name " + self.name,
             "duration " + str(self.duration),
-            "interval " + str(self.interval),
+            f"interval {self.interval:g}",
+        ]
+        if self.frame is not None:
+            data = " ".join(f"0x{byte:02x}" for byte in self.frame)
+            commands.append(f"manufacturer 0x{BEACON_COMPANY_ID:04x} {data}")
+        commands += [
             "discoverable on",
             "back",
             "advertise on",
@@ -31,62 +122,82 @@ class BLEBeacon:
         self.process = subprocess.Popen(
             ["bluetoothctl"],
             stdin=subprocess.PIPE,
-            stdout=subprocess.PIPE,
-            stderr=subprocess.PIPE,
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
             text=True,
-            universal_newlines=True,
         )
 
         for command in commands:
             print(f"Executing command: {command}")
             self.process.stdin.write(command + "\n")
             self.process.stdin.flush()
-            # # Read the output and print it
-            # while True:
-            #     output = self.process.stdout.readline()
-            #     if output == "" and self.process.poll() is not None:
-            #         break
-            #     if output:
-            #         print(output.strip())
-            print("\n")
-        
+
         print("BLE beacon started.")
 
     def stop_beacon(self):
         print("Stopping BLE beacon...")
-        commands = [
-            "advertise off",
-            "exit"
-        ]
-        for command in commands:
+        for command in ["advertise off", "exit"]:
             print(f"Executing command: {command}")
             self.process.stdin.write(command + "\n")
             self.process.stdin.flush()
-            # # Read the output and print it
-            # while True:
-            #     output = self.process.stdout.readline()
-            #     if output == "" and self.process.poll() is not None:
-            #         break
-            #     if output:
-            #         print(output.strip())
-            # print("\n")
         self.process.terminate()
         self.process = None
 
+def start_beacon(args, frame):
+    # the mgmt beacon, or the bluetoothctl one if asked for or if mgmt can not be opened or
+    # refuses the sets
+    if args.backend != "bluetoothctl":
+        beacon = BLEBeacon(args.name, args.duration, args.interval or MIN_INTERVAL_MS, frame, args.sets, args.index)
+        try:
+            beacon.start_beacon()
+            return beacon
+        except (OSError, RuntimeError, ValueError, mgmt.MgmtError) as error:
+            if args.backend == "mgmt":
+                raise
+            print(f"mgmt advertising failed ({error}), falling back to bluetoothctl")
+            beacon.stop_beacon()
+    beacon = BluetoothctlBeacon(args.name, args.duration or 9999, args.interval or BLUETOOTHCTL_INTERVAL_MS, frame)
+    beacon.start_beacon()
+    return beacon
 
+def stop_on_sigterm(signum, frame):
+    raise KeyboardInterrupt
 
 if __name__ == "__main__":
     # optionally parse args
     parser = argparse.ArgumentParser(description="BLE Beacon Setup")
     parser.add_argument("--name", type=str, default="RasPiX", help="Name of the beacon")
-    parser.add_argument("--duration", type=int, default=9999, help="Duration of advertisement in seconds")
-    parser.add_argument("--interval", type=int, default=100, help="Interval of advertisement packets in ms")
+    parser.add_argument("--duration", type=int, default=0, help="Duration of advertisement in seconds, 0 for no limit")
+    parser.add_argument("--interval", type=float, help="Interval of advertisement packets in ms, "
+                        f"{MIN_INTERVAL_MS} through mgmt and {BLUETOOTHCTL_INTERVAL_MS} through bluetoothctl by default")
+    parser.add_argument("--sets", type=int, default=DEFAULT_SETS, help="Advertising sets to run at once")
+    parser.add_argument("--index", type=int, help="Controller to use (0 for hci0), the first one by default")
+    parser.add_argument("--backend", choices=("auto", "mgmt", "bluetoothctl"), default="auto",
+                        help="How to advertise: mgmt, bluetoothctl, or mgmt falling back to bluetoothctl (auto)")
+    parser.add_argument("--id", type=int, help="Beacon id (0-255) to advertise with the position, "
+                        "the bots then need no configuration for this beacon")
+    parser.add_argument("--x", type=float, default=0.0, help="Beacon x position in metres")
+    parser.add_argument("--y", type=float, default=0.0, help="Beacon y position in metres")
+    parser.add_argument("--rssi-at-1m", type=float, default=-65.37, help="RSSI a bot measures 1 m from the beacon (dBm)")
+    parser.add_argument("--path-loss-exponent", type=float, default=2.68, help="Path loss exponent around the beacon")
     args = parser.parse_args()
 
-    # Create a BLEBeacon instance
-    beacon = BLEBeacon(args.name, args.duration, args.interval)
-    # Start the beacon
-    beacon.start_beacon()
+    if args.interval is not None and args.interval < MIN_INTERVAL_MS:
+        parser.error(f"--interval must be at least {MIN_INTERVAL_MS} ms")
+    if args.sets < 1:
+        parser.error("--sets must be at least 1")
+
+    frame = None
+    if args.id is not None:
+        if not 0 <= args.id <= 255:
+            parser.error("--id must be between 0 and 255")
+        frame = beacon_frame(args.id, args.x, args.y, args.rssi_at_1m, args.path_loss_exponent)
+
+    # Create and start the beacon
+    beacon = start_beacon(args, frame)
+
+    # the kernel keeps the sets after this process exits, so systemd's stop has to remove them too
+    signal.signal(signal.SIGTERM, stop_on_sigterm)
 
     print("Press Ctrl+C to stop the beacon.")
     try:
@@ -94,7 +205,6 @@ if __name__ == "__main__":
             time.sleep(1)
     except KeyboardInterrupt:
         # Stop the beacon
-        print("Stopping BLE beacon...")
         beacon.stop_beacon()
         print("BLE beacon stopped.")
 
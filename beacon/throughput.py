@@ -0,0 +1,106 @@
+# measures how many adverts a scanner hears from one beacon in a bot's scan phase,
+# for a few advertising configurations, on BlueZ's virtual controllers so no radio
+# is needed. btvirt (from the BlueZ tree, needs the hci_vhci module) makes them:
+#
+#   sudo btvirt -L -l2 &
+#   sudo python3 throughput.py
+#
+# or let this script start it with --start-btvirt. one controller advertises as
+# setup.py does, the other scans in windows of --window-ms like a bot's scan phase,
+# where repeated adverts from the same address are dropped (BLE.scan(false) on the
+# bot, the kernel's duplicate filter here).
+
+import argparse
+import statistics
+import subprocess
+import time
+
+import mgmt
+from setup import BLEBeacon, beacon_frame, BEACON_COMPANY_ID
+
+TEST_NAME = "RasPiT"
+TEST_ID = 200
+
+def parse_config(text):
+    # "SETSxINTERVAL", e.g. 4x20 for four sets every 20 ms
+    sets, interval = text.lower().split("x")
+    return int(sets), float(interval)
+
+def is_test_beacon(advertising):
+    for ad_type, value in mgmt.ad_structures(advertising):
+        if ad_type == 0xFF and len(value) >= 4 and value[0] | value[1] << 8 == BEACON_COMPANY_ID:
+            return value[3] == TEST_ID
+    return False
+
+def scan_window(client, scanner, seconds):
+    # adverts from the test beacon heard in one window, and from how many addresses
+    reports = 0
+    addresses = set()
+    client.start_discovery(scanner)
+    for code, index, data in client.events(seconds):
+        if code != mgmt.EV_DEVICE_FOUND or index != scanner:
+            continue
+        address, _, _, advertising = mgmt.parse_device_found(data)
+        if is_test_beacon(advertising):
+            reports += 1
+            addresses.add(address)
+    client.stop_discovery(scanner)
+    return reports, len(addresses)
+
+def measure(client, beacon_index, scanner, sets, interval, windows, window_ms):
+    beacon = BLEBeacon(TEST_NAME, 0, interval, beacon_frame(TEST_ID, 0.0, 0.0, -65.37, 2.68), sets, beacon_index)
+    beacon.start_beacon()
+    try:
+        time.sleep(0.2)
+        counts = [scan_window(client, scanner, window_ms / 1000.0) for _ in range(windows)]
+    finally:
+        beacon.stop_beacon()
+    reports = [c[0] for c in counts]
+    return {
+        "sets": len(beacon.instances) or sets,
+        "interval": interval,
+        "mean": statistics.mean(reports),
+        "min": min(reports),
+        "addresses": statistics.mean(c[1] for c in counts),
+        "per_second": statistics.mean(reports) * 1000.0 / window_ms,
+    }
+
+def main():
+    parser = argparse.ArgumentParser(description="Beacon advert throughput on virtual controllers")
+    parser.add_argument("--beacon", type=int, help="Controller index that advertises")
+    parser.add_argument("--scanner", type=int, help="Controller index that scans")
+    parser.add_argument("--start-btvirt", action="store_true", help="Start btvirt -L -l2 and use its controllers")
+    parser.add_argument("--window-ms", type=int, default=500, help="Length of a scan window (a bot's scan phase)")
+    parser.add_argument("--windows", type=int, default=20, help="Scan windows per configuration")
+    parser.add_argument("--configs", default="1x100,1x20,2x20,4x20",
+                        help="Advertising configurations to compare, SETSxINTERVAL_MS separated by commas")
+    args = parser.parse_args()
+    configs = [parse_config(text) for text in args.configs.split(",")]
+
+    btvirt = None
+    with mgmt.Mgmt() as client:
+        before = client.controllers()
+        if args.start_btvirt:
+            btvirt = subprocess.Popen(["btvirt", "-L", "-l2"], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+            time.sleep(1.0)
+        try:
+            controllers = client.controllers()
+            added = [index for index in controllers if index not in before]
+            candidates = added if args.start_btvirt else controllers
+            beacon_index = args.beacon if args.beacon is not None else candidates[-2]
+            scanner = args.scanner if args.scanner is not None else candidates[-1]
+            client.set_le(scanner, True)
+            client.set_powered(scanner, True)
+
+            print(f"beacon hci{beacon_index}, scanner hci{scanner}, {args.windows} windows of {args.window_ms} ms")
+            print("sets  interval  adverts/window (min)  addresses/window  adverts/s")
+            for sets, interval in configs:
+                result = measure(client, beacon_index, scanner, sets, interval, args.windows, args.window_ms)
+                print(f"{result['sets']:4d}  {result['interval']:6.1f} ms  {result['mean']:8.1f} ({result['min']:3d})"
+                      f"       {result['addresses']:8.1f}        {result['per_second']:8.1f}")
+        finally:
+            if btvirt is not None:
+                btvirt.terminate()
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,166 @@
+// accuracy of the Ahrs filters (src/orientation/Ahrs.h) against the vendored
+// Madgwick filter and against the true attitude, on a synthetic run: the bot spins
+// and wobbles while noisy, biased gyro, accelerometer and magnetometer readings are
+// generated from the true attitude. prints the attitude error of each filter once
+// they have converged, and how far each is from the vendored filter.
+//
+//   make && ./build/ahrs_accuracy
+
+#include <orientation/Ahrs.h>
+
+#include <MadgwickAHRS.h>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+namespace Bench
+{
+
+    static const uint32_t PERIOD_US = 10000;
+    static const float RATE = 1000000.0 / PERIOD_US; // Hz
+    static const float SECONDS = 120.0;
+    static const float SETTLE_SECONDS = 10.0; // errors are measured after this
+    static const int TRUTH_SUBSTEPS = 20;   // the true attitude is integrated finer than it is sampled
+    static const float DIP = 66.0 * Ahrs::RADIANS_PER_DEGREE; // field inclination
+
+    typedef Ahrs::Quaternion Quaternion;
+
+    static Quaternion multiply(const Quaternion &a, const Quaternion &b)
+    {
+        return {
+            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+            a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+        };
+    }
+
+    // earth frame vector v seen from the sensor frame of attitude q
+    static void toSensor(const Quaternion &q, const float v[3], float out[3])
+    {
+        Quaternion conj = {q.w, -q.x, -q.y, -q.z};
+        Quaternion r = multiply(multiply(conj, {0.0f, v[0], v[1], v[2]}), q);
+        out[0] = r.x;
+        out[1] = r.y;
+        out[2] = r.z;
+    }
+
+    // angle between two attitudes (degrees)
+    static float angleBetween(const Quaternion &a, const Quaternion &b)
+    {
+        float dot = fabsf(a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z);
+        return 2.0f * acosf(fminf(1.0f, dot)) * Ahrs::DEGREES_PER_RADIAN;
+    }
+
+    static Quaternion quaternionOf(Madgwick &filter)
+    {
+        // the vendored filter only gives angles, rebuild its quaternion from them
+        float roll = filter.getRollRadians(), pitch = filter.getPitchRadians(), yaw = filter.getYawRadians();
+        float cr = cosf(roll / 2), sr = sinf(roll / 2);
+        float cp = cosf(pitch / 2), sp = sinf(pitch / 2);
+        float cy = cosf(yaw / 2), sy = sinf(yaw / 2);
+        return {cr * cp * cy + sr * sp * sy, sr * cp * cy - cr * sp * sy, cr * sp * cy + sr * cp * sy, cr * cp * sy - sr * sp * cy};
+    }
+
+    struct Error
+    {
+        double sumSquares = 0.0;
+        float max = 0.0;
+        int count = 0;
+
+        void add(float e)
+        {
+            sumSquares += e * e;
+            max = fmaxf(max, e);
+            count++;
+        }
+
+        float rms() const
+        {
+            return count ? sqrt(sumSquares / count) : 0.0;
+        }
+    };
+
+    static int run()
+    {
+        std::mt19937 rng(7);
+        std::normal_distribution<float> normal(0.0, 1.0);
+        const float gyroNoise = 0.3, gyroBias[3] = {0.4, -0.25, 0.3}; // deg/s
+        const float accelNoise = 0.02, magNoise = 0.02;
+
+        Madgwick vendored;
+        vendored.begin(RATE);
+        Ahrs::Filter<Ahrs::Madgwick> madgwick;
+        madgwick.begin(RATE);
+        Ahrs::Filter<Ahrs::Madgwick, PERIOD_US> fixedMadgwick;
+        Ahrs::Filter<Ahrs::Mahony> mahony;
+        mahony.begin(RATE);
+
+        Quaternion truth = {1.0f, 0.0f, 0.0f, 0.0f};
+        const float gravity[3] = {0.0f, 0.0f, 1.0f};
+        const float field[3] = {cosf(DIP), 0.0f, -sinf(DIP)};
+        Error vendoredError, madgwickError, fixedError, mahonyError;
+        Error madgwickVsVendored, fixedVsMadgwick;
+
+        int steps = SECONDS * RATE;
+        for (int n = 0; n < steps; n++)
+        {
+            float t = n / RATE;
+            // body rates (rad/s): turning back and forth while rocking on the bristles
+            float w[3] = {
+                0.6f * sinf(2.1f * t),
+                0.5f * cosf(1.7f * t),
+                1.2f * sinf(0.3f * t) + 0.4f,
+            };
+            float h = 1.0f / (RATE * TRUTH_SUBSTEPS);
+            for (int s = 0; s < TRUTH_SUBSTEPS; s++)
+            {
+                float angle = sqrtf(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]) * h;
+                float k = sinf(angle / 2) / (angle / h);
+                truth = multiply(truth, {cosf(angle / 2), w[0] * k, w[1] * k, w[2] * k});
+            }
+
+            float a[3], m[3], g[3];
+            toSensor(truth, gravity, a);
+            toSensor(truth, field, m);
+            for (int i = 0; i < 3; i++)
+            {
+                g[i] = w[i] * Ahrs::DEGREES_PER_RADIAN + gyroBias[i] + gyroNoise * normal(rng);
+                a[i] += accelNoise * normal(rng);
+                m[i] += magNoise * normal(rng);
+            }
+
+            vendored.update(g[0], g[1], g[2], a[0], a[1], a[2], m[0], m[1], m[2]);
+            madgwick.update(g[0], g[1], g[2], a[0], a[1], a[2], m[0], m[1], m[2]);
+            fixedMadgwick.update(g[0], g[1], g[2], a[0], a[1], a[2], m[0], m[1], m[2]);
+            mahony.update(g[0], g[1], g[2], a[0], a[1], a[2], m[0], m[1], m[2]);
+
+            if (t < SETTLE_SECONDS)
+                continue;
+            Quaternion v = quaternionOf(vendored);
+            vendoredError.add(angleBetween(v, truth));
+            madgwickError.add(angleBetween(madgwick.quaternion(), truth));
+            fixedError.add(angleBetween(fixedMadgwick.quaternion(), truth));
+            mahonyError.add(angleBetween(mahony.quaternion(), truth));
+            madgwickVsVendored.add(angleBetween(madgwick.quaternion(), v));
+            fixedVsMadgwick.add(angleBetween(fixedMadgwick.quaternion(), madgwick.quaternion()));
+        }
+
+        printf("%.0f s at %.0f Hz, errors after %.0f s (degrees)\n", SECONDS, RATE, SETTLE_SECONDS);
+        printf("%-28s %8s %8s\n", "filter", "rms", "max");
+        printf("%-28s %8.3f %8.3f\n", "vendored Madgwick", vendoredError.rms(), vendoredError.max);
+        printf("%-28s %8.3f %8.3f\n", "Ahrs Madgwick", madgwickError.rms(), madgwickError.max);
+        printf("%-28s %8.3f %8.3f\n", "Ahrs Madgwick, fixed period", fixedError.rms(), fixedError.max);
+        printf("%-28s %8.3f %8.3f\n", "Ahrs Mahony", mahonyError.rms(), mahonyError.max);
+        printf("%-28s %8.4f %8.4f\n", "Ahrs Madgwick vs vendored", madgwickVsVendored.rms(), madgwickVsVendored.max);
+        printf("%-28s %8.4f %8.4f\n", "fixed vs runtime period", fixedVsMadgwick.rms(), fixedVsMadgwick.max);
+        return 0;
+    }
+
+}
+
+int main()
+{
+    return Bench::run();
+}
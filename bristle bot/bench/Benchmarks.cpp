@@ -0,0 +1,478 @@
+#include "Benchmarks.h"
+
+#include <Arduino.h>
+#include <BeaconRegistry.h>
+#include <Localisation.h>
+#include <Params.h>
+#include <SoundBearing.h>
+#include <SoundClassifier.h>
+#include <SoundGain.h>
+#include <SoundStats.h>
+
+#include <MadgwickAHRS.h>
+#include <processing/biquad.h>
+#include <processing/filters.h>
+
+#include <algorithm>
+
+// the compass library smooths readings in a private member, open it up for this file
+// only (before CompassModule.h includes it)
+#define private public
+#include <QMC5883LCompass.h>
+#undef private
+
+#include <orientation/Ahrs.h>
+#include <orientation/CompassModule.h>
+
+#include <classifier/LogMel.h>
+#include <classifier/SoundNet.h>
+
+namespace Bench
+{
+
+    volatile float sink = 0.0;
+
+    // inputs cycle through small tables so no call sees the same values as the last one
+    static const int INPUTS = 16;
+    static int next = 0;
+
+    static int step()
+    {
+        next = (next + 1) % INPUTS;
+        return next;
+    }
+
+    // ############ Localisation #############
+
+    static float distances[INPUTS][3];
+    static float rssiValues[INPUTS];
+    static float beaconPositions[3][2];
+
+    static void prepareLocalisation()
+    {
+        applyParams();
+        const Params::Values &p = Params::values;
+        const float positions[3][2] = {{p.beacon1X, p.beacon1Y}, {p.beacon2X, p.beacon2Y}, {p.beacon3X, p.beacon3Y}};
+        memcpy(beaconPositions, positions, sizeof(positions));
+        for (int i = 0; i < INPUTS; i++)
+        {
+            rssiValues[i] = -60.0 - i * 1.5;
+            // distances to the beacons from points spread over the arena
+            for (int b = 0; b < 3; b++)
+                distances[i][b] = 0.4 + 0.1 * ((i * 7 + b * 5) % 16);
+        }
+        // a full window for every beacon
+        for (int n = 0; n < Params::values.rssiWindow; n++)
+        {
+            for (int b = 0; b < 3; b++)
+                insertRSSI(b, -55 - (n * 3 + b) % 25);
+        }
+    }
+
+    static void runTrilateration()
+    {
+        float x, y, residual;
+        trilateration(beaconPositions, distances[step()], 3, x, y, residual);
+        sink = sink + x + y + residual;
+    }
+
+    static void runAvgRSSI()
+    {
+        sink = sink + avgRSSI(step() % 3);
+    }
+
+    static void runStdRSSI()
+    {
+        sink = sink + stdRSSI(step() % 3);
+    }
+
+    static void runRssiToDistance()
+    {
+        sink = sink + rssiToDistance(rssiValues[step()], Params::values.rssiAt1m, Params::values.pathLossExponent);
+    }
+
+    // frames of a full registry's worth of beacons
+    static uint8_t beaconFrames[BeaconRegistry::MAX_BEACONS][BeaconRegistry::FRAME_SIZE];
+
+    static void prepareBeacons()
+    {
+        BeaconRegistry::clear();
+        for (int i = 0; i < BeaconRegistry::MAX_BEACONS; i++)
+        {
+            BeaconRegistry::Beacon beacon = {(uint8_t)i, i * 1.5f, -i * 0.5f, -65.0f, 2.5f, true, 0};
+            BeaconRegistry::writeFrame(beacon, beaconFrames[i]);
+        }
+    }
+
+    // an advert from one of them: the frame read and the beacon looked up in the registry
+    static void runBeaconHeard()
+    {
+        BeaconRegistry::Beacon beacon;
+        bool added;
+        if (BeaconRegistry::parseFrame(beaconFrames[step()], BeaconRegistry::FRAME_SIZE, beacon))
+            sink = sink + BeaconRegistry::update(beacon, 0, 10000, added);
+    }
+
+    // ############ Orientation #############
+
+    static Madgwick madgwick;
+    static float imu[INPUTS][9];
+
+    static void prepareMadgwick()
+    {
+        madgwick.begin(100);
+        for (int i = 0; i < INPUTS; i++)
+        {
+            float a = i * 0.39;
+            float sample[9] = {
+                1.5f * sinf(a), 0.8f * cosf(a), 12.0f, // gyro (deg/s)
+                0.02f, -0.01f, 1.0f,                   // accel (g)
+                30.0f * cosf(a), 30.0f * sinf(a), -20.0f, // mag
+            };
+            memcpy(imu[i], sample, sizeof(sample));
+        }
+    }
+
+    static void runMadgwick()
+    {
+        const float *s = imu[step()];
+        madgwick.update(s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7], s[8]);
+        sink = sink + madgwick.getYaw();
+    }
+
+    static Ahrs::Filter<Ahrs::Madgwick> ahrsMadgwick;
+    static Ahrs::Filter<Ahrs::Madgwick, 10000> ahrsMadgwickFixed;
+    static Ahrs::Filter<Ahrs::Mahony> ahrsMahony;
+
+    static void prepareAhrs()
+    {
+        prepareMadgwick();
+        ahrsMadgwick.begin(100);
+        ahrsMahony.begin(100);
+    }
+
+    template <typename F>
+    static void runFilter(F &filter)
+    {
+        const float *s = imu[step()];
+        filter.update(s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7], s[8]);
+        sink = sink + filter.yaw();
+    }
+
+    static void runAhrsMadgwick()
+    {
+        runFilter(ahrsMadgwick);
+    }
+
+    static void runAhrsMadgwickFixed()
+    {
+        runFilter(ahrsMadgwickFixed);
+    }
+
+    static void runAhrsMahony()
+    {
+        runFilter(ahrsMahony);
+    }
+
+    static QMC5883LCompass qmc;
+    static int magReadings[INPUTS][3];
+
+    static void prepareSmoothing()
+    {
+        // as CompassModule::begin() sets it
+        qmc.setSmoothing(10, true);
+        for (int i = 0; i < INPUTS; i++)
+        {
+            magReadings[i][0] = 1200 + (i * 37) % 200;
+            magReadings[i][1] = -800 + (i * 53) % 200;
+            magReadings[i][2] = 400 + (i * 11) % 50;
+        }
+    }
+
+    static void runSmoothing()
+    {
+        memcpy(qmc._vCalibrated, magReadings[step()], sizeof(qmc._vCalibrated));
+        qmc._smoothing();
+        sink = sink + qmc._vSmooth[0];
+    }
+
+    static CompassModule compassModule;
+
+    static void prepareCalibration()
+    {
+        const float offset[3] = {120.0, -340.0, 55.0};
+        const float scale[3] = {1.0, 1.08, 0.94};
+        compassModule.setCalibration(offset, scale);
+        prepareSmoothing();
+    }
+
+    static void runApplyCalibration()
+    {
+        const int *m = magReadings[step()];
+        float mx = m[0], my = m[1], mz = m[2];
+        compassModule.applyCalibration(mx, my, mz);
+        sink = sink + mx + my + mz;
+    }
+
+    // ############ Sound #############
+
+    // SAMPLES in SoundMeasurer.cpp
+    static const int FRAME_SAMPLES = 800;
+    static int16_t frame[FRAME_SAMPLES];
+
+    static void prepareSound()
+    {
+        uint32_t state = 12345;
+        for (int i = 0; i < FRAME_SAMPLES; i++)
+        {
+            state = state * 1664525u + 1013904223u;
+            frame[i] = (int16_t)((state >> 16) % 2001) - 1000;
+        }
+    }
+
+    static void runFrameStats()
+    {
+        SoundGain::Frame stats = SoundGain::measure(frame, FRAME_SAMPLES);
+        sink = sink + stats.mean + stats.rms + stats.peak;
+    }
+
+    static float levels[INPUTS];
+
+    static void prepareSoundStats()
+    {
+        prepareSound();
+        for (int i = 0; i < INPUTS; i++)
+            levels[i] = -60.0 + (i * 7 % INPUTS) * 2.5;
+        // past the held levels, so every level goes through the estimators
+        SoundStats::reset(0);
+        for (int i = 0; i <= SoundStats::HELD_LEVELS; i++)
+            SoundStats::addLevel(levels[i % INPUTS]);
+    }
+
+    static void runSoundStatsLevel()
+    {
+        SoundStats::addLevel(levels[step()]);
+    }
+
+    static void runSoundStatsFrame()
+    {
+        SoundStats::addFrame(frame, FRAME_SAMPLES, SoundGain::DEFAULT_GAIN);
+        sink = sink + SoundStats::current().l50;
+    }
+
+    static int8_t features[LogMel::FEATURES];
+
+    static void prepareClassifier()
+    {
+        prepareSound();
+        LogMel::compute(frame, FRAME_SAMPLES, SoundGain::DEFAULT_GAIN, features);
+    }
+
+    static void runLogMel()
+    {
+        LogMel::compute(frame, FRAME_SAMPLES, SoundGain::DEFAULT_GAIN, features);
+        sink = sink + features[step()];
+    }
+
+    static void runSoundNet()
+    {
+        int8_t logits[SoundNet::CLASSES];
+        SoundNet::run(SoundNet::MODEL, features, logits);
+        sink = sink + logits[0];
+    }
+
+    static void runClassify()
+    {
+        SoundClassifier::Result result;
+        SoundClassifier::classify(frame, FRAME_SAMPLES, SoundGain::DEFAULT_GAIN, result);
+        sink = sink + result.confidence;
+    }
+
+    // a sweep's worth of levels, one frame every 3 degrees
+    static const int SWEEP_LEVELS = 120;
+
+    static void prepareBearing()
+    {
+        prepareSoundStats();
+        SoundBearing::reset();
+        for (int i = 0; i < SWEEP_LEVELS; i++)
+            SoundBearing::add(i * 3.0, levels[i % INPUTS]);
+    }
+
+    static void runBearingAdd()
+    {
+        int i = step();
+        SoundBearing::add(i * 3.0, levels[i]);
+    }
+
+    static void runBearingEstimate()
+    {
+        sink = sink + SoundBearing::estimate().bearing;
+    }
+
+    static const float SAMPLE_RATE = 16000.0; // mic_config in SoundMeasurer.cpp
+    static int16_t filtered[FRAME_SAMPLES];
+    static FilterBuHp floatHighPass;
+    static FilterBiquadQ15 highPass, bandPass, aWeighting;
+
+    static void prepareFilters()
+    {
+        prepareSound();
+        highPass.highPass(100.0, SAMPLE_RATE);
+        bandPass.bandPass(300.0, 3000.0, SAMPLE_RATE);
+        aWeighting.aWeighting(SAMPLE_RATE);
+    }
+
+    static void runFloatHighPass()
+    {
+        // the library's one sample at a time float filter, for comparison
+        for (int i = 0; i < FRAME_SAMPLES; i++)
+            filtered[i] = floatHighPass.step(frame[i]);
+        sink = sink + filtered[step()];
+    }
+
+    static void runBiquad(FilterBiquadQ15 &filter)
+    {
+        filter.process(frame, filtered, FRAME_SAMPLES);
+        sink = sink + filtered[step()];
+    }
+
+    static void runHighPass()
+    {
+        runBiquad(highPass);
+    }
+
+    static void runBandPass()
+    {
+        runBiquad(bandPass);
+    }
+
+    static void runAWeighting()
+    {
+        runBiquad(aWeighting);
+    }
+
+    // the filter's arithmetic written out sample by sample, without packing or intrinsics
+    static uint32_t compareWithModel(FilterBiquadQ15 &filter, const int16_t *input, int count)
+    {
+        struct Model
+        {
+            int32_t b[3], a[2];
+            int shift;
+            int32_t x1, x2, y1, y2, error;
+        } model[FilterBiquadQ15::MAX_STAGES];
+        for (int i = 0; i < filter.stageCount(); i++)
+        {
+            const FilterBiquadQ15::Stage &s = filter.stage(i);
+            model[i] = {{s.b0, (int16_t)s.b1b2, (int16_t)(s.b1b2 >> 16)}, {(int16_t)s.a1a2, (int16_t)(s.a1a2 >> 16)},
+                        15 - s.postShift, 0, 0, 0, 0, 0};
+        }
+
+        // the filter runs over uneven blocks, so the state has to carry across them
+        static int16_t output[FRAME_SAMPLES];
+        filter.reset();
+        uint32_t mismatches = 0;
+        int done = 0, block = 1;
+        while (done < count)
+        {
+            int n = std::min(block, count - done);
+            filter.process(&input[done], output, n);
+            for (int j = 0; j < n; j++)
+            {
+                int32_t v = input[done + j];
+                for (int i = 0; i < filter.stageCount(); i++)
+                {
+                    Model &m = model[i];
+                    int64_t acc = (int64_t)m.b[0] * v + (int64_t)m.b[1] * m.x1 + (int64_t)m.b[2] * m.x2 +
+                                  (int64_t)m.a[0] * m.y1 + (int64_t)m.a[1] * m.y2 + m.error;
+                    int64_t q = acc >> m.shift;
+                    m.error = (int32_t)(acc - q * (1 << m.shift));
+                    int32_t y = (int32_t)std::max<int64_t>(-32768, std::min<int64_t>(32767, q));
+                    m.x2 = m.x1;
+                    m.x1 = v;
+                    m.y2 = m.y1;
+                    m.y1 = y;
+                    v = y;
+                }
+                mismatches += output[j] != v;
+            }
+            done += n;
+            block = block * 3 + 1;
+        }
+        return mismatches;
+    }
+
+    uint32_t checkBiquads()
+    {
+        prepareFilters();
+        static int16_t signals[3][FRAME_SAMPLES];
+        uint32_t state = 99;
+        for (int i = 0; i < FRAME_SAMPLES; i++)
+        {
+            // full scale noise to hit the saturation, a chirp, and sparse impulses
+            state = state * 1664525u + 1013904223u;
+            signals[0][i] = (int16_t)(state >> 16);
+            signals[1][i] = (int16_t)(20000.0f * sinf(0.0005f * i * i));
+            signals[2][i] = (i % 97 == 0) ? 32767 : 0;
+        }
+
+        uint32_t mismatches = 0;
+        FilterBiquadQ15 *filters[] = {&highPass, &bandPass, &aWeighting};
+        for (FilterBiquadQ15 *filter : filters)
+        {
+            mismatches += compareWithModel(*filter, frame, FRAME_SAMPLES);
+            for (const int16_t *signal : signals)
+                mismatches += compareWithModel(*filter, signal, FRAME_SAMPLES);
+        }
+        return mismatches;
+    }
+
+    const Benchmark BENCHMARKS[] = {
+        {"trilateration", prepareLocalisation, runTrilateration},
+        {"avg_rssi", prepareLocalisation, runAvgRSSI},
+        {"std_rssi", prepareLocalisation, runStdRSSI},
+        {"rssi_to_distance", prepareLocalisation, runRssiToDistance},
+        {"beacon_heard", prepareBeacons, runBeaconHeard},
+        {"madgwick_update", prepareMadgwick, runMadgwick},
+        {"ahrs_madgwick_update", prepareAhrs, runAhrsMadgwick},
+        {"ahrs_madgwick_fixed_update", prepareAhrs, runAhrsMadgwickFixed},
+        {"ahrs_mahony_update", prepareAhrs, runAhrsMahony},
+        {"qmc_smoothing", prepareSmoothing, runSmoothing},
+        {"apply_calibration", prepareCalibration, runApplyCalibration},
+        {"sound_frame_stats", prepareSound, runFrameStats, FRAME_SAMPLES},
+        {"sound_stats_level", prepareSoundStats, runSoundStatsLevel},
+        {"sound_stats_frame", prepareSoundStats, runSoundStatsFrame, FRAME_SAMPLES},
+        {"log_mel_frame", prepareClassifier, runLogMel},
+        {"sound_net_int8", prepareClassifier, runSoundNet},
+        {"sound_classify_frame", prepareClassifier, runClassify},
+        {"sound_bearing_add", prepareBearing, runBearingAdd},
+        {"sound_bearing_estimate", prepareBearing, runBearingEstimate},
+        {"float_high_pass_frame", prepareFilters, runFloatHighPass, FRAME_SAMPLES},
+        {"biquad_high_pass_frame", prepareFilters, runHighPass, FRAME_SAMPLES},
+        {"biquad_band_pass_frame", prepareFilters, runBandPass, FRAME_SAMPLES},
+        {"biquad_a_weighting_frame", prepareFilters, runAWeighting, FRAME_SAMPLES},
+    };
+
+    const int BENCHMARK_COUNT = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+
+    Summary summarise(float *samples, int count)
+    {
+        std::sort(samples, samples + count);
+        Summary s;
+        s.min = samples[0];
+        s.median = (count % 2) ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2.0;
+        for (int i = 0; i < count; i++)
+            samples[i] = fabsf(samples[i] - s.median);
+        std::sort(samples, samples + count);
+        s.mad = (count % 2) ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2.0;
+        return s;
+    }
+
+    int formatResult(char *out, int size, const Benchmark &benchmark, const Summary &summary, int samples, uint32_t iterations)
+    {
+        return snprintf(out, size, "\"%s\": {\"median\": %.2f, \"min\": %.2f, \"mad\": %.2f, \"samples\": %d, \"iterations\": %lu, \"per_item\": %.3f}",
+                        benchmark.name, summary.median, summary.min, summary.mad, samples, (unsigned long)iterations,
+                        summary.median / benchmark.items);
+    }
+
+}
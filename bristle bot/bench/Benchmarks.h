@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+// microbenchmarks of the firmware's hot kernels. the same table is run by the host
+// harness (HostBench.cpp, wall clock ns per call) and by the benchmark firmware
+// (TargetBench.cpp, DWT cycles per call), and both print the same json so results
+// can be kept as baselines and compared with tools/bench_compare.py.
+namespace Bench
+{
+
+    struct Benchmark
+    {
+        const char *name;
+        void (*prepare)(); // sets up the inputs, not timed
+        void (*run)();     // one call of the kernel
+        int items = 1;     // samples processed per call, results are also given per item
+    };
+
+    extern const Benchmark BENCHMARKS[];
+    extern const int BENCHMARK_COUNT;
+
+    // kernel results are summed into this so the calls are not optimised away
+    extern volatile float sink;
+
+    // robust summary of the per-call times of one benchmark
+    struct Summary
+    {
+        float median;
+        float min;
+        float mad; // median absolute deviation from the median
+    };
+
+    // sorts the samples in place
+    Summary summarise(float *samples, int count);
+
+    // writes one benchmark's result as a json member ("name": {...}) into out
+    int formatResult(char *out, int size, const Benchmark &benchmark, const Summary &summary, int samples, uint32_t iterations);
+
+    // runs the Q15 biquad filters over test signals next to a plain C model of their
+    // arithmetic, returns how many output samples differ (0 when bit exact)
+    uint32_t checkBiquads();
+
+}
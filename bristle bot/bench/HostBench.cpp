@@ -0,0 +1,107 @@
+// host run of the kernel benchmarks in Benchmarks.cpp, against native/ArduinoShim.
+// every benchmark is run in samples long enough for the clock to resolve, and
+// summarised as the median, minimum and median absolute deviation of ns per call.
+//
+//   make && ./build/bench --json results.json
+//   python ../tools/bench_compare.py results.json baselines/host.json
+
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Bench
+{
+
+    static double secondsFor(const Benchmark &benchmark, uint32_t iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            benchmark.run();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static int run(int argc, char **argv)
+    {
+        int samples = 31;
+        double minSampleSeconds = 0.002;
+        const char *filter = nullptr;
+        const char *jsonPath = nullptr;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--samples" && i + 1 < argc)
+                samples = std::max(1, atoi(argv[++i]));
+            else if (arg == "--sample-ms" && i + 1 < argc)
+                minSampleSeconds = atof(argv[++i]) / 1000.0;
+            else if (arg == "--filter" && i + 1 < argc)
+                filter = argv[++i];
+            else if (arg == "--json" && i + 1 < argc)
+                jsonPath = argv[++i];
+            else
+            {
+                fprintf(stderr, "usage: %s [--samples N] [--sample-ms MS] [--filter TEXT] [--json FILE]\n", argv[0]);
+                return 2;
+            }
+        }
+
+        uint32_t mismatches = checkBiquads();
+        if (mismatches != 0)
+        {
+            fprintf(stderr, "biquad filters differ from their model in %u samples\n", mismatches);
+            return 1;
+        }
+
+        std::string json = "{\"platform\": \"host\", \"unit\": \"ns\", \"compiler\": \"" __VERSION__ "\", \"benchmarks\": {";
+        bool first = true;
+        printf("%-26s %10s %10s %10s %10s\n", "benchmark", "median", "min", "mad", "per item");
+        for (int b = 0; b < BENCHMARK_COUNT; b++)
+        {
+            const Benchmark &benchmark = BENCHMARKS[b];
+            if (filter != nullptr && strstr(benchmark.name, filter) == nullptr)
+                continue;
+            benchmark.prepare();
+
+            // enough iterations per sample for the clock, which also warms the caches
+            uint32_t iterations = 1;
+            while (secondsFor(benchmark, iterations) < minSampleSeconds && iterations < (1u << 30))
+                iterations *= 2;
+
+            std::vector<float> perCall(samples);
+            for (int s = 0; s < samples; s++)
+                perCall[s] = secondsFor(benchmark, iterations) * 1e9 / iterations;
+            Summary summary = summarise(perCall.data(), samples);
+            printf("%-26s %10.2f %10.2f %10.2f %10.3f ns\n", benchmark.name, summary.median, summary.min, summary.mad,
+                   summary.median / benchmark.items);
+
+            char member[256];
+            formatResult(member, sizeof(member), benchmark, summary, samples, iterations);
+            json += first ? "" : ", ";
+            json += member;
+            first = false;
+        }
+        json += "}}\n";
+
+        if (jsonPath != nullptr)
+        {
+            FILE *out = fopen(jsonPath, "w");
+            if (out == nullptr)
+            {
+                perror(jsonPath);
+                return 1;
+            }
+            fputs(json.c_str(), out);
+            fclose(out);
+        }
+        return 0;
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    return Bench::run(argc, argv);
+}
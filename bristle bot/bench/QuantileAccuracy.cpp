@@ -0,0 +1,220 @@
+// accuracy of the streaming percentile levels (src/SoundStats.cpp) against the exact
+// percentiles of the same levels. streams of levels shaped like what the bot hears
+// are fed through the P² estimators for L10, L50 and L90 at interval lengths from a
+// few frames to an hour; prints the worst error in dB and in rank (the fraction of
+// levels below the estimate, less the fraction there should be) of each. the last
+// case records synthetic audio and goes through SoundStats::addFrame() the way
+// updateSoundLevel() does. intervals of up to HELD_LEVELS levels are exact; past
+// that P² depends on the order the levels come in, so only the cases whose
+// distribution holds still over the interval are checked: exits 1 if one of those
+// is off by more than MAX_DB_ERROR and MAX_RANK_ERROR both.
+//
+//   make && ./build/quantile_accuracy
+
+#include <SoundStats.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Bench
+{
+
+    static const int FRAME_SAMPLES = 800;          // SAMPLES in SoundMeasurer.cpp
+    static const int LEVELS_PER_FRAME = FRAME_SAMPLES / SoundStats::BLOCK_SAMPLES;
+    static const int TRIALS = 20;                  // runs of every case, the worst is reported
+    static const float MAX_DB_ERROR = 1.0;
+    static const float MAX_RANK_ERROR = 0.03;
+
+    // levels in dB, in the order they arrive
+    typedef std::vector<float> (*Generator)(int count, std::mt19937 &rng);
+
+    // a steady background
+    static std::vector<float> steady(int count, std::mt19937 &rng)
+    {
+        std::normal_distribution<float> normal(-45.0, 3.0);
+        std::vector<float> levels(count);
+        for (float &l : levels)
+            l = normal(rng);
+        return levels;
+    }
+
+    // a quiet room with loud events (voices, a door) that last a few frames each
+    static std::vector<float> events(int count, std::mt19937 &rng)
+    {
+        std::normal_distribution<float> quiet(-62.0, 2.0), loud(-25.0, 5.0);
+        std::uniform_real_distribution<float> uniform(0.0, 1.0);
+        std::vector<float> levels(count);
+        int eventLeft = 0;
+        for (float &l : levels)
+        {
+            if (eventLeft == 0 && uniform(rng) < 0.02f)
+                eventLeft = 5 + (int)(uniform(rng) * 20);
+            if (eventLeft > 0)
+            {
+                eventLeft--;
+                l = loud(rng);
+            }
+            else
+            {
+                l = quiet(rng);
+            }
+        }
+        return levels;
+    }
+
+    // a level that rises through the interval, the distribution keeps changing (not checked)
+    static std::vector<float> drift(int count, std::mt19937 &rng)
+    {
+        std::normal_distribution<float> normal(0.0, 2.0);
+        std::vector<float> levels(count);
+        for (int i = 0; i < count; i++)
+            levels[i] = -70.0f + 40.0f * i / count + normal(rng);
+        return levels;
+    }
+
+    // the same levels sorted, the hardest order for the markers (not checked)
+    static std::vector<float> ascending(int count, std::mt19937 &rng)
+    {
+        std::vector<float> levels = steady(count, rng);
+        std::sort(levels.begin(), levels.end());
+        return levels;
+    }
+
+    // frames of synthetic audio, white noise whose level follows events(), through
+    // SoundStats::addFrame() at a fixed gain. the exact percentiles are taken of the
+    // block levels as addFrame() measures them, so only the estimators are compared.
+    // every frame gives several levels, so the events come in long runs of them and
+    // this is not checked either
+    static std::vector<float> recordedBlocks(int count, std::mt19937 &rng, SoundStats::Summary &summary)
+    {
+        std::normal_distribution<float> normal(0.0, 1.0);
+        const int gain = 40;
+        std::vector<float> frameLevels = events((count + LEVELS_PER_FRAME - 1) / LEVELS_PER_FRAME, rng);
+        std::vector<float> levels;
+        std::vector<int16_t> frame(FRAME_SAMPLES);
+        SoundStats::reset(0);
+        for (float level : frameLevels)
+        {
+            float amplitude = 32768.0f * powf(10.0f, level / 20.0f);
+            for (int16_t &s : frame)
+                s = (int16_t)std::max(-32768L, std::min(32767L, lroundf(normal(rng) * amplitude)));
+            SoundStats::addFrame(frame.data(), FRAME_SAMPLES, gain);
+            for (int b = 0; b < LEVELS_PER_FRAME; b++)
+            {
+                double sum = 0.0;
+                for (int i = 0; i < SoundStats::BLOCK_SAMPLES; i++)
+                {
+                    double s = frame[b * SoundStats::BLOCK_SAMPLES + i];
+                    sum += s * s;
+                }
+                float rms = std::max(0.5f, (float)sqrt(sum / SoundStats::BLOCK_SAMPLES));
+                levels.push_back(20.0f * log10f(rms / 32768.0f));
+            }
+        }
+        summary = SoundStats::current();
+        return levels;
+    }
+
+    // exact quantile, interpolated between ranks as SoundStats does for the held levels
+    static float exact(std::vector<float> sorted, float p)
+    {
+        float rank = p * (sorted.size() - 1);
+        size_t below = (size_t)rank;
+        if (below + 1 >= sorted.size())
+            return sorted[below];
+        return sorted[below] + (rank - below) * (sorted[below + 1] - sorted[below]);
+    }
+
+    // fraction of the levels below value
+    static float rankOf(const std::vector<float> &sorted, float value)
+    {
+        return (float)(std::lower_bound(sorted.begin(), sorted.end(), value) - sorted.begin()) / sorted.size();
+    }
+
+    struct Error
+    {
+        float db = 0.0;
+        float rank = 0.0;
+    };
+
+    static void score(const std::vector<float> &levels, const float estimates[3], Error errors[3])
+    {
+        static const float P[3] = {0.9f, 0.5f, 0.1f};
+        std::vector<float> sorted = levels;
+        std::sort(sorted.begin(), sorted.end());
+        for (int q = 0; q < 3; q++)
+        {
+            errors[q].db = std::max(errors[q].db, fabsf(estimates[q] - exact(sorted, P[q])));
+            // within the spread of values equal to the estimate the rank is ambiguous,
+            // take the nearest
+            float rank = rankOf(sorted, estimates[q]);
+            float upper = (float)(std::upper_bound(sorted.begin(), sorted.end(), estimates[q]) - sorted.begin()) / sorted.size();
+            float error = P[q] < rank ? rank - P[q] : (P[q] > upper ? P[q] - upper : 0.0f);
+            errors[q].rank = std::max(errors[q].rank, error);
+        }
+    }
+
+    static int run()
+    {
+        const int counts[] = {10, 50, 150, 1500, 18000, 90000};
+        struct Case
+        {
+            const char *name;
+            Generator generator;
+            bool checked;
+        };
+        const Case cases[] = {{"steady", steady, true}, {"events", events, true}, {"drift", drift, false},
+                              {"ascending", ascending, false}, {"recorded", nullptr, false}};
+
+        std::mt19937 rng(5);
+        bool ok = true;
+        printf("worst of %d runs, %d levels is a minute at the default sampleMillis\n", TRIALS, 30 * LEVELS_PER_FRAME);
+        printf("%-10s %7s | %-17s | %-17s | %-17s\n", "levels", "count", "L10 dB / rank", "L50 dB / rank", "L90 dB / rank");
+        for (const Case &c : cases)
+        {
+            for (int count : counts)
+            {
+                Error errors[3];
+                for (int t = 0; t < TRIALS; t++)
+                {
+                    std::vector<float> levels;
+                    SoundStats::Summary summary;
+                    if (c.generator != nullptr)
+                    {
+                        levels = c.generator(count, rng);
+                        SoundStats::reset(0);
+                        for (float l : levels)
+                            SoundStats::addLevel(l);
+                        summary = SoundStats::current();
+                    }
+                    else
+                    {
+                        levels = recordedBlocks(count, rng, summary);
+                    }
+                    const float estimates[3] = {summary.l10, summary.l50, summary.l90};
+                    score(levels, estimates, errors);
+                }
+
+                bool good = true;
+                for (const Error &e : errors)
+                    good = good && (e.db <= MAX_DB_ERROR || e.rank <= MAX_RANK_ERROR);
+                ok = ok && (good || !c.checked);
+                printf("%-10s %7d | %7.2f / %6.3f | %7.2f / %6.3f | %7.2f / %6.3f %s\n", c.name, count, errors[0].db,
+                       errors[0].rank, errors[1].db, errors[1].rank, errors[2].db, errors[2].rank,
+                       !c.checked ? "" : (good ? "ok" : "FAIL"));
+            }
+        }
+        printf("%s: steady and events within %.1f dB or %.2f in rank\n", ok ? "ok" : "FAIL", MAX_DB_ERROR, MAX_RANK_ERROR);
+        return ok ? 0 : 1;
+    }
+
+}
+
+int main()
+{
+    return Bench::run();
+}
@@ -0,0 +1,258 @@
+// dynamic range of the sound measurement with and without the automatic gain
+// control (src/SoundGain.cpp). a clip is played at levels from far below the mic's
+// noise to above full scale; every level is measured over a run of measurements
+// the way updateSoundLevel() takes them, recorded through a model of the PDM (gain,
+// mic self noise, 16 bit rounding and saturation). prints the level error, the gain
+// the AGC settles on and how long it takes, and whether the telemetry sound byte is
+// pinned at either end, next to a fixed default gain with the old amplitude byte.
+//
+//   make && ./build/sound_range
+//   ./build/sound_range --clip tone|noise|clicks
+//   ./build/sound_range --wav recording.wav   (16 bit mono)
+
+#include <SoundGain.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Bench
+{
+
+    static const int FRAME_SAMPLES = 800;     // SAMPLES in SoundMeasurer.cpp
+    static const float SAMPLE_RATE = 16000.0;
+    static const int MEASUREMENTS = 40;       // per level, one every sampleMillis on the bot
+    static const int SCORED = 10;             // the last ones are scored
+    static const int MAX_REMEASURES = 2;      // as in SoundMeasurer.cpp
+    static const float SELF_NOISE_DB = -95.0; // mic noise floor, re full scale at unity gain
+    static const float GOOD_DB = 1.0;         // a level is measured well within this
+
+    // the clip, normalised to unit rms
+    static std::vector<float> clip;
+
+    static void normalise(std::vector<float> &samples)
+    {
+        double sum = 0.0;
+        for (float s : samples)
+            sum += (double)s * s;
+        float scale = 1.0f / sqrtf(sum / samples.size());
+        for (float &s : samples)
+            s *= scale;
+    }
+
+    static bool makeClip(const std::string &kind, std::mt19937 &rng)
+    {
+        std::normal_distribution<float> normal(0.0, 1.0);
+        clip.resize(SAMPLE_RATE * 4);
+        for (size_t i = 0; i < clip.size(); i++)
+        {
+            float t = i / SAMPLE_RATE;
+            if (kind == "tone")
+                clip[i] = sinf(2.0f * (float)M_PI * 1000.0f * t);
+            else if (kind == "noise")
+                clip[i] = normal(rng);
+            else if (kind == "clicks")
+                // a quiet hum with a sharp click every 25 ms, a crest factor of about 20 dB
+                clip[i] = 0.05f * sinf(2.0f * (float)M_PI * 120.0f * t) + ((i % 400) < 4 ? 1.0f : 0.0f);
+            else
+                return false;
+        }
+        normalise(clip);
+        return true;
+    }
+
+    static bool readWav(const char *path)
+    {
+        FILE *in = fopen(path, "rb");
+        if (in == nullptr)
+        {
+            perror(path);
+            return false;
+        }
+        std::vector<uint8_t> data;
+        uint8_t buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+            data.insert(data.end(), buffer, buffer + n);
+        fclose(in);
+
+        // walk the RIFF chunks for the format and the samples
+        uint16_t format = 0, channels = 0, bits = 0;
+        size_t pos = 12;
+        while (data.size() >= 12 && pos + 8 <= data.size())
+        {
+            uint32_t size;
+            memcpy(&size, &data[pos + 4], 4);
+            if (memcmp(&data[pos], "fmt ", 4) == 0 && pos + 24 <= data.size())
+            {
+                memcpy(&format, &data[pos + 8], 2);
+                memcpy(&channels, &data[pos + 10], 2);
+                memcpy(&bits, &data[pos + 22], 2);
+            }
+            else if (memcmp(&data[pos], "data", 4) == 0)
+            {
+                if (format != 1 || channels != 1 || bits != 16)
+                {
+                    fprintf(stderr, "%s: only 16 bit mono PCM is read\n", path);
+                    return false;
+                }
+                size_t count = std::min<size_t>(size, data.size() - pos - 8) / 2;
+                clip.resize(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    int16_t s;
+                    memcpy(&s, &data[pos + 8 + i * 2], 2);
+                    clip[i] = s;
+                }
+                if (count < FRAME_SAMPLES)
+                    break;
+                normalise(clip);
+                return true;
+            }
+            pos += 8 + size + (size & 1);
+        }
+        fprintf(stderr, "%s: no samples found\n", path);
+        return false;
+    }
+
+    // one frame of the clip at level dB, as the PDM records it at gain
+    static void record(float level, int gain, size_t &position, std::mt19937 &rng, int16_t *out)
+    {
+        std::normal_distribution<float> normal(0.0, 1.0);
+        float fullScale = 32768.0f * powf(10.0f, (gain - SoundGain::UNITY_GAIN) / 40.0f);
+        float amplitude = powf(10.0f, level / 20.0f);
+        float noise = powf(10.0f, SELF_NOISE_DB / 20.0f);
+        for (int i = 0; i < FRAME_SAMPLES; i++)
+        {
+            float x = clip[position] * amplitude + normal(rng) * noise;
+            position = (position + 1) % clip.size();
+            long s = lroundf(x * fullScale);
+            out[i] = (int16_t)std::max(-32768L, std::min(32767L, s));
+        }
+    }
+
+    struct Result
+    {
+        float error = 0.0;   // mean absolute level error of the scored measurements (dB)
+        int gain = 0;        // gain of the last measurement
+        int settled = 0;     // measurements until the gain stopped changing
+        int clipped = 0;     // scored measurements that clipped
+        int byteLow = 0;     // scored measurements with the sound byte at its bottom
+        int byteHigh = 0;    // and at 255
+    };
+
+    // a run of measurements as updateSoundLevel() takes them
+    static Result run(float level, bool automatic, std::mt19937 &rng)
+    {
+        Result result;
+        SoundGain::reset();
+        size_t position = 0;
+        int16_t frame[FRAME_SAMPLES];
+        int lastChange = 0;
+        for (int m = 0; m < MEASUREMENTS; m++)
+        {
+            SoundGain::Frame stats;
+            int gain;
+            for (int attempt = 0; ; attempt++)
+            {
+                gain = automatic ? SoundGain::gain() : SoundGain::DEFAULT_GAIN;
+                record(level, gain, position, rng, frame);
+                stats = SoundGain::measure(frame, FRAME_SAMPLES);
+                if (automatic && SoundGain::update(stats))
+                    lastChange = m + 1;
+                if (!stats.clipped || !automatic || SoundGain::gain() == gain || attempt == MAX_REMEASURES)
+                    break;
+                // the two frames recorded around the gain change are dropped
+                position = (position + 2 * FRAME_SAMPLES) % clip.size();
+            }
+
+            if (m >= MEASUREMENTS - SCORED)
+            {
+                float db = SoundGain::levelDb(stats, gain);
+                result.error += fabsf(db - level) / SCORED;
+                result.clipped += stats.clipped;
+                if (automatic)
+                {
+                    // the byte sent now
+                    result.byteLow += SoundGain::levelByte(db) == 0;
+                    result.byteHigh += SoundGain::levelByte(db) == 255;
+                }
+                else
+                {
+                    // the byte sent before: the mean amplitude at the default gain
+                    result.byteLow += stats.mean < 1.5f;
+                    result.byteHigh += stats.mean >= 254.5f;
+                }
+            }
+            result.gain = gain;
+        }
+        result.settled = lastChange;
+        return result;
+    }
+
+    static int run(int argc, char **argv)
+    {
+        std::mt19937 rng(3);
+        std::string kind = "noise";
+        const char *wavPath = nullptr;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--clip" && i + 1 < argc)
+                kind = argv[++i];
+            else if (arg == "--wav" && i + 1 < argc)
+                wavPath = argv[++i];
+            else
+            {
+                fprintf(stderr, "usage: %s [--clip tone|noise|clicks] [--wav FILE]\n", argv[0]);
+                return 2;
+            }
+        }
+        if (wavPath != nullptr ? !readWav(wavPath) : !makeClip(kind, rng))
+        {
+            if (wavPath == nullptr)
+                fprintf(stderr, "unknown clip %s\n", kind.c_str());
+            return 1;
+        }
+
+        printf("clip: %s, levels in dB re full scale at unity gain, errors over the last %d of %d measurements\n",
+               wavPath != nullptr ? wavPath : kind.c_str(), SCORED, MEASUREMENTS);
+        printf("%6s | %-36s | %s\n", "", "automatic gain, dB byte", "fixed gain 20, amplitude byte");
+        printf("%6s | %8s %5s %7s %5s %7s | %8s %5s %7s\n", "level", "error", "gain", "settled", "clip", "byte",
+               "error", "clip", "byte");
+
+        float agcLow = NAN, agcHigh = NAN, fixedLow = NAN, fixedHigh = NAN;
+        for (int level = -100; level <= 10; level += 5)
+        {
+            Result agc = run(level, true, rng);
+            Result fixed = run(level, false, rng);
+            auto byteState = [](const Result &r)
+            {
+                return r.byteHigh ? "top" : (r.byteLow ? "bottom" : "ok");
+            };
+            printf("%6d | %8.2f %5d %7d %5d %7s | %8.2f %5d %7s\n", level, agc.error, agc.gain, agc.settled, agc.clipped,
+                   byteState(agc), fixed.error, fixed.clipped, byteState(fixed));
+
+            if (agc.error < GOOD_DB && std::isnan(agcLow))
+                agcLow = level;
+            if (agc.error < GOOD_DB)
+                agcHigh = level;
+            if (fixed.error < GOOD_DB && std::isnan(fixedLow))
+                fixedLow = level;
+            if (fixed.error < GOOD_DB)
+                fixedHigh = level;
+        }
+        printf("within %.0f dB: automatic gain %.0f to %.0f dB (%.0f dB range), fixed gain %.0f to %.0f dB (%.0f dB range)\n",
+               GOOD_DB, agcLow, agcHigh, agcHigh - agcLow, fixedLow, fixedHigh, fixedHigh - fixedLow);
+        return 0;
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    return Bench::run(argc, argv);
+}
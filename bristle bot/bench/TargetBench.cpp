@@ -0,0 +1,72 @@
+// benchmark firmware: replaces main.cpp in the bench environment of platformio.ini.
+// runs every benchmark in Benchmarks.cpp on the board, timing each sample with the
+// DWT cycle counter, and prints the results as one json line (and a table) over
+// serial. send 'r' to run them again.
+//
+//   pio run -e xiaoblesense_bench -t upload
+//   python tools/bench_compare.py --port /dev/ttyACM0 bench/baselines/nrf52840.json
+//
+// (with --save the first time, to record the board's baseline)
+
+#include <Arduino.h>
+#include <Profiler.h>
+
+#include "Benchmarks.h"
+
+static const int SAMPLES = 31;
+static const uint32_t ITERATIONS = 64; // calls per sample
+
+static void runBenchmarks()
+{
+    static float cycles[SAMPLES];
+    char line[256];
+
+    // the DSP instructions have to give the same samples as the plain C model
+    uint32_t mismatches = Bench::checkBiquads();
+    Serial.print("biquad check: ");
+    Serial.println(mismatches == 0 ? "bit exact" : "MISMATCH");
+
+    Serial.println("{\"platform\": \"nrf52840\", \"unit\": \"cycles\", \"benchmarks\": {");
+    for (int b = 0; b < Bench::BENCHMARK_COUNT; b++)
+    {
+        const Bench::Benchmark &benchmark = Bench::BENCHMARKS[b];
+        benchmark.prepare();
+        benchmark.run(); // warm the cache
+
+        for (int s = 0; s < SAMPLES; s++)
+        {
+            noInterrupts();
+            uint32_t start = Profiler::cycles();
+            for (uint32_t i = 0; i < ITERATIONS; i++)
+                benchmark.run();
+            uint32_t elapsed = Profiler::cycles() - start;
+            interrupts();
+            cycles[s] = (float)elapsed / ITERATIONS;
+        }
+        Bench::Summary summary = Bench::summarise(cycles, SAMPLES);
+        Bench::formatResult(line, sizeof(line), benchmark, summary, SAMPLES, ITERATIONS);
+        Serial.print(line);
+        Serial.println(b + 1 < Bench::BENCHMARK_COUNT ? "," : "");
+    }
+    Serial.println("}}");
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    while (!Serial)
+    {
+        delay(10);
+    }
+    Profiler::begin();
+    runBenchmarks();
+}
+
+void loop()
+{
+    if (Serial.available() > 0 && Serial.read() == 'r')
+    {
+        runBenchmarks();
+    }
+    delay(10);
+}
@@ -15,8 +15,15 @@ MicClass::MicClass(mic_config_t *mic_config)
       break;   
   }
 
-  buf_0 = new uint16_t[_buf_size];
-  buf_1 = new uint16_t[_buf_size];
+  // buf_0 and buf_1 are the first two buffers of the pool, the double buffer
+  // of the drivers that do not use the pool
+  for (uint8_t i = 0; i < POOL_SIZE; i++) {
+    _pool[i] = new uint16_t[_buf_size];
+    _slot_state[i] = SLOT_FREE;
+  }
+  buf_0 = _pool[0];
+  buf_1 = _pool[1];
+  _instance = this;
 
   _buf_count_ptr = &_buf_count;
   _buf_size_ptr = &_buf_size; 
@@ -32,8 +39,9 @@ MicClass::MicClass(mic_config_t *mic_config)
 
 MicClass::~MicClass()
 {
-  delete buf_0;
-  delete buf_1;
+  for (uint8_t i = 0; i < POOL_SIZE; i++) {
+    delete[] _pool[i];
+  }
 }
 
 uint8_t MicClass::begin()
@@ -59,28 +67,119 @@ void MicClass::pause()
 
 int MicClass::available()
 {
-  pause();
+  return _ready_count;
+}
 
-  uint8_t buf_count = _buf_count;
+// called with interrupts disabled
+int8_t MicClass::pop_ready()
+{
+  if (_ready_count == 0) {
+    return -1;
+  }
+  int8_t slot = _ready[_ready_head];
+  _ready_head = (_ready_head + 1) % POOL_SIZE;
+  _ready_count--;
+  return slot;
+}
 
-  resume();
+bool MicClass::borrow(mic_frame_t &frame, uint32_t timeout_ms)
+{
+  uint32_t start = millis();
+  while (true) {
+    noInterrupts();
+    int8_t slot = pop_ready();
+    if (slot >= 0) {
+      _slot_state[slot] = SLOT_LENT;
+    }
+    interrupts();
+
+    if (slot >= 0) {
+      frame.samples = (const int16_t *)_pool[slot];
+      frame.count = _slot_samples[slot];
+      frame.sequence = _slot_sequence[slot];
+      frame.slot = slot;
+      return true;
+    }
+    if (millis() - start >= timeout_ms) {
+      frame.samples = NULL;
+      frame.count = 0;
+      frame.slot = -1;
+      return false;
+    }
+    delay(1);
+  }
+}
 
-  return buf_count;
+void MicClass::release(mic_frame_t &frame)
+{
+  if (frame.slot < 0) {
+    return;
+  }
+  _slot_state[frame.slot] = SLOT_FREE;
+  frame.slot = -1;
+  frame.samples = NULL;
+  frame.count = 0;
 }
 
-int MicClass::read(void* buffer, uint8_t buf_count, size_t size)
+int MicClass::read(int16_t *buffer, uint32_t count, uint32_t timeout_ms)
 {
-  pause();
+  mic_frame_t frame;
+  if (!borrow(frame, timeout_ms)) {
+    return 0;
+  }
+  if (count > frame.count) {
+    count = frame.count;
+  }
+  memcpy(buffer, frame.samples, count * sizeof(int16_t));
+  release(frame);
+  return count;
+}
 
-  if (buf_count) {
-    memcpy(buffer, buf_1, size);
-  } else {
-    memcpy(buffer, buf_0, size);
+void MicClass::flush()
+{
+  noInterrupts();
+  int8_t slot;
+  while ((slot = pop_ready()) >= 0) {
+    _slot_state[slot] = SLOT_FREE;
   }
+  interrupts();
+}
 
-  resume();
+int8_t MicClass::claim_buffer()
+{
+  for (uint8_t i = 0; i < POOL_SIZE; i++) {
+    if (_slot_state[i] == SLOT_FREE) {
+      _slot_state[i] = SLOT_FILLING;
+      return i;
+    }
+  }
+  // nothing free, the reader is behind: record over the oldest frame
+  int8_t slot = pop_ready();
+  if (slot >= 0) {
+    _overruns++;
+    _slot_state[slot] = SLOT_FILLING;
+  }
+  return slot;
+}
 
-  return -1;
+void MicClass::publish_buffer(int8_t slot, uint32_t samples)
+{
+  uint32_t sequence = _sequence++;
+  if (_discard > 0) {
+    _discard--;
+    _slot_state[slot] = SLOT_FREE;
+    return;
+  }
+  if (_onReceive) {
+    _onReceive(_pool[slot], samples);
+    _slot_state[slot] = SLOT_FREE;
+    return;
+  }
+  _slot_samples[slot] = samples;
+  _slot_sequence[slot] = sequence;
+  _slot_state[slot] = SLOT_READY;
+  _ready[(_ready_head + _ready_count) % POOL_SIZE] = slot;
+  _ready_count++;
 }
 
 void MicClass::set_callback(void(*function)(uint16_t *buf, uint32_t buf_len))
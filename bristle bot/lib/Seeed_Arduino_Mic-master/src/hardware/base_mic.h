@@ -16,6 +16,28 @@ typedef struct {
 } mic_config_t;
 
 
+/**
+ * @brief Borrowed view of one recorded frame
+ *
+ * Points into the driver's buffer pool, so the samples stay valid until
+ * the frame is handed back with MicClass::release(). Can be iterated
+ * like a std::span.
+ */
+
+typedef struct {
+    const int16_t *samples;
+    uint32_t count;
+    uint32_t sequence;  // frames recorded before this one
+    int8_t slot;
+
+    const int16_t *data() const { return samples; }
+    uint32_t size() const { return count; }
+    const int16_t *begin() const { return samples; }
+    const int16_t *end() const { return samples + count; }
+    int16_t operator[](uint32_t i) const { return samples[i]; }
+} mic_frame_t;
+
+
 /**
  * @brief Initialize the mic config and recording buffers
  *
@@ -73,22 +95,51 @@ public:
   void set_callback(void(*function)(uint16_t *buf, uint32_t buf_len));
 
 /**
- * NOT IMPLEMENTED. Blocking method for getting number of bytes in
- * ADC buffer.
+ * Number of recorded frames waiting to be read. Only counts frames while
+ * no callback is set, with a callback every frame goes to the callback.
  * 
- * @return num of bytes in ADC buffer
+ * @return num of frames ready
  *
  */
   virtual int available();
 
  /**
- * NOT IMPLEMENTED. Blocking method for reading number of bytes from
- * ADC buffer.
+ * Copies the oldest recorded frame into buffer and hands it back to the
+ * pool. Waits up to timeout_ms for one if none is ready, 0 does not wait.
+ * 
+ * @return num of samples copied, 0 if no frame arrived in time
+ *
+ */ 
+  virtual int read(int16_t *buffer, uint32_t count, uint32_t timeout_ms = 0);
+
+ /**
+ * Lends out the oldest recorded frame without copying it. Waits up to
+ * timeout_ms like read(). The frame has to be given back with release(),
+ * until then the driver records into the other buffers of the pool.
  * 
- * @return data from ADC buffer
+ * @return true if frame was filled in
  *
  */ 
-  virtual int read(void* buffer, uint8_t buf_count, size_t size);
+  bool borrow(mic_frame_t &frame, uint32_t timeout_ms = 0);
+
+ /**
+ * Hands a borrowed frame back to the pool.
+ */ 
+  void release(mic_frame_t &frame);
+
+ /**
+ * Drops every recorded frame that has not been read yet.
+ */ 
+  void flush();
+
+ /**
+ * Frames dropped because they were not read before the pool ran out.
+ */ 
+  uint32_t overruns() const { return _overruns; }
+
+  // frames are recorded into a pool of buffers: two for the hardware to fill
+  // (one being filled, one queued), the rest for frames waiting to be read
+  static const uint8_t POOL_SIZE = 4;
 
   uint16_t *buf_0;    // ADC results array 0
   uint16_t *buf_1;    // ADC results array 1
@@ -100,6 +151,20 @@ public:
   inline static uint8_t *_debug_pin_ptr = NULL;
 
   inline static void (*_onReceive)(uint16_t *buf, uint32_t buf_len) = NULL;
+  inline static MicClass *_instance = NULL;
+
+  // interrupt side of the pool, for drivers that record into it
+
+  // takes a buffer for the hardware to fill next, the oldest unread frame if
+  // none is free. -1 when every buffer is lent out or being filled
+  int8_t claim_buffer();
+  // a buffer has been filled with samples, gives it to the callback if one is
+  // set (and straight back to the pool) or queues it to be read
+  void publish_buffer(int8_t slot, uint32_t samples);
+  // the next count buffers are returned to the pool unread
+  void discard_buffers(uint8_t count) { _discard = count; }
+
+  uint16_t *pool_buffer(int8_t slot) { return _pool[slot]; }
 
 protected:
   uint8_t _channel_cnt = 1;
@@ -109,6 +174,20 @@ protected:
   uint32_t _sampling_rate;
   uint32_t _buf_size;  
 private:
+  enum { SLOT_FREE, SLOT_FILLING, SLOT_READY, SLOT_LENT };
+
+  uint16_t *_pool[POOL_SIZE];
+  volatile uint8_t _slot_state[POOL_SIZE];
+  volatile uint32_t _slot_samples[POOL_SIZE];
+  volatile uint32_t _slot_sequence[POOL_SIZE];
+  volatile uint8_t _ready[POOL_SIZE];  // unread frames, oldest first
+  volatile uint8_t _ready_head = 0;
+  volatile uint8_t _ready_count = 0;
+  volatile uint8_t _discard = 0;
+  volatile uint32_t _sequence = 0;
+  volatile uint32_t _overruns = 0;
+
+  int8_t pop_ready();
 
 };
 
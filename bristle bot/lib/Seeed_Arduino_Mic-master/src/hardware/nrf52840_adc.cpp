@@ -86,6 +86,11 @@ uint8_t NRF52840_ADC_Class::begin()
   NVIC_ClearPendingIRQ(PDM_IRQn);
   NVIC_EnableIRQ(PDM_IRQn);
   
+  // the first buffer, the interrupt queues the next one each time the PDM starts on one
+  _filling = -1;
+  _next = claim_buffer();
+  nrf_pdm_buffer_set((uint32_t*)pool_buffer(_next), _buf_size / 2);
+
   // enable and trigger start task
   nrf_pdm_enable();
   nrf_pdm_event_clear(NRF_PDM_EVENT_STARTED);
@@ -122,6 +127,11 @@ void NRF52840_ADC_Class::pause()
 
 void NRF52840_ADC_Class::resume()
 {
+    // the PDM kept recording while paused, over and over into the queued buffer,
+    // so the next two frames to complete are stale or torn. the unread frames
+    // from before the pause are dropped too
+    flush();
+    discard_buffers(2);
     NVIC_EnableIRQ(PDM_IRQn);
 }
 
@@ -141,31 +151,30 @@ if (nrf_pdm_event_check(NRF_PDM_EVENT_STARTED)) {
     if (*NRF52840_ADC_Class::_debug_pin_ptr) 
         digitalWrite(*NRF52840_ADC_Class::_debug_pin_ptr, HIGH);
 
-    // switch to fill
+    // the PDM has latched the queued buffer, so the one it was filling is complete
 	/*
 		Why use the _buf_size_ptr / 2 not only _buf_size_ptr ?
 		Because, we alloc the data buf use the uint16_t.But everytime the PDM
 		take sample,it will use 32 bits space in the data buf.So we need the /2.
 		Actually sizeof(uint32_t) / sizeof(uint16_t) = 2.
 	*/
-    if (*NRF52840_ADC_Class::_buf_count_ptr) {
-        nrf_pdm_buffer_set((uint32_t*)(NRF52840_ADC_Class::buf_0_ptr), *NRF52840_ADC_Class::_buf_size_ptr / 2);
-        if(NRF52840_ADC_Class::_onReceive){
-            NVIC_DisableIRQ(PDM_IRQn);
-            NRF52840_ADC_Class::_onReceive(NRF52840_ADC_Class::buf_1_ptr, *NRF52840_ADC_Class::_buf_size_ptr / 2);
-            NVIC_EnableIRQ(PDM_IRQn);
-        }
-    } else {
-        nrf_pdm_buffer_set((uint32_t*)(NRF52840_ADC_Class::buf_1_ptr), *NRF52840_ADC_Class::_buf_size_ptr / 2);
-        if(NRF52840_ADC_Class::_onReceive){
-            NVIC_DisableIRQ(PDM_IRQn);
-            NRF52840_ADC_Class::_onReceive(NRF52840_ADC_Class::buf_0_ptr, *NRF52840_ADC_Class::_buf_size_ptr / 2);
-            NVIC_EnableIRQ(PDM_IRQn);
-        }
+    MicClass *mic = NRF52840_ADC_Class::_instance;
+    uint32_t samples = *NRF52840_ADC_Class::_buf_size_ptr / 2;
+    int8_t completed = NRF52840_ADC_Class::_filling;
+    NRF52840_ADC_Class::_filling = NRF52840_ADC_Class::_next;
+
+    int8_t next = mic->claim_buffer();
+    if (next < 0) {
+        // every other buffer is lent out, record over the completed frame
+        next = completed >= 0 ? completed : NRF52840_ADC_Class::_filling;
+        completed = -1;
     }
+    NRF52840_ADC_Class::_next = next;
+    nrf_pdm_buffer_set((uint32_t*)mic->pool_buffer(next), samples);
 
-    // Flip to next buffer
-    *NRF52840_ADC_Class::_buf_count_ptr = (*NRF52840_ADC_Class::_buf_count_ptr + 1) % 2;
+    if (completed >= 0) {
+        mic->publish_buffer(completed, samples);
+    }
 
     // Debug: make pin low after copying buffer
     if (*NRF52840_ADC_Class::_debug_pin_ptr) 
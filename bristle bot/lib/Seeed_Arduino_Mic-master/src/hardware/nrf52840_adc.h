@@ -19,6 +19,10 @@ public:
     //NANO 33 BLE SENSe min 0 max 80
     void setGain(int gain);
 
+    // pool buffers held by the PDM: the one it is filling and the one queued after it
+    inline static int8_t _filling = -1;
+    inline static int8_t _next = -1;
+
 private:
     int _dinPin;
     int _clkPin;
@@ -0,0 +1,213 @@
+#include "biquad.h"
+
+#include <math.h>
+
+#if defined(__ARM_FEATURE_DSP)
+
+// acc + a.lo * b.lo + a.hi * b.hi, the 16 bit halves signed (CMSIS __SMLALD)
+static inline int64_t smlald(uint32_t a, uint32_t b, int64_t acc)
+{
+  uint32_t lo = (uint32_t)acc;
+  uint32_t hi = (uint32_t)((uint64_t)acc >> 32);
+  __asm__ ("smlald %0, %1, %2, %3" : "+r"(lo), "+r"(hi) : "r"(a), "r"(b));
+  return (int64_t)(((uint64_t)hi << 32) | lo);
+}
+
+static inline int32_t ssat16(int32_t v)
+{
+  int32_t r;
+  __asm__ ("ssat %0, #16, %1" : "=r"(r) : "r"(v));
+  return r;
+}
+
+#else
+
+static inline int64_t smlald(uint32_t a, uint32_t b, int64_t acc)
+{
+  return acc + (int32_t)(int16_t)a * (int16_t)b + (int32_t)(int16_t)(a >> 16) * (int16_t)(b >> 16);
+}
+
+static inline int32_t ssat16(int32_t v)
+{
+  return v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+}
+
+#endif
+
+static inline uint32_t pack(int16_t lo, int16_t hi)
+{
+  return (uint16_t)lo | ((uint32_t)(uint16_t)hi << 16);
+}
+
+// digital section from the analog one (bs0 s^2 + bs1 s + bs2) / (as0 s^2 + as1 s + as2)
+// by the bilinear transform s = k (1 - z^-1) / (1 + z^-1), normalised so a0 = 1
+static void bilinear(const float bs[3], const float as[3], float k, float b[3], float a[2])
+{
+  float k2 = k * k;
+  float a0 = as[0] * k2 + as[1] * k + as[2];
+  b[0] = (bs[0] * k2 + bs[1] * k + bs[2]) / a0;
+  b[1] = (2.0f * bs[2] - 2.0f * bs[0] * k2) / a0;
+  b[2] = (bs[0] * k2 - bs[1] * k + bs[2]) / a0;
+  a[0] = (2.0f * as[2] - 2.0f * as[0] * k2) / a0;
+  a[1] = (as[0] * k2 - as[1] * k + as[2]) / a0;
+}
+
+// magnitude of a section at w radians per sample
+static float gainAt(const float b[3], const float a[2], float w)
+{
+  float c1 = cosf(w), s1 = sinf(w), c2 = cosf(2.0f * w), s2 = sinf(2.0f * w);
+  float nr = b[0] + b[1] * c1 + b[2] * c2, ni = -b[1] * s1 - b[2] * s2;
+  float dr = 1.0f + a[0] * c1 + a[1] * c2, di = -a[0] * s1 - a[1] * s2;
+  return sqrtf((nr * nr + ni * ni) / (dr * dr + di * di));
+}
+
+FilterBiquadQ15::FilterBiquadQ15()
+{
+  _stageCount = 0;
+}
+
+void FilterBiquadQ15::clear()
+{
+  _stageCount = 0;
+}
+
+void FilterBiquadQ15::reset()
+{
+  for (int i = 0; i < _stageCount; i++)
+  {
+    _stages[i].x = 0;
+    _stages[i].y = 0;
+    _stages[i].error = 0;
+  }
+}
+
+bool FilterBiquadQ15::addStage(const float b[3], const float a[2])
+{
+  if (_stageCount >= MAX_STAGES)
+    return false;
+
+  // the smallest post shift that fits every coefficient in 16 bits
+  float largest = 0.0f;
+  for (int i = 0; i < 3; i++)
+    largest = fmaxf(largest, fabsf(b[i]));
+  for (int i = 0; i < 2; i++)
+    largest = fmaxf(largest, fabsf(a[i]));
+  int shift = 0;
+  while (shift < 4 && largest * (float)(1 << (15 - shift)) > 32767.0f)
+    shift++;
+  if (shift == 4)
+    return false;
+
+  float scale = (float)(1 << (15 - shift));
+  int16_t b0 = (int16_t)lrintf(b[0] * scale);
+  int16_t b1 = (int16_t)lrintf(b[1] * scale);
+  int16_t b2 = (int16_t)lrintf(b[2] * scale);
+  // zeros at 0 Hz or at the nyquist frequency stay exactly there after rounding
+  float tolerance = 1e-4f * largest;
+  if (fabsf(b[0] + b[1] + b[2]) < tolerance)
+    b1 = -(b0 + b2);
+  else if (fabsf(b[0] - b[1] + b[2]) < tolerance)
+    b1 = b0 + b2;
+
+  Stage &s = _stages[_stageCount++];
+  s.b0 = b0;
+  s.b1b2 = pack(b1, b2);
+  s.a1a2 = pack((int16_t)lrintf(-a[0] * scale), (int16_t)lrintf(-a[1] * scale));
+  s.postShift = shift;
+  s.x = 0;
+  s.y = 0;
+  s.error = 0;
+  return true;
+}
+
+void FilterBiquadQ15::highPass(float cutoff, float sampleRate)
+{
+  clear();
+  float k = 2.0f * sampleRate;
+  float w = k * tanf((float)M_PI * cutoff / sampleRate); // prewarped
+  const float bs[3] = {1.0f, 0.0f, 0.0f};
+  const float as[3] = {1.0f, (float)M_SQRT2 * w, w * w};
+  float b[3], a[2];
+  bilinear(bs, as, k, b, a);
+  addStage(b, a);
+}
+
+void FilterBiquadQ15::bandPass(float low, float high, float sampleRate)
+{
+  highPass(low, sampleRate);
+  float k = 2.0f * sampleRate;
+  float w = k * tanf((float)M_PI * high / sampleRate);
+  const float bs[3] = {0.0f, 0.0f, w * w};
+  const float as[3] = {1.0f, (float)M_SQRT2 * w, w * w};
+  float b[3], a[2];
+  bilinear(bs, as, k, b, a);
+  addStage(b, a);
+}
+
+void FilterBiquadQ15::aWeighting(float sampleRate)
+{
+  // analog poles (rad/s) of IEC 61672: 20.6 Hz and 12194 Hz double, 107.7 Hz, 737.9 Hz,
+  // and four zeros at 0 Hz. each 20.6 Hz pole shares a section with a higher one: two
+  // of them together sit so close to z = 1 that 16 bit coefficients can not place them
+  const float w1 = 2.0f * (float)M_PI * 20.598997f;
+  const float w2 = 2.0f * (float)M_PI * 107.65265f;
+  const float w3 = 2.0f * (float)M_PI * 737.86223f;
+  const float w4 = 2.0f * (float)M_PI * 12194.217f;
+  const float bs[3][3] = {{1.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, w4 * w4}};
+  const float as[3][3] = {{1.0f, w1 + w2, w1 * w2}, {1.0f, w1 + w3, w1 * w3}, {1.0f, 2.0f * w4, w4 * w4}};
+
+  clear();
+  float k = 2.0f * sampleRate;
+  float w = 2.0f * (float)M_PI * 1000.0f / sampleRate;
+  float b[3][3], a[3][2];
+  float gain = 1.0f;
+  for (int i = 0; i < 3; i++)
+  {
+    bilinear(bs[i], as[i], k, b[i], a[i]);
+    gain *= gainAt(b[i], a[i], w);
+  }
+  // 0 dB at 1 kHz, the correction goes on the last section, whose coefficients are small
+  for (int i = 0; i < 3; i++)
+    b[2][i] /= gain;
+  for (int i = 0; i < 3; i++)
+    addStage(b[i], a[i]);
+}
+
+void FilterBiquadQ15::process(const int16_t *in, int16_t *out, uint32_t count)
+{
+  for (int i = 0; i < _stageCount; i++)
+  {
+    // the state and coefficients stay in registers for the whole block
+    const int32_t b0 = _stages[i].b0;
+    const uint32_t b1b2 = _stages[i].b1b2, a1a2 = _stages[i].a1a2;
+    const int shift = 15 - _stages[i].postShift;
+    uint32_t x = _stages[i].x, y = _stages[i].y;
+    int32_t error = _stages[i].error;
+
+    for (uint32_t n = 0; n < count; n++)
+    {
+      int32_t xn = in[n];
+      // the bits the last output dropped are carried into this one (first order error
+      // feedback), otherwise poles near 0 Hz amplify the truncation into a dc offset
+      int64_t acc = (int64_t)b0 * xn + error;
+      acc = smlald(b1b2, x, acc);
+      acc = smlald(a1a2, y, acc);
+      int32_t q = (int32_t)(acc >> shift);
+      error = (int32_t)(acc - ((int64_t)q << shift));
+      int32_t yn = ssat16(q);
+      x = (x << 16) | (uint16_t)xn;
+      y = (y << 16) | (uint16_t)yn;
+      out[n] = yn;
+    }
+
+    _stages[i].x = x;
+    _stages[i].y = y;
+    _stages[i].error = error;
+    in = out; // the next section filters this one's output in place
+  }
+  if (_stageCount == 0 && in != out)
+  {
+    for (uint32_t n = 0; n < count; n++)
+      out[n] = in[n];
+  }
+}
@@ -0,0 +1,56 @@
+#ifndef BIQUAD_H_INCLUDED
+#define BIQUAD_H_INCLUDED
+
+#include <stdint.h>
+
+// cascade of second order IIR sections over blocks of Q15 samples (direct form I).
+// coefficients are Q15 scaled down by 2^postShift, products are summed in 64 bits and
+// each section's output is shifted back, with the dropped bits fed into the next
+// sample, and saturated to 16 bits. on cores with the DSP extension (Cortex-M4) the
+// feedforward and feedback pairs go through SMLALD, two multiply-accumulates per
+// instruction; elsewhere the same arithmetic is done in plain C, so both give bit
+// identical output.
+class FilterBiquadQ15
+{
+  public:
+    static const int MAX_STAGES = 3;
+
+    FilterBiquadQ15();
+
+    // 2nd order butterworth high-pass
+    void highPass(float cutoff, float sampleRate);
+    // 2nd order butterworth high-pass at low followed by a low-pass at high
+    void bandPass(float low, float high, float sampleRate);
+    // IEC 61672 A-weighting (bilinear transform, 0 dB at 1 kHz). at 16 kHz it follows
+    // the curve to 0.1 dB up to 2 kHz, then falls away towards nyquist (-0.5 dB at 4 kHz)
+    void aWeighting(float sampleRate);
+
+    // one section from float coefficients, y = b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2
+    bool addStage(const float b[3], const float a[2]);
+    void clear();   // removes every section
+    void reset();   // zeroes the state, keeps the sections
+
+    // filters count samples, out may be in
+    void process(const int16_t *in, int16_t *out, uint32_t count);
+
+    int stageCount() const { return _stageCount; }
+
+    struct Stage
+    {
+      int16_t b0;
+      uint32_t b1b2;  // b1 in the low half, b2 in the high half
+      uint32_t a1a2;  // -a1 and -a2, packed the same way
+      uint8_t postShift;
+      uint32_t x;     // x[n-1] low, x[n-2] high
+      uint32_t y;     // y[n-1] low, y[n-2] high
+      int32_t error;  // bits dropped from the last output
+    };
+
+    const Stage &stage(int i) const { return _stages[i]; }
+
+  private:
+    Stage _stages[MAX_STAGES];
+    int _stageCount;
+};
+
+#endif
@@ -0,0 +1,247 @@
+#include "Arduino.h"
+
+#include <fcntl.h>
+#include <random>
+#include <unistd.h>
+
+#include "Sim.h"
+
+NativeSerial Serial;
+
+static FILE *serialOut = stdout;
+static uint64_t serialCount = 0;
+
+static const int NUM_PINS = 64;
+static int pinLevels[NUM_PINS] = {0};
+static bool pinDriven[NUM_PINS] = {false}; // set from the simulation, the pull up no longer applies
+static void (*pinInterrupts[NUM_PINS])() = {nullptr};
+
+static std::mt19937 firmwareRng(1);
+
+unsigned long millis()
+{
+    // every clock read costs a microsecond, so loops polling the clock make progress
+    Sim::advance(1);
+    return Sim::now() / 1000;
+}
+
+unsigned long micros()
+{
+    Sim::advance(1);
+    return Sim::now();
+}
+
+void delay(unsigned long ms)
+{
+    Sim::advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    Sim::advance(us);
+}
+
+void __WFE()
+{
+    // sleep for a millisecond, any event due in that time still runs at its own time
+    Sim::advance(1000);
+}
+
+static bool validPin(int pin)
+{
+    return pin >= 0 && pin < NUM_PINS;
+}
+
+void pinMode(int pin, int mode)
+{
+    if (validPin(pin) && mode == INPUT_PULLUP && !pinDriven[pin])
+        pinLevels[pin] = HIGH;
+}
+
+void digitalWrite(int pin, int value)
+{
+    if (!validPin(pin))
+        return;
+    // the motors act on the world, so it is brought up to now before they change
+    Sim::updateWorld();
+    pinLevels[pin] = value ? HIGH : LOW;
+}
+
+int digitalRead(int pin)
+{
+    return validPin(pin) ? pinLevels[pin] : LOW;
+}
+
+int analogRead(int /* pin */)
+{
+    return 0;
+}
+
+void analogWrite(int pin, int value)
+{
+    digitalWrite(pin, value > 127);
+}
+
+void attachInterrupt(int interrupt, void (*isr)(), int /* mode */)
+{
+    if (validPin(interrupt))
+        pinInterrupts[interrupt] = isr;
+}
+
+void detachInterrupt(int interrupt)
+{
+    if (validPin(interrupt))
+        pinInterrupts[interrupt] = nullptr;
+}
+
+long random(long max)
+{
+    return max <= 0 ? 0 : firmwareRng() % max;
+}
+
+long random(long min, long max)
+{
+    return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed)
+{
+    firmwareRng.seed(seed);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+namespace Sim
+{
+
+    void setSerialOutput(FILE *out)
+    {
+        serialOut = out;
+    }
+
+    uint64_t serialBytes()
+    {
+        return serialCount;
+    }
+
+    int pinLevel(int pin)
+    {
+        return validPin(pin) ? pinLevels[pin] : LOW;
+    }
+
+    void setPinLevel(int pin, int level)
+    {
+        if (!validPin(pin))
+            return;
+        bool rising = pinLevels[pin] == LOW && level == HIGH;
+        pinLevels[pin] = level;
+        pinDriven[pin] = true;
+        if (rising && pinInterrupts[pin] != nullptr)
+            pinInterrupts[pin]();
+    }
+
+}
+
+// ############ Serial #############
+
+// stdin is read without blocking so the console never stalls the firmware
+static void setupStdin()
+{
+    static bool configured = false;
+    if (!configured)
+    {
+        fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+        configured = true;
+    }
+}
+
+int NativeSerial::peek()
+{
+    setupStdin();
+    if (peeked < 0)
+    {
+        uint8_t c;
+        if (::read(STDIN_FILENO, &c, 1) == 1)
+            peeked = c;
+    }
+    return peeked;
+}
+
+int NativeSerial::available()
+{
+    return peek() >= 0 ? 1 : 0;
+}
+
+int NativeSerial::read()
+{
+    int c = peek();
+    peeked = -1;
+    return c;
+}
+
+void NativeSerial::flush()
+{
+    if (serialOut != nullptr)
+        fflush(serialOut);
+}
+
+size_t NativeSerial::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t NativeSerial::write(const uint8_t *buffer, size_t size)
+{
+    serialCount += size;
+    if (serialOut != nullptr)
+        fwrite(buffer, 1, size, serialOut);
+    return size;
+}
+
+size_t NativeSerial::print(long n, int base)
+{
+    if (base != DEC)
+        return print((unsigned long)n, base);
+    char text[24];
+    snprintf(text, sizeof(text), "%ld", n);
+    return write(text);
+}
+
+size_t NativeSerial::print(unsigned long n, int base)
+{
+    char text[24];
+    if (base == HEX)
+    {
+        snprintf(text, sizeof(text), "%lX", n);
+        return write(text);
+    }
+    if (base == OCT)
+    {
+        snprintf(text, sizeof(text), "%lo", n);
+        return write(text);
+    }
+    if (base == BIN)
+    {
+        char digits[65];
+        int i = 64;
+        digits[i] = '\0';
+        do
+        {
+            digits[--i] = '0' + (n & 1);
+            n >>= 1;
+        } while (n != 0);
+        return write(&digits[i]);
+    }
+    snprintf(text, sizeof(text), "%lu", n);
+    return write(text);
+}
+
+size_t NativeSerial::print(double n, int digits)
+{
+    char text[48];
+    snprintf(text, sizeof(text), "%.*f", digits, n);
+    return write(text);
+}
@@ -0,0 +1,403 @@
+#include "ArduinoBLE.h"
+
+#include "Sim.h"
+
+BLELocalDevice BLE;
+
+struct BLECharacteristic::State
+{
+    const char *uuid;
+    uint8_t properties;
+    int valueSize;
+    uint8_t value[64];
+    int valueLength;
+    bool local; // added to a service that was added to BLE
+    bool written;
+    BLECharacteristicEventHandler writtenHandler;
+};
+
+// time between advertisements of each transmitter (us)
+static const uint64_t ADVERT_INTERVAL = 100000;
+
+static const int MAX_CHARACTERISTICS = 16;
+static BLECharacteristic::State characteristics[MAX_CHARACTERISTICS];
+static int characteristicCount = 0;
+
+// writes from the simulation waiting for the next poll()
+static BLECharacteristic::State *pendingWrites[MAX_CHARACTERISTICS];
+static int pendingWriteCount = 0;
+
+// advertising reports waiting for the next poll(), the oldest is dropped when full
+static const int REPORT_QUEUE = 16;
+static BLEDevice reports[REPORT_QUEUE];
+static uint32_t reportHead = 0;
+static uint32_t reportTail = 0;
+static uint32_t reportsReceived = 0;
+
+static bool started = false;
+static bool scanning = false;
+static bool scanDuplicates = false;
+static uint32_t scanSession = 0;
+static int scheduledTransmitters = 0;
+// addresses already reported in this scan (the controller filters duplicates)
+static uint8_t heard[Sim::MAX_TRANSMITTERS][6];
+static int heardCount = 0;
+static BLEDeviceEventHandler discoveredHandler = nullptr;
+
+static Sim::Advert currentAdvert;
+static std::string localName;
+static std::vector<uint8_t> advertisingData;
+static std::vector<uint8_t> scanResponseData;
+
+// ############ Devices and characteristics #############
+
+BLEDevice::BLEDevice(const uint8_t address[6], const char *name, int rssi, const uint8_t *manufacturerData, int manufacturerLength)
+    : valid(true), signal(rssi)
+{
+    memcpy(deviceAddress, address, sizeof(deviceAddress));
+    // truncated to fit, always terminated
+    size_t nameLength = strnlen(name, sizeof(this->name) - 1);
+    memcpy(this->name, name, nameLength);
+    this->name[nameLength] = '\0';
+    this->manufacturerLength = std::min(manufacturerLength, (int)sizeof(manufacturer));
+    memcpy(manufacturer, manufacturerData, this->manufacturerLength);
+}
+
+String BLEDevice::address() const
+{
+    char text[18];
+    snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x",
+             deviceAddress[0], deviceAddress[1], deviceAddress[2], deviceAddress[3], deviceAddress[4], deviceAddress[5]);
+    return String(text);
+}
+
+int BLEDevice::manufacturerData(uint8_t *value, int length) const
+{
+    int n = std::min(length, (int)manufacturerLength);
+    memcpy(value, manufacturer, n);
+    return n;
+}
+
+BLECharacteristic::BLECharacteristic(const char *uuid, uint8_t properties, int valueSize, bool fixedLength)
+{
+    if (characteristicCount >= MAX_CHARACTERISTICS)
+    {
+        fprintf(stderr, "ArduinoBLE shim: more than %d characteristics\n", MAX_CHARACTERISTICS);
+        abort();
+    }
+    state = &characteristics[characteristicCount++];
+    state->uuid = uuid;
+    state->properties = properties;
+    state->valueSize = std::min(valueSize, (int)sizeof(state->value));
+    state->valueLength = fixedLength ? state->valueSize : 0;
+}
+
+const char *BLECharacteristic::uuid() const
+{
+    return state->uuid;
+}
+
+uint8_t BLECharacteristic::properties() const
+{
+    return state->properties;
+}
+
+int BLECharacteristic::valueSize() const
+{
+    return state->valueSize;
+}
+
+int BLECharacteristic::valueLength() const
+{
+    return state->valueLength;
+}
+
+const uint8_t *BLECharacteristic::value() const
+{
+    return state->value;
+}
+
+int BLECharacteristic::readValue(void *value, int length)
+{
+    int n = std::min(length, state->valueLength);
+    memcpy(value, state->value, n);
+    return n;
+}
+
+int BLECharacteristic::writeValue(const uint8_t *value, int length)
+{
+    length = std::min(length, state->valueSize);
+    memcpy(state->value, value, length);
+    state->valueLength = length;
+    return 1;
+}
+
+bool BLECharacteristic::written()
+{
+    bool was = state->written;
+    state->written = false;
+    return was;
+}
+
+void BLECharacteristic::setEventHandler(int event, BLECharacteristicEventHandler handler)
+{
+    if (event == BLEWritten)
+        state->writtenHandler = handler;
+}
+
+void BLEService::addCharacteristic(BLECharacteristic &characteristic)
+{
+    characteristics.push_back(characteristic);
+}
+
+bool BLEAdvertisingData::setLocalName(const char *name)
+{
+    localName = name;
+    return true;
+}
+
+bool BLEAdvertisingData::setManufacturerData(const uint8_t *data, int length)
+{
+    manufacturerData.assign(data, data + length);
+    return true;
+}
+
+bool BLEAdvertisingData::setManufacturerData(uint16_t companyId, const uint8_t *data, int length)
+{
+    manufacturerData = {(uint8_t)(companyId & 0xFF), (uint8_t)(companyId >> 8)};
+    manufacturerData.insert(manufacturerData.end(), data, data + length);
+    return true;
+}
+
+// ############ Local device #############
+
+int BLELocalDevice::begin()
+{
+    started = true;
+    return 1;
+}
+
+void BLELocalDevice::end()
+{
+    started = false;
+    scanning = false;
+    currentAdvert.active = false;
+}
+
+void BLELocalDevice::poll(unsigned long timeout)
+{
+    if (timeout != 0)
+        delay(timeout);
+
+    // events are handled here rather than when they arrive, as in ArduinoBLE
+    for (int i = 0; i < pendingWriteCount; i++)
+    {
+        BLECharacteristic characteristic(pendingWrites[i]);
+        if (pendingWrites[i]->writtenHandler != nullptr)
+            pendingWrites[i]->writtenHandler(BLEDevice(), characteristic);
+    }
+    pendingWriteCount = 0;
+    while (discoveredHandler != nullptr && reportTail != reportHead)
+    {
+        BLEDevice device = reports[reportTail++ % REPORT_QUEUE];
+        discoveredHandler(device);
+    }
+}
+
+static bool alreadyHeard(const uint8_t address[6])
+{
+    for (int i = 0; i < heardCount; i++)
+    {
+        if (memcmp(heard[i], address, 6) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void queueReport(const Sim::Transmitter &transmitter, int rssi)
+{
+    if (reportHead - reportTail >= (uint32_t)REPORT_QUEUE)
+        reportTail++;
+    reports[reportHead++ % REPORT_QUEUE] = BLEDevice(transmitter.address, transmitter.name, rssi,
+                                                     transmitter.manufacturerData, transmitter.manufacturerLength);
+    reportsReceived++;
+}
+
+static void scheduleNewTransmitters();
+
+// each transmitter slot advertises on its own phase for as long as this scan lasts.
+// the slot's transmitter can change between adverts (the swarm moves)
+static void scheduleTransmitter(int i, uint32_t session, uint64_t at)
+{
+    Sim::schedule(at, [i, session]()
+    {
+        if (!scanning || session != scanSession)
+            return;
+        if (i < Sim::transmitterCount())
+        {
+            const Sim::Transmitter &transmitter = Sim::transmitter(i);
+            if (scanDuplicates || !alreadyHeard(transmitter.address))
+            {
+                if (!scanDuplicates && heardCount < Sim::MAX_TRANSMITTERS)
+                    memcpy(heard[heardCount++], transmitter.address, 6);
+                queueReport(transmitter, Sim::receivedRssi(transmitter));
+            }
+        }
+        scheduleTransmitter(i, session, Sim::now() + ADVERT_INTERVAL);
+        scheduleNewTransmitters();
+    });
+}
+
+// schedules adverts for transmitter slots that appeared since the scan started
+static void scheduleNewTransmitters()
+{
+    for (; scheduledTransmitters < Sim::transmitterCount(); scheduledTransmitters++)
+    {
+        scheduleTransmitter(scheduledTransmitters, scanSession, Sim::now() + (uint64_t)(Sim::uniform() * ADVERT_INTERVAL));
+    }
+}
+
+int BLELocalDevice::scan(bool withDuplicates)
+{
+    if (!started)
+        return 0;
+    scanning = true;
+    scanDuplicates = withDuplicates;
+    scanSession++;
+    heardCount = 0;
+    scheduledTransmitters = 0;
+    scheduleNewTransmitters();
+    return 1;
+}
+
+int BLELocalDevice::scanForName(const String & /* name */, bool withDuplicates)
+{
+    return scan(withDuplicates);
+}
+
+void BLELocalDevice::stopScan()
+{
+    scanning = false;
+    reportTail = reportHead;
+}
+
+BLEDevice BLELocalDevice::available()
+{
+    if (reportTail == reportHead)
+        return BLEDevice();
+    return reports[reportTail++ % REPORT_QUEUE];
+}
+
+void BLELocalDevice::setEventHandler(BLEDeviceEvent event, BLEDeviceEventHandler handler)
+{
+    if (event == BLEDiscovered)
+        discoveredHandler = handler;
+}
+
+void BLELocalDevice::setAdvertisingInterval(uint16_t /* interval */)
+{
+}
+
+int BLELocalDevice::setAdvertisingData(BLEAdvertisingData &data)
+{
+    if (!data.localName.empty())
+        localName = data.localName;
+    advertisingData = data.manufacturerData;
+    return 1;
+}
+
+int BLELocalDevice::setScanResponseData(BLEAdvertisingData &data)
+{
+    scanResponseData = data.manufacturerData;
+    return 1;
+}
+
+bool BLELocalDevice::setLocalName(const char *name)
+{
+    localName = name;
+    return true;
+}
+
+bool BLELocalDevice::setManufacturerData(const uint8_t *data, int length)
+{
+    advertisingData.assign(data, data + length);
+    return true;
+}
+
+int BLELocalDevice::advertise()
+{
+    if (!started)
+        return 0;
+    currentAdvert.active = true;
+    currentAdvert.localName = localName;
+    currentAdvert.manufacturerData = advertisingData;
+    currentAdvert.scanResponseData = scanResponseData;
+    return 1;
+}
+
+void BLELocalDevice::stopAdvertise()
+{
+    currentAdvert.active = false;
+}
+
+void BLELocalDevice::addService(BLEService &service)
+{
+    for (BLECharacteristic &characteristic : service.characteristics)
+    {
+        characteristic.state->local = true;
+    }
+}
+
+// ############ Simulation side #############
+
+namespace Sim
+{
+
+    const Advert &advert()
+    {
+        return currentAdvert;
+    }
+
+    static BLECharacteristic::State *findCharacteristic(const char *uuid)
+    {
+        for (int i = 0; i < characteristicCount; i++)
+        {
+            if (characteristics[i].local && strcmp(characteristics[i].uuid, uuid) == 0)
+                return &characteristics[i];
+        }
+        return nullptr;
+    }
+
+    bool writeCharacteristic(const char *uuid, const uint8_t *data, int len)
+    {
+        BLECharacteristic::State *characteristic = findCharacteristic(uuid);
+        if (characteristic == nullptr || len > characteristic->valueSize)
+            return false;
+        memcpy(characteristic->value, data, len);
+        characteristic->valueLength = len;
+        characteristic->written = true;
+        if (pendingWriteCount < MAX_CHARACTERISTICS)
+            pendingWrites[pendingWriteCount++] = characteristic;
+        return true;
+    }
+
+    bool readCharacteristic(const char *uuid, std::vector<uint8_t> &out)
+    {
+        BLECharacteristic::State *characteristic = findCharacteristic(uuid);
+        if (characteristic == nullptr)
+            return false;
+        out.assign(characteristic->value, characteristic->value + characteristic->valueLength);
+        return true;
+    }
+
+    void deliverAdvert(const Transmitter &transmitter, int rssi)
+    {
+        queueReport(transmitter, rssi);
+    }
+
+    uint32_t advertsReceived()
+    {
+        return reportsReceived;
+    }
+
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <string>
+#include <vector>
+
+#include "Sim.h"
+
+// stand-in for ArduinoBLE. scanning hears the beacons in Sim::beacons() (once per
+// scan, as the controller filters duplicates), advertising is recorded in
+// Sim::advert(), and local GATT characteristics can be written from the
+// simulation with Sim::writeCharacteristic().
+
+enum BLEProperty
+{
+    BLEBroadcast = 0x01,
+    BLERead = 0x02,
+    BLEWriteWithoutResponse = 0x04,
+    BLEWrite = 0x08,
+    BLENotify = 0x10,
+    BLEIndicate = 0x20
+};
+
+enum BLEDeviceEvent
+{
+    BLEConnected = 0,
+    BLEDisconnected = 1,
+    BLEDiscovered = 2
+};
+
+enum BLECharacteristicEvent
+{
+    BLESubscribed = 0,
+    BLEUnsubscribed = 1,
+    BLEWritten = 3
+};
+
+class BLEDevice
+{
+public:
+    BLEDevice() {}
+    BLEDevice(const uint8_t address[6], const char *name, int rssi, const uint8_t *manufacturerData, int manufacturerLength);
+
+    explicit operator bool() const { return valid; }
+    String address() const;
+    int rssi() { return signal; }
+    bool hasLocalName() const { return name[0] != '\0'; }
+    String localName() const { return String(name); }
+    bool hasManufacturerData() const { return manufacturerLength != 0; }
+    int manufacturerDataLength() const { return manufacturerLength; }
+    int manufacturerData(uint8_t *value, int length) const;
+    bool connected() const { return false; }
+
+private:
+    bool valid = false;
+    uint8_t deviceAddress[6] = {0};
+    char name[16] = {0};
+    int signal = 0;
+    uint8_t manufacturer[31];
+    uint8_t manufacturerLength = 0;
+};
+
+typedef void (*BLEDeviceEventHandler)(BLEDevice device);
+
+class BLECharacteristic;
+typedef void (*BLECharacteristicEventHandler)(BLEDevice device, BLECharacteristic characteristic);
+
+// copies share the same characteristic, like the handles ArduinoBLE passes to event handlers.
+// the state comes from a fixed pool so static characteristics do not allocate
+class BLECharacteristic
+{
+public:
+    BLECharacteristic(const char *uuid, uint8_t properties, int valueSize, bool fixedLength = false);
+
+    const char *uuid() const;
+    uint8_t properties() const;
+    int valueSize() const;
+    int valueLength() const;
+    const uint8_t *value() const;
+    int readValue(void *value, int length);
+    int writeValue(const uint8_t *value, int length);
+    int writeValue(const char *value) { return writeValue((const uint8_t *)value, strlen(value)); }
+    bool written();
+    void setEventHandler(int event, BLECharacteristicEventHandler handler);
+
+    struct State;
+
+private:
+    explicit BLECharacteristic(State *state) : state(state) {}
+
+    State *state;
+    friend class BLELocalDevice;
+    friend bool Sim::writeCharacteristic(const char *uuid, const uint8_t *data, int len);
+};
+
+class BLEService
+{
+public:
+    BLEService(const char *uuid) : serviceUuid(uuid) {}
+    const char *uuid() const { return serviceUuid; }
+    void addCharacteristic(BLECharacteristic &characteristic);
+
+private:
+    const char *serviceUuid;
+    std::vector<BLECharacteristic> characteristics;
+    friend class BLELocalDevice;
+};
+
+class BLEAdvertisingData
+{
+public:
+    bool setLocalName(const char *name);
+    bool setManufacturerData(const uint8_t *data, int length);
+    bool setManufacturerData(uint16_t companyId, const uint8_t *data, int length);
+    bool setAdvertisedServiceUuid(const char * /* uuid */) { return true; }
+    void setFlags(uint8_t /* flags */) {}
+
+    std::string localName;
+    std::vector<uint8_t> manufacturerData;
+};
+
+class BLELocalDevice
+{
+public:
+    int begin();
+    void end();
+    void poll(unsigned long timeout = 0);
+
+    int scan(bool withDuplicates = false);
+    int scanForName(const String &name, bool withDuplicates = false);
+    void stopScan();
+    BLEDevice available();
+
+    void setEventHandler(BLEDeviceEvent event, BLEDeviceEventHandler handler);
+
+    void setAdvertisingInterval(uint16_t interval);
+    int setAdvertisingData(BLEAdvertisingData &data);
+    int setScanResponseData(BLEAdvertisingData &data);
+    bool setLocalName(const char *name);
+    bool setDeviceName(const char * /* name */) { return true; }
+    bool setManufacturerData(const uint8_t *data, int length);
+    void setAdvertisedService(const BLEService & /* service */) {}
+    int advertise();
+    void stopAdvertise();
+
+    void addService(BLEService &service);
+
+    String address() const { return String("c0:ff:ee:00:00:01"); }
+    bool connected() const { return false; }
+};
+
+extern BLELocalDevice BLE;
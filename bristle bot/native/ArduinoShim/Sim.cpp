@@ -0,0 +1,209 @@
+#include "Sim.h"
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <cmath>
+#include <queue>
+#include <random>
+#include <thread>
+
+namespace Sim
+{
+
+    struct Event
+    {
+        uint64_t at;
+        uint64_t order; // keeps events at the same time in the order they were scheduled
+        std::function<void()> callback;
+
+        bool operator>(const Event &other) const
+        {
+            return at != other.at ? at > other.at : order > other.order;
+        }
+    };
+
+    static uint64_t clock = 0;
+    static uint64_t eventOrder = 0;
+    static std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    static bool advancing = false;
+
+    static bool realtime = false;
+    static std::chrono::steady_clock::time_point wallStart;
+
+    // small state generators, the state is copied for every bot in the swarm simulator
+    static std::minstd_rand rng(1);
+    static std::normal_distribution<float> normal(0.0, 1.0);
+    static std::uniform_real_distribution<float> flat(0.0, 1.0);
+
+    static World state = {
+        0.0, 0.3,  // position
+        0.0,       // heading
+        0.0,       // hand rotation
+        40.0,      // sound level
+        0.0,       // sound bearing
+        0.0,       // mic directivity
+        0.03,      // forward speed
+        60.0,      // turn rate
+        2.0,       // rssi noise
+        false,     // fading
+        4.0,       // compass noise
+        1.5,       // arena
+    };
+    static uint64_t worldTime = 0;
+
+    static const int NUM_BEACONS = 3;
+    static Transmitter transmitters[MAX_TRANSMITTERS] = {
+        // each describes itself with a beacon frame (src/BeaconRegistry.h): company id 0xFFFD,
+        // version 1, id, x and y in cm, rssi at 1 m in 0.01 dBm and path loss exponent in 0.01
+        {"RasPi1", {0xdc, 0xa6, 0x32, 0, 0, 1}, 0.0, 1.0, -65.37, 2.68,
+         {0xfd, 0xff, 1, 0, 0x00, 0x00, 0x64, 0x00, 0x77, 0xe6, 0x0c, 0x01}, 12},
+        {"RasPi2", {0xdc, 0xa6, 0x32, 0, 0, 2}, -0.75, 0.0, -65.37, 2.68,
+         {0xfd, 0xff, 1, 1, 0xb5, 0xff, 0x00, 0x00, 0x77, 0xe6, 0x0c, 0x01}, 12},
+        {"RasPi3", {0xdc, 0xa6, 0x32, 0, 0, 3}, 0.75, 0.0, -65.37, 2.68,
+         {0xfd, 0xff, 1, 2, 0x4b, 0x00, 0x00, 0x00, 0x77, 0xe6, 0x0c, 0x01}, 12},
+    };
+    static int numTransmitters = NUM_BEACONS;
+
+    static uint8_t flash[FLASH_SLOTS][FLASH_SLOT_SIZE];
+
+    uint64_t now()
+    {
+        return clock;
+    }
+
+    void powerOnAt(uint64_t us)
+    {
+        clock = us;
+        worldTime = us;
+    }
+
+    void schedule(uint64_t at, std::function<void()> callback)
+    {
+        events.push(Event{at, eventOrder++, std::move(callback)});
+    }
+
+    void advance(uint64_t us)
+    {
+        uint64_t target = clock + us;
+        if (advancing)
+        {
+            // called from an event (a clock read in a callback), just move the clock
+            clock = target;
+            return;
+        }
+        advancing = true;
+        while (!events.empty() && events.top().at <= target)
+        {
+            Event event = events.top();
+            events.pop();
+            if (event.at > clock)
+                clock = event.at;
+            event.callback();
+        }
+        if (target > clock)
+            clock = target;
+        advancing = false;
+
+        if (realtime)
+        {
+            std::this_thread::sleep_until(wallStart + std::chrono::microseconds(clock));
+        }
+    }
+
+    void setRealtime(bool enabled)
+    {
+        realtime = enabled;
+        wallStart = std::chrono::steady_clock::now() - std::chrono::microseconds(clock);
+    }
+
+    void seed(uint32_t value)
+    {
+        rng.seed(value);
+        normal.reset();
+        randomSeed(value);
+    }
+
+    float gaussian()
+    {
+        return normal(rng);
+    }
+
+    float uniform()
+    {
+        return flat(rng);
+    }
+
+    World &world()
+    {
+        return state;
+    }
+
+    void updateWorld()
+    {
+        if (clock <= worldTime)
+            return;
+        float dt = (clock - worldTime) / 1e6;
+        worldTime = clock;
+
+        bool right = pinLevel(MOTOR_RIGHT_PIN) == HIGH;
+        bool left = pinLevel(MOTOR_LEFT_PIN) == HIGH;
+
+        // the right motor alone turns the bot left (anticlockwise) and the left alone turns it right
+        float turn = state.handRotation;
+        if (right && !left)
+            turn -= state.turnRate;
+        else if (left && !right)
+            turn += state.turnRate;
+        state.heading = fmod(state.heading + turn * dt + 360.0, 360.0);
+
+        if (right && left)
+        {
+            float radians = state.heading * PI / 180.0;
+            state.x += state.forwardSpeed * dt * sin(radians);
+            state.y += state.forwardSpeed * dt * cos(radians);
+            state.x = constrain(state.x, -state.arenaHalfSize, state.arenaHalfSize);
+            state.y = constrain(state.y, -state.arenaHalfSize, state.arenaHalfSize);
+        }
+    }
+
+    int transmitterCount()
+    {
+        return numTransmitters;
+    }
+
+    const Transmitter &transmitter(int i)
+    {
+        return transmitters[i];
+    }
+
+    void setNeighbours(const Transmitter *neighbours, int count)
+    {
+        if (count > MAX_TRANSMITTERS - NUM_BEACONS)
+            count = MAX_TRANSMITTERS - NUM_BEACONS;
+        memcpy(&transmitters[NUM_BEACONS], neighbours, count * sizeof(Transmitter));
+        numTransmitters = NUM_BEACONS + count;
+    }
+
+    int receivedRssi(const Transmitter &transmitter)
+    {
+        updateWorld();
+        float dx = state.x - transmitter.x;
+        float dy = state.y - transmitter.y;
+        float distance = std::max(0.05f, sqrtf(dx * dx + dy * dy));
+        float rssi = transmitter.rssiAt1m - 10.0 * transmitter.pathLossExponent * log10f(distance);
+        rssi += gaussian() * state.rssiNoise;
+        if (state.fading)
+        {
+            // rayleigh fading: the received power is exponentially distributed around the mean
+            rssi += 10.0 * log10f(std::max(1e-6f, -logf(1.0f - uniform())));
+        }
+        return lroundf(rssi);
+    }
+
+    uint8_t *flashSlot(int slot)
+    {
+        return (slot >= 0 && slot < FLASH_SLOTS) ? flash[slot] : nullptr;
+    }
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// host side model of the bot's hardware for the native build.
+// time is virtual: it only moves in delay(), __WFE() and by 1 us on every clock
+// read, so setup() and loop() run unmodified but far faster than real time.
+// the simulated peripherals (compass, mic, beacons, motors) are driven from
+// events on that clock.
+//
+// all of the simulated state is plain static data, and static objects must not
+// allocate in their constructors: the swarm simulator (native/swarm) runs many
+// bots in one process by swapping copies of this data in and out.
+namespace Sim
+{
+
+    // motor pins, as wired in Locomotion.cpp
+    static const int MOTOR_RIGHT_PIN = 2;
+    static const int MOTOR_LEFT_PIN = 3;
+
+    // current virtual time (us)
+    uint64_t now();
+
+    // sets the clock before setup() runs, the swarm simulator staggers power on
+    void powerOnAt(uint64_t us);
+
+    // moves virtual time forward, running every event that falls due on the way
+    void advance(uint64_t us);
+
+    // runs the callback at the given virtual time (us), like an interrupt would
+    void schedule(uint64_t at, std::function<void()> callback);
+
+    // holds virtual time back to wall clock time, so the serial console is usable
+    void setRealtime(bool enabled);
+
+    // seeds every random source (firmware random() and the peripheral models)
+    void seed(uint32_t value);
+
+    // standard normal and uniform [0, 1) samples for the peripheral models
+    float gaussian();
+    float uniform();
+
+    // physical state of the bot and its surroundings
+    struct World
+    {
+        float x, y;          // position (m), y is north
+        float heading;       // magnetic heading (degrees)
+        float handRotation;  // deg/s the bot is being turned by hand, used for the boot calibration
+        float soundLevel;    // mic amplitude
+        float soundBearing;  // direction the sound comes from (degrees)
+        float micDirectivity; // dB louder facing the sound than facing away from it, 0 for an omni mic
+        float forwardSpeed;  // m/s with both motors on
+        float turnRate;      // deg/s with one motor on
+        float rssiNoise;     // std dev of the rssi shadowing (dB)
+        bool fading;         // adds rayleigh fading to every received advert
+        float compassNoise;  // std dev of each magnetometer axis (counts)
+        float arenaHalfSize; // the bot is kept inside +-this (m)
+    };
+
+    World &world();
+
+    // brings the world up to the current time, using the motor pins since the last update.
+    // the world is only integrated when something looks at it, call this before reading it
+    void updateWorld();
+
+    // largest advertising payload a transmitter can carry
+    static const int MAX_ADVERT_DATA = 31;
+
+    // something the bot can hear while scanning: a beacon or another bot
+    struct Transmitter
+    {
+        char name[16];
+        uint8_t address[6];
+        float x, y;
+        float rssiAt1m;
+        float pathLossExponent;
+        uint8_t manufacturerData[MAX_ADVERT_DATA];
+        uint8_t manufacturerLength;
+    };
+
+    static const int MAX_TRANSMITTERS = 72;
+
+    // transmitters heard while scanning, by default the three beacons of Params.def
+    int transmitterCount();
+    const Transmitter &transmitter(int i);
+
+    // replaces the transmitters after the fixed beacons (the swarm simulator's neighbours)
+    void setNeighbours(const Transmitter *neighbours, int count);
+
+    // rssi the bot would measure from a transmitter right now
+    int receivedRssi(const Transmitter &transmitter);
+
+    // queues an advert for the next BLE.poll() as if it had just been received with this
+    // rssi, whether or not the bot is scanning (used to replay traces)
+    void deliverAdvert(const Transmitter &transmitter, int rssi);
+
+    // level of a pin, as last written by the firmware or set by setPinLevel
+    int pinLevel(int pin);
+
+    // drives an input pin from outside, firing any attached interrupt on a rising edge
+    void setPinLevel(int pin, int level);
+
+    // what the bot is currently advertising
+    struct Advert
+    {
+        bool active;
+        std::string localName;
+        std::vector<uint8_t> manufacturerData;
+        std::vector<uint8_t> scanResponseData; // manufacturer data of the scan response
+    };
+
+    const Advert &advert();
+
+    // writes a local GATT characteristic as a connected central would, the
+    // firmware's handler runs on its next BLE.poll()
+    bool writeCharacteristic(const char *uuid, const uint8_t *data, int len);
+
+    // reads a local GATT characteristic, false if there is no such characteristic
+    bool readCharacteristic(const char *uuid, std::vector<uint8_t> &out);
+
+    // simulated internal flash, one record slot per storage slot (see Storage.cpp)
+    static const int FLASH_SLOTS = 4;
+    static const int FLASH_SLOT_SIZE = 512;
+    uint8_t *flashSlot(int slot);
+
+    // where Serial output goes, nullptr discards it. counted either way
+    void setSerialOutput(FILE *out);
+    uint64_t serialBytes();
+
+    // adverts delivered to the firmware while scanning
+    uint32_t advertsReceived();
+
+}
@@ -0,0 +1,90 @@
+#include "SimApi.h"
+
+#include <Arduino.h>
+
+static const int MODE_SELECT_PIN = 0; // as in main.cpp
+
+// how fast the bot is turned by hand while setup() runs, so a full boot's
+// compass calibration sees every direction
+static const float CALIBRATION_SPIN = 45.0;
+
+extern "C"
+{
+
+    void sim_reset(uint32_t seed, uint64_t powerOnUs, float x, float y, float heading, int mode, float arenaHalfSize)
+    {
+        Sim::seed(seed);
+        Sim::powerOnAt(powerOnUs);
+        Sim::World &world = Sim::world();
+        world.x = x;
+        world.y = y;
+        world.heading = heading;
+        world.arenaHalfSize = arenaHalfSize;
+        // the mode pin has a pull up, mode 0 is selected by grounding it
+        Sim::setPinLevel(MODE_SELECT_PIN, mode == 0 ? LOW : HIGH);
+    }
+
+    void sim_boot()
+    {
+        Sim::world().handRotation = CALIBRATION_SPIN;
+        setup();
+        Sim::updateWorld();
+        Sim::world().handRotation = 0.0;
+    }
+
+    void sim_run_until(uint64_t us)
+    {
+        while (Sim::now() < us)
+        {
+            loop();
+        }
+    }
+
+    void sim_set_sound(float level, float bearing, float directivity)
+    {
+        Sim::World &world = Sim::world();
+        world.soundLevel = level;
+        world.soundBearing = bearing;
+        world.micDirectivity = directivity;
+    }
+
+    void sim_set_radio(float rssiNoise, int fading, float compassNoise)
+    {
+        Sim::World &world = Sim::world();
+        world.rssiNoise = rssiNoise;
+        world.fading = fading != 0;
+        world.compassNoise = compassNoise;
+    }
+
+    void sim_set_neighbours(const Sim::Transmitter *neighbours, int count)
+    {
+        Sim::setNeighbours(neighbours, count);
+    }
+
+    void sim_set_serial(FILE *out)
+    {
+        Sim::setSerialOutput(out);
+    }
+
+    uint8_t *sim_flash(int slot)
+    {
+        return Sim::flashSlot(slot);
+    }
+
+    void sim_get_state(SimBotState *state)
+    {
+        Sim::updateWorld();
+        const Sim::World &world = Sim::world();
+        const Sim::Advert &advert = Sim::advert();
+        state->x = world.x;
+        state->y = world.y;
+        state->heading = world.heading;
+        state->advertising = advert.active;
+        state->manufacturerLength = std::min((int)advert.manufacturerData.size(), Sim::MAX_ADVERT_DATA);
+        memcpy(state->manufacturerData, advert.manufacturerData.data(), state->manufacturerLength);
+        state->advertsReceived = Sim::advertsReceived();
+        state->serialBytes = Sim::serialBytes();
+        state->now = Sim::now();
+    }
+
+}
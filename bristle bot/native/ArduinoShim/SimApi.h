@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#include "Sim.h"
+
+// plain C entry points into one simulated bot, looked up with dlsym by the swarm
+// simulator (native/swarm), which loads the firmware and this shim as a shared object.
+// every call acts on the bot whose state is currently swapped in.
+extern "C"
+{
+
+    // what the swarm simulator reads back after each slice
+    struct SimBotState
+    {
+        float x, y, heading;
+        uint8_t advertising;
+        uint8_t manufacturerData[Sim::MAX_ADVERT_DATA];
+        uint8_t manufacturerLength;
+        uint32_t advertsReceived;
+        uint64_t serialBytes;
+        uint64_t now;
+    };
+
+    // places the bot and seeds it, call on a fresh state before sim_boot
+    void sim_reset(uint32_t seed, uint64_t powerOnUs, float x, float y, float heading, int mode, float arenaHalfSize);
+
+    // runs setup(), turning the bot by hand in case it calibrates
+    void sim_boot();
+
+    // runs loop() until the clock reaches the given time (us)
+    void sim_run_until(uint64_t us);
+
+    // the mic amplitude, the direction it comes from (degrees) and the mic's front to back ratio (dB)
+    void sim_set_sound(float level, float bearing, float directivity);
+    void sim_set_radio(float rssiNoise, int fading, float compassNoise);
+    void sim_set_neighbours(const Sim::Transmitter *neighbours, int count);
+    void sim_set_serial(FILE *out);
+
+    // the storage slots, so a calibrated bot's flash can be copied into the others
+    uint8_t *sim_flash(int slot);
+
+    void sim_get_state(SimBotState *state);
+
+}
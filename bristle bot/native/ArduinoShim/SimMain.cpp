@@ -0,0 +1,56 @@
+#include <Arduino.h>
+
+#include <cstring>
+
+#include "Sim.h"
+#include "SimApi.h"
+
+// runs the firmware's setup() and loop() against the simulated peripherals
+//
+//   program [--seconds N] [--seed N] [--mode 0|1] [--realtime]
+//
+// --seconds is virtual time to run loop() for after setup(). the serial output (text and binary log frames) goes
+// to stdout, so it can be piped through tools/log_decode.py --file /dev/stdin.
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [--seconds N] [--seed N] [--mode 0|1] [--realtime]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 120.0;
+    uint32_t seed = 1;
+    int mode = 1;
+    bool realtime = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+            seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+            seed = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--mode") == 0 && hasValue)
+            mode = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--realtime") == 0)
+            realtime = true;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    const Sim::World &world = Sim::world();
+    sim_reset(seed, 0, world.x, world.y, world.heading, mode, world.arenaHalfSize);
+    Sim::setRealtime(realtime);
+    sim_boot();
+    sim_run_until(Sim::now() + (uint64_t)(seconds * 1e6));
+
+    Serial.flush();
+    Sim::updateWorld();
+    fprintf(stderr, "simulated %.1f s: position (%.2f, %.2f) heading %.1f\n",
+            Sim::now() / 1e6, world.x, world.y, world.heading);
+    return 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdlib>
+#include <string>
+
+// the parts of the Arduino String class used by the firmware, over std::string
+class String
+{
+public:
+    String(const char *s = "") : text(s ? s : "") {}
+    String(const std::string &s) : text(s) {}
+    explicit String(char c) : text(1, c) {}
+    explicit String(int value) : text(std::to_string(value)) {}
+    explicit String(unsigned int value) : text(std::to_string(value)) {}
+    explicit String(long value) : text(std::to_string(value)) {}
+    explicit String(unsigned long value) : text(std::to_string(value)) {}
+    explicit String(double value, unsigned char decimals = 2)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+        text = buffer;
+    }
+
+    const char *c_str() const { return text.c_str(); }
+    unsigned int length() const { return text.length(); }
+    char operator[](unsigned int i) const { return i < text.length() ? text[i] : 0; }
+
+    bool equals(const String &other) const { return text == other.text; }
+    bool operator==(const String &other) const { return text == other.text; }
+    bool operator==(const char *other) const { return text == (other ? other : ""); }
+    bool operator!=(const String &other) const { return text != other.text; }
+    bool operator!=(const char *other) const { return !(*this == other); }
+    bool startsWith(const String &prefix) const { return text.compare(0, prefix.text.length(), prefix.text) == 0; }
+
+    int indexOf(char c) const
+    {
+        size_t i = text.find(c);
+        return i == std::string::npos ? -1 : (int)i;
+    }
+
+    String substring(unsigned int from) const { return from < text.length() ? String(text.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        return from < text.length() && to > from ? String(text.substr(from, to - from)) : String();
+    }
+
+    long toInt() const { return atol(text.c_str()); }
+    float toFloat() const { return atof(text.c_str()); }
+
+    String &operator+=(const String &other)
+    {
+        text += other.text;
+        return *this;
+    }
+    String &operator+=(const char *other)
+    {
+        text += other;
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        text += c;
+        return *this;
+    }
+
+    friend String operator+(String a, const String &b) { return a += b; }
+    friend String operator+(String a, const char *b) { return a += b; }
+
+private:
+    std::string text;
+};
@@ -0,0 +1,98 @@
+#include "Wire.h"
+
+#include "Sim.h"
+
+TwoWire Wire;
+
+// QMC5883L model: horizontal field of FIELD counts rotated by the heading, with a
+// fixed hard iron offset (so the calibration has something to remove) and noise
+// of Sim::world().compassNoise on each axis
+static const uint8_t QMC5883L_ADDRESS = 0x0D;
+static const float FIELD = 1500.0;
+static const float VERTICAL_FIELD = 1200.0;
+static const float OFFSET[3] = {220.0, -140.0, 60.0};
+
+static uint8_t qmcRegisters[16] = {0};
+
+static void qmcSample()
+{
+    Sim::updateWorld();
+    float radians = Sim::world().heading * PI / 180.0;
+    float noise = Sim::world().compassNoise;
+    int16_t field[3] = {
+        (int16_t)lroundf(FIELD * cos(radians) + OFFSET[0] + Sim::gaussian() * noise),
+        (int16_t)lroundf(FIELD * sin(radians) + OFFSET[1] + Sim::gaussian() * noise),
+        (int16_t)lroundf(VERTICAL_FIELD + OFFSET[2] + Sim::gaussian() * noise),
+    };
+    memcpy(qmcRegisters, field, sizeof(field));
+    qmcRegisters[0x06] = 0x01; // data ready
+    qmcRegisters[0x0D] = 0xFF; // chip id
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    this->address = address;
+    txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (txLength >= sizeof(txBuffer))
+        return 0;
+    txBuffer[txLength++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len)
+{
+    size_t written = 0;
+    while (written < len && write(data[written]))
+        written++;
+    return written;
+}
+
+uint8_t TwoWire::endTransmission(bool /* sendStop */)
+{
+    if (address != QMC5883L_ADDRESS)
+        return 2; // address not acknowledged
+    if (txLength > 0)
+        registerPointer = txBuffer[0];
+    // control register writes (mode, set/reset period) are stored but have no effect
+    for (uint8_t i = 1; i < txLength; i++)
+    {
+        uint8_t reg = registerPointer + i - 1;
+        if (reg > 0x06 && reg < sizeof(qmcRegisters))
+            qmcRegisters[reg] = txBuffer[i];
+    }
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t /* sendStop */)
+{
+    rxLength = 0;
+    rxIndex = 0;
+    if (address != QMC5883L_ADDRESS)
+        return 0;
+    if (registerPointer == 0x00)
+        qmcSample();
+    for (uint8_t i = 0; i < quantity && i < sizeof(rxBuffer); i++)
+    {
+        rxBuffer[rxLength++] = qmcRegisters[(registerPointer + i) % sizeof(qmcRegisters)];
+    }
+    return rxLength;
+}
+
+int TwoWire::available()
+{
+    return rxLength - rxIndex;
+}
+
+int TwoWire::read()
+{
+    return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1;
+}
+
+int TwoWire::peek()
+{
+    return rxIndex < rxLength ? rxBuffer[rxIndex] : -1;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+
+// i2c bus with a simulated QMC5883L magnetometer at 0x0D, reading the heading from Sim::world()
+class TwoWire
+{
+public:
+    void begin() {}
+    void begin(uint8_t) {}
+    void end() {}
+    void setClock(uint32_t) {}
+
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+    uint8_t endTransmission(bool sendStop = true);
+
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *data, size_t len);
+
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop = 1);
+    uint8_t requestFrom(int address, int quantity) { return requestFrom((uint8_t)address, (uint8_t)quantity); }
+
+    int available();
+    int read();
+    int peek();
+
+private:
+    uint8_t address = 0;
+    uint8_t txBuffer[32];
+    uint8_t txLength = 0;
+    uint8_t registerPointer = 0;
+    uint8_t rxBuffer[32];
+    uint8_t rxLength = 0;
+    uint8_t rxIndex = 0;
+};
+
+extern TwoWire Wire;
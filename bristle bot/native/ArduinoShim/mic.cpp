@@ -0,0 +1,134 @@
+#include "mic.h"
+
+#include "Sim.h"
+
+#include <algorithm>
+
+uint8_t NRF52840_ADC_Class::begin()
+{
+    if (config->buf_size / 2 > sizeof(pool[0]) / sizeof(pool[0][0]) || config->sampling_rate == 0)
+        return 0;
+    running = true;
+    paused = false;
+    deliver();
+    return 1;
+}
+
+void NRF52840_ADC_Class::end()
+{
+    running = false;
+}
+
+void NRF52840_ADC_Class::resume()
+{
+    // as the driver: frames from before the pause are dropped. the board also loses
+    // the two frames that were being recorded, that gap is not simulated
+    flush();
+    paused = false;
+}
+
+int8_t NRF52840_ADC_Class::popReady()
+{
+    if (readyCount == 0)
+        return -1;
+    int8_t slot = ready[readyHead];
+    readyHead = (readyHead + 1) % POOL_SIZE;
+    readyCount--;
+    return slot;
+}
+
+bool NRF52840_ADC_Class::borrow(mic_frame_t &frame, uint32_t timeout_ms)
+{
+    uint32_t start = millis();
+    int8_t slot;
+    while ((slot = popReady()) < 0)
+    {
+        if (millis() - start >= timeout_ms)
+        {
+            frame = {nullptr, 0, 0, -1};
+            return false;
+        }
+        delay(1);
+    }
+    lent[slot] = true;
+    frame = {(const int16_t *)pool[slot], config->buf_size / 2, sequence[slot], slot};
+    return true;
+}
+
+void NRF52840_ADC_Class::release(mic_frame_t &frame)
+{
+    if (frame.slot >= 0)
+        lent[frame.slot] = false;
+    frame = {nullptr, 0, 0, -1};
+}
+
+int NRF52840_ADC_Class::read(int16_t *buffer, uint32_t count, uint32_t timeout_ms)
+{
+    mic_frame_t frame;
+    if (!borrow(frame, timeout_ms))
+        return 0;
+    count = std::min(count, frame.count);
+    memcpy(buffer, frame.samples, count * sizeof(int16_t));
+    release(frame);
+    return count;
+}
+
+void NRF52840_ADC_Class::flush()
+{
+    readyCount = 0;
+}
+
+// gain (dB) of the mic's direction response at the bot's heading now
+float NRF52840_ADC_Class::facing() const
+{
+    Sim::updateWorld();
+    const Sim::World &world = Sim::world();
+    return world.micDirectivity / 2.0f * cosf((world.heading - world.soundBearing) * (float)PI / 180.0f);
+}
+
+// runs once per filled buffer, like the PDM interrupt
+void NRF52840_ADC_Class::deliver()
+{
+    startFacing = facing();
+    uint32_t samples = config->buf_size / 2;
+    uint64_t period = (uint64_t)samples * 1000000 / config->sampling_rate;
+    Sim::schedule(Sim::now() + period, [this, samples]()
+    {
+        if (!running)
+            return;
+        if (!paused)
+        {
+            // a buffer that is neither lent out nor waiting, else the oldest waiting one
+            int8_t slot = -1;
+            for (uint8_t i = 0; i < POOL_SIZE && slot < 0; i++)
+            {
+                bool waiting = false;
+                for (uint8_t j = 0; j < readyCount; j++)
+                    waiting |= ready[(readyHead + j) % POOL_SIZE] == i;
+                if (!lent[i] && !waiting)
+                    slot = i;
+            }
+            if (slot < 0 && (slot = popReady()) >= 0)
+                overrunCount++;
+
+            if (slot >= 0)
+            {
+                // the mic hears more of the sound the more the bot faces it
+                float direction = (startFacing + facing()) / 2.0f;
+                float level = Sim::world().soundLevel * powf(10.0f, (gain - 20) / 40.0f) *
+                              powf(10.0f, direction / 20.0f);
+                for (uint32_t i = 0; i < samples; i++)
+                {
+                    long s = lroundf(Sim::gaussian() * level * 1.25);
+                    pool[slot][i] = (uint16_t)(int16_t)std::max(-32768L, std::min(32767L, s));
+                }
+                sequence[slot] = recorded++;
+                if (callback != nullptr)
+                    callback(pool[slot], samples);
+                else
+                    ready[(readyHead + readyCount++) % POOL_SIZE] = slot;
+            }
+        }
+        deliver();
+    });
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+
+// stand-in for the Seeed mic library's nRF52840 PDM driver: while running, a
+// buffer of buf_size / 2 samples of noise at Sim::world().soundLevel is
+// recorded at the sampling rate, and given to the callback or queued in the
+// buffer pool to be read. soundLevel is the mean amplitude at the default PDM
+// gain, other gains scale it by 0.5 dB a step and samples saturate at 16 bits.
+// a directional mic is louder by micDirectivity / 2 dB facing soundBearing, and
+// quieter by as much facing away, averaged between the start and end of the frame
+typedef struct
+{
+    uint8_t channel_cnt;
+    uint32_t sampling_rate;
+    uint32_t buf_size;
+    uint8_t debug_pin;
+} mic_config_t;
+
+typedef struct
+{
+    const int16_t *samples;
+    uint32_t count;
+    uint32_t sequence;
+    int8_t slot;
+
+    const int16_t *data() const { return samples; }
+    uint32_t size() const { return count; }
+    const int16_t *begin() const { return samples; }
+    const int16_t *end() const { return samples + count; }
+    int16_t operator[](uint32_t i) const { return samples[i]; }
+} mic_frame_t;
+
+class NRF52840_ADC_Class
+{
+public:
+    NRF52840_ADC_Class(mic_config_t *mic_config) : config(mic_config) {}
+
+    uint8_t begin();
+    void end();
+    void pause() { paused = true; }
+    void resume();
+    void set_callback(void (*function)(uint16_t *buf, uint32_t buf_len)) { callback = function; }
+    void setGain(int gain) { this->gain = gain; }
+
+    int available() { return readyCount; }
+    int read(int16_t *buffer, uint32_t count, uint32_t timeout_ms = 0);
+    bool borrow(mic_frame_t &frame, uint32_t timeout_ms = 0);
+    void release(mic_frame_t &frame);
+    void flush();
+    uint32_t overruns() const { return overrunCount; }
+
+    static const uint8_t POOL_SIZE = 4;
+
+private:
+    void deliver();
+    int8_t popReady();
+    float facing() const;
+
+    mic_config_t *config;
+    void (*callback)(uint16_t *buf, uint32_t buf_len) = nullptr;
+    bool running = false;
+    bool paused = false;
+    int gain = 20; // DEFAULT_PDM_GAIN
+    uint16_t pool[POOL_SIZE][1024];
+    bool lent[POOL_SIZE] = {};
+    uint32_t sequence[POOL_SIZE] = {};
+    uint8_t ready[POOL_SIZE];
+    uint8_t readyHead = 0, readyCount = 0;
+    uint32_t recorded = 0, overrunCount = 0;
+    float startFacing = 0.0; // facing() when the frame being recorded started
+};
@@ -0,0 +1,181 @@
+// measures the rotate and listen sound bearing (startSoundBearing()) in simulation.
+//
+// one bot is booted in the levy walk mode, then for every trial a sound is placed at
+// a random bearing, a sweep is started and run to the end, and the estimate is
+// compared with the true bearing. the firmware's headings have the compass mounting
+// and calibration in them, so the truth is moved into the same frame by the mean
+// difference between the firmware's heading and the simulated one over the sweep. the level of the sound wanders from frame to frame
+// by --fluctuation dB, as a real source does. prints the error statistics, how often
+// the reported standard error covers the real error, and the time per estimate.
+//
+//   ./build/bearing [--trials N] [--directivity DB] [--level L] [--fluctuation DB]
+//                   [--compass-noise COUNTS] [--seed N]
+
+#include <Arduino.h>
+#include <Sim.h>
+#include <SimApi.h>
+
+#include <SoundMeasurer.h>
+#include <orientation/Orientation.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace Bearing
+{
+
+    struct Options
+    {
+        int trials = 50;
+        float directivity = 6.0; // front to back ratio of the mic (dB)
+        float level = 100.0;     // mic amplitude of the sound at the default gain
+        float fluctuation = 1.0; // std dev of the sound level from one frame to the next (dB)
+        float compassNoise = 4.0;
+        uint32_t seed = 1;
+    };
+
+    // time the sound level is held for, one mic frame
+    static const uint64_t FRAME_US = 50000;
+
+    struct Trial
+    {
+        float truth, offset, estimate, error, reported, seconds;
+        bool valid;
+    };
+
+    static void usage(const char *name)
+    {
+        fprintf(stderr,
+                "usage: %s [--trials N] [--directivity DB] [--level L] [--fluctuation DB]\n"
+                "          [--compass-noise COUNTS] [--seed N]\n",
+                name);
+    }
+
+    static bool parseOptions(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            if (i + 1 >= argc)
+                return false;
+            const char *value = argv[++i];
+            if (strcmp(argv[i - 1], "--trials") == 0)
+                options.trials = atoi(value);
+            else if (strcmp(argv[i - 1], "--directivity") == 0)
+                options.directivity = atof(value);
+            else if (strcmp(argv[i - 1], "--level") == 0)
+                options.level = atof(value);
+            else if (strcmp(argv[i - 1], "--fluctuation") == 0)
+                options.fluctuation = atof(value);
+            else if (strcmp(argv[i - 1], "--compass-noise") == 0)
+                options.compassNoise = atof(value);
+            else if (strcmp(argv[i - 1], "--seed") == 0)
+                options.seed = strtoul(value, nullptr, 0);
+            else
+                return false;
+        }
+        return options.trials > 0 && options.level > 0.0;
+    }
+
+    static Trial runTrial(const Options &options)
+    {
+        Trial trial;
+        trial.truth = Sim::uniform() * 360.0f;
+
+        // a sweep left running by the last trial's timeout is finished first
+        while (soundBearingActive())
+            sim_run_until(Sim::now() + FRAME_US);
+
+        uint32_t before = soundBearingCount();
+        uint64_t start = Sim::now();
+        double east = 0.0, north = 0.0;
+        startSoundBearing();
+        while (soundBearingCount() == before)
+        {
+            float level = options.level * powf(10.0f, options.fluctuation * Sim::gaussian() / 20.0f);
+            sim_set_sound(level, trial.truth, options.directivity);
+            sim_run_until(Sim::now() + FRAME_US);
+
+            Sim::updateWorld();
+            float offset = (getHeading() - Sim::world().heading) * PI / 180.0;
+            east += sin(offset);
+            north += cos(offset);
+        }
+
+        const SoundBearing::Estimate &estimate = lastSoundBearing();
+        trial.offset = atan2(east, north) * 180.0 / PI;
+        trial.estimate = estimate.bearing;
+        trial.error = remainderf(estimate.bearing - (trial.truth + trial.offset), 360.0f);
+        trial.reported = estimate.error;
+        trial.valid = estimate.valid;
+        trial.seconds = (Sim::now() - start) / 1e6f;
+        return trial;
+    }
+
+    static float percentile(std::vector<float> values, float p)
+    {
+        if (values.empty())
+            return NAN;
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, (size_t)(p * values.size()))];
+    }
+
+    static int run(int argc, char **argv)
+    {
+        Options options;
+        if (!parseOptions(argc, argv, options))
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        const Sim::World &world = Sim::world();
+        sim_reset(options.seed, 0, world.x, world.y, world.heading, 0, world.arenaHalfSize);
+        sim_set_radio(world.rssiNoise, world.fading, options.compassNoise);
+        sim_set_serial(nullptr);
+        sim_set_sound(options.level, 0.0, options.directivity);
+        sim_boot();
+
+        std::vector<Trial> trials;
+        for (int i = 0; i < options.trials; i++)
+            trials.push_back(runTrial(options));
+
+        std::vector<float> errors, seconds;
+        int valid = 0, covered = 0;
+        double squares = 0.0, bias = 0.0;
+        for (const Trial &trial : trials)
+        {
+            seconds.push_back(trial.seconds);
+            if (!trial.valid)
+                continue;
+            valid++;
+            errors.push_back(fabsf(trial.error));
+            squares += trial.error * trial.error;
+            bias += trial.error;
+            covered += fabsf(trial.error) <= 2.0f * trial.reported;
+        }
+
+        double totalSeconds = 0.0;
+        for (float s : seconds)
+            totalSeconds += s;
+        printf("trials %d, directivity %.1f dB, fluctuation %.1f dB, compass noise %.1f\n",
+               options.trials, options.directivity, options.fluctuation, options.compassNoise);
+        printf("valid estimates    %d (%.0f%%)\n", valid, 100.0 * valid / options.trials);
+        if (valid > 0)
+        {
+            printf("bearing error      rms %.1f deg, median %.1f, 90%% %.1f, max %.1f, mean %+.1f\n",
+                   sqrt(squares / valid), percentile(errors, 0.5), percentile(errors, 0.9), percentile(errors, 1.0),
+                   bias / valid);
+            printf("within 2 reported  %.0f%% of the valid estimates\n", 100.0 * covered / valid);
+        }
+        printf("time per estimate  mean %.2f s, max %.2f s\n", totalSeconds / options.trials, percentile(seconds, 1.0));
+        return 0;
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    return Bearing::run(argc, argv);
+}
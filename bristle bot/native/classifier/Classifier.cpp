@@ -0,0 +1,712 @@
+// trains, quantizes and checks the sound classifier (src/SoundClassifier.h).
+//
+// there are no recordings to train on, so clips are synthesized for every label:
+// room noise, the target (a piezo buzzer tone with its odd harmonics), vibration
+// motors (a harmonic buzz with the bristles rattling once per turn) and speech
+// (a glottal pulse train through three formant resonators, or a fricative), mixed
+// with room noise and recorded through a model of the PDM at a gain like the AGC's.
+// features come from the firmware's LogMel::compute() and the int8 network runs
+// through the firmware's kernels, so the accuracy printed is what the bot gets on
+// these clips.
+//
+//   make && ./build/classifier                       checks src/classifier/SoundModel.cpp
+//   ./build/classifier --train [--out FILE]          trains a new model and writes it
+//
+// the check exits 1 if the int8 accuracy is under MIN_ACCURACY.
+
+#include <SoundClassifier.h>
+#include <SoundGain.h>
+#include <classifier/LogMel.h>
+#include <classifier/SoundNet.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Classifier
+{
+
+    static const float SAMPLE_RATE = 16000.0;
+    static const int FRAME_SAMPLES = 800;       // SAMPLES in SoundMeasurer.cpp
+    static const float SELF_NOISE_DB = -95.0;   // as bench/SoundRange.cpp
+    static const int TRAIN_CLIPS = 2000;        // per label
+    static const int TEST_CLIPS = 500;
+    static const int EPOCHS = 40;
+    static const int BATCH = 32;
+    static const float LEARNING_RATE = 0.003;
+    static const float MIN_ACCURACY = 0.9;
+
+    static const int CLASSES = SoundNet::CLASSES;
+    static const int CHANNELS = SoundNet::CHANNELS;
+    static const int KERNEL = SoundNet::KERNEL;
+    static const int ROWS = LogMel::WINDOWS;
+    static const int COLUMNS = LogMel::BANDS;
+    static const int POOLED_COLUMNS = COLUMNS / SoundNet::POOL;
+    static const int POOLED_SIZE = SoundNet::POOLED_SIZE;
+
+    typedef std::mt19937 Random;
+
+    static float uniform(Random &rng, float low, float high)
+    {
+        return std::uniform_real_distribution<float>(low, high)(rng);
+    }
+
+    static float gaussian(Random &rng)
+    {
+        return std::normal_distribution<float>(0.0, 1.0)(rng);
+    }
+
+    static void scaleTo(std::vector<float> &signal, float db)
+    {
+        double sum = 0.0;
+        for (float s : signal)
+            sum += (double)s * s;
+        float rms = sqrt(sum / signal.size());
+        float scale = rms > 0.0f ? powf(10.0f, db / 20.0f) / rms : 0.0f;
+        for (float &s : signal)
+            s *= scale;
+    }
+
+    // two pole resonator at hz with bandwidth width
+    struct Resonator
+    {
+        float a1, a2, gain, y1 = 0.0, y2 = 0.0;
+
+        Resonator(float hz, float width)
+        {
+            float r = expf(-(float)M_PI * width / SAMPLE_RATE);
+            a1 = 2.0f * r * cosf(2.0f * (float)M_PI * hz / SAMPLE_RATE);
+            a2 = -r * r;
+            gain = 1.0f - r;
+        }
+
+        float step(float x)
+        {
+            float y = gain * x + a1 * y1 + a2 * y2;
+            y2 = y1;
+            y1 = y;
+            return y;
+        }
+    };
+
+    // ############ Clips #############
+
+    // room noise: white and low passed noise in a random mix, sometimes mains hum
+    static std::vector<float> roomNoise(Random &rng)
+    {
+        std::vector<float> signal(FRAME_SAMPLES);
+        float tilt = uniform(rng, 0.0, 1.0), pole = uniform(rng, 0.8, 0.99);
+        float low = 0.0;
+        float hum = uniform(rng, 0.0, 1.0) < 0.3f ? uniform(rng, 0.0, 0.5) : 0.0f;
+        float mains = uniform(rng, 0.0, 1.0) < 0.5f ? 50.0f : 60.0f;
+        float phase = uniform(rng, 0.0, 2.0f * (float)M_PI);
+        for (int i = 0; i < FRAME_SAMPLES; i++)
+        {
+            float white = gaussian(rng);
+            low = pole * low + (1.0f - pole) * white * 4.0f;
+            float t = i / SAMPLE_RATE;
+            signal[i] = (1.0f - tilt) * white + tilt * low +
+                        hum * (sinf(2.0f * (float)M_PI * mains * t + phase) + 0.5f * sinf(4.0f * (float)M_PI * mains * t));
+        }
+        return signal;
+    }
+
+    // piezo buzzer: a square-ish tone, sometimes starting or stopping in the frame
+    static std::vector<float> target(Random &rng)
+    {
+        std::vector<float> signal(FRAME_SAMPLES);
+        float hz = uniform(rng, 2000.0, 4000.0);
+        float phase = uniform(rng, 0.0, 2.0f * (float)M_PI);
+        int on = 0, off = FRAME_SAMPLES;
+        if (uniform(rng, 0.0, 1.0) < 0.2f)
+            on = (int)uniform(rng, 0.0, FRAME_SAMPLES / 2);
+        else if (uniform(rng, 0.0, 1.0) < 0.2f)
+            off = (int)uniform(rng, FRAME_SAMPLES / 2, FRAME_SAMPLES);
+        for (int i = on; i < off; i++)
+        {
+            float p = 2.0f * (float)M_PI * hz * i / SAMPLE_RATE + phase;
+            signal[i] = sinf(p) + 0.3f * sinf(3.0f * p) + 0.15f * sinf(5.0f * p);
+        }
+        return signal;
+    }
+
+    // vibration motors: harmonics of the rotation and the bristles hitting the floor
+    static std::vector<float> motors(Random &rng)
+    {
+        std::vector<float> signal(FRAME_SAMPLES);
+        int count = 1 + (int)uniform(rng, 0.0, 2.0); // one or two motors
+        float rattle = uniform(rng, 0.2, 1.5);
+        for (int m = 0; m < count; m++)
+        {
+            float hz = uniform(rng, 120.0, 260.0);
+            float phases[40];
+            for (float &p : phases)
+                p = uniform(rng, 0.0, 2.0f * (float)M_PI);
+            float rolloff = uniform(rng, 0.4, 1.0);
+            for (int i = 0; i < FRAME_SAMPLES; i++)
+            {
+                float t = i / SAMPLE_RATE;
+                float buzz = 0.0f;
+                for (int k = 1; k <= 40 && k * hz < SAMPLE_RATE / 2; k++)
+                    buzz += sinf(2.0f * (float)M_PI * k * hz * t + phases[k - 1]) / powf(k, rolloff);
+                float hit = 0.5f + 0.5f * cosf(2.0f * (float)M_PI * hz * t + phases[0]);
+                signal[i] += buzz + rattle * hit * hit * hit * gaussian(rng) * 2.0f;
+            }
+        }
+        return signal;
+    }
+
+    // voiced speech through formants, or a fricative
+    static std::vector<float> speech(Random &rng)
+    {
+        std::vector<float> signal(FRAME_SAMPLES);
+        if (uniform(rng, 0.0, 1.0) < 0.25f)
+        {
+            Resonator band(uniform(rng, 3500.0, 6500.0), uniform(rng, 1000.0, 3000.0));
+            for (float &s : signal)
+                s = band.step(gaussian(rng));
+            return signal;
+        }
+        Resonator formants[3] = {Resonator(uniform(rng, 300.0, 900.0), uniform(rng, 60.0, 150.0)),
+                                 Resonator(uniform(rng, 900.0, 2500.0), uniform(rng, 80.0, 200.0)),
+                                 Resonator(uniform(rng, 2300.0, 3300.0), uniform(rng, 100.0, 250.0))};
+        float weights[3] = {1.0f, uniform(rng, 0.3, 1.0), uniform(rng, 0.1, 0.6)};
+        float f0 = uniform(rng, 85.0, 255.0), glide = uniform(rng, -0.3, 0.3);
+        float phase = uniform(rng, 0.0, 1.0), breath = uniform(rng, 0.0, 0.2);
+        float envelope = uniform(rng, 0.3, 1.0), attack = uniform(rng, -1.0, 1.0);
+        float glottal = 0.0;
+        for (int i = 0; i < FRAME_SAMPLES; i++)
+        {
+            float t = (float)i / FRAME_SAMPLES;
+            phase += f0 * (1.0f + glide * t) / SAMPLE_RATE;
+            // a sharp pulse once a period, smoothed into a glottal wave
+            float pulse = 0.0f;
+            if (phase >= 1.0f)
+            {
+                phase -= 1.0f;
+                pulse = 1.0f;
+            }
+            glottal = 0.9f * glottal + pulse + breath * gaussian(rng);
+            float voice = 0.0f;
+            for (int f = 0; f < 3; f++)
+                voice += weights[f] * formants[f].step(glottal);
+            float level = std::max(0.1f, envelope + attack * (t - 0.5f));
+            signal[i] = voice * level;
+        }
+        return signal;
+    }
+
+    struct Clip
+    {
+        int label;
+        int gain;
+        int16_t samples[FRAME_SAMPLES];
+    };
+
+    // one clip of label as the mic would record it
+    static void synthesize(int label, Random &rng, Clip &clip)
+    {
+        std::vector<float> room = roomNoise(rng);
+        std::vector<float> signal(FRAME_SAMPLES, 0.0f);
+        float sourceDb = uniform(rng, -65.0, -10.0);
+        float roomDb;
+        if (label == SoundClassifier::LABEL_AMBIENT)
+        {
+            roomDb = uniform(rng, -85.0, -35.0);
+            // now and then a far away source, well under the room
+            if (uniform(rng, 0.0, 1.0) < 0.3f)
+            {
+                int other = 1 + (int)uniform(rng, 0.0, 3.0);
+                signal = other == 1 ? target(rng) : (other == 2 ? motors(rng) : speech(rng));
+                scaleTo(signal, roomDb - uniform(rng, 15.0, 25.0));
+            }
+        }
+        else
+        {
+            signal = label == SoundClassifier::LABEL_TARGET ? target(rng)
+                   : (label == SoundClassifier::LABEL_MOTORS ? motors(rng) : speech(rng));
+            scaleTo(signal, sourceDb);
+            roomDb = std::min(uniform(rng, -85.0, -45.0), sourceDb - uniform(rng, 6.0, 30.0));
+        }
+        scaleTo(room, roomDb);
+
+        float peak = 0.0f;
+        for (int i = 0; i < FRAME_SAMPLES; i++)
+        {
+            signal[i] += room[i];
+            peak = std::max(peak, fabsf(signal[i]));
+        }
+
+        // the AGC keeps peaks around -12 dBFS, give or take
+        float peakDb = 20.0f * log10f(peak) + uniform(rng, -6.0, 6.0);
+        clip.label = label;
+        clip.gain = std::max(SoundGain::MIN_GAIN,
+                             std::min(SoundGain::MAX_GAIN, (int)lroundf(SoundGain::UNITY_GAIN + 2.0f * (-12.0f - peakDb))));
+        float fullScale = 32768.0f * powf(10.0f, (clip.gain - SoundGain::UNITY_GAIN) / 40.0f);
+        float noise = powf(10.0f, SELF_NOISE_DB / 20.0f);
+        for (int i = 0; i < FRAME_SAMPLES; i++)
+        {
+            long s = lroundf((signal[i] + gaussian(rng) * noise) * fullScale);
+            clip.samples[i] = (int16_t)std::max(-32768L, std::min(32767L, s));
+        }
+    }
+
+    struct Example
+    {
+        int label;
+        int8_t features[LogMel::FEATURES];
+    };
+
+    static std::vector<Example> dataset(int perLabel, Random &rng)
+    {
+        std::vector<Example> examples;
+        Clip clip;
+        for (int n = 0; n < perLabel; n++)
+        {
+            for (int label = 0; label < CLASSES; label++)
+            {
+                synthesize(label, rng, clip);
+                Example example;
+                example.label = label;
+                LogMel::compute(clip.samples, FRAME_SAMPLES, clip.gain, example.features);
+                examples.push_back(example);
+            }
+        }
+        return examples;
+    }
+
+    // ############ Float network #############
+
+    // the same layers as SoundNet in float, with gradients
+    struct Network
+    {
+        float conv[CHANNELS][KERNEL][KERNEL];
+        float convBias[CHANNELS];
+        float dense[CLASSES][POOLED_SIZE];
+        float denseBias[CLASSES];
+    };
+
+    struct Activations
+    {
+        float input[ROWS][COLUMNS];
+        float conv[ROWS][COLUMNS][CHANNELS];   // after the ReLU
+        float pooled[POOLED_SIZE];
+        int argmax[POOLED_SIZE];               // which band each pooled value came from
+        float logits[CLASSES];
+    };
+
+    static void forward(const Network &net, const Example &example, Activations &a)
+    {
+        for (int y = 0; y < ROWS; y++)
+        {
+            for (int x = 0; x < COLUMNS; x++)
+                a.input[y][x] = example.features[y * COLUMNS + x] * SoundNet::INPUT_SCALE;
+        }
+        for (int y = 0; y < ROWS; y++)
+        {
+            for (int x = 0; x < COLUMNS; x++)
+            {
+                for (int c = 0; c < CHANNELS; c++)
+                {
+                    float sum = net.convBias[c];
+                    for (int ky = 0; ky < KERNEL; ky++)
+                    {
+                        int iy = y + ky - KERNEL / 2;
+                        for (int kx = 0; kx < KERNEL; kx++)
+                        {
+                            int ix = x + kx - KERNEL / 2;
+                            if (iy >= 0 && iy < ROWS && ix >= 0 && ix < COLUMNS)
+                                sum += net.conv[c][ky][kx] * a.input[iy][ix];
+                        }
+                    }
+                    a.conv[y][x][c] = std::max(0.0f, sum);
+                }
+            }
+        }
+        // NHWC order, as the int8 pooled tensor
+        for (int y = 0; y < ROWS; y++)
+        {
+            for (int x = 0; x < POOLED_COLUMNS; x++)
+            {
+                for (int c = 0; c < CHANNELS; c++)
+                {
+                    int i = (y * POOLED_COLUMNS + x) * CHANNELS + c;
+                    int from = x * SoundNet::POOL;
+                    for (int p = 1; p < SoundNet::POOL; p++)
+                    {
+                        if (a.conv[y][x * SoundNet::POOL + p][c] > a.conv[y][from][c])
+                            from = x * SoundNet::POOL + p;
+                    }
+                    a.pooled[i] = a.conv[y][from][c];
+                    a.argmax[i] = from;
+                }
+            }
+        }
+        for (int k = 0; k < CLASSES; k++)
+        {
+            float sum = net.denseBias[k];
+            for (int i = 0; i < POOLED_SIZE; i++)
+                sum += net.dense[k][i] * a.pooled[i];
+            a.logits[k] = sum;
+        }
+    }
+
+    static void softmax(const float *logits, float *probabilities)
+    {
+        float largest = *std::max_element(logits, logits + CLASSES), sum = 0.0f;
+        for (int k = 0; k < CLASSES; k++)
+        {
+            probabilities[k] = expf(logits[k] - largest);
+            sum += probabilities[k];
+        }
+        for (int k = 0; k < CLASSES; k++)
+            probabilities[k] /= sum;
+    }
+
+    // adds the cross entropy gradient of one example to grad
+    static void backward(const Network &net, const Activations &a, int label, Network &grad)
+    {
+        float dLogits[CLASSES];
+        softmax(a.logits, dLogits);
+        dLogits[label] -= 1.0f;
+
+        float dPooled[POOLED_SIZE] = {0.0f};
+        for (int k = 0; k < CLASSES; k++)
+        {
+            grad.denseBias[k] += dLogits[k];
+            for (int i = 0; i < POOLED_SIZE; i++)
+            {
+                grad.dense[k][i] += dLogits[k] * a.pooled[i];
+                dPooled[i] += dLogits[k] * net.dense[k][i];
+            }
+        }
+
+        static float dConv[ROWS][COLUMNS][CHANNELS];
+        memset(dConv, 0, sizeof(dConv));
+        for (int y = 0; y < ROWS; y++)
+        {
+            for (int x = 0; x < POOLED_COLUMNS; x++)
+            {
+                for (int c = 0; c < CHANNELS; c++)
+                {
+                    int i = (y * POOLED_COLUMNS + x) * CHANNELS + c;
+                    if (a.pooled[i] > 0.0f)
+                        dConv[y][a.argmax[i]][c] += dPooled[i];
+                }
+            }
+        }
+        for (int y = 0; y < ROWS; y++)
+        {
+            for (int x = 0; x < COLUMNS; x++)
+            {
+                for (int c = 0; c < CHANNELS; c++)
+                {
+                    float d = dConv[y][x][c];
+                    if (d == 0.0f)
+                        continue;
+                    grad.convBias[c] += d;
+                    for (int ky = 0; ky < KERNEL; ky++)
+                    {
+                        int iy = y + ky - KERNEL / 2;
+                        for (int kx = 0; kx < KERNEL; kx++)
+                        {
+                            int ix = x + kx - KERNEL / 2;
+                            if (iy >= 0 && iy < ROWS && ix >= 0 && ix < COLUMNS)
+                                grad.conv[c][ky][kx] += d * a.input[iy][ix];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // the network as a flat array of parameters, for the optimiser
+    static const int PARAMETERS = sizeof(Network) / sizeof(float);
+
+    static float *parameters(Network &net)
+    {
+        return reinterpret_cast<float *>(&net);
+    }
+
+    static void train(Network &net, const std::vector<Example> &examples, Random &rng)
+    {
+        // He initialisation
+        float *p = parameters(net);
+        memset(p, 0, sizeof(Network));
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            for (int k = 0; k < KERNEL * KERNEL; k++)
+                net.conv[c][k / KERNEL][k % KERNEL] = gaussian(rng) * sqrtf(2.0f / (KERNEL * KERNEL));
+        }
+        for (int k = 0; k < CLASSES; k++)
+        {
+            for (int i = 0; i < POOLED_SIZE; i++)
+                net.dense[k][i] = gaussian(rng) * sqrtf(1.0f / POOLED_SIZE);
+        }
+
+        // adam
+        std::vector<float> m(PARAMETERS, 0.0f), v(PARAMETERS, 0.0f);
+        const float beta1 = 0.9f, beta2 = 0.999f, epsilon = 1e-8f;
+        int steps = 0;
+        std::vector<int> order(examples.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        Activations a;
+        for (int epoch = 0; epoch < EPOCHS; epoch++)
+        {
+            std::shuffle(order.begin(), order.end(), rng);
+            float loss = 0.0f;
+            int correct = 0;
+            float rate = LEARNING_RATE * (epoch < EPOCHS * 3 / 4 ? 1.0f : 0.1f);
+            for (size_t start = 0; start < order.size(); start += BATCH)
+            {
+                Network grad;
+                memset(&grad, 0, sizeof(grad));
+                size_t end = std::min(order.size(), start + BATCH);
+                for (size_t n = start; n < end; n++)
+                {
+                    const Example &example = examples[order[n]];
+                    forward(net, example, a);
+                    float probabilities[CLASSES];
+                    softmax(a.logits, probabilities);
+                    loss -= logf(std::max(probabilities[example.label], 1e-12f));
+                    correct += std::max_element(a.logits, a.logits + CLASSES) - a.logits == example.label;
+                    backward(net, a, example.label, grad);
+                }
+                steps++;
+                float *g = parameters(grad);
+                for (int i = 0; i < PARAMETERS; i++)
+                {
+                    float gi = g[i] / (end - start);
+                    m[i] = beta1 * m[i] + (1.0f - beta1) * gi;
+                    v[i] = beta2 * v[i] + (1.0f - beta2) * gi * gi;
+                    float mHat = m[i] / (1.0f - powf(beta1, steps));
+                    float vHat = v[i] / (1.0f - powf(beta2, steps));
+                    p[i] -= rate * mHat / (sqrtf(vHat) + epsilon);
+                }
+            }
+            if (epoch % 5 == 4 || epoch == EPOCHS - 1)
+                printf("epoch %2d: loss %.3f, train accuracy %.1f%%\n", epoch + 1, loss / examples.size(),
+                       100.0f * correct / examples.size());
+        }
+    }
+
+    // ############ Quantization #############
+
+    struct Quantized
+    {
+        int8_t convWeights[CHANNELS * KERNEL * KERNEL];
+        int32_t convBias[CHANNELS];
+        Nn::Requant convRequant[CHANNELS];
+        int8_t denseWeights[CLASSES * POOLED_SIZE];
+        int32_t denseBias[CLASSES];
+        SoundNet::Model model;
+    };
+
+    // post training quantization: symmetric int8 weights (per channel for the
+    // convolution), int32 biases, and activation ranges from the training set
+    static void quantize(const Network &net, const std::vector<Example> &examples, Quantized &q)
+    {
+        float convMax = 0.0f, logitMax = 0.0f;
+        Activations a;
+        for (const Example &example : examples)
+        {
+            forward(net, example, a);
+            for (int i = 0; i < POOLED_SIZE; i++)
+                convMax = std::max(convMax, a.pooled[i]);
+            for (int k = 0; k < CLASSES; k++)
+                logitMax = std::max(logitMax, fabsf(a.logits[k]));
+        }
+        const float convScale = convMax / 255.0f; // ReLU output over the whole int8 range
+        const int32_t convZero = -128;
+        const float logitScale = logitMax / 127.0f;
+
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            float largest = 1e-9f;
+            for (int k = 0; k < KERNEL * KERNEL; k++)
+                largest = std::max(largest, fabsf(net.conv[c][k / KERNEL][k % KERNEL]));
+            float weightScale = largest / 127.0f;
+            for (int k = 0; k < KERNEL * KERNEL; k++)
+                q.convWeights[c * KERNEL * KERNEL + k] = (int8_t)lroundf(net.conv[c][k / KERNEL][k % KERNEL] / weightScale);
+            q.convBias[c] = lroundf(net.convBias[c] / (SoundNet::INPUT_SCALE * weightScale));
+            q.convRequant[c] = Nn::requantFor((double)SoundNet::INPUT_SCALE * weightScale / convScale);
+        }
+
+        float largest = 1e-9f;
+        for (int k = 0; k < CLASSES; k++)
+        {
+            for (int i = 0; i < POOLED_SIZE; i++)
+                largest = std::max(largest, fabsf(net.dense[k][i]));
+        }
+        float denseScale = largest / 127.0f;
+        for (int k = 0; k < CLASSES; k++)
+        {
+            for (int i = 0; i < POOLED_SIZE; i++)
+                q.denseWeights[k * POOLED_SIZE + i] = (int8_t)lroundf(net.dense[k][i] / denseScale);
+            q.denseBias[k] = lroundf(net.denseBias[k] / (convScale * denseScale));
+        }
+
+        q.model = {q.convWeights, q.convBias, q.convRequant, convZero, q.denseWeights, q.denseBias,
+                   Nn::requantFor((double)convScale * denseScale / logitScale), 0, logitScale};
+    }
+
+    static bool writeModel(const Quantized &q, const char *path)
+    {
+        FILE *out = fopen(path, "w");
+        if (out == nullptr)
+        {
+            perror(path);
+            return false;
+        }
+        auto writeInt8 = [out](const char *name, const int8_t *values, int count, int perLine)
+        {
+            fprintf(out, "    static const int8_t %s[%d] = {", name, count);
+            for (int i = 0; i < count; i++)
+                fprintf(out, "%s%d,", i % perLine == 0 ? "\n        " : " ", values[i]);
+            fprintf(out, "\n    };\n\n");
+        };
+        fprintf(out, "// generated by native/classifier (./build/classifier --train), do not edit\n\n");
+        fprintf(out, "#include <classifier/SoundNet.h>\n\nnamespace SoundNet\n{\n\n");
+        writeInt8("CONV_WEIGHTS", q.convWeights, CHANNELS * KERNEL * KERNEL, KERNEL * KERNEL);
+        fprintf(out, "    static const int32_t CONV_BIAS[%d] = {", CHANNELS);
+        for (int c = 0; c < CHANNELS; c++)
+            fprintf(out, "%s%d", c ? ", " : "", q.convBias[c]);
+        fprintf(out, "};\n\n    static const Nn::Requant CONV_REQUANT[%d] = {", CHANNELS);
+        for (int c = 0; c < CHANNELS; c++)
+            fprintf(out, "%s\n        {%d, %d}", c ? "," : "", q.convRequant[c].multiplier, q.convRequant[c].shift);
+        fprintf(out, "\n    };\n\n");
+        writeInt8("DENSE_WEIGHTS", q.denseWeights, CLASSES * POOLED_SIZE, 20);
+        fprintf(out, "    static const int32_t DENSE_BIAS[%d] = {", CLASSES);
+        for (int k = 0; k < CLASSES; k++)
+            fprintf(out, "%s%d", k ? ", " : "", q.denseBias[k]);
+        fprintf(out, "};\n\n");
+        fprintf(out, "    const Model MODEL = {CONV_WEIGHTS, CONV_BIAS, CONV_REQUANT, %d, DENSE_WEIGHTS, DENSE_BIAS,\n",
+                q.model.convZero);
+        fprintf(out, "                         {%d, %d}, %d, %.9g};\n\n}\n", q.model.denseRequant.multiplier,
+                q.model.denseRequant.shift, q.model.logitZero, q.model.logitScale);
+        fclose(out);
+        return true;
+    }
+
+    // ############ Evaluation #############
+
+    // accuracy of the int8 model, with the confusion matrix if print is set
+    static float evaluate(const SoundNet::Model &model, const std::vector<Example> &examples, bool print)
+    {
+        int confusion[CLASSES][CLASSES] = {{0}};
+        int correct = 0;
+        for (const Example &example : examples)
+        {
+            int8_t logits[CLASSES];
+            SoundNet::run(model, example.features, logits);
+            int best = std::max_element(logits, logits + CLASSES) - logits;
+            confusion[example.label][best]++;
+            correct += best == example.label;
+        }
+        if (print)
+        {
+            printf("%-9s", "label");
+            for (int k = 0; k < CLASSES; k++)
+                printf(" %8s", SoundClassifier::labelName((SoundClassifier::Label)k));
+            printf("\n");
+            for (int l = 0; l < CLASSES; l++)
+            {
+                printf("%-9s", SoundClassifier::labelName((SoundClassifier::Label)l));
+                for (int k = 0; k < CLASSES; k++)
+                    printf(" %8d", confusion[l][k]);
+                printf("\n");
+            }
+        }
+        return (float)correct / examples.size();
+    }
+
+    static float evaluateFloat(const Network &net, const std::vector<Example> &examples)
+    {
+        Activations a;
+        int correct = 0;
+        for (const Example &example : examples)
+        {
+            forward(net, example, a);
+            correct += std::max_element(a.logits, a.logits + CLASSES) - a.logits == example.label;
+        }
+        return (float)correct / examples.size();
+    }
+
+    // time per frame of the features and the network, on this machine
+    static void timeClassify(Random &rng)
+    {
+        Clip clip;
+        synthesize(SoundClassifier::LABEL_SPEECH, rng, clip);
+        const int RUNS = 2000;
+        SoundClassifier::Result result;
+        int8_t features[LogMel::FEATURES], logits[CLASSES];
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < RUNS; i++)
+            LogMel::compute(clip.samples, FRAME_SAMPLES, clip.gain, features);
+        auto middle = std::chrono::steady_clock::now();
+        for (int i = 0; i < RUNS; i++)
+            SoundNet::run(SoundNet::MODEL, features, logits);
+        auto end = std::chrono::steady_clock::now();
+        SoundClassifier::classify(clip.samples, FRAME_SAMPLES, clip.gain, result);
+        printf("per frame on this host: features %.1f us, network %.1f us; arena %d bytes\n",
+               std::chrono::duration<double, std::micro>(middle - start).count() / RUNS,
+               std::chrono::duration<double, std::micro>(end - middle).count() / RUNS, SoundNet::ARENA_SIZE);
+    }
+
+    static int run(int argc, char **argv)
+    {
+        bool training = false;
+        const char *outPath = "../../src/classifier/SoundModel.cpp";
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--train")
+                training = true;
+            else if (arg == "--out" && i + 1 < argc)
+                outPath = argv[++i];
+            else
+            {
+                fprintf(stderr, "usage: %s [--train [--out FILE]]\n", argv[0]);
+                return 2;
+            }
+        }
+
+        // the test clips come from their own seed, whatever the training saw
+        Random testRng(2);
+        std::vector<Example> test = dataset(TEST_CLIPS, testRng);
+
+        if (training)
+        {
+            Random rng(1);
+            std::vector<Example> examples = dataset(TRAIN_CLIPS, rng);
+            static Network net;
+            train(net, examples, rng);
+            static Quantized q;
+            quantize(net, examples, q);
+            printf("test accuracy: float %.1f%%, int8 %.1f%%\n", 100.0f * evaluateFloat(net, test),
+                   100.0f * evaluate(q.model, test, false));
+            if (!writeModel(q, outPath))
+                return 1;
+            printf("wrote %s, rebuild to check it\n", outPath);
+            return 0;
+        }
+
+        float accuracy = evaluate(SoundNet::MODEL, test, true);
+        timeClassify(testRng);
+        printf("%s: int8 accuracy %.1f%% on %d test clips (minimum %.0f%%)\n", accuracy >= MIN_ACCURACY ? "ok" : "FAIL",
+               100.0f * accuracy, (int)test.size(), 100.0f * MIN_ACCURACY);
+        return accuracy >= MIN_ACCURACY ? 0 : 1;
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    return Classifier::run(argc, argv);
+}
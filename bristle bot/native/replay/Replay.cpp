@@ -0,0 +1,349 @@
+// replays an input trace through the firmware's localisation and orientation code.
+//
+// a trace is the serial output of a build with TRACE_INPUTS (see src/Trace.h),
+// captured with tools/log_decode.py --save. the LOG_TRACE_* records in it are applied
+// in order on the virtual clock: parameters and compass calibration first, beacon rssi
+// as adverts through the BLE shim before the same localisation update that received
+// them on the bot, and magnetometer readings through the compass code. the positions
+// and headings that come out are written as csv, hashed into a digest that only
+// changes when the output does, and the time spent in the firmware code is reported.
+//
+//   ./build/replay capture.bin --csv replay.csv
+
+#include <Arduino.h>
+#include <ArduinoBLE.h>
+#include <Sim.h>
+
+#include <Localisation.h>
+#include <Log.h>
+#include <Params.h>
+#include <orientation/CompassModule.h>
+#include <orientation/Orientation.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Replay.h"
+
+// firmware state the replay reads back
+extern CompassModule compass;      // Orientation.cpp
+extern float smoothedX, smoothedY; // Localisation.cpp
+
+namespace Replay
+{
+
+    // one log record, as written by src/Log.cpp
+    struct Record
+    {
+        uint16_t message;
+        uint32_t time; // ms
+        uint8_t argCount;
+        uint32_t args[LOG_MAX_ARGS];
+    };
+
+    static const uint32_t HEADER_SIZE = 1 + 2 + 4;
+
+    // pulls the framed records out of a capture, skipping the text between them
+    static std::vector<Record> readRecords(const std::vector<uint8_t> &data, uint32_t &badFrames)
+    {
+        std::vector<Record> records;
+        size_t i = 0;
+        while (i + 2 <= data.size())
+        {
+            if (data[i] != Log::FRAME_SYNC)
+            {
+                i++;
+                continue;
+            }
+            uint8_t length = data[i + 1];
+            if (i + 2 + length + 1 > data.size())
+                break;
+            const uint8_t *record = &data[i + 2];
+            uint8_t checksum = 0;
+            for (int j = 0; j < length; j++)
+                checksum += record[j];
+            uint8_t argCount = record[0] & 0x0F;
+            if (length < HEADER_SIZE || checksum != data[i + 2 + length] || argCount > LOG_MAX_ARGS ||
+                length != HEADER_SIZE + argCount * 4)
+            {
+                // not a real frame, resynchronise on the next sync byte
+                badFrames++;
+                i++;
+                continue;
+            }
+            Record r;
+            r.argCount = argCount;
+            memcpy(&r.message, &record[1], 2);
+            memcpy(&r.time, &record[3], 4);
+            memcpy(r.args, &record[HEADER_SIZE], argCount * 4);
+            records.push_back(r);
+            i += 2 + length + 1;
+        }
+        return records;
+    }
+
+    static int asInt(uint32_t word)
+    {
+        return (int32_t)word;
+    }
+
+    static float asFloat(uint32_t word)
+    {
+        float v;
+        memcpy(&v, &word, sizeof(v));
+        return v;
+    }
+
+    // where the replayed outputs go
+    struct Output
+    {
+        FILE *csv = nullptr;
+        uint64_t digest = 14695981039346656037ull;
+        uint32_t positions = 0;
+        uint32_t headings = 0;
+
+        // FNV-1a over every output value, so two runs can be compared by one number
+        void hash(float value)
+        {
+            uint8_t bytes[4];
+            memcpy(bytes, &value, 4);
+            for (uint8_t b : bytes)
+                digest = (digest ^ b) * 1099511628211ull;
+        }
+
+        void row(uint32_t time, const char *event, float a, float b = NAN)
+        {
+            if (csv != nullptr)
+                fprintf(csv, "%lu,%s,%g,%g\n", (unsigned long)time, event, a, b);
+        }
+    };
+
+    struct Timing
+    {
+        uint64_t calls = 0;
+        double seconds = 0.0;
+
+        template <typename F>
+        void run(F function)
+        {
+            auto start = std::chrono::steady_clock::now();
+            function();
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            calls++;
+        }
+
+        double nanosPerCall() const
+        {
+            return calls ? seconds * 1e9 / calls : 0.0;
+        }
+    };
+
+    struct State
+    {
+        Output output;
+        Timing localisation, orientation;
+        uint32_t updates = 0; // localisation updates replayed
+        bool synced = false;  // updates lined up with the trace's update count
+        float magOffset[3];
+        bool haveOffset = false, calibrated = false;
+        float lastX = NAN, lastY = NAN;
+        uint32_t time = 0;
+        uint32_t adverts = 0, rejectedParams = 0, gaps = 0;
+    };
+
+    static void moveClockTo(uint32_t ms)
+    {
+        uint64_t target = (uint64_t)ms * 1000;
+        if (target > Sim::now())
+            Sim::advance(target - Sim::now());
+    }
+
+    // runs localisation updates until as many have happened as on the bot when the
+    // record was written, so the record lands before the same update it did there
+    static void runUpdatesTo(State &state, uint32_t updates)
+    {
+        if (!state.synced)
+        {
+            // the capture may have started after boot
+            state.updates = updates;
+            state.synced = true;
+        }
+        while ((int32_t)(updates - state.updates) > 0)
+        {
+            state.localisation.run(updateLocalisation);
+            state.updates++;
+            Log::flushAll();
+            if (smoothedX != state.lastX || smoothedY != state.lastY)
+            {
+                state.lastX = smoothedX;
+                state.lastY = smoothedY;
+                state.output.hash(smoothedX);
+                state.output.hash(smoothedY);
+                state.output.row(state.time, "position", smoothedX, smoothedY);
+                state.output.positions++;
+            }
+        }
+    }
+
+    static void apply(State &state, const Record &r)
+    {
+        state.time = r.time;
+        moveClockTo(r.time);
+
+        switch (r.message)
+        {
+        case LOG_TRACE_PARAM:
+            runUpdatesTo(state, r.args[2]);
+            if (!Params::set((Params::Id)r.args[0], asFloat(r.args[1])))
+                state.rejectedParams++;
+            applyParams();
+            break;
+        case LOG_TRACE_MAG_OFFSET:
+            for (int i = 0; i < 3; i++)
+                state.magOffset[i] = asFloat(r.args[i]);
+            state.haveOffset = true;
+            break;
+        case LOG_TRACE_MAG_SCALE:
+            if (state.haveOffset)
+            {
+                float scale[3] = {asFloat(r.args[0]), asFloat(r.args[1]), asFloat(r.args[2])};
+                compass.setCalibration(state.magOffset, scale);
+                state.calibrated = true;
+            }
+            break;
+        case LOG_TRACE_RSSI:
+            runUpdatesTo(state, r.args[2]);
+            if (r.args[0] < 3)
+            {
+                // beacon ids 0..2 are the first transmitters of the shim
+                Sim::deliverAdvert(Sim::transmitter(r.args[0]), asInt(r.args[1]));
+                state.adverts++;
+            }
+            break;
+        case LOG_TRACE_MAGNETOMETER:
+            for (int i = 0; i < 3; i++)
+                magnetometerReading[i] = asInt(r.args[i]);
+            state.orientation.run(displayHeading);
+            Log::flushAll();
+            state.output.hash(getHeading());
+            state.output.row(r.time, "heading", getHeading());
+            state.output.headings++;
+            break;
+        case LOG_TRACE_SOUND:
+            state.output.row(r.time, "sound", r.args[0], r.args[1]);
+            break;
+        case LOG_TRACE_MOTORS:
+            state.output.row(r.time, "motors", r.args[0], r.args[1]);
+            break;
+        case LOG_DROPPED:
+            // records are missing here, the replay can not match the bot from this point
+            state.gaps++;
+            break;
+        }
+    }
+
+    static void usage(const char *name)
+    {
+        fprintf(stderr, "usage: %s TRACE [--csv FILE]\n", name);
+    }
+
+    static int run(int argc, char **argv)
+    {
+        const char *tracePath = nullptr;
+        const char *csvPath = nullptr;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--csv" && i + 1 < argc)
+                csvPath = argv[++i];
+            else if (arg[0] != '-' && tracePath == nullptr)
+                tracePath = argv[i];
+            else
+            {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        if (tracePath == nullptr)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        FILE *in = fopen(tracePath, "rb");
+        if (in == nullptr)
+        {
+            perror(tracePath);
+            return 1;
+        }
+        std::vector<uint8_t> data;
+        uint8_t buffer[65536];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+            data.insert(data.end(), buffer, buffer + n);
+        fclose(in);
+
+        uint32_t badFrames = 0;
+        std::vector<Record> records = readRecords(data, badFrames);
+
+        State state;
+        if (csvPath != nullptr)
+        {
+            state.output.csv = fopen(csvPath, "w");
+            if (state.output.csv == nullptr)
+            {
+                perror(csvPath);
+                return 1;
+            }
+            fprintf(state.output.csv, "time_ms,event,a,b\n");
+        }
+
+        // the same start up as setup(), minus everything that is not replayed
+        Sim::setSerialOutput(nullptr);
+        Sim::seed(1);
+        beginOrientation();
+        BLE.begin();
+        initialiseLocalisation();
+
+        uint32_t traceRecords = 0;
+        uint32_t lastUpdate = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const Record &r : records)
+        {
+            if (r.message >= LOG_TRACE_PARAM && r.message <= LOG_TRACE_MOTORS)
+                traceRecords++;
+            if (r.message == LOG_TRACE_RSSI)
+                lastUpdate = r.args[2];
+            apply(state, r);
+        }
+        // the last adverts are taken in by the update after them
+        if (state.synced)
+            runUpdatesTo(state, lastUpdate + 1);
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (state.output.csv != nullptr)
+            fclose(state.output.csv);
+
+        fprintf(stderr, "%u trace records (%zu log records, %u bad frames) covering %.1f s, replayed in %.3f s\n",
+                traceRecords, records.size(), badFrames, state.time / 1000.0, wall);
+        fprintf(stderr, "%u adverts, %u localisation updates (%.0f ns each), %u positions\n",
+                state.adverts, (unsigned)state.localisation.calls, state.localisation.nanosPerCall(), state.output.positions);
+        fprintf(stderr, "%u magnetometer readings (%.0f ns each)\n",
+                state.output.headings, state.orientation.nanosPerCall());
+        if (!state.calibrated && state.output.headings > 0)
+            fprintf(stderr, "warning: no compass calibration in the trace, headings are uncalibrated\n");
+        if (state.rejectedParams > 0)
+            fprintf(stderr, "warning: %u parameters out of range for this build\n", state.rejectedParams);
+        if (state.gaps > 0)
+            fprintf(stderr, "warning: %u gaps where the bot dropped log records, the output will differ from the bot's\n", state.gaps);
+        printf("digest %016llx\n", (unsigned long long)state.output.digest);
+        return 0;
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    return Replay::run(argc, argv);
+}
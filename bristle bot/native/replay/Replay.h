@@ -0,0 +1,10 @@
+#pragma once
+
+// shared between the replay harness and its Trace implementation
+namespace Replay
+{
+
+    // the magnetometer reading Trace::magnetometer() hands to the compass code
+    extern int magnetometerReading[3];
+
+}
@@ -0,0 +1,38 @@
+#include <Trace.h>
+
+#include "Replay.h"
+
+// Trace as linked into the replay harness: nothing is recorded, and the compass
+// code gets the magnetometer reading being replayed instead of the simulated one
+namespace Replay
+{
+
+    int magnetometerReading[3] = {0, 0, 0};
+
+}
+
+namespace Trace
+{
+
+    void begin() {}
+
+    void params() {}
+
+    void calibration(const float offset[3], const float scale[3]) {}
+
+    void localisationUpdate() {}
+
+    void rssi(uint8_t beacon, int rssi) {}
+
+    void magnetometer(int &x, int &y, int &z)
+    {
+        x = Replay::magnetometerReading[0];
+        y = Replay::magnetometerReading[1];
+        z = Replay::magnetometerReading[2];
+    }
+
+    void soundFrame(uint8_t mean, uint16_t peak, uint8_t gain) {}
+
+    void motors(bool left, bool right) {}
+
+}
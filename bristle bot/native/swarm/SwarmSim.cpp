@@ -0,0 +1,670 @@
+// swarm simulator: thousands of copies of the bot firmware in one process.
+//
+// the firmware keeps all of its state in globals, so a bot is just a copy of the
+// writable data of the firmware's shared object (.data and .bss). each worker
+// thread loads its own copy of build/firmware.so and runs its shard of bots one
+// after another for each time slice, swapping their images in and out of that
+// copy. between slices the bots' positions and adverts go into a spatial hash,
+// and every bot hears the advertising bots in radio range (plus the beacons)
+// during the next slice.
+//
+//   ./build/swarm --bots 5000 --minutes 10 --arena 60 --csv positions.csv
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SimApi.h"
+
+namespace Swarm
+{
+
+    struct SoundSource
+    {
+        float x, y, level;
+    };
+
+    struct Options
+    {
+        int bots = 100;
+        double minutes = 1.0;
+        float arena = 10.0;        // side of the square arena (m), centred on the beacons
+        int sliceMillis = 100;     // bots exchange radio state every slice
+        int threads = std::max(1u, std::thread::hardware_concurrency());
+        uint32_t seed = 1;
+        int mode = 0;              // behaviour mode of every bot
+        float rssiNoise = 2.0;     // shadowing (dB)
+        bool fading = true;
+        float compassNoise = 4.0;  // counts per axis
+        float sensitivity = -95.0; // weakest advert a bot can receive (dBm)
+        int maxNeighbours = 48;    // strongest neighbours offered to each bot per slice
+        float ambientSound = 20.0;
+        float micDirectivity = 0.0; // front to back ratio of every bot's mic (dB)
+        std::vector<SoundSource> sounds;
+        std::string csv;
+        int traceBot = -1;         // bot whose serial output goes to stdout
+        std::string library = "build/firmware.so";
+    };
+
+    // radio constants of a bot's own advertising, the same as the beacons
+    static const float BOT_RSSI_AT_1M = -65.37;
+    static const float BOT_PATH_LOSS = 2.68;
+    static const char *BOT_NAME = "BristleBot";
+
+    // bots power on at a random time in this window, so their scan phases are not aligned
+    static const uint64_t POWER_ON_WINDOW = 2000000;
+
+    // entry points of one loaded copy of the firmware
+    struct FirmwareApi
+    {
+        decltype(&sim_reset) reset;
+        decltype(&sim_boot) boot;
+        decltype(&sim_run_until) runUntil;
+        decltype(&sim_set_sound) setSound;
+        decltype(&sim_set_radio) setRadio;
+        decltype(&sim_set_neighbours) setNeighbours;
+        decltype(&sim_set_serial) setSerial;
+        decltype(&sim_flash) flash;
+        decltype(&sim_get_state) getState;
+    };
+
+    struct Bot
+    {
+        int worker;
+        std::vector<uint8_t> image;
+        uint64_t powerOn;
+        bool booted;
+        float startX, startY, startHeading;
+        SimBotState state;
+    };
+
+    struct Worker
+    {
+        void *handle;
+        uint8_t *segment; // writable data of this copy, swapped per bot
+        size_t segmentSize;
+        std::vector<uint8_t> pristine; // the segment as loaded, before any bot ran
+        FirmwareApi api;
+        std::vector<int> bots;
+        std::vector<Sim::Transmitter> neighbours;
+        std::thread thread;
+    };
+
+    // ############ Loading #############
+
+    struct SegmentSearch
+    {
+        ElfW(Addr) base;
+        uintptr_t start, end;
+    };
+
+    static int findSegment(struct dl_phdr_info *info, size_t size, void *data)
+    {
+        SegmentSearch *search = (SegmentSearch *)data;
+        if (info->dlpi_addr != search->base)
+            return 0;
+
+        uintptr_t page = sysconf(_SC_PAGESIZE);
+        uintptr_t relroEnd = 0;
+        for (int i = 0; i < info->dlpi_phnum; i++)
+        {
+            const ElfW(Phdr) &phdr = info->dlpi_phdr[i];
+            if (phdr.p_type == PT_GNU_RELRO)
+                relroEnd = (info->dlpi_addr + phdr.p_vaddr + phdr.p_memsz + page - 1) & ~(page - 1);
+        }
+        for (int i = 0; i < info->dlpi_phnum; i++)
+        {
+            const ElfW(Phdr) &phdr = info->dlpi_phdr[i];
+            if (phdr.p_type != PT_LOAD || !(phdr.p_flags & PF_W))
+                continue;
+            uintptr_t start = info->dlpi_addr + phdr.p_vaddr;
+            uintptr_t end = start + phdr.p_memsz;
+            // the relro part is read only after loading, and the same for every bot
+            search->start = std::max(start, std::min(relroEnd, end));
+            search->end = end;
+        }
+        return 1;
+    }
+
+    static bool copyFile(const char *from, int to)
+    {
+        int in = open(from, O_RDONLY);
+        if (in < 0)
+            return false;
+        char buffer[65536];
+        ssize_t n;
+        bool ok = true;
+        while ((n = read(in, buffer, sizeof(buffer))) > 0)
+        {
+            if (write(to, buffer, n) != n)
+                ok = false;
+        }
+        close(in);
+        return ok && n == 0;
+    }
+
+    template <typename T>
+    static bool lookup(void *handle, const char *name, T &function)
+    {
+        function = (T)dlsym(handle, name);
+        if (function == nullptr)
+            fprintf(stderr, "missing %s in the firmware library\n", name);
+        return function != nullptr;
+    }
+
+    static bool loadFirmware(const std::string &library, Worker &worker)
+    {
+        // dlopen only loads a file once, so each worker opens a private copy to get its own globals
+        char path[] = "/tmp/bristle-swarm-XXXXXX.so";
+        int fd = mkstemps(path, 3);
+        if (fd < 0 || !copyFile(library.c_str(), fd))
+        {
+            fprintf(stderr, "could not copy %s\n", library.c_str());
+            return false;
+        }
+        close(fd);
+        worker.handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+        unlink(path);
+        if (worker.handle == nullptr)
+        {
+            fprintf(stderr, "%s\n", dlerror());
+            return false;
+        }
+
+        struct link_map *map;
+        dlinfo(worker.handle, RTLD_DI_LINKMAP, &map);
+        SegmentSearch search = {map->l_addr, 0, 0};
+        dl_iterate_phdr(findSegment, &search);
+        if (search.end <= search.start)
+        {
+            fprintf(stderr, "no writable segment in %s\n", library.c_str());
+            return false;
+        }
+        worker.segment = (uint8_t *)search.start;
+        worker.segmentSize = search.end - search.start;
+        worker.pristine.assign(worker.segment, worker.segment + worker.segmentSize);
+
+        FirmwareApi &api = worker.api;
+        return lookup(worker.handle, "sim_reset", api.reset) &&
+               lookup(worker.handle, "sim_boot", api.boot) &&
+               lookup(worker.handle, "sim_run_until", api.runUntil) &&
+               lookup(worker.handle, "sim_set_sound", api.setSound) &&
+               lookup(worker.handle, "sim_set_radio", api.setRadio) &&
+               lookup(worker.handle, "sim_set_neighbours", api.setNeighbours) &&
+               lookup(worker.handle, "sim_set_serial", api.setSerial) &&
+               lookup(worker.handle, "sim_flash", api.flash) &&
+               lookup(worker.handle, "sim_get_state", api.getState);
+    }
+
+    // ############ Spatial hash #############
+
+    // bots bucketed into square cells the size of the radio range, rebuilt every slice
+    class Grid
+    {
+    public:
+        void build(const std::vector<Bot> &bots, float arena, float range)
+        {
+            cell = range;
+            origin = -arena / 2.0;
+            dim = std::max(1, (int)ceil(arena / cell));
+            cellStart.assign(dim * dim + 1, 0);
+            entries.resize(bots.size());
+
+            // counting sort of the advertising bots by cell
+            std::vector<int> cells(bots.size(), -1);
+            for (size_t i = 0; i < bots.size(); i++)
+            {
+                if (!bots[i].booted || !bots[i].state.advertising)
+                    continue;
+                cells[i] = cellOf(bots[i].state.x, bots[i].state.y);
+                cellStart[cells[i] + 1]++;
+            }
+            for (int c = 0; c < dim * dim; c++)
+                cellStart[c + 1] += cellStart[c];
+            std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+            for (size_t i = 0; i < bots.size(); i++)
+            {
+                if (cells[i] >= 0)
+                    entries[fill[cells[i]]++] = i;
+            }
+        }
+
+        // calls visit(index) for every advertising bot in the cells around (x, y)
+        template <typename Visit>
+        void query(float x, float y, Visit visit) const
+        {
+            int cx = std::min(dim - 1, std::max(0, (int)((x - origin) / cell)));
+            int cy = std::min(dim - 1, std::max(0, (int)((y - origin) / cell)));
+            for (int gy = std::max(0, cy - 1); gy <= std::min(dim - 1, cy + 1); gy++)
+            {
+                for (int gx = std::max(0, cx - 1); gx <= std::min(dim - 1, cx + 1); gx++)
+                {
+                    int c = gy * dim + gx;
+                    for (int e = cellStart[c]; e < cellStart[c + 1]; e++)
+                        visit(entries[e]);
+                }
+            }
+        }
+
+    private:
+        int cellOf(float x, float y) const
+        {
+            int cx = std::min(dim - 1, std::max(0, (int)((x - origin) / cell)));
+            int cy = std::min(dim - 1, std::max(0, (int)((y - origin) / cell)));
+            return cy * dim + cx;
+        }
+
+        float cell = 1.0;
+        float origin = 0.0;
+        int dim = 1;
+        std::vector<int> cellStart;
+        std::vector<int> entries;
+    };
+
+    // ############ Simulation #############
+
+    class Barrier
+    {
+    public:
+        explicit Barrier(int count) : count(count), waiting(0), generation(0) {}
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            int current = generation;
+            if (++waiting == count)
+            {
+                waiting = 0;
+                generation++;
+                changed.notify_all();
+                return;
+            }
+            changed.wait(lock, [&] { return generation != current; });
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable changed;
+        int count, waiting, generation;
+    };
+
+    struct Simulation
+    {
+        Options options;
+        std::vector<Bot> bots;
+        std::vector<Worker> workers;
+        std::vector<uint8_t> factoryFlash; // flash of a calibrated bot, copied into every bot
+        Grid grid;
+        float range = 0.0;
+        uint64_t sliceEnd = 0;
+        bool finished = false;
+    };
+
+    // the sound level at a point, and the direction it comes from: the sources' directions
+    // (degrees clockwise from north) averaged by how loud each one is there
+    static float soundAt(const Options &options, float x, float y, float *bearing)
+    {
+        float level = options.ambientSound;
+        float east = 0.0, north = 0.0;
+        for (const SoundSource &source : options.sounds)
+        {
+            float d = hypotf(x - source.x, y - source.y);
+            float heard = source.level / (1.0 + d);
+            level += heard;
+            if (d > 0.0)
+            {
+                east += heard * (source.x - x) / d;
+                north += heard * (source.y - y) / d;
+            }
+        }
+        *bearing = fmod(atan2(east, north) * 180.0 / M_PI + 360.0, 360.0);
+        return level;
+    }
+
+    static void setSound(const Options &options, Worker &worker, float x, float y)
+    {
+        float bearing;
+        float level = soundAt(options, x, y, &bearing);
+        worker.api.setSound(level, bearing, options.micDirectivity);
+    }
+
+    // the advertising bots in range of a bot, strongest (nearest) first if there are too many
+    static void findNeighbours(const Simulation &sim, int self, std::vector<Sim::Transmitter> &out)
+    {
+        const Bot &bot = sim.bots[self];
+        float x = bot.state.x, y = bot.state.y;
+        float range2 = sim.range * sim.range;
+
+        struct Candidate
+        {
+            int index;
+            float distance2;
+        };
+        thread_local std::vector<Candidate> candidates;
+        candidates.clear();
+        sim.grid.query(x, y, [&](int other)
+        {
+            if (other == self)
+                return;
+            float dx = sim.bots[other].state.x - x;
+            float dy = sim.bots[other].state.y - y;
+            float d2 = dx * dx + dy * dy;
+            if (d2 <= range2)
+                candidates.push_back({other, d2});
+        });
+        int limit = std::min((int)candidates.size(), std::min(sim.options.maxNeighbours, Sim::MAX_TRANSMITTERS - 3));
+        if ((int)candidates.size() > limit)
+        {
+            std::nth_element(candidates.begin(), candidates.begin() + limit, candidates.end(),
+                             [](const Candidate &a, const Candidate &b) { return a.distance2 < b.distance2; });
+        }
+
+        out.resize(limit);
+        for (int i = 0; i < limit; i++)
+        {
+            const Bot &other = sim.bots[candidates[i].index];
+            Sim::Transmitter &t = out[i];
+            memset(&t, 0, sizeof(t));
+            strncpy(t.name, BOT_NAME, sizeof(t.name) - 1);
+            uint32_t id = candidates[i].index;
+            uint8_t address[6] = {0xc0, 0xff, 0xee, (uint8_t)(id >> 16), (uint8_t)(id >> 8), (uint8_t)id};
+            memcpy(t.address, address, sizeof(address));
+            t.x = other.state.x;
+            t.y = other.state.y;
+            t.rssiAt1m = BOT_RSSI_AT_1M;
+            t.pathLossExponent = BOT_PATH_LOSS;
+            t.manufacturerLength = other.state.manufacturerLength;
+            memcpy(t.manufacturerData, other.state.manufacturerData, t.manufacturerLength);
+        }
+    }
+
+    static void startBot(Simulation &sim, Worker &worker, int index)
+    {
+        Bot &bot = sim.bots[index];
+        memcpy(worker.segment, worker.pristine.data(), worker.segmentSize);
+        worker.api.setSerial(index == sim.options.traceBot ? stdout : nullptr);
+        worker.api.reset(sim.options.seed * 1000003u + index, bot.powerOn, bot.startX, bot.startY, bot.startHeading,
+                         sim.options.mode, sim.options.arena / 2.0);
+        worker.api.setRadio(sim.options.rssiNoise, sim.options.fading, sim.options.compassNoise);
+        for (int slot = 0; slot < Sim::FLASH_SLOTS; slot++)
+        {
+            memcpy(worker.api.flash(slot), &sim.factoryFlash[slot * Sim::FLASH_SLOT_SIZE], Sim::FLASH_SLOT_SIZE);
+        }
+        setSound(sim.options, worker, bot.startX, bot.startY);
+        worker.api.boot();
+        bot.booted = true;
+    }
+
+    static void stepBot(Simulation &sim, Worker &worker, int index)
+    {
+        Bot &bot = sim.bots[index];
+        if (bot.powerOn >= sim.sliceEnd)
+            return;
+
+        if (!bot.booted)
+        {
+            startBot(sim, worker, index);
+        }
+        else
+        {
+            memcpy(worker.segment, bot.image.data(), worker.segmentSize);
+        }
+
+        findNeighbours(sim, index, worker.neighbours);
+        worker.api.setNeighbours(worker.neighbours.data(), worker.neighbours.size());
+        setSound(sim.options, worker, bot.state.x, bot.state.y);
+        worker.api.runUntil(sim.sliceEnd);
+        worker.api.getState(&bot.state);
+
+        bot.image.assign(worker.segment, worker.segment + worker.segmentSize);
+    }
+
+    // boots one bot fully, with the compass calibration, and keeps its flash for the rest
+    static void calibrateFactoryBot(Simulation &sim, Worker &worker)
+    {
+        memcpy(worker.segment, worker.pristine.data(), worker.segmentSize);
+        worker.api.setSerial(nullptr);
+        worker.api.reset(sim.options.seed, 0, 0.0, 0.0, 0.0, sim.options.mode, sim.options.arena / 2.0);
+        worker.api.boot();
+        sim.factoryFlash.resize(Sim::FLASH_SLOTS * Sim::FLASH_SLOT_SIZE);
+        for (int slot = 0; slot < Sim::FLASH_SLOTS; slot++)
+        {
+            memcpy(&sim.factoryFlash[slot * Sim::FLASH_SLOT_SIZE], worker.api.flash(slot), Sim::FLASH_SLOT_SIZE);
+        }
+    }
+
+    static void writeCsv(FILE *csv, const Simulation &sim)
+    {
+        for (size_t i = 0; i < sim.bots.size(); i++)
+        {
+            const Bot &bot = sim.bots[i];
+            if (!bot.booted)
+                continue;
+            const SimBotState &s = bot.state;
+            // the bot's own position estimate, as it advertises it (0-255 over -2..2 m)
+            float estX = s.manufacturerLength >= 4 ? s.manufacturerData[2] / 255.0 * 4.0 - 2.0 : NAN;
+            float estY = s.manufacturerLength >= 4 ? s.manufacturerData[3] / 255.0 * 4.0 - 2.0 : NAN;
+            fprintf(csv, "%.1f,%zu,%.3f,%.3f,%.1f,%.3f,%.3f,%d,%u\n",
+                    sim.sliceEnd / 1e6, i, s.x, s.y, s.heading, estX, estY, s.advertising, s.advertsReceived);
+        }
+    }
+
+    static void usage(const char *name)
+    {
+        fprintf(stderr,
+                "usage: %s [--bots N] [--minutes M] [--arena METRES] [--slice-ms MS] [--threads N]\n"
+                "          [--seed N] [--mode 0|1] [--rssi-noise DB] [--no-fading] [--compass-noise COUNTS]\n"
+                "          [--sensitivity DBM] [--max-neighbours N] [--ambient LEVEL] [--sound X,Y,LEVEL]...\n"
+                "          [--mic-directivity DB] [--csv FILE] [--trace-bot N] [--library PATH]\n",
+                name);
+    }
+
+    static bool parseOptions(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--no-fading")
+            {
+                options.fading = false;
+                continue;
+            }
+            if (i + 1 >= argc)
+                return false;
+            const char *value = argv[++i];
+            if (arg == "--bots")
+                options.bots = atoi(value);
+            else if (arg == "--minutes")
+                options.minutes = atof(value);
+            else if (arg == "--arena")
+                options.arena = atof(value);
+            else if (arg == "--slice-ms")
+                options.sliceMillis = atoi(value);
+            else if (arg == "--threads")
+                options.threads = atoi(value);
+            else if (arg == "--seed")
+                options.seed = strtoul(value, nullptr, 0);
+            else if (arg == "--mode")
+                options.mode = atoi(value);
+            else if (arg == "--rssi-noise")
+                options.rssiNoise = atof(value);
+            else if (arg == "--compass-noise")
+                options.compassNoise = atof(value);
+            else if (arg == "--sensitivity")
+                options.sensitivity = atof(value);
+            else if (arg == "--max-neighbours")
+                options.maxNeighbours = atoi(value);
+            else if (arg == "--ambient")
+                options.ambientSound = atof(value);
+            else if (arg == "--mic-directivity")
+                options.micDirectivity = atof(value);
+            else if (arg == "--sound")
+            {
+                SoundSource source;
+                if (sscanf(value, "%f,%f,%f", &source.x, &source.y, &source.level) != 3)
+                    return false;
+                options.sounds.push_back(source);
+            }
+            else if (arg == "--csv")
+                options.csv = value;
+            else if (arg == "--trace-bot")
+                options.traceBot = atoi(value);
+            else if (arg == "--library")
+                options.library = value;
+            else
+                return false;
+        }
+        return options.bots > 0 && options.threads > 0 && options.sliceMillis > 0 && options.arena > 0;
+    }
+
+    static int run(int argc, char **argv)
+    {
+        Simulation sim;
+        Options &options = sim.options;
+        if (!parseOptions(argc, argv, options))
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        if (options.sounds.empty())
+            options.sounds.push_back({0.0, 0.0, 200.0});
+        options.threads = std::min(options.threads, options.bots);
+
+        // distance at which a bot's adverts fall below the receiver sensitivity
+        sim.range = pow(10.0, (BOT_RSSI_AT_1M - options.sensitivity) / (10.0 * BOT_PATH_LOSS));
+
+        sim.workers.resize(options.threads);
+        for (Worker &worker : sim.workers)
+        {
+            if (!loadFirmware(options.library, worker))
+                return 1;
+        }
+        calibrateFactoryBot(sim, sim.workers[0]);
+
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<float> position(-options.arena / 2.0, options.arena / 2.0);
+        std::uniform_real_distribution<float> heading(0.0, 360.0);
+        std::uniform_int_distribution<uint64_t> powerOn(0, POWER_ON_WINDOW);
+        sim.bots.resize(options.bots);
+        for (int i = 0; i < options.bots; i++)
+        {
+            Bot &bot = sim.bots[i];
+            // images hold absolute addresses of one loaded copy, so a bot stays on its worker
+            bot.worker = i % options.threads;
+            bot.powerOn = powerOn(rng);
+            bot.booted = false;
+            bot.startX = position(rng);
+            bot.startY = position(rng);
+            bot.startHeading = heading(rng);
+            memset(&bot.state, 0, sizeof(bot.state));
+            bot.state.x = bot.startX;
+            bot.state.y = bot.startY;
+            sim.workers[bot.worker].bots.push_back(i);
+        }
+
+        FILE *csv = nullptr;
+        if (!options.csv.empty())
+        {
+            csv = fopen(options.csv.c_str(), "w");
+            if (csv == nullptr)
+            {
+                perror(options.csv.c_str());
+                return 1;
+            }
+            fprintf(csv, "time,bot,x,y,heading,est_x,est_y,advertising,adverts_received\n");
+        }
+
+        uint64_t slice = (uint64_t)options.sliceMillis * 1000;
+        uint64_t end = (uint64_t)(options.minutes * 60e6);
+        uint64_t csvEvery = std::max<uint64_t>(1, 1000000 / slice);
+        Barrier start(options.threads + 1), done(options.threads + 1);
+
+        for (Worker &worker : sim.workers)
+        {
+            worker.thread = std::thread([&sim, &worker, &start, &done]()
+            {
+                while (true)
+                {
+                    start.wait();
+                    if (sim.finished)
+                        return;
+                    for (int index : worker.bots)
+                        stepBot(sim, worker, index);
+                    done.wait();
+                }
+            });
+        }
+
+        auto wallStart = std::chrono::steady_clock::now();
+        uint64_t slices = 0;
+        for (sim.sliceEnd = slice; sim.sliceEnd <= end; sim.sliceEnd += slice)
+        {
+            sim.grid.build(sim.bots, options.arena, sim.range);
+            start.wait();
+            done.wait();
+            if (csv != nullptr && ++slices % csvEvery == 0)
+                writeCsv(csv, sim);
+            if (sim.sliceEnd % 60000000 == 0)
+            {
+                double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+                fprintf(stderr, "%4.0f s simulated, %.1f s wall\n", sim.sliceEnd / 1e6, wall);
+            }
+        }
+        sim.finished = true;
+        start.wait();
+        for (Worker &worker : sim.workers)
+            worker.thread.join();
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+        if (csv != nullptr)
+            fclose(csv);
+
+        // summary: speed, protocol load and how well the bots near the beacons localise
+        double seconds = end / 1e6;
+        uint64_t adverts = 0, serial = 0;
+        double error = 0.0;
+        int located = 0;
+        for (const Bot &bot : sim.bots)
+        {
+            adverts += bot.state.advertsReceived;
+            serial += bot.state.serialBytes;
+            const SimBotState &s = bot.state;
+            if (fabs(s.x) < 1.5 && fabs(s.y) < 1.5 && s.manufacturerLength >= 4)
+            {
+                float estX = s.manufacturerData[2] / 255.0 * 4.0 - 2.0;
+                float estY = s.manufacturerData[3] / 255.0 * 4.0 - 2.0;
+                error += hypot(estX - s.x, estY - s.y);
+                located++;
+            }
+        }
+        fprintf(stderr, "%d bots, %.0f s each in %.1f s wall (%.0fx real time overall) on %d threads\n",
+                options.bots, seconds, wall, options.bots * seconds / wall, options.threads);
+        fprintf(stderr, "image %zu bytes per bot, radio range %.1f m\n", sim.workers[0].segmentSize, sim.range);
+        fprintf(stderr, "adverts received per bot: %.2f/s, serial output per bot: %.0f B/s\n",
+                adverts / (double)options.bots / seconds, serial / (double)options.bots / seconds);
+        if (located > 0)
+            fprintf(stderr, "bots near the beacons: %d, mean advertised position error %.2f m\n", located, error / located);
+
+        fflush(stdout);
+        // the loaded copies still hold every bot's static destructors, skip them
+        _exit(0);
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    return Swarm::run(argc, argv);
+}
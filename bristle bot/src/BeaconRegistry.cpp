@@ -0,0 +1,112 @@
+#include "BeaconRegistry.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace BeaconRegistry
+{
+
+    static Beacon beacons[MAX_BEACONS];
+    static bool inUse[MAX_BEACONS] = {false};
+
+    static int16_t readInt16(const uint8_t *data)
+    {
+        return (int16_t)(data[0] | data[1] << 8);
+    }
+
+    static void writeInt16(uint8_t *data, long value)
+    {
+        int16_t clamped = value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+        data[0] = (uint16_t)clamped & 0xFF;
+        data[1] = (uint16_t)clamped >> 8;
+    }
+
+    bool parseFrame(const uint8_t *data, int length, Beacon &beacon)
+    {
+        if (length < FRAME_SIZE || (data[0] | data[1] << 8) != COMPANY_ID || data[2] != FRAME_VERSION)
+            return false;
+        beacon.id = data[3];
+        beacon.x = readInt16(data + 4) / 100.0f;
+        beacon.y = readInt16(data + 6) / 100.0f;
+        beacon.rssiAt1m = readInt16(data + 8) / 100.0f;
+        beacon.pathLossExponent = (uint16_t)readInt16(data + 10) / 100.0f;
+        beacon.described = true;
+        beacon.lastHeard = 0;
+        // a beacon that can not be turned into a distance is no use
+        return beacon.pathLossExponent > 0.0f;
+    }
+
+    void writeFrame(const Beacon &beacon, uint8_t *data)
+    {
+        data[0] = COMPANY_ID & 0xFF;
+        data[1] = COMPANY_ID >> 8;
+        data[2] = FRAME_VERSION;
+        data[3] = beacon.id;
+        writeInt16(data + 4, lroundf(beacon.x * 100.0f));
+        writeInt16(data + 6, lroundf(beacon.y * 100.0f));
+        writeInt16(data + 8, lroundf(beacon.rssiAt1m * 100.0f));
+        long exponent = lroundf(beacon.pathLossExponent * 100.0f);
+        data[10] = exponent & 0xFF;
+        data[11] = (exponent >> 8) & 0xFF;
+    }
+
+    void clear()
+    {
+        for (int i = 0; i < MAX_BEACONS; i++)
+            inUse[i] = false;
+    }
+
+    int find(uint8_t id)
+    {
+        for (int i = 0; i < MAX_BEACONS; i++)
+        {
+            if (inUse[i] && beacons[i].id == id)
+                return i;
+        }
+        return -1;
+    }
+
+    int update(const Beacon &beacon, uint32_t now, uint32_t staleMillis, bool &added)
+    {
+        int slot = find(beacon.id);
+        added = slot < 0;
+        if (slot >= 0)
+        {
+            if (beacon.described || !beacons[slot].described)
+                beacons[slot] = beacon;
+            beacons[slot].lastHeard = now;
+            return slot;
+        }
+
+        // a free slot, else the stalest
+        int stalest = -1;
+        for (int i = 0; i < MAX_BEACONS && slot < 0; i++)
+        {
+            if (!inUse[i])
+                slot = i;
+            else if (stalest < 0 || now - beacons[i].lastHeard > now - beacons[stalest].lastHeard)
+                stalest = i;
+        }
+        if (slot < 0)
+        {
+            if (now - beacons[stalest].lastHeard <= staleMillis)
+                return -1;
+            slot = stalest;
+        }
+        beacons[slot] = beacon;
+        beacons[slot].lastHeard = now;
+        inUse[slot] = true;
+        return slot;
+    }
+
+    bool used(int slot)
+    {
+        return inUse[slot];
+    }
+
+    const Beacon &at(int slot)
+    {
+        return beacons[slot];
+    }
+
+}
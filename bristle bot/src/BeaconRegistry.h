@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+// the beacons a bot has heard, built up from scans instead of compiled in. a
+// beacon advertises a manufacturer data frame under COMPANY_ID with its id, its
+// position and the calibration of its signal (see beacon/setup.py), so a beacon
+// can be moved or added without touching the bots. the older beacons that only
+// advertise the name RasPi1..3 are still taken, as ids 0..2 with the positions
+// and calibration from Params. the registry holds MAX_BEACONS; when it is full a
+// new beacon takes the place of one that has not been heard for a while.
+namespace BeaconRegistry
+{
+
+    static const int MAX_BEACONS = 16;
+
+    // company id of the beacon frame (the bots' own frames are 0xFFFF and 0xFFFE)
+    static const uint16_t COMPANY_ID = 0xFFFD;
+    static const uint8_t FRAME_VERSION = 1;
+
+    // company id (2), version (1), id (1), x and y in cm (int16 each), rssi at 1 m
+    // in 0.01 dBm (int16) and the path loss exponent in 0.01 (uint16), little endian
+    static const int FRAME_SIZE = 12;
+
+    struct Beacon
+    {
+        uint8_t id;
+        float x, y; // position (m)
+        float rssiAt1m;
+        float pathLossExponent;
+        bool described;     // the position came from the beacon's own frame, not from Params
+        uint32_t lastHeard; // millis()
+    };
+
+    // reads a beacon frame from an advert's manufacturer data, false if it is not one
+    bool parseFrame(const uint8_t *data, int length, Beacon &beacon);
+
+    // the frame a beacon advertises, FRAME_SIZE bytes
+    void writeFrame(const Beacon &beacon, uint8_t *data);
+
+    void clear();
+
+    // records that a beacon was heard at now. a new beacon is added, or replaces the
+    // one heard longest ago if that was more than staleMillis ago. a described entry
+    // keeps its description when the beacon is heard by name only. returns the slot,
+    // -1 if there is no room, and sets added when the slot is new to this beacon
+    int update(const Beacon &beacon, uint32_t now, uint32_t staleMillis, bool &added);
+
+    // slot of a beacon id, -1 if it is not in the registry
+    int find(uint8_t id);
+
+    bool used(int slot);
+    const Beacon &at(int slot);
+
+}
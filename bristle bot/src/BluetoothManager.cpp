@@ -2,16 +2,13 @@
 
 #include <Arduino.h>
 #include <ArduinoBLE.h>
-#include <cstdint>
-
 #include "Communication.h"
+#include "Log.h"
 #include "Localisation.h"
 
 namespace BLEManager
 {
 
-    static const uint32_t SWAP_INTERVAL = 1000;
-
     void setupBLE()
     {
         if (!BLE.begin())
@@ -29,17 +26,13 @@ namespace BLEManager
     }
 
     static bool scanning = false;
-    static uint32_t lastSwap = 0;
 
     void swapClientServer()
     {
-        uint32_t now = millis();
-        if (lastSwap + SWAP_INTERVAL > now)
-            return;
         if (!scanning)
         {
             Comms::stopAdvertiseBLE();
-            Serial.println("Starting scan mode...");
+            LOG_DEBUG(LOG_SCAN_START);
             digitalWrite(LED_BLUE, LOW);
             delay(50);
             BLE.scan(false); // Start scanning for devices
@@ -54,7 +47,6 @@ namespace BLEManager
             Comms::advertiseBLE();
             scanning = false;
         }
-        lastSwap = now;
     }
 
     bool isScanning()
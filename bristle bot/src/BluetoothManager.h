@@ -1,12 +1,14 @@
 #pragma once
 
+#include <cstdint>
+
 namespace BLEManager
 {
 
     // initialises BLE system
     void setupBLE();
 
-    // swaps the BLE between scanning and advertising based on internal delay
+    // swaps the BLE between scanning and advertising, call every Params::values.swapInterval ms
     void swapClientServer();
 
     // provides that status of the BLE system
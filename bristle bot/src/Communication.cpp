@@ -3,6 +3,8 @@
 #include <Arduino.h>
 #include <ArduinoBLE.h>
 
+#include "Log.h"
+
 #include <vector>
 
 namespace Comms
@@ -16,6 +18,16 @@ namespace Comms
 
     static const char *LOCAL_NAME = "BristleBot";
 
+    static uint8_t frames[FRAME_TYPE_COUNT][MAX_FRAME_PAYLOAD];
+    static uint8_t frameLengths[FRAME_TYPE_COUNT] = {0};
+    static uint8_t nextFrame = 0;
+    // a frame type sent in one advertising phase out of every sharedEvery (set_frame_share)
+    static uint8_t sharedFrame = 0;
+    static uint8_t sharedEvery = 0;
+    static uint8_t sharedPhase = 0;
+
+    static bool advertisedOnce = false;
+
     std::vector<uint8_t> create_manuf_data_packet()
     {
         std::vector<uint8_t> out = std::vector<uint8_t>(7);
@@ -38,6 +50,46 @@ namespace Comms
         return packet;
     }
 
+    // builds the scan response for one frame type
+    static void put_frame(BLEAdvertisingData &packet, uint8_t type)
+    {
+        uint8_t data[3 + MAX_FRAME_PAYLOAD];
+        data[0] = 0xFE;
+        data[1] = 0xFF;
+        data[2] = type;
+        memcpy(&data[3], frames[type], frameLengths[type]);
+        packet.setManufacturerData(data, 3 + frameLengths[type]);
+    }
+
+    // picks the frame for this advertising phase: the one with a share of its own when
+    // its turn comes, else the next of the others that has data
+    static bool set_frame_data(BLEAdvertisingData &packet)
+    {
+        bool shared = sharedEvery > 0 && frameLengths[sharedFrame] > 0;
+        if (shared && sharedPhase++ % sharedEvery == 0)
+        {
+            put_frame(packet, sharedFrame);
+            return true;
+        }
+        for (int i = 0; i < FRAME_TYPE_COUNT; i++)
+        {
+            uint8_t type = (nextFrame + i) % FRAME_TYPE_COUNT;
+            if (frameLengths[type] == 0 || (shared && type == sharedFrame))
+                continue;
+
+            put_frame(packet, type);
+            nextFrame = (type + 1) % FRAME_TYPE_COUNT;
+            return true;
+        }
+        // nothing else to send, the shared frame has the phase after all
+        if (shared)
+        {
+            put_frame(packet, sharedFrame);
+            return true;
+        }
+        return false;
+    }
+
     void setupCommunication()
     {
 
@@ -50,16 +102,28 @@ namespace Comms
 
     void advertiseBLE()
     {
-        Serial.println("Advertising BLE...");
+        LOG_DEBUG(LOG_ADVERTISE_START);
 
         // Create a custom advertisement packet
 
         BLEAdvertisingData data = set_manuf_data();
         BLE.setAdvertisingData(data);
 
+        BLEAdvertisingData scanResponse;
+        if (set_frame_data(scanResponse))
+        {
+            BLE.setScanResponseData(scanResponse);
+        }
+
         if (!BLE.advertise())
         {
-            Serial.println("Error Setting advertisement");
+            LOG_ERROR(LOG_ADVERTISE_FAILED);
+        }
+        else if (!advertisedOnce)
+        {
+            // time to first telemetry, the main figure for boot speed
+            LOG_INFO(LOG_FIRST_TELEMETRY, millis());
+            advertisedOnce = true;
         }
     }
 
@@ -84,10 +148,28 @@ namespace Comms
         sound_level = level;
     }
 
+    void update_frame(FrameType type, const uint8_t *data, uint8_t len)
+    {
+        if (type >= FRAME_TYPE_COUNT)
+            return;
+        if (len > MAX_FRAME_PAYLOAD)
+            len = MAX_FRAME_PAYLOAD;
+        memcpy(frames[type], data, len);
+        frameLengths[type] = len;
+    }
+
+    void set_frame_share(FrameType type, uint8_t every)
+    {
+        if (type >= FRAME_TYPE_COUNT)
+            return;
+        sharedFrame = type;
+        sharedEvery = every;
+    }
+
     void stopAdvertiseBLE()
     {
 
-        Serial.println("End Advertising...");
+        LOG_DEBUG(LOG_ADVERTISE_STOP);
 
         BLE.stopAdvertise();
     }
@@ -18,7 +18,32 @@ namespace Comms
     void update_heading(uint8_t h);
     // update the battery level on the BLE packet
     void update_battery_level(uint8_t level);
-    // update the sound level on the BLE packet
+    // update the sound level on the BLE packet (SoundGain::levelByte())
     void update_sound(uint8_t level);
 
+    // extended telemetry frames, sent in the scan response under company id 0xFFFE.
+    // one frame type is sent per advertising phase, cycling through the ones that are set
+    // (but see set_frame_share())
+    enum FrameType : uint8_t
+    {
+        FRAME_DIAGNOSTICS = 0, // profiler summary, see Profiler::summarise()
+        FRAME_SOUND = 1,       // absolute sound level and mic gain, see updateSoundLevel()
+        FRAME_SOUND_STATS = 2, // percentile sound levels over Params soundStatsMillis, see SoundStats
+        FRAME_SOUND_CLASS = 3, // sound classifier label and probabilities, ENABLE_SOUND_CLASSIFIER builds
+        FRAME_SOUND_BEARING = 4, // rotate and listen bearing of the sound, see startSoundBearing()
+        FRAME_RSSI_STATS = 5,  // per beacon rssi statistics for the ground station, Params localisationMode
+        FRAME_TYPE_COUNT
+    };
+
+    // largest frame payload that fits in the scan response
+    static const uint8_t MAX_FRAME_PAYLOAD = 26;
+
+    // update the payload of an extended telemetry frame
+    void update_frame(FrameType type, const uint8_t *data, uint8_t len);
+
+    // gives one frame type a fixed share of the advertising phases: one in every `every`
+    // (1 is every phase) while it has data, the others rotate through the rest. 0 puts
+    // it back in the rotation. one frame type at a time
+    void set_frame_share(FrameType type, uint8_t every);
+
 }
@@ -1,42 +1,78 @@
 #include <Arduino.h>
 #include <ArduinoBLE.h>
+#include <BeaconRegistry.h>
 #include <Communication.h>
+#include <Log.h>
+#include <Params.h>
+#include <Profiler.h>
+#include <Trace.h>
 
 // ####### Constants and Variables #######
 const bool CALLBACK_SCANNING_MODE = true; // true = scan with the callback, false = scan with BLE.available()
 
-const int NUM_BEACONS = 3;
+// beacons that only advertise a name, ids 0..2. their positions and calibration come
+// from Params (Params.def), beacons that advertise a frame describe themselves
+const int NUM_NAMED_BEACONS = 3;
 const char *BEACON_NAMES[] = {"RasPi1", "RasPi2", "RasPi3"};
-const float BEACON_POSITIONS[3][2] = {
-    {0.0, 1.0},   // Beacon1
-    {-0.75, 0.0}, // Beacon2
-    {0.75, 0.0}   // Beacon3
-};
+float BEACON_POSITIONS[NUM_NAMED_BEACONS][2];
+
+// most beacons a position is worked out from, the strongest are used
+const int MAX_FIX_BEACONS = 4;
+// most beacons in the rssi statistics frame, 5 bytes each in the scan response
+const int MAX_STATS_BEACONS = 5;
 
 const float POSITION_RANGE[2][2] = {
     {-2.0, 2.0}, // X range
     {-2.0, 2.0}  // Y range
 };
 
-// RSSI calibration parameters
-const float RSSI_AT_1M = -65.37;       // Calibrated RSSI at 1 meter
-const float PATH_LOSS_EXPONENT = 2.68; // Path loss exponent
-
-// Output
+// Output: the position is logged when it has moved POSITION_LOG_STEP since the last
+// time, and every CALC_MILLIS otherwise, not on every update
 const int CALC_MILLIS = 5000;
+const float POSITION_LOG_STEP = 0.05;
 
-// RSSI smoothing variables
-const int windowSize = 7;
-int rssiBuffers[NUM_BEACONS][windowSize] = {0};
-int rssiIndexes[NUM_BEACONS] = {0};
-bool buffersFilled[NUM_BEACONS] = {false};
+// RSSI smoothing variables, one window per registry slot
+int windowSize = 0;
+int8_t rssiBuffers[BeaconRegistry::MAX_BEACONS][Params::MAX_RSSI_WINDOW] = {0};
+int rssiIndexes[BeaconRegistry::MAX_BEACONS] = {0};
+bool buffersFilled[BeaconRegistry::MAX_BEACONS] = {false};
+// samples ever put in each window, wrapping, so the ground station can tell new samples
+// from ones an earlier statistics frame already carried
+uint8_t rssiHeard[BeaconRegistry::MAX_BEACONS] = {0};
 
 // Position smoothing
-float ALPHA = 0.4;
 float smoothedX = NAN, smoothedY = NAN;
 
-// Last update times
-unsigned long lastUpdatedTimes[NUM_BEACONS] = {0};
+static void resetRSSI(int i)
+{
+  rssiIndexes[i] = 0;
+  buffersFilled[i] = false;
+}
+
+static int countRSSI(int i)
+{
+  return buffersFilled[i] ? windowSize : rssiIndexes[i];
+}
+
+// picks up parameter changes, a new window size restarts the averages
+void applyParams()
+{
+  const Params::Values &p = Params::values;
+  BEACON_POSITIONS[0][0] = p.beacon1X;
+  BEACON_POSITIONS[0][1] = p.beacon1Y;
+  BEACON_POSITIONS[1][0] = p.beacon2X;
+  BEACON_POSITIONS[1][1] = p.beacon2Y;
+  BEACON_POSITIONS[2][0] = p.beacon3X;
+  BEACON_POSITIONS[2][1] = p.beacon3Y;
+  if (p.rssiWindow != windowSize)
+  {
+    windowSize = p.rssiWindow;
+    for (int i = 0; i < BeaconRegistry::MAX_BEACONS; i++)
+    {
+      resetRSSI(i);
+    }
+  }
+}
 
 void insertRSSI(int i, int rssi)
 {
@@ -44,12 +80,13 @@ void insertRSSI(int i, int rssi)
   rssiIndexes[i] = (rssiIndexes[i] + 1) % windowSize;
   if (rssiIndexes[i] == 0)
     buffersFilled[i] = true;
+  rssiHeard[i]++;
 }
 
 float avgRSSI(int i)
 {
   int sum = 0;
-  int count = buffersFilled[i] ? windowSize : rssiIndexes[i];
+  int count = countRSSI(i);
   if (count == 0)
     return -100.0;
   for (int j = 0; j < count; j++)
@@ -57,20 +94,45 @@ float avgRSSI(int i)
   return float(sum) / count;
 }
 
-void trilateration(float d[3], float &x, float &y, float &residual)
+float stdRSSI(int i)
 {
-  float weights[3];
-  for (int i = 0; i < 3; i++)
+  int count = countRSSI(i);
+  if (count < 2)
+    return 0.0;
+  float mean = avgRSSI(i);
+  float sum = 0.0;
+  for (int j = 0; j < count; j++)
+  {
+    float err = rssiBuffers[i][j] - mean;
+    sum += err * err;
+  }
+  return sqrt(sum / (count - 1));
+}
+
+// log-distance path loss model, calibrated per beacon
+float rssiToDistance(float rssi, float rssiAt1m, float pathLossExponent)
+{
+  return pow(10.0, (rssiAt1m - rssi) / (10 * pathLossExponent));
+}
+
+void trilateration(const float positions[][2], const float *d, int count, float &x, float &y, float &residual)
+{
+  float weights[MAX_FIX_BEACONS];
+  float x0 = 0.0, y0 = 0.0; // Initial guess in the middle of the beacons
+  for (int i = 0; i < count; i++)
+  {
     weights[i] = 1.0 / (d[i] * d[i] + 1e-6);
+    x0 += positions[i][0] / count;
+    y0 += positions[i][1] / count;
+  }
 
-  float x0 = 0.0, y0 = 0.3; // Initial guess near center
   for (int iter = 0; iter < 10; iter++)
   {
     float gradX = 0.0, gradY = 0.0;
-    for (int i = 0; i < 3; i++)
+    for (int i = 0; i < count; i++)
     {
-      float dx = x0 - BEACON_POSITIONS[i][0];
-      float dy = y0 - BEACON_POSITIONS[i][1];
+      float dx = x0 - positions[i][0];
+      float dy = y0 - positions[i][1];
       float ri = sqrt(dx * dx + dy * dy);
       if (ri < 1e-6)
         ri = 1e-6;
@@ -86,10 +148,10 @@ void trilateration(float d[3], float &x, float &y, float &residual)
 
   // Compute residual
   residual = 0.0;
-  for (int i = 0; i < 3; i++)
+  for (int i = 0; i < count; i++)
   {
-    float dx = x - BEACON_POSITIONS[i][0];
-    float dy = y - BEACON_POSITIONS[i][1];
+    float dx = x - positions[i][0];
+    float dy = y - positions[i][1];
     float est = sqrt(dx * dx + dy * dy);
     float err = est - d[i];
     residual += err * err;
@@ -97,31 +159,100 @@ void trilateration(float d[3], float &x, float &y, float &residual)
   residual = sqrt(residual);
 }
 
+// adds an advert's rssi to its beacon, if it came from one
+static void beaconHeard(BLEDevice &peripheral)
+{
+  BeaconRegistry::Beacon beacon;
+  bool isBeacon = false;
+  if (peripheral.hasManufacturerData())
+  {
+    uint8_t data[31];
+    int length = peripheral.manufacturerData(data, sizeof(data));
+    isBeacon = BeaconRegistry::parseFrame(data, length, beacon);
+  }
+  for (int i = 0; i < NUM_NAMED_BEACONS && !isBeacon && peripheral.hasLocalName(); i++)
+  {
+    if (strcmp(peripheral.localName().c_str(), BEACON_NAMES[i]) == 0)
+    {
+      beacon = {(uint8_t)i, BEACON_POSITIONS[i][0], BEACON_POSITIONS[i][1],
+                Params::values.rssiAt1m, Params::values.pathLossExponent, false, 0};
+      isBeacon = true;
+    }
+  }
+  if (!isBeacon)
+    return;
+
+  bool added;
+  int slot = BeaconRegistry::update(beacon, millis(), Params::values.beaconTimeout, added);
+  if (slot < 0)
+  {
+    LOG_DEBUG(LOG_BEACON_REGISTRY_FULL, beacon.id);
+    return;
+  }
+  if (added)
+  {
+    resetRSSI(slot);
+    LOG_INFO(LOG_BEACON_ADDED, beacon.id, beacon.x, beacon.y, beacon.described);
+  }
+  int rssi = peripheral.rssi();
+  LOG_DEBUG(LOG_BEACON_RSSI, beacon.id, rssi);
+  TRACE_RSSI(beacon.id, rssi);
+  insertRSSI(slot, rssi);
+}
+
 // Callback for when adv. packet is detected
 void deviceDiscoveredCallback(BLEDevice peripheral)
 {
   // Serial.println("Callback triggered");
-  if (peripheral.hasLocalName() && peripheral.localName().length() != 0)
-  {
-    Serial.print("Device discovered with name: ");
-    Serial.println(peripheral.localName());
-  }
-  for (int i = 0; i < NUM_BEACONS; i++)
+  LOG_DEBUG(LOG_DEVICE_DISCOVERED, peripheral.rssi());
+  beaconHeard(peripheral);
+}
+
+// the strongest beacons heard lately, strongest first, with their average rssi
+static int strongestBeacons(int *chosen, float *chosenRSSI, int most)
+{
+  int count = 0;
+  unsigned long now = millis();
+  for (int slot = 0; slot < BeaconRegistry::MAX_BEACONS; slot++)
   {
-    const char *name = BEACON_NAMES[i];
-    if (peripheral.hasLocalName() && strcmp(peripheral.localName().c_str(), name) == 0)
+    if (!BeaconRegistry::used(slot) || countRSSI(slot) == 0 ||
+        now - BeaconRegistry::at(slot).lastHeard > (unsigned long)Params::values.beaconTimeout)
+      continue;
+    float rssi = avgRSSI(slot);
+    if (count == most && rssi <= chosenRSSI[count - 1])
+      continue;
+    // kept in order, the weakest drops off a full list
+    int i = count < most ? count++ : count - 1;
+    for (; i > 0 && chosenRSSI[i - 1] < rssi; i--)
     {
-      Serial.print("Discovered ");
-      Serial.println(name);
-      insertRSSI(i, peripheral.rssi());
-      lastUpdatedTimes[i] = millis();
-      //   Serial.print("Discovered ");
-      //   Serial.print(name);
-      //   Serial.print(" with RSSI: ");
-      //   Serial.println(latest_rssi[i]);
-      break;
+      chosen[i] = chosen[i - 1];
+      chosenRSSI[i] = chosenRSSI[i - 1];
     }
+    chosen[i] = slot;
+    chosenRSSI[i] = rssi;
+  }
+  return count;
+}
+
+// per beacon rssi statistics for the ground station to work the position out from
+// (Comms::FRAME_RSSI_STATS): beacon id, mean rssi in 0.1 dBm, its standard deviation
+// in 0.1 dB, then how many samples they are from less one in the low nibble and the
+// samples heard so far, modulo 16, in the high one. consecutive frames share most of
+// the window, the ground station only counts the samples heard since the last frame
+static void sendRSSIStats(const int *chosen, const float *chosenRSSI, int count)
+{
+  uint8_t payload[MAX_STATS_BEACONS * 5];
+  for (int i = 0; i < count; i++)
+  {
+    int16_t mean = lroundf(chosenRSSI[i] * 10.0f);
+    uint8_t *entry = payload + i * 5;
+    entry[0] = BeaconRegistry::at(chosen[i]).id;
+    memcpy(entry + 1, &mean, 2);
+    entry[3] = constrain(lroundf(stdRSSI(chosen[i]) * 10.0f), 0, 255);
+    entry[4] = (countRSSI(chosen[i]) - 1) | (rssiHeard[chosen[i]] & 0x0F) << 4;
   }
+  // no beacons clears the frame rather than repeating old statistics
+  Comms::update_frame(Comms::FRAME_RSSI_STATS, payload, count * 5);
 }
 
 void sendPosition(float x, float y)
@@ -137,6 +268,8 @@ void sendPosition(float x, float y)
 
 void initialiseLocalisation()
 {
+  BeaconRegistry::clear();
+  applyParams();
 
   // Set the event handler for discovered devices
   if (CALLBACK_SCANNING_MODE) {
@@ -148,7 +281,10 @@ void updateLocalisation()
 {
   // Serial.println("Update localisation called...");
   if (CALLBACK_SCANNING_MODE) {
-    BLE.poll();
+    {
+      PROFILE_SCOPE(PROFILE_BLE_POLL);
+      BLE.poll();
+    }
     // Serial.println("Polling done...");
 
   } else {
@@ -167,48 +303,50 @@ void updateLocalisation()
       //Serial.println("Parse scanned devices");
       BLEDevice dev = BLE.available();
       if (dev) {
-        String name = dev.localName();
-        for (int i = 0; i < NUM_BEACONS; i++) {
-          if (name == BEACON_NAMES[i]) {
-            insertRSSI(i, dev.rssi());
-            lastUpdatedTimes[i] = now;
-            break;
-          }
+        beaconHeard(dev);
       }
-    }
   }
 
 
-  // Check if we have enough valid RSSI for all beacons
-  bool ready = true;
-  for (int i = 0; i < NUM_BEACONS; i++)
+  // the strongest beacons heard lately, at least three are needed
+  int chosen[MAX_STATS_BEACONS];
+  float chosenRSSI[MAX_STATS_BEACONS];
+  int mode = Params::values.localisationMode;
+  int count = strongestBeacons(chosen, chosenRSSI, mode > 0 ? MAX_STATS_BEACONS : MAX_FIX_BEACONS);
+  // the statistics are all the ground station gets in mode 2, they go out every
+  // advertising phase. in mode 1 every other, the sound frames share the rest
+  sendRSSIStats(chosen, chosenRSSI, mode > 0 ? count : 0);
+  Comms::set_frame_share(Comms::FRAME_RSSI_STATS, mode == 2 ? 1 : mode == 1 ? 2 : 0);
+  // the ground station works the position out
+  if (mode == 2)
   {
-    if ((buffersFilled[i] ? windowSize : rssiIndexes[i]) == 0)
-    {
-      // Serial.print("Not enough RSSI data for ");
-      // Serial.print(BEACON_NAMES[i]);
-      // Serial.println(", skipping...");
-      ready = false;
-      break;
-    }
+    TRACE_LOCALISATION_UPDATE();
+    return;
   }
-  if (!ready)
+  count = min(count, MAX_FIX_BEACONS);
+  if (count < 3)
   {
+    TRACE_LOCALISATION_UPDATE();
     return;
   }
 
-  Serial.println("Enough valid RSSI, calculating position...");
   // onvert RSSI to distance
-  float rssi[3], d[3];
-  for (int i = 0; i < 3; i++)
+  float positions[MAX_FIX_BEACONS][2];
+  float d[MAX_FIX_BEACONS];
+  for (int i = 0; i < count; i++)
   {
-    rssi[i] = avgRSSI(i);
-    d[i] = pow(10.0, (RSSI_AT_1M - rssi[i]) / (10 * PATH_LOSS_EXPONENT));
+    const BeaconRegistry::Beacon &beacon = BeaconRegistry::at(chosen[i]);
+    positions[i][0] = beacon.x;
+    positions[i][1] = beacon.y;
+    d[i] = rssiToDistance(chosenRSSI[i], beacon.rssiAt1m, beacon.pathLossExponent);
   }
 
   // Trilateration + residual
   float x, y, residual;
-  trilateration(d, x, y, residual);
+  {
+    PROFILE_SCOPE(PROFILE_TRILATERATION);
+    trilateration(positions, d, count, x, y, residual);
+  }
 
   // Confidence estimation
   float maxResidual = 1.5;
@@ -222,21 +360,25 @@ void updateLocalisation()
   }
   else
   {
-    smoothedX = ALPHA * x + (1 - ALPHA) * smoothedX;
-    smoothedY = ALPHA * y + (1 - ALPHA) * smoothedY;
+    const float alpha = Params::values.alpha;
+    smoothedX = alpha * x + (1 - alpha) * smoothedX;
+    smoothedY = alpha * y + (1 - alpha) * smoothedY;
   }
 
   // Output only if confidence is sufficient
-  if (confidence >= 0.5)
+  static float loggedX = NAN, loggedY = NAN;
+  static unsigned long loggedAt = 0;
+  unsigned long now = millis();
+  if (confidence >= 0.5 &&
+      (isnan(loggedX) || fabsf(smoothedX - loggedX) >= POSITION_LOG_STEP ||
+       fabsf(smoothedY - loggedY) >= POSITION_LOG_STEP || now - loggedAt >= (unsigned long)CALC_MILLIS))
   {
-    Serial.print("Position: (");
-    Serial.print(smoothedX, 2);
-    Serial.print(", ");
-    Serial.print(smoothedY, 2);
-    Serial.print(") | Confidence: ");
-    Serial.println(int(confidence * 100));
+    LOG_INFO(LOG_POSITION, smoothedX, smoothedY, int(confidence * 100));
+    loggedX = smoothedX;
+    loggedY = smoothedY;
+    loggedAt = now;
   }
 
   sendPosition(smoothedX, smoothedY);
-
+  TRACE_LOCALISATION_UPDATE();
 }
@@ -1,4 +1,16 @@
 #pragma once
 
 void initialiseLocalisation();
-void updateLocalisation();
\ No newline at end of file
+void updateLocalisation();
+
+// re-reads the localisation parameters, call after Params have changed
+void applyParams();
+
+// the localisation kernels, also run by the benchmarks in bench/
+void insertRSSI(int i, int rssi);
+float avgRSSI(int i);
+// sample standard deviation of a beacon's rssi window
+float stdRSSI(int i);
+float rssiToDistance(float rssi, float rssiAt1m, float pathLossExponent);
+// position from the distances to count beacons (at least three)
+void trilateration(const float positions[][2], const float *d, int count, float &x, float &y, float &residual);
@@ -1,18 +1,41 @@
 #include "Locomotion.h"
 #include <Arduino.h>
 #include <orientation/Orientation.h>
+#include <Log.h>
+#include <Params.h>
+#include <Trace.h>
 #include <cmath>
+#ifdef USE_RTOS_THREADS
+#include <mbed.h>
+#endif
 
 namespace Locomotion
 {
 
+#ifdef USE_RTOS_THREADS
+  // the motion and audio threads both drive the motors, the walk state and the pins
+  // are only touched under this (mbed mutexes are recursive, walkStraight() nests)
+  static rtos::Mutex motorMutex;
+  struct MotorLock
+  {
+    MotorLock() { motorMutex.lock(); }
+    ~MotorLock() { motorMutex.unlock(); }
+  };
+#else
+  // one thread in the loop() build, nothing to lock. the empty constructor and
+  // destructor keep the unused lock variables from warning
+  struct MotorLock
+  {
+    MotorLock() {}
+    ~MotorLock() {}
+  };
+#endif
+
   // motor pins fo Seeed
   static const int motorRight = 2;
   static const int motorLeft = 3;
 
-  // lévy walk maximum and minimum times
-  static const int minWalkTime = 500;  // Minimum walk interval (ms)
-  static const int maxWalkTime = 2000; // Maximum walk interval (ms)
+  // the lévy walk interval bounds and heading threshold are Params (minWalkTime, maxWalkTime, headingThreshold)
 
   // timing markers for the walk
   static unsigned long previousMillis = 0;
@@ -21,50 +44,157 @@ namespace Locomotion
   // stopped motor states
   static bool leftState = false;
   static bool rightState = false;
+  // set while the motors are stopped for a measurement, walk updates are skipped
+  static bool motorsHeld = false;
+
+  // age of the heading sample when a steering decision is made (us)
+  static uint32_t latencyCount = 0;
+  static uint64_t latencyTotal = 0;
+  static uint32_t latencyMax = 0;
 
   float initialHeading = 0.0; // variable to store the heading
-  float threshold = 5;
+  bool initialHeadingSet = false; // false until a heading reading has been taken
+
+  // background motor test: right motor, then left motor, SELF_TEST_MILLIS each
+  static const unsigned long SELF_TEST_MILLIS = 1000;
+  static int selfTestStage = 0;
+  static unsigned long selfTestStart = 0;
 
-  void initialiseLocomotion()
+  void initialiseLocomotion(bool runSelfTest)
   {
     pinMode(motorRight, OUTPUT);
     pinMode(motorLeft, OUTPUT);
 
     // Serial.begin(115200);  //initialise serial port for debugging
     // initialize walk timing to some random interval between min/max, set timer
-    interval = random(minWalkTime, maxWalkTime);
+    interval = random(Params::values.minWalkTime, Params::values.maxWalkTime);
     previousMillis = millis();
-    // spin motors for a short time to test
-    digitalWrite(motorRight, HIGH);
-    delay(1000);
-    digitalWrite(motorRight, LOW);
-    digitalWrite(motorLeft, HIGH);
-    delay(1000);
-    digitalWrite(motorLeft, LOW);
-    // update heading
-    initialHeading = getHeading();
+    motorsHeld = false;
+    if (runSelfTest)
+    {
+      // spin motors for a short time to test
+      digitalWrite(motorRight, HIGH);
+      delay(SELF_TEST_MILLIS);
+      digitalWrite(motorRight, LOW);
+      digitalWrite(motorLeft, HIGH);
+      delay(SELF_TEST_MILLIS);
+      digitalWrite(motorLeft, LOW);
+    }
+    // update heading, if the compass has not been read yet this happens on the first walk step
+    if (getHeadingTime() != 0)
+    {
+      initialHeading = getHeading();
+      initialHeadingSet = true;
+    }
+  }
+
+  bool selfTestStep()
+  {
+    MotorLock lock;
+    unsigned long now = millis();
+    switch (selfTestStage)
+    {
+    case 0:
+      // hold the walk while the test drives the motors
+      motorsHeld = true;
+      digitalWrite(motorLeft, LOW);
+      digitalWrite(motorRight, HIGH);
+      selfTestStart = now;
+      selfTestStage = 1;
+      break;
+    case 1:
+      if (now - selfTestStart >= SELF_TEST_MILLIS)
+      {
+        digitalWrite(motorRight, LOW);
+        digitalWrite(motorLeft, HIGH);
+        selfTestStage = 2;
+      }
+      break;
+    case 2:
+      if (now - selfTestStart >= 2 * SELF_TEST_MILLIS)
+      {
+        digitalWrite(motorLeft, LOW);
+        motorsHeld = false;
+        selfTestStage = 3;
+      }
+      break;
+    }
+    return selfTestStage == 3;
+  }
+
+  // age of the heading a steering decision is made with, 0 is no heading yet
+  static void recordLatency(uint32_t headingTime)
+  {
+    if (headingTime == 0)
+      return;
+    uint32_t latency = micros() - headingTime;
+    latencyCount++;
+    latencyTotal += latency;
+    if (latency > latencyMax)
+      latencyMax = latency;
   }
 
   void updateLocomotion()
   {
+    updateLocomotion(getHeadingTime());
+  }
+
+  void updateLocomotion(uint32_t headingTime)
+  {
+    MotorLock lock;
+    if (motorsHeld)
+      return;
+
     unsigned long currentMillis = millis(); // update timer
 
-    if (currentMillis - previousMillis >= interval)
+    if (currentMillis - previousMillis >= (unsigned long)interval)
     { // loop around timer until random interval met.
       previousMillis = currentMillis;
+      recordLatency(headingTime);
       levyWalk(); // perform levy walk
     }
   }
 
   void updateLocomotionWalkStraight()
   {
-    unsigned long currentMillis = millis(); // update timer
+    updateLocomotionWalkStraight(getHeading(), getHeadingTime());
+  }
 
-    if (currentMillis - previousMillis >= interval)
-    { // loop around timer until random interval met.
+  void updateLocomotionWalkStraight(float heading, uint32_t headingTime)
+  {
+    {
+      MotorLock lock;
+      if (motorsHeld)
+        return;
+
+      unsigned long currentMillis = millis(); // update timer
+
+      if (currentMillis - previousMillis < (unsigned long)interval)
+        return; // loop around timer until random interval met.
       previousMillis = currentMillis;
-      walkStraight(getHeading());
+
+      if (!initialHeadingSet)
+      {
+        if (headingTime == 0)
+          return;
+        initialHeading = heading;
+        initialHeadingSet = true;
+      }
+
+      recordLatency(headingTime);
     }
+    // walkStraight() waits out its turns, it takes the lock itself around the motor changes
+    walkStraight(heading);
+  }
+
+  void printControlLatency()
+  {
+    Serial.print("Heading-to-motor latency (us) mean: ");
+    Serial.print(latencyCount ? (unsigned long)(latencyTotal / latencyCount) : 0);
+    Serial.print(" max: ");
+    Serial.print(latencyMax);
+    Serial.print(" n: ");
+    Serial.println(latencyCount);
   }
 
   long powerLawRandomInterval(long t_min, long t_max, float mu) {
@@ -89,18 +219,32 @@ namespace Locomotion
   void walkStraight(float currentHeading) 
   {
     float headingDifference = fmod(180 + currentHeading - initialHeading, 360) - 180;
-    if (headingDifference > threshold) {
-      turnLeft();
-      delay(500);
-    } else if (headingDifference < -threshold) {
-      turnRight();
-      delay(500);
+    const float threshold = Params::values.headingThreshold;
+    bool turning = false;
+    {
+      MotorLock lock;
+      if (motorsHeld)
+        return;
+      if (headingDifference > threshold) {
+        turnLeft();
+        turning = true;
+      } else if (headingDifference < -threshold) {
+        turnRight();
+        turning = true;
+      }
     }
-    moveForward();
+    // the lock is not held through the turn, the motors may have been stopped meanwhile
+    if (turning)
+      delay(500);
+    MotorLock lock;
+    if (!motorsHeld)
+      moveForward();
   }
 
   void levyWalk()
   {
+    const int minWalkTime = Params::values.minWalkTime;
+    const int maxWalkTime = Params::values.maxWalkTime;
     int r = random(100); // probabilities for each to happen, i.e 60% to go forwards, 20%ea to turn left/right
 
     if (r < 101)
@@ -122,40 +266,52 @@ namespace Locomotion
 
   void moveForward()
   {
-    Serial.println("Moving Forward");
+    MotorLock lock;
+    LOG_DEBUG(LOG_MOTOR_FORWARD);
     digitalWrite(motorRight, HIGH);
     digitalWrite(motorLeft, HIGH);
+    TRACE_MOTORS(true, true);
   }
 
   void turnLeft()
   {
-    Serial.println("Turning Left");
+    MotorLock lock;
+    LOG_DEBUG(LOG_MOTOR_LEFT);
     digitalWrite(motorRight, HIGH);
     digitalWrite(motorLeft, LOW);
+    TRACE_MOTORS(false, true);
   }
 
   void turnRight()
   {
-    Serial.println("Turning Right");
+    MotorLock lock;
+    LOG_DEBUG(LOG_MOTOR_RIGHT);
     digitalWrite(motorRight, LOW);
     digitalWrite(motorLeft, HIGH);
+    TRACE_MOTORS(true, false);
   }
 
   void stopMotors()
   { // never actually used but can be in future for stopping to listen to sound etc.
     // store states to resume
-    Serial.println("Stopping Motors");
+    MotorLock lock;
+    LOG_DEBUG(LOG_MOTOR_STOP);
+    motorsHeld = true;
     leftState = digitalRead(motorLeft);
     rightState = digitalRead(motorRight);
     digitalWrite(motorRight, LOW);
     digitalWrite(motorLeft, LOW);
+    TRACE_MOTORS(false, false);
   }
 
   void resumeMotors()
   { // resume motors to previous state
-    Serial.println("Resuming Motors");
+    MotorLock lock;
+    LOG_DEBUG(LOG_MOTOR_RESUME);
     digitalWrite(motorRight, rightState);
     digitalWrite(motorLeft, leftState);
+    TRACE_MOTORS(leftState, rightState);
+    motorsHeld = false;
   }
 
 }
\ No newline at end of file
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <cstdint>
+
 namespace Locomotion
 {
-    //initializes motor control and Lévy walk parameters such as interval times 
-    void initialiseLocomotion();
+    //initializes motor control and Lévy walk parameters such as interval times,
+    //runSelfTest spins each motor for a second before returning
+    void initialiseLocomotion(bool runSelfTest);
+
+    //non-blocking version of the motor self test, call periodically until it returns true.
+    //walk updates are held while it runs
+    bool selfTestStep();
 
     //updates Lévy walk behavior (on loop)
     void updateLocomotion();
@@ -11,14 +18,24 @@ namespace Locomotion
     // alternate walking behaviour
     void updateLocomotionWalkStraight();
 
+    // the same with a heading sample handed over by the caller (the motion thread)
+    // instead of the orientation globals, headingTime is 0 until there is one. the Lévy
+    // walk does not steer by the heading, only how old it is gets recorded
+    void updateLocomotion(uint32_t headingTime);
+    void updateLocomotionWalkStraight(float heading, uint32_t headingTime);
+
     //locomotion control functions
     void walkStraight(float currentHeading);
     void levyWalk();
     void moveForward();
     void turnLeft();
     void turnRight();
+    // stopMotors() also holds the walk updates until resumeMotors() is called
     void stopMotors();
     void resumeMotors();
 
+    // prints how old the heading was when walk decisions were made
+    void printControlLatency();
+
 }
 
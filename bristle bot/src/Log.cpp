@@ -0,0 +1,126 @@
+#include "Log.h"
+
+#include <Arduino.h>
+
+namespace Log
+{
+
+    // a record in the ring is a header byte (level << 4 | argument count), the message
+    // id, a millis() timestamp and the arguments. on the wire each record is wrapped as
+    // FRAME_SYNC, length, record, checksum (sum of the record bytes)
+    static const uint32_t HEADER_SIZE = 1 + 2 + 4;
+
+    static uint8_t ring[RING_SIZE];
+    static volatile uint32_t head = 0; // next byte to write
+    static volatile uint32_t tail = 0; // next byte to send
+    static volatile uint32_t dropped = 0; // not yet reported with a LOG_DROPPED record
+    static volatile uint32_t totalDropped = 0;
+
+    static uint32_t used()
+    {
+        return head - tail;
+    }
+
+    static void put(const uint8_t *data, uint32_t len)
+    {
+        for (uint32_t i = 0; i < len; i++)
+        {
+            ring[(head + i) % RING_SIZE] = data[i];
+        }
+        head += len;
+    }
+
+    static void putRecord(uint8_t level, uint16_t message, uint8_t argCount, const uint32_t *args)
+    {
+        uint8_t record[HEADER_SIZE + LOG_MAX_ARGS * 4];
+        uint32_t now = millis();
+        record[0] = (level << 4) | argCount;
+        memcpy(&record[1], &message, 2);
+        memcpy(&record[3], &now, 4);
+        memcpy(&record[HEADER_SIZE], args, argCount * 4);
+        put(record, HEADER_SIZE + argCount * 4);
+    }
+
+    void write(uint8_t level, uint16_t message, uint8_t argCount, const uint32_t *args)
+    {
+        if (argCount > LOG_MAX_ARGS)
+            argCount = LOG_MAX_ARGS;
+        uint32_t len = HEADER_SIZE + argCount * 4;
+
+        noInterrupts();
+        if (dropped != 0 && RING_SIZE - used() >= len + HEADER_SIZE + 4)
+        {
+            // let the reader know there is a gap before the next record
+            uint32_t count = dropped;
+            putRecord(LOG_LEVEL_WARN, LOG_DROPPED, 1, &count);
+            dropped = 0;
+        }
+        if (RING_SIZE - used() < len)
+        {
+            dropped++;
+            totalDropped++;
+        }
+        else
+        {
+            putRecord(level, message, argCount, args);
+        }
+        interrupts();
+    }
+
+    // copies the next record out of the ring, returns its length or 0 if the ring is empty
+    static uint32_t takeRecord(uint8_t *out)
+    {
+        noInterrupts();
+        uint32_t len = 0;
+        if (used() != 0)
+        {
+            uint8_t argCount = ring[tail % RING_SIZE] & 0x0F;
+            len = HEADER_SIZE + argCount * 4;
+            for (uint32_t i = 0; i < len; i++)
+            {
+                out[i] = ring[(tail + i) % RING_SIZE];
+            }
+            tail += len;
+        }
+        interrupts();
+        return len;
+    }
+
+    void flush(uint32_t maxBytes)
+    {
+        uint32_t sent = 0;
+        uint8_t frame[2 + HEADER_SIZE + LOG_MAX_ARGS * 4 + 1];
+        while (used() != 0)
+        {
+            uint8_t argCount = ring[tail % RING_SIZE] & 0x0F;
+            uint32_t frameLen = HEADER_SIZE + argCount * 4 + 3;
+            if (sent + frameLen > maxBytes)
+                break;
+
+            uint32_t len = takeRecord(&frame[2]);
+            if (len == 0)
+                break;
+            uint8_t checksum = 0;
+            for (uint32_t i = 0; i < len; i++)
+            {
+                checksum += frame[2 + i];
+            }
+            frame[0] = FRAME_SYNC;
+            frame[1] = len;
+            frame[2 + len] = checksum;
+            Serial.write(frame, len + 3);
+            sent += len + 3;
+        }
+    }
+
+    void flushAll()
+    {
+        flush(UINT32_MAX);
+    }
+
+    uint32_t droppedCount()
+    {
+        return totalDropped;
+    }
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// deferred binary logging. records are a message id, a timestamp and up to
+// LOG_MAX_ARGS 32 bit arguments, written into a RAM ring and only sent over
+// serial when Log::flush() is called from idle time. the text for each id is in
+// LogMessages.def and tools/log_decode.py turns the records back into text.
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+// records below this level are compiled out, override with -DLOG_LEVEL=...
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_MAX_ARGS 4
+
+// size of the RAM ring (bytes, a power of two), override with -DLOG_RING_SIZE=...
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 1024
+#endif
+
+enum LogMessage : uint16_t
+{
+#define LOG_MESSAGE(id, text) LOG_##id,
+#include "LogMessages.def"
+#undef LOG_MESSAGE
+    LOG_MESSAGE_COUNT
+};
+
+namespace Log
+{
+
+    static const uint32_t RING_SIZE = LOG_RING_SIZE;
+    // head and tail run free and wrap modulo 2^32, which only lands on a ring slot boundary if this is a power of two
+    static_assert(RING_SIZE != 0 && (RING_SIZE & (RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+    // start of every record frame on the serial line. it can turn up in text as well,
+    // the decoder resyncs on a frame whose length or checksum is wrong
+    static const uint8_t FRAME_SYNC = 0xA5;
+
+    // copies a record into the ring, drops it if the ring is full
+    void write(uint8_t level, uint16_t message, uint8_t argCount, const uint32_t *args);
+
+    // sends at most maxBytes of framed records over serial
+    void flush(uint32_t maxBytes);
+
+    // sends everything in the ring, blocking until done
+    void flushAll();
+
+    // number of records dropped because the ring was full
+    uint32_t droppedCount();
+
+    // arguments are stored as raw 32 bit words, floats keep their bit pattern
+    inline uint32_t toWord(float v)
+    {
+        uint32_t w;
+        memcpy(&w, &v, sizeof(w));
+        return w;
+    }
+    inline uint32_t toWord(double v) { return toWord((float)v); }
+    template <typename T>
+    inline uint32_t toWord(T v) { return (uint32_t)v; }
+
+    inline void record(uint8_t level, LogMessage message)
+    {
+        write(level, message, 0, nullptr);
+    }
+
+    template <typename... Args>
+    inline void record(uint8_t level, LogMessage message, Args... args)
+    {
+        static_assert(sizeof...(args) <= LOG_MAX_ARGS, "too many log arguments");
+        const uint32_t words[] = {toWord(args)...};
+        write(level, message, sizeof...(args), words);
+    }
+
+}
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log::record(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log::record(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log::record(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Log::record(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
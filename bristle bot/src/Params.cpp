@@ -0,0 +1,361 @@
+#include "Params.h"
+
+#include <Arduino.h>
+#include <ArduinoBLE.h>
+
+#include "Storage.h"
+
+namespace Params
+{
+
+    template <typename T>
+    struct TypeOf;
+    template <>
+    struct TypeOf<float>
+    {
+        static const Type value = TYPE_FLOAT;
+    };
+    template <>
+    struct TypeOf<int32_t>
+    {
+        static const Type value = TYPE_INT;
+    };
+
+    static const Info INFO[PARAM_COUNT] = {
+#define PARAM(name, type, def, min, max) {#name, TypeOf<type>::value, def, min, max},
+#include "Params.def"
+#undef PARAM
+    };
+
+    Values values = {
+#define PARAM(name, type, def, min, max) def,
+#include "Params.def"
+#undef PARAM
+    };
+
+    // address of each field of values, indexed by id
+    static void *const FIELDS[PARAM_COUNT] = {
+#define PARAM(name, type, def, min, max) &values.name,
+#include "Params.def"
+#undef PARAM
+    };
+
+    static volatile bool changed = false;
+
+    // stored alongside the values so a record written by a different table is ignored
+    struct StoredParams
+    {
+        uint32_t layout;
+        Values values;
+    };
+
+    static uint32_t layoutHash()
+    {
+        // FNV-1a over the names and types, in table order
+        uint32_t hash = 2166136261u;
+        for (int i = 0; i < PARAM_COUNT; i++)
+        {
+            for (const char *c = INFO[i].name; *c; c++)
+                hash = (hash ^ (uint8_t)*c) * 16777619u;
+            hash = (hash ^ INFO[i].type) * 16777619u;
+        }
+        return hash;
+    }
+
+    const Info &info(Id id)
+    {
+        return INFO[id < PARAM_COUNT ? id : 0];
+    }
+
+    bool find(const char *name, Id &id)
+    {
+        for (int i = 0; i < PARAM_COUNT; i++)
+        {
+            if (strcmp(INFO[i].name, name) == 0)
+            {
+                id = (Id)i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    float get(Id id)
+    {
+        if (id >= PARAM_COUNT)
+            return 0.0;
+        if (INFO[id].type == TYPE_INT)
+            return *(int32_t *)FIELDS[id];
+        return *(float *)FIELDS[id];
+    }
+
+    static bool inBounds(Id id, float value)
+    {
+        return id < PARAM_COUNT && !isnan(value) && value >= INFO[id].min && value <= INFO[id].max;
+    }
+
+    static void store(Id id, float value)
+    {
+        if (INFO[id].type == TYPE_INT)
+            *(int32_t *)FIELDS[id] = lroundf(value);
+        else
+            *(float *)FIELDS[id] = value;
+        changed = true;
+    }
+
+    // parameters that bound each other: the walk interval's lower bound may not pass its upper one
+    static bool consistent(Id id, float value)
+    {
+        if (id == PARAM_minWalkTime)
+            return lroundf(value) <= values.maxWalkTime;
+        if (id == PARAM_maxWalkTime)
+            return lroundf(value) >= values.minWalkTime;
+        return true;
+    }
+
+    bool set(Id id, float value)
+    {
+        if (!inBounds(id, value) || !consistent(id, value))
+            return false;
+        store(id, value);
+        return true;
+    }
+
+    void resetDefaults()
+    {
+        // one field at a time could fall foul of consistent() half way, the defaults are consistent
+        for (int i = 0; i < PARAM_COUNT; i++)
+        {
+            store((Id)i, INFO[i].defaultValue);
+        }
+    }
+
+    bool load()
+    {
+        StoredParams stored;
+        if (!Storage::load(Storage::SLOT_PARAMETERS, &stored, sizeof(stored)) || stored.layout != layoutHash())
+            return false;
+
+        // copy field by field so anything out of bounds keeps its default
+        Values loaded = stored.values;
+        for (int i = 0; i < PARAM_COUNT; i++)
+        {
+            const uint8_t *field = (const uint8_t *)&loaded + ((const uint8_t *)FIELDS[i] - (const uint8_t *)&values);
+            float value;
+            if (INFO[i].type == TYPE_INT)
+            {
+                int32_t v;
+                memcpy(&v, field, sizeof(v));
+                value = v;
+            }
+            else
+            {
+                memcpy(&value, field, sizeof(value));
+            }
+            if (inBounds((Id)i, value))
+                store((Id)i, value);
+        }
+        // a record that breaks a pair keeps the defaults for both
+        if (values.minWalkTime > values.maxWalkTime)
+        {
+            store(PARAM_minWalkTime, INFO[PARAM_minWalkTime].defaultValue);
+            store(PARAM_maxWalkTime, INFO[PARAM_maxWalkTime].defaultValue);
+        }
+        return true;
+    }
+
+    bool save()
+    {
+        StoredParams stored;
+        stored.layout = layoutHash();
+        stored.values = values;
+        return Storage::save(Storage::SLOT_PARAMETERS, &stored, sizeof(stored));
+    }
+
+    bool consumeChanged()
+    {
+        if (!changed)
+            return false;
+        changed = false;
+        return true;
+    }
+
+    // ############ BLE service #############
+
+    // commands written to the command characteristic: op, parameter id, value (4 bytes)
+    enum Command : uint8_t
+    {
+        CMD_SELECT = 0, // make the id the one shown by the value characteristic
+        CMD_SET = 1,    // set the id to the value (float bits or int32 depending on type)
+        CMD_SAVE = 2,   // store all values in flash
+        CMD_RESET = 3,  // restore the defaults
+    };
+
+    static BLEService service("6b1e0000-4c3a-4e5b-9c1d-2f7a8b9c0d1e");
+    static BLECharacteristic commandCharacteristic("6b1e0001-4c3a-4e5b-9c1d-2f7a8b9c0d1e", BLEWrite, 6);
+    // selected parameter: id, type, value (4 bytes), result of the last command (1 = ok)
+    static BLECharacteristic valueCharacteristic("6b1e0002-4c3a-4e5b-9c1d-2f7a8b9c0d1e", BLERead | BLENotify, 7);
+
+    static Id selected = (Id)0;
+
+    static void publishSelected(bool ok)
+    {
+        uint8_t out[7];
+        out[0] = selected;
+        out[1] = INFO[selected].type;
+        // raw field bytes, int32 or float bits depending on the type
+        memcpy(&out[2], FIELDS[selected], 4);
+        out[6] = ok;
+        valueCharacteristic.writeValue(out, sizeof(out));
+    }
+
+    static void onCommand(BLEDevice /* central */, BLECharacteristic characteristic)
+    {
+        uint8_t data[6] = {0};
+        int len = characteristic.readValue(data, sizeof(data));
+        if (len < 1)
+            return;
+
+        bool ok = true;
+        switch (data[0])
+        {
+        case CMD_SELECT:
+        case CMD_SET:
+            if (len < 2 || data[1] >= PARAM_COUNT)
+            {
+                ok = false;
+                break;
+            }
+            selected = (Id)data[1];
+            if (data[0] == CMD_SET)
+            {
+                if (len < 6)
+                {
+                    ok = false;
+                    break;
+                }
+                float value;
+                if (INFO[selected].type == TYPE_INT)
+                {
+                    int32_t v;
+                    memcpy(&v, &data[2], 4);
+                    value = v;
+                }
+                else
+                {
+                    memcpy(&value, &data[2], 4);
+                }
+                ok = set(selected, value);
+            }
+            break;
+        case CMD_SAVE:
+            ok = save();
+            break;
+        case CMD_RESET:
+            resetDefaults();
+            break;
+        default:
+            ok = false;
+        }
+        publishSelected(ok);
+    }
+
+    void setupService()
+    {
+        service.addCharacteristic(commandCharacteristic);
+        service.addCharacteristic(valueCharacteristic);
+        BLE.addService(service);
+        commandCharacteristic.setEventHandler(BLEWritten, onCommand);
+        publishSelected(true);
+    }
+
+    // ############ Serial console #############
+
+    static void printParam(int i)
+    {
+        Serial.print(INFO[i].name);
+        Serial.print(" = ");
+        if (INFO[i].type == TYPE_INT)
+            Serial.print(*(int32_t *)FIELDS[i]);
+        else
+            Serial.print(*(float *)FIELDS[i], 4);
+        Serial.print("  [");
+        Serial.print(INFO[i].min, 2);
+        Serial.print(", ");
+        Serial.print(INFO[i].max, 2);
+        Serial.println("]");
+    }
+
+    void printAll()
+    {
+        for (int i = 0; i < PARAM_COUNT; i++)
+        {
+            printParam(i);
+        }
+    }
+
+    // param list | param get <name> | param set <name> <value> | param save | param reset
+    static void runCommand(char *line)
+    {
+        char *word = strtok(line, " \t");
+        if (word == nullptr || strcmp(word, "param") != 0)
+            return;
+        char *action = strtok(nullptr, " \t");
+        char *name = strtok(nullptr, " \t");
+        char *value = strtok(nullptr, " \t");
+        Id id;
+
+        if (action == nullptr || strcmp(action, "list") == 0)
+        {
+            printAll();
+        }
+        else if (strcmp(action, "save") == 0)
+        {
+            Serial.println(save() ? "Parameters saved" : "Saving parameters failed");
+        }
+        else if (strcmp(action, "reset") == 0)
+        {
+            resetDefaults();
+            Serial.println("Parameters reset to defaults");
+        }
+        else if (name == nullptr || !find(name, id))
+        {
+            Serial.println("Unknown parameter");
+        }
+        else if (strcmp(action, "get") == 0)
+        {
+            printParam(id);
+        }
+        else if (strcmp(action, "set") == 0 && value != nullptr)
+        {
+            if (set(id, atof(value)))
+                printParam(id);
+            else
+                Serial.println("Value out of range (minWalkTime may not pass maxWalkTime)");
+        }
+    }
+
+    void handleConsole()
+    {
+        static char line[64];
+        static uint8_t length = 0;
+        while (Serial.available() > 0)
+        {
+            char c = Serial.read();
+            if (c == '\r' || c == '\n')
+            {
+                if (length > 0)
+                {
+                    line[length] = '\0';
+                    runCommand(line);
+                    length = 0;
+                }
+            }
+            else if (length < sizeof(line) - 1)
+            {
+                line[length++] = c;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+
+// runtime tunable parameters. the table is in Params.def, each entry becomes a
+// field of Params::values so hot paths read it directly (Params::values.alpha).
+// values can be changed over BLE (see setupService) or the serial console, are
+// kept within their bounds and can be stored in flash.
+namespace Params
+{
+
+    // largest rssi window the localisation buffers are sized for
+    static const int MAX_RSSI_WINDOW = 16;
+
+    enum Type : uint8_t
+    {
+        TYPE_FLOAT = 0,
+        TYPE_INT = 1
+    };
+
+    enum Id : uint8_t
+    {
+#define PARAM(name, type, def, min, max) PARAM_##name,
+#include "Params.def"
+#undef PARAM
+        PARAM_COUNT
+    };
+
+    struct Values
+    {
+#define PARAM(name, type, def, min, max) type name;
+#include "Params.def"
+#undef PARAM
+    };
+
+    // the live parameter values
+    extern Values values;
+
+    struct Info
+    {
+        const char *name;
+        Type type;
+        float defaultValue;
+        float min;
+        float max;
+    };
+
+    const Info &info(Id id);
+
+    // looks a parameter up by name, false if there is no such parameter
+    bool find(const char *name, Id &id);
+
+    float get(Id id);
+
+    // sets a parameter, false (and no change) if the value is out of bounds or would
+    // put minWalkTime above maxWalkTime
+    bool set(Id id, float value);
+
+    // sets every parameter back to its default
+    void resetDefaults();
+
+    // loads the stored values, false (and defaults kept) if none are stored
+    bool load();
+
+    // stores the current values in flash
+    bool save();
+
+    // true once after any parameter has changed, used to apply new periods
+    bool consumeChanged();
+
+    // adds the parameter GATT service, call after BLE.begin()
+    void setupService();
+
+    // reads and runs "param ..." commands from the serial console
+    void handleConsole();
+
+    // prints every parameter with its value and bounds
+    void printAll();
+
+}
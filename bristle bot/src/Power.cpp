@@ -0,0 +1,90 @@
+#include "Power.h"
+
+#include <Arduino.h>
+
+#if defined(ARDUINO_ARCH_MBED)
+#include <mbed.h>
+#endif
+
+namespace Power
+{
+
+    static const uint32_t WAKE_FLAG = 1 << 0;
+
+#if defined(ARDUINO_ARCH_MBED)
+    static rtos::EventFlags wakeFlags;
+#else
+    static volatile bool wakeRequested = false;
+#endif
+
+    static uint64_t sleepTime = 0; // us
+    static uint32_t sleepCount = 0;
+    static uint32_t earlyWakes = 0;
+    static uint32_t bootTime = 0;
+
+    void setupPower()
+    {
+        bootTime = micros();
+        if (COMPASS_DRDY_PIN >= 0)
+        {
+            pinMode(COMPASS_DRDY_PIN, INPUT);
+            attachInterrupt(digitalPinToInterrupt(COMPASS_DRDY_PIN), wake, RISING);
+        }
+    }
+
+    void idle(uint32_t maxMillis)
+    {
+        if (maxMillis < MIN_SLEEP_MILLIS)
+            return;
+
+        uint32_t start = micros();
+        bool woken;
+#if defined(ARDUINO_ARCH_MBED)
+        uint32_t flags = wakeFlags.wait_any_for(WAKE_FLAG, std::chrono::milliseconds(maxMillis));
+        woken = !(flags & osFlagsError) && (flags & WAKE_FLAG);
+#else
+        uint32_t deadline = millis() + maxMillis;
+        while (!wakeRequested && (int32_t)(deadline - millis()) > 0)
+        {
+            __WFE();
+        }
+        woken = wakeRequested;
+        wakeRequested = false;
+#endif
+        sleepTime += micros() - start;
+        sleepCount++;
+        if (woken)
+            earlyWakes++;
+    }
+
+    void wake()
+    {
+#if defined(ARDUINO_ARCH_MBED)
+        wakeFlags.set(WAKE_FLAG);
+#else
+        wakeRequested = true;
+#endif
+    }
+
+    float sleepShare()
+    {
+        uint32_t elapsed = micros() - bootTime;
+        if (elapsed == 0)
+            return 0.0;
+        return 100.0 * (float)sleepTime / (float)elapsed;
+    }
+
+    void printStats()
+    {
+        // only what is measured here. the current draw and runtime per charge need a bench
+        // profile of the awake and asleep current, none has been recorded yet
+        Serial.print("Idle: ");
+        Serial.print(sleepShare(), 1);
+        Serial.print("% asleep, ");
+        Serial.print(sleepCount);
+        Serial.print(" sleeps, ");
+        Serial.print(earlyWakes);
+        Serial.println(" woken early");
+    }
+
+}
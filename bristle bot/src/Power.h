@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// low power idle between scheduled events. loop() passes the time until the
+// next task is due, and the cpu sleeps until then or until wake() is called
+// from an interrupt. on the mbed core this blocks the main thread, so the rtos
+// idle thread sleeps (WFE) with the RTC low power ticker as the wakeup.
+namespace Power
+{
+
+    // shorter gaps than this are not worth sleeping for (ms)
+    static const uint32_t MIN_SLEEP_MILLIS = 2;
+
+    // pin wired to the compass DRDY output, -1 when it is not connected
+    static const int COMPASS_DRDY_PIN = -1;
+
+    // sets up the wake sources
+    void setupPower();
+
+    // sleeps for up to maxMillis, returns early if wake() is called
+    void idle(uint32_t maxMillis);
+
+    // ends the current idle period early, safe to call from interrupts
+    void wake();
+
+    // share of time spent asleep since boot (0-100%)
+    float sleepShare();
+
+    // prints the share of time asleep, the sleeps and the early wakes
+    void printStats();
+
+}
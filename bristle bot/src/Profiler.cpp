@@ -0,0 +1,131 @@
+#include "Profiler.h"
+
+#include <Arduino.h>
+
+namespace Profiler
+{
+
+    static const char *ZONE_NAMES[PROFILE_ZONE_COUNT] = {
+        "trilateration",
+        "ble poll",
+        "read heading",
+        "sound average",
+        "sound classify",
+    };
+
+    static const uint32_t CYCLES_PER_US = 64;
+
+    static ZoneStats zones[PROFILE_ZONE_COUNT];
+
+    void begin()
+    {
+#if defined(DWT)
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+        reset();
+    }
+
+    uint32_t cycles()
+    {
+#if defined(DWT)
+        return DWT->CYCCNT;
+#else
+        return micros() * CYCLES_PER_US;
+#endif
+    }
+
+    static int bucketFor(uint32_t cycles)
+    {
+        if (cycles == 0)
+            return 0;
+        int bucket = (31 - __builtin_clz(cycles)) - BUCKET_SHIFT;
+        if (bucket < 0)
+            return 0;
+        if (bucket >= NUM_BUCKETS)
+            return NUM_BUCKETS - 1;
+        return bucket;
+    }
+
+    void record(ProfileZone zone, uint32_t cycles)
+    {
+        ZoneStats &z = zones[zone];
+        if (z.count == 0 || cycles < z.min)
+            z.min = cycles;
+        if (cycles > z.max)
+            z.max = cycles;
+        z.count++;
+        z.total += cycles;
+        z.histogram[bucketFor(cycles)]++;
+    }
+
+    const ZoneStats &getZone(ProfileZone zone)
+    {
+        return zones[zone];
+    }
+
+    void print()
+    {
+        char line[96];
+        snprintf(line, sizeof(line), "%-14s %8s %10s %10s %10s", "zone", "count", "min", "mean", "max");
+        Serial.println(line);
+        for (int i = 0; i < PROFILE_ZONE_COUNT; i++)
+        {
+            const ZoneStats &z = zones[i];
+            snprintf(line, sizeof(line), "%-14s %8lu %10lu %10lu %10lu",
+                     ZONE_NAMES[i],
+                     (unsigned long)z.count,
+                     (unsigned long)z.min,
+                     (unsigned long)(z.count ? z.total / z.count : 0),
+                     (unsigned long)z.max);
+            Serial.println(line);
+
+            // histogram as counts per power of two bucket, starting at 2^BUCKET_SHIFT cycles
+            Serial.print("  hist:");
+            for (int b = 0; b < NUM_BUCKETS; b++)
+            {
+                Serial.print(' ');
+                Serial.print(z.histogram[b]);
+            }
+            Serial.println();
+        }
+    }
+
+    static uint16_t toMicros16(uint64_t cycles)
+    {
+        uint64_t us = cycles / CYCLES_PER_US;
+        return us > UINT16_MAX ? UINT16_MAX : us;
+    }
+
+    uint8_t summarise(uint8_t *out, uint8_t maxLen)
+    {
+        // zone count, then per zone mean and max in us as little endian uint16
+        if (maxLen < 1)
+            return 0;
+        uint8_t len = 1;
+        uint8_t count = 0;
+        for (int i = 0; i < PROFILE_ZONE_COUNT && len + 4 <= maxLen; i++)
+        {
+            const ZoneStats &z = zones[i];
+            uint16_t mean = toMicros16(z.count ? z.total / z.count : 0);
+            uint16_t max = toMicros16(z.max);
+            out[len++] = mean & 0xFF;
+            out[len++] = mean >> 8;
+            out[len++] = max & 0xFF;
+            out[len++] = max >> 8;
+            count++;
+        }
+        out[0] = count;
+        return len;
+    }
+
+    void reset()
+    {
+        for (int i = 0; i < PROFILE_ZONE_COUNT; i++)
+        {
+            zones[i] = ZoneStats();
+        }
+    }
+
+}
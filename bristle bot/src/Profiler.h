@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+// scoped cycle profiler using the Cortex-M4 DWT cycle counter (64 cycles per us at 64 MHz).
+// PROFILE_SCOPE() is compiled out unless the build defines ENABLE_PROFILER.
+
+// zones that can be profiled, add new ones before PROFILE_ZONE_COUNT and name them in Profiler.cpp
+enum ProfileZone : uint8_t
+{
+    PROFILE_TRILATERATION,
+    PROFILE_BLE_POLL,
+    PROFILE_READ_HEADING,
+    PROFILE_SOUND_AVERAGE,
+    PROFILE_SOUND_CLASSIFY,
+    PROFILE_ZONE_COUNT
+};
+
+namespace Profiler
+{
+
+    // histogram bucket i counts runs of 2^(i + BUCKET_SHIFT) to 2^(i + BUCKET_SHIFT + 1) cycles,
+    // the first and last buckets also collect everything below and above
+    static const int NUM_BUCKETS = 16;
+    static const int BUCKET_SHIFT = 6;
+
+    struct ZoneStats
+    {
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+        uint64_t total;
+        uint32_t histogram[NUM_BUCKETS];
+    };
+
+    // enables the cycle counter
+    void begin();
+
+    // current value of the cycle counter
+    uint32_t cycles();
+
+    // adds one run of a zone
+    void record(ProfileZone zone, uint32_t cycles);
+
+    const ZoneStats &getZone(ProfileZone zone);
+
+    // prints every zone's statistics and histogram over serial
+    void print();
+
+    // packs mean and max time (us) of every zone into a telemetry payload, returns its length
+    uint8_t summarise(uint8_t *out, uint8_t maxLen);
+
+    void reset();
+
+    // records the cycles between construction and destruction
+    class Scope
+    {
+    public:
+        explicit Scope(ProfileZone zone) : zone(zone), start(cycles()) {}
+        ~Scope() { record(zone, cycles() - start); }
+
+    private:
+        ProfileZone zone;
+        uint32_t start;
+    };
+
+}
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_SCOPE(zone) Profiler::Scope profileScope_##zone(zone)
+#else
+#define PROFILE_SCOPE(zone) do {} while (0)
+#endif
@@ -0,0 +1,206 @@
+#include "Scheduler.h"
+
+#include <Arduino.h>
+
+namespace Scheduler
+{
+
+    struct Task
+    {
+        const char *name;
+        TaskFunction function;
+        uint32_t period;      // us
+        uint32_t budget;      // us
+        uint8_t priority;
+        bool suspended;
+        uint32_t nextRelease; // micros() timestamp of the next release
+        TaskStats stats;
+    };
+
+    // tasks are stored in registration order (the index is the task id),
+    // dispatchOrder holds the same ids sorted by priority
+    static Task tasks[MAX_TASKS];
+    static uint8_t dispatchOrder[MAX_TASKS];
+    static int taskCount = 0;
+
+    static uint32_t statsStart = 0;
+
+    int addTask(const char *name, TaskFunction function, uint32_t periodMs, uint8_t priority, uint32_t budgetUs)
+    {
+        if (taskCount >= MAX_TASKS || function == nullptr)
+            return -1;
+
+        int id = taskCount;
+        Task &task = tasks[id];
+        task.name = name;
+        task.function = function;
+        task.period = periodMs * 1000;
+        task.budget = budgetUs;
+        task.priority = priority;
+        task.suspended = false;
+        task.nextRelease = micros();
+        task.stats = TaskStats();
+
+        // insert into the dispatch order, tasks of equal priority keep registration order
+        int pos = taskCount;
+        while (pos > 0 && tasks[dispatchOrder[pos - 1]].priority > priority)
+        {
+            dispatchOrder[pos] = dispatchOrder[pos - 1];
+            pos--;
+        }
+        dispatchOrder[pos] = id;
+        taskCount++;
+
+        if (statsStart == 0)
+            statsStart = micros();
+
+        return id;
+    }
+
+    static void runTask(Task &task, uint32_t now)
+    {
+        uint32_t jitter = (task.period == 0) ? 0 : now - task.nextRelease;
+
+        uint32_t start = micros();
+        task.function();
+        uint32_t duration = micros() - start;
+
+        TaskStats &s = task.stats;
+        s.runs++;
+        s.lastJitter = jitter;
+        if (jitter > s.maxJitter)
+            s.maxJitter = jitter;
+        s.lastRunTime = duration;
+        if (duration > s.maxRunTime)
+            s.maxRunTime = duration;
+        s.totalRunTime += duration;
+        if (task.budget != 0 && duration > task.budget)
+            s.overruns++;
+
+        if (task.period == 0)
+            return;
+
+        // keep releases on a fixed grid, unless we have fallen a whole period behind
+        task.nextRelease += task.period;
+        uint32_t late = micros() - task.nextRelease;
+        if ((int32_t)late >= (int32_t)task.period)
+        {
+            s.skipped += late / task.period;
+            task.nextRelease = micros() + task.period;
+        }
+    }
+
+    void dispatch()
+    {
+        for (int i = 0; i < taskCount; i++)
+        {
+            Task &task = tasks[dispatchOrder[i]];
+            if (task.suspended)
+                continue;
+            uint32_t now = micros();
+            if (task.period == 0 || (int32_t)(now - task.nextRelease) >= 0)
+            {
+                runTask(task, now);
+            }
+        }
+    }
+
+    uint32_t msUntilNextTask()
+    {
+        uint32_t now = micros();
+        uint32_t soonest = UINT32_MAX;
+        for (int i = 0; i < taskCount; i++)
+        {
+            if (tasks[i].suspended)
+                continue;
+            if (tasks[i].period == 0)
+                return 0;
+            int32_t remaining = (int32_t)(tasks[i].nextRelease - now);
+            if (remaining <= 0)
+                return 0;
+            if ((uint32_t)remaining < soonest)
+                soonest = remaining;
+        }
+        return (soonest == UINT32_MAX) ? UINT32_MAX : soonest / 1000;
+    }
+
+    void setPeriod(int id, uint32_t periodMs)
+    {
+        if (id < 0 || id >= taskCount)
+            return;
+        tasks[id].period = periodMs * 1000;
+    }
+
+    void suspendTask(int id)
+    {
+        if (id < 0 || id >= taskCount)
+            return;
+        tasks[id].suspended = true;
+    }
+
+    void deferTask(int id, uint32_t delayMs)
+    {
+        if (id < 0 || id >= taskCount)
+            return;
+        tasks[id].nextRelease = micros() + delayMs * 1000;
+    }
+
+    const TaskStats *getStats(int id)
+    {
+        if (id < 0 || id >= taskCount)
+            return nullptr;
+        return &tasks[id].stats;
+    }
+
+    float cpuShare(int id)
+    {
+        if (id < 0 || id >= taskCount)
+            return 0.0;
+        uint32_t elapsed = micros() - statsStart;
+        if (elapsed == 0)
+            return 0.0;
+        return 100.0 * (float)tasks[id].stats.totalRunTime / (float)elapsed;
+    }
+
+    // cpu share in hundredths of a percent, printed as fixed point: newlib-nano leaves
+    // out float printf unless it is linked in, and %f would print nothing
+    static unsigned long cpuHundredths(int id)
+    {
+        uint32_t elapsed = micros() - statsStart;
+        if (elapsed == 0)
+            return 0;
+        return (unsigned long)((uint64_t)tasks[id].stats.totalRunTime * 10000 / elapsed);
+    }
+
+    void printStats()
+    {
+        char line[112];
+        snprintf(line, sizeof(line), "%-12s %7s %7s %7s %8s %8s %8s %8s %6s",
+                 "task", "runs", "overrun", "skipped", "jit(us)", "maxjit", "run(us)", "maxrun", "cpu%");
+        Serial.println(line);
+        for (int i = 0; i < taskCount; i++)
+        {
+            const TaskStats &s = tasks[i].stats;
+            unsigned long cpu = cpuHundredths(i);
+            snprintf(line, sizeof(line), "%-12s %7lu %7lu %7lu %8lu %8lu %8lu %8lu %3lu.%02lu",
+                     tasks[i].name,
+                     (unsigned long)s.runs,
+                     (unsigned long)s.overruns,
+                     (unsigned long)s.skipped,
+                     (unsigned long)s.lastJitter,
+                     (unsigned long)s.maxJitter,
+                     (unsigned long)s.lastRunTime,
+                     (unsigned long)s.maxRunTime,
+                     cpu / 100, cpu % 100);
+            Serial.println(line);
+        }
+    }
+
+    void resetStats()
+    {
+        for (int i = 0; i < taskCount; i++)
+            tasks[i].stats = TaskStats();
+        statsStart = micros();
+    }
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Scheduler
+{
+
+    typedef void (*TaskFunction)();
+
+    // maximum number of tasks that can be registered
+    static const int MAX_TASKS = 12;
+
+    // timing statistics kept for every task, times are in microseconds
+    struct TaskStats
+    {
+        uint32_t runs;        // number of times the task has been dispatched
+        uint32_t overruns;    // runs that took longer than the task's budget
+        uint32_t skipped;     // releases dropped because the task fell a full period behind
+        uint32_t lastJitter;  // how late the last run started after its release time
+        uint32_t maxJitter;   // worst start delay seen
+        uint32_t lastRunTime; // duration of the last run
+        uint32_t maxRunTime;  // worst run duration seen
+        uint64_t totalRunTime; // summed run duration, used for the cpu share
+    };
+
+    // registers a task and returns its id, or -1 if the table is full.
+    // a lower priority value is dispatched first when several tasks are due,
+    // a period of 0 runs the task on every dispatch
+    int addTask(const char *name, TaskFunction function, uint32_t periodMs, uint8_t priority, uint32_t budgetUs);
+
+    // runs every task that is due, in priority order (call this from loop())
+    void dispatch();
+
+    // milliseconds until the next task is due, 0 if one is due now
+    uint32_t msUntilNextTask();
+
+    // changes the period of a registered task, takes effect from its next release
+    void setPeriod(int id, uint32_t periodMs);
+
+    // stops dispatching a task, used by tasks that have finished their work
+    void suspendTask(int id);
+
+    // moves a task's next release to delayMs from now
+    void deferTask(int id, uint32_t delayMs);
+
+    // statistics for a task, or nullptr for an invalid id
+    const TaskStats *getStats(int id);
+
+    // share of cpu time a task has used since the stats were last reset (0-100%)
+    float cpuShare(int id);
+
+    // prints a table of the task statistics over serial
+    void printStats();
+
+    // clears all task statistics
+    void resetStats();
+
+}
@@ -0,0 +1,113 @@
+#include "SoundBearing.h"
+
+#include <cmath>
+
+namespace SoundBearing
+{
+
+    static const double DEGREES = 180.0 / M_PI;
+
+    // depth has to be this many standard errors for the bearing to mean anything
+    static const double MIN_SIGNIFICANCE = 3.0;
+
+    // sums for the normal equations of level = a + b cos h + c sin h
+    static uint32_t count = 0;
+    static double sumCos, sumSin, sumCos2, sumSin2, sumCosSin;
+    static double sumLevel, sumLevelCos, sumLevelSin, sumLevel2;
+
+    // unwrapped heading of the last level and the first one
+    static double firstHeading, lastHeading;
+    static double lowest, highest;
+
+    void reset()
+    {
+        count = 0;
+        sumCos = sumSin = sumCos2 = sumSin2 = sumCosSin = 0.0;
+        sumLevel = sumLevelCos = sumLevelSin = sumLevel2 = 0.0;
+        firstHeading = lastHeading = lowest = highest = 0.0;
+    }
+
+    void add(float heading, float level)
+    {
+        double unwrapped = heading;
+        if (count == 0)
+        {
+            firstHeading = lowest = highest = unwrapped;
+        }
+        else
+        {
+            unwrapped = lastHeading + remainder(heading - lastHeading, 360.0);
+            lowest = fmin(lowest, unwrapped);
+            highest = fmax(highest, unwrapped);
+        }
+        lastHeading = unwrapped;
+
+        double c = cos(heading / DEGREES), s = sin(heading / DEGREES);
+        count++;
+        sumCos += c;
+        sumSin += s;
+        sumCos2 += c * c;
+        sumSin2 += s * s;
+        sumCosSin += c * s;
+        sumLevel += level;
+        sumLevelCos += level * c;
+        sumLevelSin += level * s;
+        sumLevel2 += (double)level * level;
+    }
+
+    float turned()
+    {
+        return count > 0 ? lastHeading - firstHeading : 0.0f;
+    }
+
+    uint32_t levels()
+    {
+        return count;
+    }
+
+    Estimate estimate()
+    {
+        Estimate result = {NAN, NAN, 0.0f, NAN, (float)(highest - lowest), count, false};
+        if (count < 3)
+            return result;
+
+        // solve the 3x3 normal equations by Cramer's rule
+        double m[3][3] = {{(double)count, sumCos, sumSin},
+                          {sumCos, sumCos2, sumCosSin},
+                          {sumSin, sumCosSin, sumSin2}};
+        double v[3] = {sumLevel, sumLevelCos, sumLevelSin};
+        double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                     m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                     m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+        if (fabs(det) < 1e-9 * count * count * count)
+            return result;
+        double x[3];
+        for (int k = 0; k < 3; k++)
+        {
+            double n[3][3];
+            for (int i = 0; i < 3; i++)
+                for (int j = 0; j < 3; j++)
+                    n[i][j] = j == k ? v[i] : m[i][j];
+            x[k] = (n[0][0] * (n[1][1] * n[2][2] - n[1][2] * n[2][1]) -
+                    n[0][1] * (n[1][0] * n[2][2] - n[1][2] * n[2][0]) +
+                    n[0][2] * (n[1][0] * n[2][1] - n[1][1] * n[2][0])) / det;
+        }
+
+        // residual sum of squares from the sums: sum(y^2) - x . v at the least squares solution
+        double amplitude = hypot(x[1], x[2]);
+        double squares = fmax(sumLevel2 - (x[0] * v[0] + x[1] * v[1] + x[2] * v[2]), 0.0);
+        double sigma = count > 3 ? sqrt(squares / (count - 3)) : 0.0;
+        // for headings spread evenly round the circle b and c each have variance 2 sigma^2 / n,
+        // so does the amplitude, and the bearing sigma / amplitude times that in radians
+        double amplitudeError = sigma * sqrt(2.0 / count);
+
+        result.bearing = fmod(atan2(x[2], x[1]) * DEGREES + 360.0, 360.0);
+        result.error = amplitude > 0.0 ? fmin(amplitudeError / amplitude * DEGREES, 180.0) : 180.0;
+        result.depth = 2.0 * amplitude;
+        result.residual = sigma;
+        result.valid = count >= (uint32_t)MIN_LEVELS && result.coverage >= MIN_COVERAGE &&
+                       amplitude > MIN_SIGNIFICANCE * amplitudeError;
+        return result;
+    }
+
+}
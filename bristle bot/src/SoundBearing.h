@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+// bearing of a sound from one microphone: the bot spins in place while the level is
+// measured, and the level against heading is fitted with the response of a mic that
+// is more sensitive to its front, L(h) = offset + depth / 2 * cos(h - bearing). the
+// fit is least squares on running sums, so a sweep of any length takes the same
+// memory. headings and bearings are compass degrees, clockwise from north.
+namespace SoundBearing
+{
+
+    // fewest levels an estimate is made from
+    static const int MIN_LEVELS = 24;
+
+    // the headings have to cover this much of the circle (degrees)
+    static const float MIN_COVERAGE = 330.0;
+
+    struct Estimate
+    {
+        float bearing;  // heading the response peaks at, where the sound comes from (degrees)
+        float error;    // standard error of the bearing (degrees)
+        float depth;    // peak to trough of the fitted response (dB)
+        float residual; // rms of the levels about the fit (dB)
+        float coverage; // degrees the sweep turned through
+        uint32_t levels;
+        bool valid;     // enough levels and coverage, and the depth is well clear of the noise
+    };
+
+    // forgets the levels so far
+    void reset();
+
+    // adds a level (dB) heard at a heading. headings are unwrapped from one level to
+    // the next, so consecutive levels must be less than half a turn apart
+    void add(float heading, float level);
+
+    // degrees turned since reset(), signed, positive clockwise
+    float turned();
+
+    uint32_t levels();
+
+    // fits the levels added so far
+    Estimate estimate();
+
+}
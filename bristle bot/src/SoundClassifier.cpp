@@ -0,0 +1,53 @@
+#include "SoundClassifier.h"
+
+#include <classifier/LogMel.h>
+#include <classifier/SoundNet.h>
+
+#include <cmath>
+
+namespace SoundClassifier
+{
+
+    static_assert(SoundNet::CLASSES == LABEL_COUNT, "the network and the labels disagree");
+
+    static const char *LABEL_NAMES[LABEL_COUNT] = {
+        "ambient",
+        "target",
+        "motors",
+        "speech",
+    };
+
+    const char *labelName(Label label)
+    {
+        return label < LABEL_COUNT ? LABEL_NAMES[label] : "?";
+    }
+
+    bool classify(const int16_t *samples, int count, int gain, Result &result)
+    {
+        int8_t features[LogMel::FEATURES];
+        int8_t logits[SoundNet::CLASSES];
+        if (!LogMel::compute(samples, count, gain, features) || !SoundNet::run(SoundNet::MODEL, features, logits))
+            return false;
+
+        // softmax of the four dequantized logits, in float
+        const SoundNet::Model &model = SoundNet::MODEL;
+        int best = 0;
+        for (int i = 1; i < LABEL_COUNT; i++)
+        {
+            if (logits[i] > logits[best])
+                best = i;
+        }
+        float sum = 0.0f;
+        for (int i = 0; i < LABEL_COUNT; i++)
+        {
+            result.probabilities[i] = expf(model.logitScale * (logits[i] - logits[best]));
+            sum += result.probabilities[i];
+        }
+        for (int i = 0; i < LABEL_COUNT; i++)
+            result.probabilities[i] /= sum;
+        result.label = (Label)best;
+        result.confidence = result.probabilities[best];
+        return true;
+    }
+
+}
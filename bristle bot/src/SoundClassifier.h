@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// what a mic frame is mostly made of, from its log-mel features through a small
+// int8 network (classifier/SoundNet.h). optional: updateSoundLevel() only runs it
+// in builds that define ENABLE_SOUND_CLASSIFIER.
+namespace SoundClassifier
+{
+
+    enum Label : uint8_t
+    {
+        LABEL_AMBIENT = 0, // room noise, nothing in particular
+        LABEL_TARGET = 1,  // the tonal sound source the swarm is looking for
+        LABEL_MOTORS = 2,  // vibration motors, this bot's or its neighbours'
+        LABEL_SPEECH = 3,
+        LABEL_COUNT
+    };
+
+    const char *labelName(Label label);
+
+    struct Result
+    {
+        Label label;
+        float confidence; // probability of label
+        float probabilities[LABEL_COUNT];
+    };
+
+    // classifies a frame recorded at gain (PDM register value), false if it is too
+    // short or the network fails
+    bool classify(const int16_t *samples, int count, int gain, Result &result);
+
+}
@@ -0,0 +1,123 @@
+#include "SoundGain.h"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace SoundGain
+{
+
+    static const float FULL_SCALE = 32768.0;
+
+    // peaks above HIGH_PEAK turn the gain down straight away, to bring them to
+    // TARGET_PEAK. frames that stay under both quiet levels for QUIET_FRAMES in a
+    // row turn it up, by at most MAX_STEP_UP and never past TARGET_PEAK
+    static const int HIGH_PEAK = 23197;  // -3 dBFS
+    static const int TARGET_PEAK = 8231; // -12 dBFS
+    static const int QUIET_PEAK = 1036;  // -30 dBFS
+    static const float QUIET_RMS = 328;  // -40 dBFS
+    static const int QUIET_FRAMES = 2;
+    static const int MAX_STEP_UP = 12;   // 6 dB
+    static const int CLIPPED_STEP_DOWN = 12; // the real peak of a clipped frame is unknown
+
+    static int currentGain = DEFAULT_GAIN;
+    static int quietFrames = 0;
+
+    static int clampGain(int gain)
+    {
+        return gain < MIN_GAIN ? MIN_GAIN : (gain > MAX_GAIN ? MAX_GAIN : gain);
+    }
+
+    // gain steps (0.5 dB) between two amplitudes
+    static float stepsBetween(float from, float to)
+    {
+        return 40.0f * log10f(to / from);
+    }
+
+    Frame measure(const int16_t *samples, int count)
+    {
+        Frame frame = {0.0, 0.0, 0, false};
+        int32_t sum = 0;
+        int64_t sumSquares = 0;
+        for (int i = 0; i < count; i++)
+        {
+            int32_t s = samples[i];
+            sumSquares += s * s;
+            int amplitude = abs(s);
+            sum += amplitude;
+            if (amplitude > frame.peak)
+                frame.peak = amplitude;
+        }
+        if (count > 0)
+        {
+            frame.mean = (float)sum / count;
+            frame.rms = sqrtf((float)sumSquares / count);
+        }
+        frame.clipped = frame.peak >= 32767;
+        return frame;
+    }
+
+    void reset(int gain)
+    {
+        currentGain = clampGain(gain);
+        quietFrames = 0;
+    }
+
+    int gain()
+    {
+        return currentGain;
+    }
+
+    bool update(const Frame &frame)
+    {
+        int change = 0;
+        if (frame.peak > HIGH_PEAK)
+        {
+            quietFrames = 0;
+            change = -(int)ceilf(stepsBetween(TARGET_PEAK, frame.peak));
+            if (frame.clipped && change > -CLIPPED_STEP_DOWN)
+                change = -CLIPPED_STEP_DOWN;
+        }
+        else if (frame.peak < QUIET_PEAK && frame.rms < QUIET_RMS)
+        {
+            if (++quietFrames >= QUIET_FRAMES)
+            {
+                quietFrames = 0;
+                change = (int)floorf(stepsBetween(frame.peak > 0 ? frame.peak : 1, TARGET_PEAK));
+                if (change > MAX_STEP_UP)
+                    change = MAX_STEP_UP;
+            }
+        }
+        else
+        {
+            quietFrames = 0;
+        }
+
+        int previous = currentGain;
+        currentGain = clampGain(currentGain + change);
+        return currentGain != previous;
+    }
+
+    float levelDb(const Frame &frame, int gain)
+    {
+        float rms = frame.rms > 0.0f ? frame.rms : 0.5f; // below one step, call it half
+        return 20.0f * log10f(rms / FULL_SCALE) - (gain - UNITY_GAIN) * 0.5f;
+    }
+
+    float peakDb(const Frame &frame, int gain)
+    {
+        float peak = frame.peak > 0 ? frame.peak : 0.5f;
+        return 20.0f * log10f(peak / FULL_SCALE) - (gain - UNITY_GAIN) * 0.5f;
+    }
+
+    float atDefaultGain(float amplitude, int gain)
+    {
+        return amplitude * powf(10.0f, (DEFAULT_GAIN - gain) / 40.0f);
+    }
+
+    uint8_t levelByte(float db)
+    {
+        long steps = lroundf((db + 110.0f) * 2.0f);
+        return steps < 0 ? 0 : (steps > 255 ? 255 : steps);
+    }
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+// automatic gain control for the PDM microphone. the gain is the nRF52840 PDM
+// register value: 0.5 dB steps, 0 is -20 dB, 40 is 0 dB and 80 is +20 dB. it is
+// changed between frames from their peak and rms: down at once when a frame gets
+// near full scale, up a step at a time after a few quiet frames, and not at all in
+// between. levels are reported with the gain taken out, so they stay comparable
+// whatever the gain was.
+namespace SoundGain
+{
+
+    static const int MIN_GAIN = 0;
+    static const int MAX_GAIN = 80;
+    static const int UNITY_GAIN = 40;
+    static const int DEFAULT_GAIN = 20; // DEFAULT_PDM_GAIN of the mic library
+
+    // statistics of one frame of samples
+    struct Frame
+    {
+        float mean; // mean absolute amplitude
+        float rms;
+        int peak;
+        bool clipped;
+    };
+
+    Frame measure(const int16_t *samples, int count);
+
+    // forgets the quiet frames so far and starts from gain
+    void reset(int gain = DEFAULT_GAIN);
+
+    // gain the next frame should be recorded at
+    int gain();
+
+    // takes the statistics of a frame recorded at gain(), true if gain() changed
+    bool update(const Frame &frame);
+
+    // frame rms in dB relative to full scale at unity gain, independent of the gain
+    float levelDb(const Frame &frame, int gain);
+
+    // frame peak on the same scale
+    float peakDb(const Frame &frame, int gain);
+
+    // an amplitude recorded at gain, as it would have been at the default gain
+    float atDefaultGain(float amplitude, int gain);
+
+    // a level from levelDb() in the telemetry sound byte: 0.5 dB steps from -110 dB,
+    // so the byte covers -110 to +17.5 dB
+    uint8_t levelByte(float db);
+
+}
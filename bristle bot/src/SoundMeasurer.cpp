@@ -3,13 +3,22 @@
 #include <mic.h>
 #include <Communication.h>
 #include <Locomotion.h>
+#include <Log.h>
+#include <Params.h>
+#include <Profiler.h>
+#include <SoundBearing.h>
+#include <SoundClassifier.h>
+#include <SoundGain.h>
+#include <SoundStats.h>
+#include <Trace.h>
+#include <orientation/Orientation.h>
 
 // roughly based on the example from the Seeed studio mic library
 
 // settings for nrf52840
 #define DEBUG 0                   // no debugging "pin pulse during isr" idk what that means
-#define SAMPLES 800               // Number of samples to caputure
-#define SAMPLE_MILLIS 2000        // How often to sample
+#define SAMPLES 800               // samples in one frame (buf_size / 2), 50 ms
+#define FRAME_MICROS 50000
 
 // config
 mic_config_t mic_config
@@ -23,32 +32,47 @@ mic_config_t mic_config
 // mic instance
 NRF52840_ADC_Class Mic(&mic_config);
 
-int16_t recording_buf[SAMPLES];
-volatile uint8_t recording = 0;
-volatile static bool record_ready = false;
-
-
-// Callback function for audio data - from the example
-static void audio_rec_callback(uint16_t *buf, uint32_t buf_len) {
-    static uint32_t idx = 0;
-    
-    // Copy samples from DMA buffer to our recording buffer
-    for (uint32_t i = 0; i < buf_len; i++) {
-      recording_buf[idx++] = buf[i];
-      
-      // Check if we've filled our recording buffer
-      if (idx >= SAMPLES) { 
-        idx = 0;
-        record_ready = true;
-        break;
-      }
+// frames measured again at a lower gain when one clips
+static const int MAX_REMEASURES = 2;
+
+// gain the PDM is set to
+static int appliedGain = SoundGain::DEFAULT_GAIN;
+
+// sets the gain for the next frames: the parameter if it is fixed, else the AGC's
+static void applyGain()
+{
+    int gain = Params::values.micGain >= 0 ? Params::values.micGain : SoundGain::gain();
+    if (gain != appliedGain) {
+        Mic.setGain(gain);
+        appliedGain = gain;
     }
 }
 
-void setupSoundLevel()
+#ifdef ENABLE_SOUND_CLASSIFIER
+// what the frame is mostly made of, and how sure the network is of each label
+static void classifyFrame(const mic_frame_t &frame, int gain)
 {
-    Mic.set_callback(audio_rec_callback);
+    SoundClassifier::Result result;
+    bool classified;
+    {
+        PROFILE_SCOPE(PROFILE_SOUND_CLASSIFY);
+        classified = SoundClassifier::classify(frame.data(), frame.size(), gain, result);
+    }
+    if (!classified)
+        return;
+    LOG_INFO(LOG_SOUND_CLASS, result.label, result.confidence);
 
+    uint8_t payload[1 + SoundClassifier::LABEL_COUNT];
+    payload[0] = result.label;
+    for (int i = 0; i < SoundClassifier::LABEL_COUNT; i++)
+        payload[1 + i] = constrain(lroundf(result.probabilities[i] * 255.0f), 0, 255);
+    Comms::update_frame(Comms::FRAME_SOUND_CLASS, payload, sizeof(payload));
+}
+#endif
+
+void setupSoundLevel()
+{
+    // no callback: frames are read from the driver's buffer pool, outside the interrupt
     if (!Mic.begin()) {
         Serial.println("Microphone init failed");
         while (1) {
@@ -59,68 +83,226 @@ void setupSoundLevel()
         }
     }
 
-    Mic.pause(); // pause so callback does't run constantly
+    Mic.pause(); // pause so the interrupt does't run constantly
+    SoundStats::reset(millis());
 
     Serial.println("Microphone init done");
 }
 
 void updateSoundLevel()
 {   
-
-    static unsigned long lastSample = 0;
-    if (millis() - lastSample < SAMPLE_MILLIS)
-    {
+    // the bearing sweep has the mic and the motors
+    if (soundBearingActive())
         return;
-    }
-    lastSample = millis();
 
-    Serial.println("Resuming Recording, pausing motors ");
+    LOG_DEBUG(LOG_SOUND_START);
     Locomotion::stopMotors();
     delay(200); // wait for motors to stop
+    applyGain();
     Mic.resume();
 
-    // Wait until recording is ready
-    unsigned long startTime = millis();
-    while (!record_ready) {
-      if (millis() - startTime > 500) {
-          Serial.println("Measurement timed out");
-          recording = 0;
+    // wait for a frame recorded after the motors stopped
+    mic_frame_t frame;
+    SoundGain::Frame stats;
+    int gain;
+    for (int attempt = 0; ; attempt++) {
+        if (!Mic.borrow(frame, 500)) {
+            LOG_WARN(LOG_SOUND_TIMEOUT);
             Mic.pause();
+            Locomotion::resumeMotors();
             return;
         }
-        delay(1);
+
+        {
+            PROFILE_SCOPE(PROFILE_SOUND_AVERAGE);
+            stats = SoundGain::measure(frame.data(), frame.size());
+        }
+        gain = appliedGain;
+        bool automatic = Params::values.micGain < 0;
+        if (automatic && SoundGain::update(stats)) {
+            LOG_INFO(LOG_SOUND_GAIN, gain, SoundGain::gain(), stats.peak, stats.rms);
+        }
+        if (!stats.clipped || !automatic || SoundGain::gain() == gain || attempt == MAX_REMEASURES)
+            break;
+
+        // clipped: the level is lost, measure again at the lower gain. resuming
+        // drops the frames recorded while the gain changed
+        Mic.release(frame);
+        Mic.pause();
+        applyGain();
+        Mic.resume();
     }
 
+    SoundStats::addFrame(frame.data(), frame.size(), gain);
+#ifdef ENABLE_SOUND_CLASSIFIER
+    classifyFrame(frame, gain);
+#endif
+    Mic.release(frame);
     Mic.pause();
-    Serial.println("Done recording, resuming motors ");
     Locomotion::resumeMotors();
 
-    //Serial.println("Finished sampling");
-    
-    // // Print all the samples
-    // for (int i = 0; i < SAMPLES; i++) {
-    //   Serial.println(recording_buf[i]);
-    // }
-
-    // average the samples
-    int32_t sum = 0;
-    for (int i = 0; i < SAMPLES; i++) {
-        sum += abs(recording_buf[i]); // amplitude
+    // the mean amplitude as the default gain would have recorded it, the old sound byte
+    uint8_t average = constrain(lroundf(SoundGain::atDefaultGain(stats.mean, gain)), 0, 255);
+    float level = SoundGain::levelDb(stats, gain);
+    LOG_INFO(LOG_SOUND_LEVEL, average, level, gain);
+    TRACE_SOUND_FRAME(average, stats.peak, gain);
+
+    // update the sound level, in dB so it neither saturates nor bottoms out
+    Comms::update_sound(SoundGain::levelByte(level));
+
+    // the absolute level and the gain it was measured at
+    int16_t centiDb = constrain(lroundf(level * 100.0f), -32768, 32767);
+    uint8_t payload[4];
+    memcpy(payload, &centiDb, 2);
+    payload[2] = gain;
+    payload[3] = (stats.clipped ? 0x01 : 0) | (Params::values.micGain >= 0 ? 0x02 : 0);
+    Comms::update_frame(Comms::FRAME_SOUND, payload, sizeof(payload));
+
+    SoundStats::Summary summary;
+    if (SoundStats::intervalDone(millis(), Params::values.soundStatsMillis, summary) && summary.count > 0) {
+        LOG_INFO(LOG_SOUND_STATS, summary.l10, summary.l50, summary.l90, summary.peak);
+
+        // the percentile levels and peak of the interval, and how many levels they are from
+        const float levels[4] = {summary.l10, summary.l50, summary.l90, summary.peak};
+        uint8_t stats[10];
+        for (int i = 0; i < 4; i++) {
+            int16_t centi = constrain(lroundf(levels[i] * 100.0f), -32768, 32767);
+            memcpy(stats + i * 2, &centi, 2);
+        }
+        uint16_t count = min(summary.count, (uint32_t)UINT16_MAX);
+        memcpy(stats + 8, &count, 2);
+        Comms::update_frame(Comms::FRAME_SOUND_STATS, stats, sizeof(stats));
     }
-    uint8_t average = constrain(sum / SAMPLES, 0, 255);
-    Serial.print("Sound Average: ");
-    Serial.println(average);
+}
+
+// rotate and listen: the bot spins in place with the mic running, and every frame's
+// level goes to SoundBearing with the heading the bot had halfway through the frame
+
+// time for the motor to get the bot turning before levels are taken
+static const unsigned long SPIN_UP_MILLIS = 200;
+// a sweep that has not turned a full circle by then is given up on
+static const unsigned long SWEEP_TIMEOUT_MILLIS = 20000;
+
+enum BearingState { BEARING_IDLE, BEARING_SPIN_UP, BEARING_SWEEP };
+static BearingState bearingState = BEARING_IDLE;
+static unsigned long bearingStart = 0;     // millis() the current or last sweep started
+static uint32_t firstLevelTime = 0;        // micros() of the first level of the sweep
+static uint32_t lastLevelTime = 0;
+static SoundBearing::Estimate lastBearing = {NAN, NAN, 0.0, NAN, 0.0, 0, false};
+static uint32_t bearingCount = 0;
+
+void startSoundBearing()
+{
+    if (bearingState != BEARING_IDLE)
+        return;
+    LOG_INFO(LOG_SOUND_BEARING_START, Params::values.micGain >= 0 ? Params::values.micGain : SoundGain::gain());
+    // the gain stays put for the whole sweep, the levels have to be comparable
+    applyGain();
+    Locomotion::stopMotors(); // holds the walk until resumeMotors()
+    Locomotion::turnLeft();
+    SoundBearing::reset();
+    bearingStart = millis();
+    bearingState = BEARING_SPIN_UP;
+}
 
-    // update the sound level
-    Comms::update_sound(average);
+bool soundBearingActive()
+{
+    return bearingState != BEARING_IDLE;
+}
 
-    
-    // Reset flag
-    record_ready = false;
-    
+const SoundBearing::Estimate &lastSoundBearing()
+{
+    return lastBearing;
+}
 
-    // // Small delay before starting the next recording
-    // delay(1000);
+uint32_t soundBearingCount()
+{
+    return bearingCount;
+}
+
+// heading halfway through a frame that ended newer frames ago
+static float frameHeading(uint32_t now, int newer)
+{
+    // a frame is picked up on average half a task period after it ends, and its
+    // middle is half a frame before that
+    uint32_t centre = now - (uint32_t)newer * FRAME_MICROS - FRAME_MICROS;
+    float heading = getHeading();
+    uint32_t span = lastLevelTime - firstLevelTime;
+    if (SoundBearing::levels() < 2 || span == 0)
+        return heading;
+    // moved along by the rate the sweep has turned at so far
+    float rate = SoundBearing::turned() / span;
+    return heading + rate * (int32_t)(centre - getHeadingTime());
+}
+
+static void finishSoundBearing()
+{
+    Mic.pause();
+    Locomotion::resumeMotors();
+    bearingState = BEARING_IDLE;
+
+    lastBearing = SoundBearing::estimate();
+    bearingCount++;
+    LOG_INFO(LOG_SOUND_BEARING, lastBearing.bearing, lastBearing.error, lastBearing.depth, lastBearing.levels);
+    if (!lastBearing.valid)
+        LOG_WARN(LOG_SOUND_BEARING_INVALID, lastBearing.coverage, lastBearing.residual);
+
+    // bearing and its standard error in centidegrees, depth in centi-dB, levels and validity
+    uint16_t bearing = lastBearing.valid ? lroundf(lastBearing.bearing * 100.0f) % 36000 : UINT16_MAX;
+    uint16_t error = lastBearing.valid ? constrain(lroundf(lastBearing.error * 100.0f), 0, UINT16_MAX) : UINT16_MAX;
+    int16_t depth = constrain(lroundf(lastBearing.depth * 100.0f), -32768, 32767);
+    uint16_t levels = min(lastBearing.levels, (uint32_t)UINT16_MAX);
+    uint32_t millisTaken = millis() - bearingStart;
+    uint8_t seconds = min(millisTaken / 1000, (uint32_t)255);
+    uint8_t payload[9];
+    memcpy(payload, &bearing, 2);
+    memcpy(payload + 2, &error, 2);
+    memcpy(payload + 4, &depth, 2);
+    memcpy(payload + 6, &levels, 2);
+    payload[8] = seconds;
+    Comms::update_frame(Comms::FRAME_SOUND_BEARING, payload, sizeof(payload));
+}
+
+void updateSoundBearing()
+{
+    unsigned long now = millis();
+    if (bearingState == BEARING_IDLE) {
+        if (Params::values.bearingMillis > 0 && now - bearingStart >= (unsigned long)Params::values.bearingMillis)
+            startSoundBearing();
+        return;
+    }
+
+    if (bearingState == BEARING_SPIN_UP) {
+        if (now - bearingStart < SPIN_UP_MILLIS)
+            return;
+        Mic.resume(); // drops anything older
+        bearingState = BEARING_SWEEP;
+        return;
+    }
+
+    // every frame since the last call, oldest first
+    uint32_t nowMicros = micros();
+    int waiting = Mic.available();
+    for (int i = 0; i < waiting; i++) {
+        mic_frame_t frame;
+        if (!Mic.borrow(frame, 0))
+            break;
+        SoundGain::Frame stats;
+        {
+            PROFILE_SCOPE(PROFILE_SOUND_AVERAGE);
+            stats = SoundGain::measure(frame.data(), frame.size());
+        }
+        Mic.release(frame);
+        // a clipped frame's level is unknown, the gain is not changed mid sweep
+        if (stats.clipped)
+            continue;
+        float heading = frameHeading(nowMicros, waiting - 1 - i);
+        SoundBearing::add(heading, SoundGain::levelDb(stats, appliedGain));
+        if (SoundBearing::levels() == 1)
+            firstLevelTime = nowMicros;
+        lastLevelTime = nowMicros;
+    }
 
-    //Serial.println("Starting next sampling...");
+    if (fabsf(SoundBearing::turned()) >= 360.0f || now - bearingStart >= SWEEP_TIMEOUT_MILLIS)
+        finishSoundBearing();
 }
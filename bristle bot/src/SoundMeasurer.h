@@ -1,5 +1,23 @@
 #pragma once
 
+#include <SoundBearing.h>
+#include <cstdint>
+
 void setupSoundLevel();
 
-void updateSoundLevel();
\ No newline at end of file
+// takes a sound level measurement, call every Params::values.sampleMillis ms
+void updateSoundLevel();
+
+// starts a rotate and listen sweep for the bearing of the sound, see SoundBearing.
+// the bot spins in place for a full turn, the walk and updateSoundLevel() wait for it
+void startSoundBearing();
+
+// runs the sweep, call every 50 ms (one frame). also starts a sweep every
+// Params::values.bearingMillis ms when that is not 0
+void updateSoundBearing();
+
+bool soundBearingActive();
+
+// the last finished sweep's estimate, and how many sweeps have finished
+const SoundBearing::Estimate &lastSoundBearing();
+uint32_t soundBearingCount();
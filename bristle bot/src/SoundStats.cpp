@@ -0,0 +1,231 @@
+#include "SoundStats.h"
+#include "SoundGain.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace SoundStats
+{
+
+    Quantile::Quantile(float p) : p(p)
+    {
+        reset();
+    }
+
+    void Quantile::reset()
+    {
+        total = 0;
+        for (int i = 0; i < 5; i++)
+        {
+            heights[i] = 0.0f;
+            positions[i] = i;
+        }
+        desired[0] = 0.0f;
+        desired[1] = 2.0f * p;
+        desired[2] = 4.0f * p;
+        desired[3] = 2.0f + 2.0f * p;
+        desired[4] = 4.0f;
+        increments[0] = 0.0f;
+        increments[1] = p / 2.0f;
+        increments[2] = p;
+        increments[3] = (1.0f + p) / 2.0f;
+        increments[4] = 1.0f;
+    }
+
+    void Quantile::start(const float *sorted, uint32_t count)
+    {
+        reset();
+        // the markers go where they would be after count values
+        total = count;
+        for (int i = 0; i < 5; i++)
+        {
+            desired[i] = increments[i] * (count - 1);
+            positions[i] = lroundf(desired[i]);
+            if (i > 0 && positions[i] <= positions[i - 1])
+                positions[i] = positions[i - 1] + 1;
+        }
+        for (int i = 4; i > 0 && positions[i] > (int32_t)count - 5 + i; i--)
+            positions[i] = count - 5 + i;
+        for (int i = 0; i < 5; i++)
+            heights[i] = sorted[positions[i]];
+    }
+
+    float Quantile::parabolic(int i, int d) const
+    {
+        float below = positions[i] - positions[i - 1];
+        float above = positions[i + 1] - positions[i];
+        return heights[i] + d / (below + above) *
+            ((below + d) * (heights[i + 1] - heights[i]) / above + (above - d) * (heights[i] - heights[i - 1]) / below);
+    }
+
+    float Quantile::linear(int i, int d) const
+    {
+        return heights[i] + d * (heights[i + d] - heights[i]) / (positions[i + d] - positions[i]);
+    }
+
+    void Quantile::add(float x)
+    {
+        // the first five values, kept sorted
+        if (total < 5)
+        {
+            int i = total++;
+            for (; i > 0 && heights[i - 1] > x; i--)
+                heights[i] = heights[i - 1];
+            heights[i] = x;
+            return;
+        }
+        total++;
+
+        // the cell x falls in, stretching the ends if it is outside them
+        int cell;
+        if (x < heights[0])
+        {
+            heights[0] = x;
+            cell = 0;
+        }
+        else if (x >= heights[4])
+        {
+            heights[4] = x;
+            cell = 3;
+        }
+        else
+        {
+            cell = 0;
+            while (x >= heights[cell + 1])
+                cell++;
+        }
+        for (int i = cell + 1; i < 5; i++)
+            positions[i]++;
+        for (int i = 0; i < 5; i++)
+            desired[i] += increments[i];
+
+        // move the middle markers a position towards where they should be, if there
+        // is room between them and their neighbours
+        for (int i = 1; i < 4; i++)
+        {
+            float off = desired[i] - positions[i];
+            if ((off >= 1.0f && positions[i + 1] - positions[i] > 1) || (off <= -1.0f && positions[i - 1] - positions[i] < -1))
+            {
+                int d = off > 0.0f ? 1 : -1;
+                float height = parabolic(i, d);
+                if (heights[i - 1] < height && height < heights[i + 1])
+                    heights[i] = height;
+                else
+                    heights[i] = linear(i, d);
+                positions[i] += d;
+            }
+        }
+    }
+
+    float Quantile::value() const
+    {
+        if (total == 0)
+            return NAN;
+        if (total >= 5)
+            return heights[2];
+        // interpolated between the values kept so far
+        float rank = p * (total - 1);
+        int below = (int)rank;
+        if (below + 1 >= (int)total)
+            return heights[below];
+        return heights[below] + (rank - below) * (heights[below + 1] - heights[below]);
+    }
+
+    // L10 is exceeded 10% of the time, the 90th percentile of the levels
+    static Quantile l10(0.9f);
+    static Quantile l50(0.5f);
+    static Quantile l90(0.1f);
+    static float peak = -INFINITY;
+    static uint32_t start = 0;
+
+    // the first levels of the interval, in no particular order
+    static float held[HELD_LEVELS];
+    static uint32_t levels = 0;
+
+    void reset(uint32_t now)
+    {
+        l10.reset();
+        l50.reset();
+        l90.reset();
+        levels = 0;
+        peak = -INFINITY;
+        start = now;
+    }
+
+    void addLevel(float level)
+    {
+        if (levels < HELD_LEVELS)
+        {
+            held[levels++] = level;
+            if (levels < HELD_LEVELS)
+                return;
+            // full, the estimators take over from here
+            std::sort(held, held + levels);
+            l10.start(held, levels);
+            l50.start(held, levels);
+            l90.start(held, levels);
+            return;
+        }
+        levels++;
+        l10.add(level);
+        l50.add(level);
+        l90.add(level);
+    }
+
+    // percentile of the held levels, sorted
+    static float exact(float p)
+    {
+        float rank = p * (levels - 1);
+        uint32_t below = (uint32_t)rank;
+        if (below + 1 >= levels)
+            return held[below];
+        return held[below] + (rank - below) * (held[below + 1] - held[below]);
+    }
+
+    void addFrame(const int16_t *samples, int count, int gain)
+    {
+        for (int i = 0; i + BLOCK_SAMPLES <= count; i += BLOCK_SAMPLES)
+        {
+            SoundGain::Frame block = SoundGain::measure(samples + i, BLOCK_SAMPLES);
+            addLevel(SoundGain::levelDb(block, gain));
+            float blockPeak = SoundGain::peakDb(block, gain);
+            if (blockPeak > peak)
+                peak = blockPeak;
+        }
+    }
+
+    Summary current()
+    {
+        Summary summary;
+        summary.peak = peak;
+        summary.count = levels;
+        if (levels == 0)
+        {
+            summary.l10 = summary.l50 = summary.l90 = NAN;
+        }
+        else if (levels < HELD_LEVELS)
+        {
+            std::sort(held, held + levels);
+            summary.l10 = exact(0.9f);
+            summary.l50 = exact(0.5f);
+            summary.l90 = exact(0.1f);
+        }
+        else
+        {
+            summary.l10 = l10.value();
+            summary.l50 = l50.value();
+            summary.l90 = l90.value();
+        }
+        return summary;
+    }
+
+    bool intervalDone(uint32_t now, uint32_t interval, Summary &summary)
+    {
+        if (now - start < interval)
+            return false;
+        summary = current();
+        reset(now);
+        return true;
+    }
+
+}
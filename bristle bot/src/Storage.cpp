@@ -0,0 +1,143 @@
+#include "Storage.h"
+
+#include <Arduino.h>
+
+#if defined(ARDUINO_ARCH_MBED)
+#include <mbed.h>
+#elif defined(ARDUINO_NATIVE)
+#include <Sim.h>
+#endif
+
+namespace Storage
+{
+
+    // the last pages below the bootloader (0xF4000 on the XIAO nRF52840), one 4 KB page per slot.
+    // a fixed number of pages is reserved so adding a slot does not move the existing ones
+    static const uint32_t SLOT_SIZE = 0x1000;
+    static const uint32_t RESERVED_PAGES = 4;
+    static const uint32_t BASE_ADDRESS = 0xF4000 - RESERVED_PAGES * SLOT_SIZE;
+    static_assert(SLOT_COUNT <= RESERVED_PAGES, "not enough flash pages reserved for the storage slots");
+
+    static const uint32_t RECORD_MAGIC = 0x42425354; // "BBST"
+
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t length;
+        uint16_t reserved;
+        uint32_t crc;
+    };
+
+    static uint32_t crc32(const uint8_t *data, uint32_t len)
+    {
+        uint32_t crc = 0xFFFFFFFF;
+        for (uint32_t i = 0; i < len; i++)
+        {
+            crc ^= data[i];
+            for (int b = 0; b < 8; b++)
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+        return ~crc;
+    }
+
+    // header and record, padded to a whole number of words for programming
+    static uint8_t buffer[(sizeof(Header) + MAX_RECORD_SIZE + 3) & ~3u];
+
+#if defined(ARDUINO_ARCH_MBED)
+    static mbed::FlashIAP flash;
+
+    static bool readSlot(Slot slot, uint8_t *out, uint32_t len)
+    {
+        if (flash.init() != 0)
+            return false;
+        int err = flash.read(out, BASE_ADDRESS + slot * SLOT_SIZE, len);
+        flash.deinit();
+        return err == 0;
+    }
+
+    static bool writeSlot(Slot slot, const uint8_t *data, uint32_t len)
+    {
+        if (flash.init() != 0)
+            return false;
+        uint32_t address = BASE_ADDRESS + slot * SLOT_SIZE;
+        int err = flash.erase(address, SLOT_SIZE);
+        if (err == 0)
+            err = flash.program(data, address, len);
+        flash.deinit();
+        return err == 0;
+    }
+#elif defined(ARDUINO_NATIVE)
+    // host build: the slots live in the simulated flash, so the simulator can preload them
+    static bool readSlot(Slot slot, uint8_t *out, uint32_t len)
+    {
+        uint8_t *page = Sim::flashSlot(slot);
+        if (page == nullptr || len > (uint32_t)Sim::FLASH_SLOT_SIZE)
+            return false;
+        memcpy(out, page, len);
+        return true;
+    }
+
+    static bool writeSlot(Slot slot, const uint8_t *data, uint32_t len)
+    {
+        uint8_t *page = Sim::flashSlot(slot);
+        if (page == nullptr || len > (uint32_t)Sim::FLASH_SLOT_SIZE)
+            return false;
+        memcpy(page, data, len);
+        return true;
+    }
+#else
+    // no flash driver on this platform, records only last until reset
+    static uint8_t slots[SLOT_COUNT][sizeof(buffer)];
+
+    static bool readSlot(Slot slot, uint8_t *out, uint32_t len)
+    {
+        memcpy(out, slots[slot], len);
+        return true;
+    }
+
+    static bool writeSlot(Slot slot, const uint8_t *data, uint32_t len)
+    {
+        memcpy(slots[slot], data, len);
+        return true;
+    }
+#endif
+
+    bool load(Slot slot, void *data, uint16_t len)
+    {
+        if (slot >= SLOT_COUNT || len > MAX_RECORD_SIZE)
+            return false;
+
+        uint32_t total = (sizeof(Header) + len + 3) & ~3u;
+        if (!readSlot(slot, buffer, total))
+            return false;
+
+        Header header;
+        memcpy(&header, buffer, sizeof(header));
+        if (header.magic != RECORD_MAGIC || header.length != len)
+            return false;
+        if (header.crc != crc32(buffer + sizeof(Header), len))
+            return false;
+
+        memcpy(data, buffer + sizeof(Header), len);
+        return true;
+    }
+
+    bool save(Slot slot, const void *data, uint16_t len)
+    {
+        if (slot >= SLOT_COUNT || len > MAX_RECORD_SIZE)
+            return false;
+
+        Header header;
+        header.magic = RECORD_MAGIC;
+        header.length = len;
+        header.reserved = 0;
+        header.crc = crc32((const uint8_t *)data, len);
+
+        uint32_t total = (sizeof(Header) + len + 3) & ~3u;
+        memset(buffer, 0xFF, total);
+        memcpy(buffer, &header, sizeof(header));
+        memcpy(buffer + sizeof(Header), data, len);
+        return writeSlot(slot, buffer, total);
+    }
+
+}
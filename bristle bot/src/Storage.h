@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// small persistent record store in internal flash. each slot holds one record
+// (a plain struct) in its own flash page, with a length and crc check so a
+// missing or corrupted record is reported instead of loaded.
+namespace Storage
+{
+
+    enum Slot : uint8_t
+    {
+        SLOT_CALIBRATION = 0,
+        SLOT_PARAMETERS = 1,
+        SLOT_COUNT
+    };
+
+    // largest record a slot can hold (bytes)
+    static const uint16_t MAX_RECORD_SIZE = 256;
+
+    // reads a record, false if the slot is empty, corrupt or a different size
+    bool load(Slot slot, void *data, uint16_t len);
+
+    // erases the slot and writes the record, false on a flash error
+    bool save(Slot slot, const void *data, uint16_t len);
+
+}
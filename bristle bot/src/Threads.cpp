@@ -0,0 +1,259 @@
+#include "Threads.h"
+
+#ifdef USE_RTOS_THREADS
+
+#include <Arduino.h>
+#include <mbed.h>
+#include <ArduinoBLE.h>
+
+#include "BluetoothManager.h"
+#include "Localisation.h"
+#include "Locomotion.h"
+#include "Params.h"
+#include "SoundMeasurer.h"
+#include "orientation/Orientation.h"
+
+namespace Threads
+{
+
+    // release flags set by the tick interrupt
+    static const uint32_t FLAG_RADIO = 1 << 0;
+    static const uint32_t FLAG_ORIENTATION = 1 << 1;
+    static const uint32_t FLAG_AUDIO = 1 << 2;
+    static const uint32_t FLAG_BEARING = 1 << 3;
+
+    static const uint32_t ORIENTATION_TICKS = 50 / TICK_MILLIS;
+    // the audio and swap periods are Params, read on every tick so changes apply straight away
+    static uint32_t ticksOf(int32_t millis)
+    {
+        return millis > (int32_t)TICK_MILLIS ? millis / TICK_MILLIS : 1;
+    }
+
+    // untouched stack bytes are left with this value, used to find the high-water mark
+    static const uint8_t STACK_FILL = 0xA5;
+
+    // heading samples handed from the orientation thread to the motion thread
+    struct HeadingSample
+    {
+        float heading;
+        uint32_t time;
+    };
+
+    static rtos::EventFlags releases;
+    static rtos::Mail<HeadingSample, 4> headingMail;
+    static mbed::Ticker ticker;
+    static volatile uint32_t tickCount = 0;
+
+    struct ThreadInfo
+    {
+        const char *name;
+        osPriority priority;
+        uint32_t stackSize;
+        unsigned char *stack;
+        void (*body)();
+        rtos::Thread *thread;
+        volatile uint64_t busyTime; // us spent doing work rather than waiting
+    };
+
+    MBED_ALIGN(8) static unsigned char radioStack[4096];
+    MBED_ALIGN(8) static unsigned char audioStack[2048];
+    MBED_ALIGN(8) static unsigned char orientationStack[2048];
+    MBED_ALIGN(8) static unsigned char motionStack[2048];
+
+    static void radioThread();
+    static void audioThread();
+    static void orientationThread();
+    static void motionThread();
+
+    static ThreadInfo threads[] = {
+        {"motion", osPriorityHigh, sizeof(motionStack), motionStack, motionThread, nullptr, 0},
+        {"radio", osPriorityAboveNormal, sizeof(radioStack), radioStack, radioThread, nullptr, 0},
+        {"orientation", osPriorityNormal, sizeof(orientationStack), orientationStack, orientationThread, nullptr, 0},
+        {"audio", osPriorityBelowNormal, sizeof(audioStack), audioStack, audioThread, nullptr, 0},
+    };
+    static const int NUM_THREADS = sizeof(threads) / sizeof(threads[0]);
+
+    static uint32_t statsStart = 0;
+    static uint8_t mode = 0;
+
+    enum ThreadIndex
+    {
+        MOTION,
+        RADIO,
+        ORIENTATION,
+        AUDIO
+    };
+
+    // runs in interrupt context, releases each periodic thread on its own multiple of the tick
+    static void onTick()
+    {
+        uint32_t t = ++tickCount;
+        uint32_t flags = FLAG_RADIO;
+        if (t % ORIENTATION_TICKS == 0)
+            flags |= FLAG_ORIENTATION | FLAG_BEARING;
+        if (t % ticksOf(Params::values.sampleMillis) == 0)
+            flags |= FLAG_AUDIO;
+        releases.set(flags);
+    }
+
+    static void radioThread()
+    {
+        uint32_t ticksSinceSwap = 0;
+        while (true)
+        {
+            releases.wait_any(FLAG_RADIO);
+            uint32_t start = micros();
+
+            if (++ticksSinceSwap >= ticksOf(Params::values.swapInterval))
+            {
+                BLEManager::swapClientServer();
+                ticksSinceSwap = 0;
+            }
+            if (BLEManager::isScanning())
+            {
+                updateLocalisation();
+            }
+            else
+            {
+                // services the parameter service connections while advertising
+                BLE.poll();
+            }
+
+            threads[RADIO].busyTime += micros() - start;
+        }
+    }
+
+    static void audioThread()
+    {
+        while (true)
+        {
+            uint32_t flags = releases.wait_any(FLAG_AUDIO | FLAG_BEARING);
+            uint32_t start = micros();
+
+            // the bearing sweep shares the mic with the level, so both run in this thread.
+            // their motor holds and turns take Locomotion's lock against the motion thread
+            if (flags & FLAG_BEARING)
+            {
+                updateSoundBearing();
+            }
+            // blocks while recording, but only this thread waits
+            if (flags & FLAG_AUDIO)
+            {
+                updateSoundLevel();
+            }
+
+            threads[AUDIO].busyTime += micros() - start;
+        }
+    }
+
+    static void orientationThread()
+    {
+        while (true)
+        {
+            releases.wait_any(FLAG_ORIENTATION);
+            uint32_t start = micros();
+
+            updateOrientation();
+
+            // if the motion thread is behind, the sample is dropped rather than queued
+            HeadingSample *sample = headingMail.try_alloc();
+            if (sample != nullptr)
+            {
+                sample->heading = getHeading();
+                sample->time = getHeadingTime();
+                headingMail.put(sample);
+            }
+
+            threads[ORIENTATION].busyTime += micros() - start;
+        }
+    }
+
+    static void motionThread()
+    {
+        // the last heading handed over, kept for the ticks no new one comes in
+        HeadingSample last = {0.0f, 0};
+        while (true)
+        {
+            // wake on a fresh heading, or every tick to keep the walk timing
+            HeadingSample *sample = headingMail.try_get_for(std::chrono::milliseconds(TICK_MILLIS));
+            // steer with the newest, older ones still queued are stale
+            while (sample != nullptr)
+            {
+                last = *sample;
+                headingMail.free(sample);
+                sample = headingMail.try_get();
+            }
+            uint32_t start = micros();
+
+            if (mode == 1)
+            {
+                Locomotion::updateLocomotionWalkStraight(last.heading, last.time);
+            }
+            else
+            {
+                Locomotion::updateLocomotion(last.time);
+            }
+
+            threads[MOTION].busyTime += micros() - start;
+        }
+    }
+
+    // fills unused stack with a known value so the deepest use can be found later
+    static void fillStack(unsigned char *stack, uint32_t size)
+    {
+        memset(stack, STACK_FILL, size);
+    }
+
+    static uint32_t stackHighWater(const unsigned char *stack, uint32_t size)
+    {
+        // the rtos keeps a magic word at the very bottom of the stack, skip it
+        uint32_t untouched = 0;
+        for (uint32_t i = 8; i < size && stack[i] == STACK_FILL; i++)
+        {
+            untouched++;
+        }
+        return size - 8 - untouched;
+    }
+
+    void startThreads(uint8_t behaviourMode)
+    {
+        mode = behaviourMode;
+        for (int i = 0; i < NUM_THREADS; i++)
+        {
+            ThreadInfo &info = threads[i];
+            // sound is only measured in the levy walk mode
+            if (i == AUDIO && mode != 0)
+                continue;
+            fillStack(info.stack, info.stackSize);
+            info.thread = new rtos::Thread(info.priority, info.stackSize, info.stack, info.name);
+            info.thread->start(mbed::callback(info.body));
+        }
+        statsStart = micros();
+        ticker.attach(mbed::callback(onTick), std::chrono::milliseconds(TICK_MILLIS));
+    }
+
+    void printStats()
+    {
+        uint32_t elapsed = micros() - statsStart;
+        Serial.println("thread        stack used/size   cpu%");
+        for (int i = 0; i < NUM_THREADS; i++)
+        {
+            const ThreadInfo &info = threads[i];
+            if (info.thread == nullptr)
+                continue;
+            // hundredths of a percent, newlib-nano has no float printf unless linked in
+            unsigned long cpu = elapsed ? (unsigned long)((uint64_t)info.busyTime * 10000 / elapsed) : 0;
+            char line[64];
+            snprintf(line, sizeof(line), "%-12s %6lu/%-6lu %5lu.%02lu",
+                     info.name,
+                     (unsigned long)stackHighWater(info.stack, info.stackSize),
+                     (unsigned long)info.stackSize,
+                     cpu / 100, cpu % 100);
+            Serial.println(line);
+        }
+        Locomotion::printControlLatency();
+    }
+
+}
+
+#endif
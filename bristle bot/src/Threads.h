@@ -0,0 +1,25 @@
+#pragma once
+
+// alternative execution model, enabled with -DUSE_RTOS_THREADS (see the *_rtos
+// environments in platformio.ini). radio/localisation, audio, orientation and
+// motion each run in their own prioritised Mbed RTOS thread instead of being
+// dispatched from loop(), so a blocking call in one no longer starves the rest.
+#ifdef USE_RTOS_THREADS
+
+#include <cstdint>
+
+namespace Threads
+{
+
+    // base tick that releases the periodic threads (ms)
+    static const uint32_t TICK_MILLIS = 10;
+
+    // starts the radio, audio, orientation and motion threads for the given behaviour mode
+    void startThreads(uint8_t behaviourMode);
+
+    // prints the stack high-water mark and cpu usage of each thread
+    void printStats();
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "Trace.h"
+
+#include "Log.h"
+#include "Params.h"
+
+namespace Trace
+{
+
+    // trace records are written whatever LOG_LEVEL is, they are only built with TRACE_INPUTS
+    static const uint8_t TRACE_LEVEL = LOG_LEVEL_INFO;
+
+    static uint32_t updates = 0;
+
+    void begin()
+    {
+        params();
+    }
+
+    void params()
+    {
+        for (int i = 0; i < Params::PARAM_COUNT; i++)
+        {
+            Log::record(TRACE_LEVEL, LOG_TRACE_PARAM, i, Params::get((Params::Id)i), updates);
+        }
+    }
+
+    void calibration(const float offset[3], const float scale[3])
+    {
+        Log::record(TRACE_LEVEL, LOG_TRACE_MAG_OFFSET, offset[0], offset[1], offset[2]);
+        Log::record(TRACE_LEVEL, LOG_TRACE_MAG_SCALE, scale[0], scale[1], scale[2]);
+    }
+
+    void localisationUpdate()
+    {
+        updates++;
+    }
+
+    void rssi(uint8_t beacon, int rssi)
+    {
+        Log::record(TRACE_LEVEL, LOG_TRACE_RSSI, beacon, rssi, updates);
+    }
+
+    void magnetometer(int &x, int &y, int &z)
+    {
+        Log::record(TRACE_LEVEL, LOG_TRACE_MAGNETOMETER, x, y, z);
+    }
+
+    void soundFrame(uint8_t mean, uint16_t peak, uint8_t gain)
+    {
+        Log::record(TRACE_LEVEL, LOG_TRACE_SOUND, mean, peak, gain);
+    }
+
+    void motors(bool left, bool right)
+    {
+        Log::record(TRACE_LEVEL, LOG_TRACE_MOTORS, left, right);
+    }
+
+}
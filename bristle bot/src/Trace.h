@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+// input trace for record and replay. a build with TRACE_INPUTS defined writes the
+// raw inputs the firmware acts on (beacon rssi, magnetometer readings, sound frames,
+// motor commands, and the parameters and compass calibration they are used with) as
+// LOG_TRACE_* log records, so a capture of the serial line is also a trace.
+// native/replay feeds a trace back through Localisation.cpp and Orientation.cpp on the
+// host. the TRACE_* macros are compiled out otherwise.
+namespace Trace
+{
+
+    // records every parameter, call once setup has loaded them
+    void begin();
+
+    // records the parameters again after a change
+    void params();
+
+    // records the compass calibration in use
+    void calibration(const float offset[3], const float scale[3]);
+
+    // marks the end of a localisation update. rssi and parameter records carry the
+    // number of updates so far, so a replay applies them before the same update
+    void localisationUpdate();
+
+    // an rssi reading from the beacon with that id (BeaconRegistry)
+    void rssi(uint8_t beacon, int rssi);
+
+    // a magnetometer reading as the compass library returns it. the replay build
+    // links its own Trace, which substitutes the recorded reading here
+    void magnetometer(int &x, int &y, int &z);
+
+    // statistics of one sound frame and the mic gain it was recorded at
+    void soundFrame(uint8_t mean, uint16_t peak, uint8_t gain);
+
+    // motor pin states after a motor command
+    void motors(bool left, bool right);
+
+}
+
+#ifdef TRACE_INPUTS
+#define TRACE_BEGIN() Trace::begin()
+#define TRACE_PARAMS() Trace::params()
+#define TRACE_CALIBRATION(offset, scale) Trace::calibration(offset, scale)
+#define TRACE_LOCALISATION_UPDATE() Trace::localisationUpdate()
+#define TRACE_RSSI(beacon, rssi) Trace::rssi(beacon, rssi)
+#define TRACE_MAGNETOMETER(x, y, z) Trace::magnetometer(x, y, z)
+#define TRACE_SOUND_FRAME(mean, peak, gain) Trace::soundFrame(mean, peak, gain)
+#define TRACE_MOTORS(left, right) Trace::motors(left, right)
+#else
+#define TRACE_BEGIN() do {} while (0)
+#define TRACE_PARAMS() do {} while (0)
+#define TRACE_CALIBRATION(offset, scale) do {} while (0)
+#define TRACE_LOCALISATION_UPDATE() do {} while (0)
+#define TRACE_RSSI(beacon, rssi) do {} while (0)
+#define TRACE_MAGNETOMETER(x, y, z) do {} while (0)
+#define TRACE_SOUND_FRAME(mean, peak, gain) do {} while (0)
+#define TRACE_MOTORS(left, right) do {} while (0)
+#endif
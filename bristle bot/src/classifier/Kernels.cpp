@@ -0,0 +1,200 @@
+#include "Kernels.h"
+
+#include <cmath>
+
+#ifdef USE_CMSIS_NN
+#include <arm_nnfunctions.h>
+#endif
+
+namespace Nn
+{
+
+    Requant requantFor(double scale)
+    {
+        Requant requant = {0, 0};
+        if (scale <= 0.0)
+            return requant;
+        int exponent;
+        double fraction = frexp(scale, &exponent); // [0.5, 1)
+        int64_t multiplier = llround(fraction * (double)(1ll << 31));
+        if (multiplier == (1ll << 31))
+        {
+            multiplier /= 2;
+            exponent++;
+        }
+        requant.multiplier = (int32_t)multiplier;
+        requant.shift = exponent;
+        return requant;
+    }
+
+    int32_t requantize(int32_t value, const Requant &requant)
+    {
+        int32_t left = requant.shift > 0 ? requant.shift : 0;
+        int32_t right = requant.shift > 0 ? 0 : -requant.shift;
+
+        // arm_nn_doubling_high_mult_no_sat(), rounding half up
+        int64_t product = (int64_t)(int32_t)((uint32_t)value << left) * requant.multiplier + (1ll << 30);
+        int32_t high = (int32_t)(product >> 31);
+
+        // arm_nn_divide_by_power_of_two(), rounding half away from zero
+        int32_t mask = (int32_t)((1u << right) - 1);
+        int32_t remainder = high & mask;
+        int32_t result = high >> right;
+        int32_t threshold = (mask >> 1) + (result < 0 ? 1 : 0);
+        return result + (remainder > threshold ? 1 : 0);
+    }
+
+    static int32_t clamp(int32_t value, int32_t low, int32_t high)
+    {
+        return value < low ? low : (value > high ? high : value);
+    }
+
+#ifdef USE_CMSIS_NN
+
+    // largest channel count the per channel parameters are copied for
+    static const int MAX_CHANNELS = 32;
+
+    int32_t convScratchSize(const Conv &conv, const Shape &input, const Shape &output)
+    {
+        cmsis_nn_conv_params params = {conv.inputOffset, conv.outputOffset, {1, 1}, {conv.padW, conv.padH}, {1, 1},
+                                       {conv.activationMin, conv.activationMax}};
+        cmsis_nn_dims inputDims = {1, input.h, input.w, input.c};
+        cmsis_nn_dims filterDims = {output.c, conv.kernelH, conv.kernelW, input.c};
+        cmsis_nn_dims outputDims = {1, output.h, output.w, output.c};
+        return arm_convolve_wrapper_s8_get_buffer_size(&params, &inputDims, &filterDims, &outputDims);
+    }
+
+    bool convolve(const Conv &conv, const Requant *requant, const Shape &input, const int8_t *in,
+                  const int8_t *filter, const int32_t *bias, const Shape &output, int8_t *out,
+                  int8_t *scratch, int32_t scratchSize)
+    {
+        if (output.c > MAX_CHANNELS || convScratchSize(conv, input, output) > scratchSize)
+            return false;
+        int32_t multipliers[MAX_CHANNELS], shifts[MAX_CHANNELS];
+        for (int32_t c = 0; c < output.c; c++)
+        {
+            multipliers[c] = requant[c].multiplier;
+            shifts[c] = requant[c].shift;
+        }
+        cmsis_nn_context context = {scratch, scratchSize};
+        cmsis_nn_conv_params params = {conv.inputOffset, conv.outputOffset, {1, 1}, {conv.padW, conv.padH}, {1, 1},
+                                       {conv.activationMin, conv.activationMax}};
+        cmsis_nn_per_channel_quant_params quant = {multipliers, shifts};
+        cmsis_nn_dims inputDims = {1, input.h, input.w, input.c};
+        cmsis_nn_dims filterDims = {output.c, conv.kernelH, conv.kernelW, input.c};
+        cmsis_nn_dims biasDims = {1, 1, 1, output.c};
+        cmsis_nn_dims outputDims = {1, output.h, output.w, output.c};
+        return arm_convolve_wrapper_s8(&context, &params, &quant, &inputDims, in, &filterDims, filter, &biasDims, bias,
+                                       &outputDims, out) == ARM_CMSIS_NN_SUCCESS;
+    }
+
+    bool maxPool(int32_t poolH, int32_t poolW, const Shape &input, const int8_t *in, const Shape &output,
+                 int8_t *out)
+    {
+        cmsis_nn_context context = {nullptr, 0};
+        cmsis_nn_pool_params params = {{poolW, poolH}, {0, 0}, {-128, 127}};
+        cmsis_nn_dims inputDims = {1, input.h, input.w, input.c};
+        cmsis_nn_dims filterDims = {1, poolH, poolW, 1};
+        cmsis_nn_dims outputDims = {1, output.h, output.w, output.c};
+        return arm_max_pool_s8(&context, &params, &inputDims, in, &filterDims, &outputDims, out) == ARM_CMSIS_NN_SUCCESS;
+    }
+
+    bool fullyConnected(const FullyConnected &fc, const Requant &requant, int32_t inputs, const int8_t *in,
+                        const int8_t *weights, const int32_t *bias, int32_t outputs, int8_t *out)
+    {
+        cmsis_nn_context context = {nullptr, 0};
+        cmsis_nn_fc_params params = {fc.inputOffset, 0, fc.outputOffset, {fc.activationMin, fc.activationMax}};
+        cmsis_nn_per_tensor_quant_params quant = {requant.multiplier, requant.shift};
+        cmsis_nn_dims inputDims = {1, 1, 1, inputs};
+        cmsis_nn_dims filterDims = {inputs, 1, 1, outputs};
+        cmsis_nn_dims biasDims = {1, 1, 1, outputs};
+        cmsis_nn_dims outputDims = {1, 1, 1, outputs};
+        return arm_fully_connected_s8(&context, &params, &quant, &inputDims, in, &filterDims, weights, &biasDims, bias,
+                                      &outputDims, out) == ARM_CMSIS_NN_SUCCESS;
+    }
+
+#else
+
+    // the plain C kernels need no scratch
+    int32_t convScratchSize(const Conv & /* conv */, const Shape & /* input */, const Shape & /* output */)
+    {
+        return 0;
+    }
+
+    bool convolve(const Conv &conv, const Requant *requant, const Shape &input, const int8_t *in,
+                  const int8_t *filter, const int32_t *bias, const Shape &output, int8_t *out,
+                  int8_t * /* scratch */, int32_t /* scratchSize */)
+    {
+        for (int32_t y = 0; y < output.h; y++)
+        {
+            // taps in the padding see the zero point and add nothing, leave them out
+            int32_t kyStart = conv.padH - y > 0 ? conv.padH - y : 0;
+            int32_t kyEnd = input.h + conv.padH - y < conv.kernelH ? input.h + conv.padH - y : conv.kernelH;
+            for (int32_t x = 0; x < output.w; x++)
+            {
+                int32_t kxStart = conv.padW - x > 0 ? conv.padW - x : 0;
+                int32_t kxEnd = input.w + conv.padW - x < conv.kernelW ? input.w + conv.padW - x : conv.kernelW;
+                int32_t taps = (kxEnd - kxStart) * input.c;
+                for (int32_t oc = 0; oc < output.c; oc++)
+                {
+                    int32_t acc = bias != nullptr ? bias[oc] : 0;
+                    const int8_t *weights = filter + oc * conv.kernelH * conv.kernelW * input.c;
+                    for (int32_t ky = kyStart; ky < kyEnd; ky++)
+                    {
+                        const int8_t *pixel = in + ((y + ky - conv.padH) * input.w + x + kxStart - conv.padW) * input.c;
+                        const int8_t *tap = weights + (ky * conv.kernelW + kxStart) * input.c;
+                        for (int32_t i = 0; i < taps; i++)
+                            acc += (pixel[i] + conv.inputOffset) * tap[i];
+                    }
+                    acc = requantize(acc, requant[oc]) + conv.outputOffset;
+                    out[(y * output.w + x) * output.c + oc] = clamp(acc, conv.activationMin, conv.activationMax);
+                }
+            }
+        }
+        return true;
+    }
+
+    bool maxPool(int32_t poolH, int32_t poolW, const Shape &input, const int8_t *in, const Shape &output,
+                 int8_t *out)
+    {
+        for (int32_t y = 0; y < output.h; y++)
+        {
+            for (int32_t x = 0; x < output.w; x++)
+            {
+                for (int32_t c = 0; c < output.c; c++)
+                {
+                    int8_t largest = -128;
+                    for (int32_t py = 0; py < poolH; py++)
+                    {
+                        for (int32_t px = 0; px < poolW; px++)
+                        {
+                            int32_t iy = y * poolH + py, ix = x * poolW + px;
+                            if (iy < input.h && ix < input.w && in[(iy * input.w + ix) * input.c + c] > largest)
+                                largest = in[(iy * input.w + ix) * input.c + c];
+                        }
+                    }
+                    out[(y * output.w + x) * output.c + c] = largest;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool fullyConnected(const FullyConnected &fc, const Requant &requant, int32_t inputs, const int8_t *in,
+                        const int8_t *weights, const int32_t *bias, int32_t outputs, int8_t *out)
+    {
+        for (int32_t o = 0; o < outputs; o++)
+        {
+            int32_t acc = bias != nullptr ? bias[o] : 0;
+            const int8_t *row = weights + o * inputs;
+            for (int32_t i = 0; i < inputs; i++)
+                acc += (in[i] + fc.inputOffset) * row[i];
+            acc = requantize(acc, requant) + fc.outputOffset;
+            out[o] = clamp(acc, fc.activationMin, fc.activationMax);
+        }
+        return true;
+    }
+
+#endif
+
+}
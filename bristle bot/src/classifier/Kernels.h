@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+// int8 neural network kernels with the arithmetic of CMSIS-NN (arm_convolve_s8,
+// arm_max_pool_s8, arm_fully_connected_s8): NHWC tensors, int32 bias, activations
+// requantized with a Q31 multiplier and a power of two shift, and the quantization
+// zero points passed in as offsets. builds that define USE_CMSIS_NN (and have the
+// CMSIS-NN 4.x headers on the include path) call the library, the rest run the
+// plain C versions here, which give the same output bit for bit. the host tools use
+// the plain versions to check a model's int8 accuracy.
+namespace Nn
+{
+
+    struct Shape
+    {
+        int32_t h, w, c;
+    };
+
+    // a real scale factor as multiplier * 2^shift / 2^31, multiplier in [2^30, 2^31)
+    struct Requant
+    {
+        int32_t multiplier;
+        int32_t shift; // positive shifts left
+    };
+
+    Requant requantFor(double scale);
+
+    // (value * multiplier * 2^shift) >> 31, rounded like arm_nn_requantize()
+    int32_t requantize(int32_t value, const Requant &requant);
+
+    struct Conv
+    {
+        int32_t inputOffset;  // minus the input zero point
+        int32_t outputOffset; // the output zero point
+        int32_t kernelH, kernelW;
+        int32_t padH, padW;   // stride 1 only
+        int32_t activationMin, activationMax;
+    };
+
+    // scratch bytes convolve() needs for the given shapes
+    int32_t convScratchSize(const Conv &conv, const Shape &input, const Shape &output);
+
+    // 2d convolution, filter [output c][kernelH][kernelW][input c], one Requant per
+    // output channel
+    bool convolve(const Conv &conv, const Requant *requant, const Shape &input, const int8_t *in,
+                  const int8_t *filter, const int32_t *bias, const Shape &output, int8_t *out,
+                  int8_t *scratch, int32_t scratchSize);
+
+    // max pooling over poolH x poolW windows, stride the window size
+    bool maxPool(int32_t poolH, int32_t poolW, const Shape &input, const int8_t *in, const Shape &output,
+                 int8_t *out);
+
+    struct FullyConnected
+    {
+        int32_t inputOffset;
+        int32_t outputOffset;
+        int32_t activationMin, activationMax;
+    };
+
+    // weights [outputs][inputs], one Requant for the whole layer
+    bool fullyConnected(const FullyConnected &fc, const Requant &requant, int32_t inputs, const int8_t *in,
+                        const int8_t *weights, const int32_t *bias, int32_t outputs, int8_t *out);
+
+}
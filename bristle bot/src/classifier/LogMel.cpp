@@ -0,0 +1,172 @@
+#include <classifier/LogMel.h>
+#include <SoundGain.h>
+
+#include <cmath>
+
+namespace LogMel
+{
+
+    static const float SAMPLE_RATE = 16000.0;
+    static const float LOW_HZ = 125.0;
+    static const float HIGH_HZ = 7500.0;
+    static const int BINS = WINDOW / 2 + 1;
+
+    // tables, filled on the first call
+    static bool ready = false;
+    static float window[WINDOW];
+    static float cosines[WINDOW / 2], sines[WINDOW / 2];
+    static uint8_t reversed[WINDOW];
+    // each bin is shared between two neighbouring bands: lowerBand[bin] gets
+    // 1 - upperWeight[bin] of its power and the band above upperWeight[bin].
+    // -1 and BANDS mark the bins outside the filterbank
+    static int8_t lowerBand[BINS];
+    static float upperWeight[BINS];
+    // power of a full scale sine at the centre of a band, 0 dB
+    static float fullScale;
+
+    static float toMel(float hz)
+    {
+        return 2595.0f * log10f(1.0f + hz / 700.0f);
+    }
+
+    static float fromMel(float mel)
+    {
+        return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+    }
+
+    static void prepare()
+    {
+        float windowSum = 0.0f;
+        for (int i = 0; i < WINDOW; i++)
+        {
+            window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / WINDOW);
+            windowSum += window[i];
+        }
+        for (int i = 0; i < WINDOW / 2; i++)
+        {
+            cosines[i] = cosf(2.0f * (float)M_PI * i / WINDOW);
+            sines[i] = -sinf(2.0f * (float)M_PI * i / WINDOW);
+        }
+        int bits = 0;
+        while ((1 << bits) < WINDOW)
+            bits++;
+        for (int i = 0; i < WINDOW; i++)
+        {
+            int r = 0;
+            for (int b = 0; b < bits; b++)
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            reversed[i] = r;
+        }
+
+        // band centres equally spaced in mel, the edges of the outer two at LOW_HZ and HIGH_HZ
+        float centres[BANDS + 2];
+        float lowMel = toMel(LOW_HZ), highMel = toMel(HIGH_HZ);
+        for (int b = 0; b < BANDS + 2; b++)
+            centres[b] = fromMel(lowMel + (highMel - lowMel) * b / (BANDS + 1)) * WINDOW / SAMPLE_RATE;
+        for (int bin = 0; bin < BINS; bin++)
+        {
+            int b = 0;
+            while (b < BANDS + 2 && centres[b] <= bin)
+                b++;
+            // bin lies between centres[b - 1] and centres[b], the bands are numbered from centre 1
+            if (b == 0 || b == BANDS + 2)
+            {
+                lowerBand[bin] = b == 0 ? -1 : BANDS;
+                upperWeight[bin] = 0.0f;
+                continue;
+            }
+            lowerBand[bin] = b - 2;
+            upperWeight[bin] = (bin - centres[b - 1]) / (centres[b] - centres[b - 1]);
+        }
+
+        float amplitude = 32768.0f * windowSum / 2.0f;
+        fullScale = amplitude * amplitude;
+        ready = true;
+    }
+
+    // in place radix 2 FFT of WINDOW points
+    static void fft(float *re, float *im)
+    {
+        for (int i = 0; i < WINDOW; i++)
+        {
+            int j = reversed[i];
+            if (j > i)
+            {
+                float t = re[i];
+                re[i] = re[j];
+                re[j] = t;
+                t = im[i];
+                im[i] = im[j];
+                im[j] = t;
+            }
+        }
+        for (int size = 2; size <= WINDOW; size *= 2)
+        {
+            int half = size / 2, stride = WINDOW / size;
+            for (int start = 0; start < WINDOW; start += size)
+            {
+                for (int k = 0; k < half; k++)
+                {
+                    float c = cosines[k * stride], s = sines[k * stride];
+                    int a = start + k, b = a + half;
+                    float tr = re[b] * c - im[b] * s;
+                    float ti = re[b] * s + im[b] * c;
+                    re[b] = re[a] - tr;
+                    im[b] = im[a] - ti;
+                    re[a] += tr;
+                    im[a] += ti;
+                }
+            }
+        }
+    }
+
+    bool computeDb(const int16_t *samples, int count, int gain, float *db)
+    {
+        if (count < SAMPLES)
+            return false;
+        if (!ready)
+            prepare();
+
+        static float re[WINDOW], im[WINDOW];
+        float gainDb = (gain - SoundGain::UNITY_GAIN) * 0.5f;
+        for (int w = 0; w < WINDOWS; w++)
+        {
+            const int16_t *in = samples + w * HOP;
+            for (int i = 0; i < WINDOW; i++)
+            {
+                re[i] = in[i] * window[i];
+                im[i] = 0.0f;
+            }
+            fft(re, im);
+
+            float bands[BANDS + 1] = {0.0f};
+            for (int bin = 0; bin < BINS; bin++)
+            {
+                int b = lowerBand[bin];
+                if (b >= BANDS)
+                    break;
+                float power = re[bin] * re[bin] + im[bin] * im[bin];
+                if (b >= 0)
+                    bands[b] += power * (1.0f - upperWeight[bin]);
+                bands[b + 1] += power * upperWeight[bin];
+            }
+            for (int b = 0; b < BANDS; b++)
+                db[w * BANDS + b] = 10.0f * log10f(bands[b] / fullScale + 1e-14f) - gainDb;
+        }
+        return true;
+    }
+
+    bool compute(const int16_t *samples, int count, int gain, int8_t *features)
+    {
+        float db[FEATURES];
+        if (!computeDb(samples, count, gain, db))
+            return false;
+        for (int i = 0; i < FEATURES; i++)
+        {
+            long q = lroundf((db[i] - ZERO_DB) / DB_PER_STEP);
+            features[i] = q < -128 ? -128 : (q > 127 ? 127 : q);
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+// log-mel feature frame of a mic frame, the input of the sound classifier:
+// Hann windowed 256 point FFTs every 128 samples, their power summed into BANDS
+// triangular mel bands from 125 Hz to 7.5 kHz and taken to dB with the mic gain
+// taken out (the scale of SoundGain::levelDb()), then quantized to int8.
+namespace LogMel
+{
+
+    static const int WINDOW = 256;
+    static const int HOP = 128;
+    static const int BANDS = 16;
+    static const int WINDOWS = 5;  // (800 - WINDOW) / HOP + 1, one 50 ms mic frame
+    static const int FEATURES = WINDOWS * BANDS;
+    static const int SAMPLES = (WINDOWS - 1) * HOP + WINDOW;
+
+    // feature value q is ZERO_DB + q * DB_PER_STEP dB, so int8 covers -114 to +13.5 dB
+    static const float ZERO_DB = -50.0;
+    static const float DB_PER_STEP = 0.5;
+
+    // fills features [WINDOWS][BANDS] from the first SAMPLES samples of a frame recorded
+    // at gain (PDM register value), false if the frame is shorter
+    bool compute(const int16_t *samples, int count, int gain, int8_t *features);
+
+    // the same in dB, before quantizing
+    bool computeDb(const int16_t *samples, int count, int gain, float *db);
+
+}
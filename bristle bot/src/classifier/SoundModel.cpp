@@ -0,0 +1,104 @@
+// generated by native/classifier (./build/classifier --train), do not edit
+
+#include <classifier/SoundNet.h>
+
+namespace SoundNet
+{
+
+    static const int8_t CONV_WEIGHTS[72] = {
+        -22, -61, 127, -10, 3, 24, 19, 36, -72,
+        -111, 21, -37, 127, 54, 49, 2, 0, -61,
+        -65, 56, -15, -51, -28, -127, 42, -63, 120,
+        -93, 50, 36, -88, 24, 124, -127, 93, -17,
+        -68, -7, 49, 57, -111, -75, -38, 127, 48,
+        -127, 10, 54, -76, -34, 98, -9, -17, 116,
+        46, 111, 11, 63, 71, -127, 52, 51, -96,
+        127, 40, -118, 27, -17, -57, 52, 11, -56,
+    };
+
+    static const int32_t CONV_BIAS[8] = {2302, 2291, -4807, -115, -301, -342, -1646, 219};
+
+    static const Nn::Requant CONV_REQUANT[8] = {
+        {1454663186, -7},
+        {1464517671, -7},
+        {1808086129, -8},
+        {1095632441, -7},
+        {1389232808, -7},
+        {1401724355, -7},
+        {1545590319, -7},
+        {1879488201, -7}
+    };
+
+    static const int8_t DENSE_WEIGHTS[1280] = {
+        3, -13, -5, -16, 25, 39, -31, 16, -8, 13, 13, 6, 23, -36, -57, -5, 6, 0, 25, -10,
+        35, 21, -51, 7, 1, 19, -1, 9, 30, 18, -38, 20, 5, 24, 13, -27, 1, 0, -32, 9,
+        -7, 9, 14, -47, 6, 14, -6, 6, -26, -4, 26, -39, -43, 18, -49, -13, -3, 18, 18, 14,
+        -51, 7, 30, -23, 45, -24, 14, -25, 17, -15, 17, 0, 26, 5, -9, -11, 22, -33, -25, 2,
+        25, 6, -18, -15, 0, 5, 17, 5, 24, -1, -12, -26, 4, -20, -61, 1, -5, 0, 6, -55,
+        4, -45, -37, -3, -28, -3, 1, -50, -4, -44, -53, -12, -11, -21, -4, -13, -21, -68, -11, -105,
+        -5, -1, 4, 11, -20, -1, 47, -38, 50, -7, 26, -21, 16, 6, 21, 13, 26, 33, 7, -23,
+        41, -41, -21, -13, 23, 18, -15, -22, 13, 9, 12, 0, 8, 17, -17, -30, 4, -36, -8, -26,
+        -5, 9, -34, -22, -2, -35, -34, 5, -14, -11, 16, -50, -2, -58, -60, -27, -5, -10, 1, -5,
+        -5, -21, -19, -83, -10, -14, 23, 16, -15, -5, 31, -39, 44, 4, 12, -37, 41, 9, 7, 1,
+        20, 34, -8, -11, 40, -28, 9, -14, 11, 26, 8, -10, 4, -10, -16, -5, 12, 15, -6, -43,
+        -5, -9, -11, 1, 22, 0, 0, -17, 6, -44, -18, 1, -36, 7, 12, -34, -12, -45, -24, -22,
+        -1, -1, -1, -32, -16, -57, -39, -79, -15, -8, -7, 2, -16, 10, 30, -52, 34, -41, 13, -8,
+        8, 45, -15, -4, 21, 23, -5, -36, 20, 27, -5, 4, 32, 9, 10, 19, 11, 11, -59, -4,
+        9, 35, -8, 11, -6, 5, -50, 7, -2, 8, -11, -11, -9, -12, -2, 12, 5, -8, 5, -48,
+        -4, -17, -48, -20, 6, -8, 8, -14, -5, 2, -65, -83, -9, 30, -6, 26, -11, -11, 32, -62,
+        -100, -56, 18, -39, -7, -2, 27, -7, -96, -49, 10, 24, 0, 16, 5, -19, -115, -26, 16, 15,
+        4, 10, 9, -10, -103, -39, 18, 29, -1, 40, 13, 0, -41, -19, 11, 41, -2, 33, 28, 7,
+        -22, 2, 10, 64, -5, 72, 34, 10, -72, -2, 5, -9, 0, 15, 64, 42, -60, -39, 8, 14,
+        -1, 6, 42, -13, -74, -79, 15, -16, 5, 2, -13, -19, -53, -39, 7, 31, -1, 27, -1, 5,
+        -66, -55, 10, 14, 4, 15, 8, 7, -26, -33, 8, 39, 4, 44, 3, 22, 7, -2, 13, 40,
+        1, 46, 9, 46, 15, 15, 8, 65, -1, 63, 27, 55, -30, -28, 5, -9, 4, 59, 30, 75,
+        -22, -8, 1, 11, 0, -5, -10, 31, -47, -49, 3, -31, 1, 14, -13, -15, -59, -51, 11, 28,
+        -1, 21, -2, 2, -57, -45, 10, 24, 0, 31, 6, -5, -21, -32, 7, 41, -5, 35, -1, 34,
+        9, 31, -1, 41, -11, 45, 8, 51, 22, 37, -8, 63, -6, 58, 30, 54, -16, 9, -5, -2,
+        -2, 48, 25, 72, -32, 4, -5, 7, -1, -7, -2, 22, -58, -55, 8, -34, 2, 7, -12, -26,
+        -42, -51, 8, 20, -1, 21, -3, 19, -57, -55, 15, 23, -5, 20, 10, -9, -22, -37, 3, 40,
+        -10, 29, -4, 32, 12, 9, 4, 37, -3, 37, 8, 49, 28, 19, -16, 59, -7, 65, 23, 52,
+        -26, -21, -3, -8, -6, 31, 27, 89, -29, -21, -3, 14, -4, 0, -1, 30, -38, -40, 0, -9,
+        -5, -15, -13, -27, -26, -47, 0, 31, 0, 0, 9, -4, -45, -45, 8, 14, 4, 16, 8, -16,
+        -5, -33, 8, 35, 0, 9, 2, 40, 11, -6, 3, 28, -5, 19, 17, 59, 41, 2, 1, 78,
+        -8, 30, 22, 53, -14, -43, 2, -9, -4, -8, 25, 75, -23, -37, 2, 13, 0, -2, -7, 17,
+        32, 29, -79, -5, -49, -18, 28, -14, 26, -16, -27, -107, -23, -10, -59, 6, 19, 2, -28, -22,
+        -47, 16, -70, -3, 23, 11, 9, -48, -17, -12, -64, -25, 29, 2, -41, -65, 14, -24, -31, -1,
+        32, -2, -37, -40, 0, -27, -37, 13, 38, -1, -67, 3, 69, -23, -53, 28, 38, 4, -59, -16,
+        57, -5, -3, 25, -34, 32, -88, 14, -39, -13, -18, 16, -5, -7, -13, -95, -21, -42, 1, -28,
+        -2, 3, 1, -49, -5, -43, -7, -26, -3, 10, -5, -31, -12, -62, 21, -32, 0, 15, -18, -25,
+        -3, -54, 25, -5, 19, 3, 1, -62, 16, -78, 1, 6, 15, 24, 3, -39, 27, -9, -19, -13,
+        10, 16, -12, -23, 18, -5, -23, 5, -42, 30, -86, 24, -32, -12, -6, 16, -6, -32, 3, -54,
+        -31, -11, -1, -15, 5, -7, 29, -19, -9, -56, -8, -19, 13, -7, 18, -42, -2, -34, 14, -14,
+        9, 11, 40, -58, 4, -68, 20, -15, 12, 14, -27, -60, 22, -61, -6, 7, 18, 30, -5, -43,
+        17, -39, 1, -20, 24, 28, -28, -24, 18, 2, -10, 0, -50, 12, -44, 36, -69, 4, 2, 29,
+        -2, -14, 5, -127, -33, -45, 0, -21, 18, -12, -3, -41, -2, -56, 9, -28, 6, 0, 6, -54,
+        2, -74, 13, -28, -20, 23, 1, -61, -6, -50, 21, -7, 23, -3, -13, -83, 23, -75, -1, 16,
+        13, 19, -12, -41, 26, -26, -1, -12, 34, 18, -3, -16, 30, -3, -13, 8, -39, 54, -30, 29,
+        -1, -88, 28, 13, -4, -13, -9, -10, -11, -45, 2, -25, 0, 2, -18, 6, -23, -14, 9, -31,
+        2, 0, -9, -30, 3, -18, 38, -39, -5, 4, -2, -25, 9, -7, 4, -8, -11, 12, -4, -37,
+        0, 5, -4, 19, 5, 11, 1, -22, 9, -3, 2, 26, 12, -8, 2, -10, 4, -8, -14, 16,
+        -28, -25, 46, 21, 19, 17, 10, 7, -7, 14, 2, 96, -5, 30, 100, 5, -20, -7, -16, 17,
+        10, -25, 106, -6, -23, -10, -44, 19, -24, -20, 86, 9, -41, -22, 18, 61, 0, 9, 28, -25,
+        -25, -2, 25, 20, -1, -5, 29, -39, -15, 7, 17, 55, -53, 8, 49, -17, -19, 1, 23, -22,
+        6, -12, -5, 10, 11, -6, 29, -3, 19, 18, 18, -11, -12, 15, 2, 73, -1, 67, 15, 31,
+        -24, -24, 10, 62, 3, 35, 4, 36, -16, -13, 10, 20, -2, 55, 0, 35, -11, -27, 7, 52,
+        5, 63, -23, -2, 7, -20, -5, 25, -6, 52, 7, -16, -7, -9, -1, 44, 1, 69, 19, 93,
+        -7, -17, 8, -22, 6, 1, -2, 20, 1, -44, 32, -11, 6, 2, 9, -14, -22, 5, -18, 59,
+        -29, 40, 15, 39, -25, 8, -14, 28, -11, 25, 3, 32, -27, -9, -6, 24, 12, 60, -10, 44,
+        -24, -59, 14, 33, 5, 61, -14, 10, -4, -44, 6, 10, -6, 46, 8, -15, -20, -27, 9, 35,
+        -5, 47, 16, 68, -13, -26, -4, -30, -7, 5, -4, 18, 22, 7, 16, -14, 20, 0, 0, -37,
+        -30, -1, -8, 101, -21, 53, -4, 39, -35, -13, -13, 45, -17, 56, 7, 36, -26, -11, -7, 67,
+        -9, 65, -7, 21, -12, -31, 7, 40, 2, 54, -22, -3, -12, -35, 7, 26, -3, 60, 5, -27,
+        -14, -16, 7, 74, 3, 76, 24, 59, -17, -19, 10, -24, -1, 5, -5, 19, 20, -36, 14, -26,
+        -10, 31, -18, -6, -16, -11, 5, 33, -10, -3, -6, 30, -22, -6, 6, -25, 5, -6, 17, 38,
+        -29, -24, 13, 9, 4, -14, -14, 39, -5, -23, 10, 1, 10, 1, -14, -8, -9, -10, 21, 15,
+        9, 0, -2, -46, -18, 7, 0, 44, 3, 12, 22, 34, -6, -17, -1, -32, 3, 7, 5, 21,
+    };
+
+    static const int32_t DENSE_BIAS[4] = {-17, -687, 638, -583};
+
+    const Model MODEL = {CONV_WEIGHTS, CONV_BIAS, CONV_REQUANT, -128, DENSE_WEIGHTS, DENSE_BIAS,
+                         {1925881132, -11}, 0, 1.96606767};
+
+}
@@ -0,0 +1,32 @@
+#include <classifier/SoundNet.h>
+
+#include <cstring>
+
+namespace SoundNet
+{
+
+    static_assert(LogMel::BANDS % POOL == 0, "the pooling has to cover every band");
+    static_assert(ARENA_SIZE <= 1024, "over the sound classifier RAM budget");
+
+    alignas(4) static int8_t arena[ARENA_SIZE];
+
+    bool run(const Model &model, const int8_t *features, int8_t *logits)
+    {
+        int8_t *convOut = arena;
+        int8_t *input = arena + LogMel::FEATURES * CHANNELS;
+        int8_t *pooled = input; // the input is done with by then
+        int8_t *scratch = input + POOLED_SIZE;
+        memcpy(input, features, LogMel::FEATURES);
+
+        const Nn::Conv conv = {0, model.convZero, KERNEL, KERNEL, KERNEL / 2, KERNEL / 2, model.convZero, 127};
+        if (!Nn::convolve(conv, model.convRequant, INPUT_SHAPE, input, model.convWeights, model.convBias, CONV_SHAPE, convOut,
+                          scratch, SCRATCH_SIZE))
+            return false;
+        if (!Nn::maxPool(1, POOL, CONV_SHAPE, convOut, POOLED_SHAPE, pooled))
+            return false;
+        const Nn::FullyConnected dense = {-model.convZero, model.logitZero, -128, 127};
+        return Nn::fullyConnected(dense, model.denseRequant, POOLED_SIZE, pooled, model.denseWeights, model.denseBias,
+                                  CLASSES, logits);
+    }
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <classifier/Kernels.h>
+#include <classifier/LogMel.h>
+
+#include <cstdint>
+
+// the sound classifier network: a LogMel feature frame (WINDOWS x BANDS x 1) through
+// a 3x3 convolution with CHANNELS filters and ReLU, max pooling over pairs of bands,
+// and a fully connected layer to one logit per class. every tensor lives in a static
+// arena of ARENA_SIZE bytes, the weights in flash. the model is trained and quantized
+// on the host by native/classifier, which writes SoundModel.cpp.
+namespace SoundNet
+{
+
+    static const int CLASSES = 4;
+    static const int CHANNELS = 8;
+    static const int KERNEL = 3;
+    static const int POOL = 2; // bands per pooled value
+
+    static const Nn::Shape INPUT_SHAPE = {LogMel::WINDOWS, LogMel::BANDS, 1};
+    static const Nn::Shape CONV_SHAPE = {LogMel::WINDOWS, LogMel::BANDS, CHANNELS};
+    static const Nn::Shape POOLED_SHAPE = {LogMel::WINDOWS, LogMel::BANDS / POOL, CHANNELS};
+    static const int POOLED_SIZE = LogMel::WINDOWS * (LogMel::BANDS / POOL) * CHANNELS;
+
+    // the input is the LogMel int8 frame as it is: scale INPUT_SCALE, zero point 0
+    static const float INPUT_SCALE = LogMel::DB_PER_STEP / 20.0;
+
+    // arena: the convolution output, then the input and later the pooled values, then
+    // scratch for the CMSIS-NN convolution
+    static const int SCRATCH_SIZE = 64; // arm_convolve_s8 takes 2 * KERNEL * KERNEL int16s
+    static const int ARENA_SIZE = LogMel::WINDOWS * LogMel::BANDS * CHANNELS + POOLED_SIZE + SCRATCH_SIZE;
+
+    struct Model
+    {
+        const int8_t *convWeights;     // [CHANNELS][KERNEL][KERNEL][1]
+        const int32_t *convBias;
+        const Nn::Requant *convRequant; // per channel
+        int32_t convZero;              // zero point of the ReLU output
+        const int8_t *denseWeights;    // [CLASSES][POOLED_SIZE]
+        const int32_t *denseBias;
+        Nn::Requant denseRequant;
+        int32_t logitZero;
+        float logitScale;              // a logit is logitScale * (q - logitZero)
+    };
+
+    // the trained model, SoundModel.cpp
+    extern const Model MODEL;
+
+    // runs the network on a feature frame, false if a kernel fails
+    bool run(const Model &model, const int8_t *features, int8_t *logits);
+
+}
@@ -7,75 +7,211 @@
 #include <Communication.h>
 #include <BluetoothManager.h>
 #include <SoundMeasurer.h>
+#include <Scheduler.h>
+#include <Threads.h>
+#include <Log.h>
+#include <Profiler.h>
+#include <Power.h>
+#include <Params.h>
+#include <Trace.h>
 #include <orientation/Orientation.h>
 
 
 
 const int BLINK_MILLIS = 1000;
+const int LOCALISATION_MILLIS = 10;
+const int ORIENTATION_MILLIS = 50;
+const int BEARING_MILLIS = 50; // one mic frame
+const int LOCOMOTION_MILLIS = 10;
+const int STATS_MILLIS = 10000;
+const int LOG_FLUSH_BYTES = 64; // most log bytes sent per pass before sleeping
+const int SELF_TEST_MILLIS = 100;
+const int CONSOLE_MILLIS = 100;
 const int modeSelectPin = 0;
 
+// set to true to always run the diagnostics and compass calibration at boot
+const bool FORCE_FULL_BOOT = false;
+
 u_int8_t behaviourMode = 0;
+bool fastBoot = false;
+int selfTestTaskId = -1;
+int bleSwapTaskId = -1;
+int soundTaskId = -1;
 
-void setup()
+// ############ Tasks #############
+
+void blinkTask()
 {
-  Serial.begin(9600);
+  LOG_DEBUG(LOG_BLINK);
+  if (behaviourMode == 1)
+  {
+    digitalWrite(LED_RED, !digitalRead(LED_RED));
+  }
+  else if (behaviourMode == 0)
+  {
+    digitalWrite(LED_BLUE, !digitalRead(LED_BLUE));
+  }
+}
+
+void localisationTask()
+{
+  if (BLEManager::isScanning())
+  {
+    updateLocalisation();
+  }
+  else
+  {
+    // services the parameter service connections while advertising
+    BLE.poll();
+  }
+}
 
-  // Wait for serial monitor with timeout (5 seconds)
-  unsigned long startTime = millis();
-  while (!Serial && (millis() - startTime < 5000))
+// runs serial parameter commands and applies any changed parameters
+void paramsTask()
+{
+  Params::handleConsole();
+  if (Params::consumeChanged())
   {
-    delay(10);
+    applyParams();
+    TRACE_PARAMS();
+    Scheduler::setPeriod(bleSwapTaskId, Params::values.swapInterval);
+    Scheduler::setPeriod(soundTaskId, Params::values.sampleMillis);
   }
+}
+
+// prints the profiler zones and publishes their summary as a diagnostics frame
+void reportProfile()
+{
+#ifdef ENABLE_PROFILER
+  Profiler::print();
+  uint8_t frame[Comms::MAX_FRAME_PAYLOAD];
+  uint8_t len = Profiler::summarise(frame, sizeof(frame));
+  Comms::update_frame(Comms::FRAME_DIAGNOSTICS, frame, len);
+#endif
+}
+
+// motor self test deferred from setup() in a fast boot
+void selfTestTask()
+{
+  if (Locomotion::selfTestStep())
+  {
+    Scheduler::suspendTask(selfTestTaskId);
+  }
+}
+
+void statsTask()
+{
+  Scheduler::printStats();
+  Locomotion::printControlLatency();
+  Power::printStats();
+  reportProfile();
+}
+
+// registers every periodic job with the scheduler, lower priority value runs first
+void setupTasks()
+{
+  if (behaviourMode == 0)
+  {
+    Scheduler::addTask("locomotion", Locomotion::updateLocomotion,             LOCOMOTION_MILLIS,            0,    2000);
+  }
+  else if (behaviourMode == 1)
+  {
+    Scheduler::addTask("locomotion", Locomotion::updateLocomotionWalkStraight, LOCOMOTION_MILLIS,            0,    2000);
+  }
+  bleSwapTaskId =
+    Scheduler::addTask("ble swap",     BLEManager::swapClientServer,             Params::values.swapInterval,  1,    60000);
+  Scheduler::addTask("localisation", localisationTask,                         LOCALISATION_MILLIS,          2,    5000);
+  Scheduler::addTask("orientation",  updateOrientation,                        ORIENTATION_MILLIS,           3,    5000);
+  if (behaviourMode == 0)
+  {
+    soundTaskId =
+      Scheduler::addTask("sound",    updateSoundLevel,                         Params::values.sampleMillis,  4,    750000);
+    Scheduler::addTask("bearing",    updateSoundBearing,                       BEARING_MILLIS,               4,    5000);
+  }
+  Scheduler::addTask("blink",        blinkTask,                                BLINK_MILLIS,                 5,    2000);
+  Scheduler::addTask("stats",        statsTask,                                STATS_MILLIS,                 6,    20000);
+  Scheduler::addTask("params",       paramsTask,                               CONSOLE_MILLIS,               6,    2000);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+
+#ifdef ENABLE_PROFILER
+  Profiler::begin();
+#endif
+  Power::setupPower();
+
+  // stored parameters replace the defaults before anything reads them
+  Params::load();
 
   // LED setup
   pinMode(LED_BUILTIN, OUTPUT);
   digitalWrite(LED_BUILTIN, LOW);
 
-  // do a blink
-  for (int i = 0; i < 10; i++)
+  // start the compass first so it settles while everything else initialises.
+  // with a valid stored calibration the diagnostics and calibration are skipped
+  fastBoot = beginOrientation() && !FORCE_FULL_BOOT;
+
+  if (!fastBoot)
   {
-    digitalWrite(LED_BUILTIN, HIGH);
-    delay(100);
-    digitalWrite(LED_BUILTIN, LOW);
-    delay(100);
+    // Wait for serial monitor with timeout (5 seconds)
+    unsigned long startTime = millis();
+    while (!Serial && (millis() - startTime < 5000))
+    {
+      delay(10);
+    }
+
+    // do a blink
+    for (int i = 0; i < 10; i++)
+    {
+      digitalWrite(LED_BUILTIN, HIGH);
+      delay(100);
+      digitalWrite(LED_BUILTIN, LOW);
+      delay(100);
+    }
   }
 
   // Initialise localisation
   BLEManager::setupBLE();
+  Params::setupService();
   initialiseLocalisation();
+  TRACE_BEGIN();
 
   digitalWrite(LED_BUILTIN, HIGH);
-    // do a blink
-  for (int i = 0; i < 10; i++)
+
+  if (!fastBoot)
   {
-    digitalWrite(LED_BLUE, HIGH);
-    delay(50);
-    digitalWrite(LED_BLUE, LOW);
-    delay(50);
-  }
+    // do a blink
+    for (int i = 0; i < 10; i++)
+    {
+      digitalWrite(LED_BLUE, HIGH);
+      delay(50);
+      digitalWrite(LED_BLUE, LOW);
+      delay(50);
+    }
 
-  // initialise orientation
-  // this will trigger a 60 second orientation phase where the user will need
-  // to rotate the robot in all directions
-  setupOrientation();
+    // this will trigger a 60 second orientation phase where the user will need
+    // to rotate the robot in all directions
+    calibrateOrientation();
 
-  digitalWrite(LED_BLUE, HIGH);
-  Locomotion::moveForward();
-  delay(200);
-  Locomotion::stopMotors();
-  // do a blink
-  for (int i = 0; i < 20; i++)
-  {
-    digitalWrite(LED_GREEN, LOW);
-    delay(50);
-    digitalWrite(LED_GREEN, HIGH);
-    delay(50);
+    digitalWrite(LED_BLUE, HIGH);
+    Locomotion::moveForward();
+    delay(200);
+    Locomotion::stopMotors();
+    // do a blink
+    for (int i = 0; i < 20; i++)
+    {
+      digitalWrite(LED_GREEN, LOW);
+      delay(50);
+      digitalWrite(LED_GREEN, HIGH);
+      delay(50);
+    }
+    displayHeading();
   }
-  //updateOrientation();
-  displayHeading();
 
-  // Initialise locomotion
-  Locomotion::initialiseLocomotion();
+  // Initialise locomotion, in a fast boot the motor test runs in the background
+  Locomotion::initialiseLocomotion(!fastBoot);
 
   // initialise sound level
   setupSoundLevel();
@@ -92,51 +228,55 @@ void setup()
     behaviourMode = 0;
   }
 
+  // get the first telemetry out straight away rather than after the first scan phase
+#ifdef USE_RTOS_THREADS
+  // before the threads start: ArduinoBLE is not thread safe and the radio thread owns it
+  // from then on, counting its first swap interval from its start
+  Comms::advertiseBLE();
+  Threads::startThreads(behaviourMode);
+#else
+  setupTasks();
+  if (fastBoot)
+  {
+    selfTestTaskId = Scheduler::addTask("self test", selfTestTask, SELF_TEST_MILLIS, 6, 1000);
+  }
+  Comms::advertiseBLE();
+  Scheduler::deferTask(bleSwapTaskId, Params::values.swapInterval);
+#endif
 
+  LOG_INFO(LOG_BOOT_DONE, millis(), fastBoot);
 }
-  // ############ Blink the LED #############
-  static unsigned long lastBlink = 0;
 
 void loop()
 {
-
-  if (millis() - lastBlink > BLINK_MILLIS)
+#ifdef USE_RTOS_THREADS
+  // the subsystems run in their own threads, loop() is left with the blink and the stats
+  static uint32_t lastStats = 0;
+  static bool selfTestDone = !fastBoot;
+  blinkTask();
+  if (!selfTestDone)
   {
-    Serial.println("Blink!");
-    if (behaviourMode == 1)
-    {
-      digitalWrite(LED_RED, !digitalRead(LED_RED));
-    } 
-    else if (behaviourMode == 0)
-    {
-      digitalWrite(LED_BLUE, !digitalRead(LED_BLUE));
-    }
-    lastBlink = millis();
+    selfTestDone = Locomotion::selfTestStep();
   }
-
-  BLEManager::swapClientServer();
-
-  if (BLEManager::isScanning())
+  Log::flushAll();
+  Params::handleConsole();
+  if (Params::consumeChanged())
   {
-    updateLocalisation();
+    applyParams();
+    TRACE_PARAMS();
   }
-
-  // ############ Orientation #############
-  updateOrientation();
-
-  // ############ Sound Level #############
-  if (behaviourMode == 0) {
-      updateSoundLevel();
-  }
-
-  // ############ Locomotion #############
-  if (behaviourMode == 0)
-  {
-    Locomotion::updateLocomotion();
-  } 
-  else if (behaviourMode == 1)
+  if (millis() - lastStats >= STATS_MILLIS)
   {
-    Locomotion::updateLocomotionWalkStraight();
+    Threads::printStats();
+    reportProfile();
+    lastStats = millis();
   }
-}
+  delay(BLINK_MILLIS); // sleeps this thread, the others keep running
+#else
+  Scheduler::dispatch();
 
+  // idle time: send some log records, then sleep until the next task is due
+  Log::flush(LOG_FLUSH_BYTES);
+  Power::idle(Scheduler::msUntilNextTask());
+#endif
+}
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// attitude and heading filters with one quaternion api:
+//
+//   Ahrs::Filter<Ahrs::Madgwick> filter;           // sample rate set with begin()
+//   Ahrs::Filter<Ahrs::Mahony, 10000> fixedFilter; // fixed 10 ms sample period
+//   filter.update(gx, gy, gz, ax, ay, az, mx, my, mz);
+//   float heading = filter.yaw();
+//
+// gyro rates are in deg/s, accelerometer and magnetometer readings in any unit (they
+// are normalised). a zero accelerometer reading skips the correction and a zero
+// magnetometer reading falls back to the imu-only update, as in lib/MadgwickAHRS.
+// euler angles are only computed when asked for, one at a time, and kept until the
+// next update. bench/ has the cycle counts and the accuracy check against the
+// vendored Madgwick filter.
+namespace Ahrs
+{
+
+    struct Quaternion
+    {
+        float w, x, y, z;
+    };
+
+    static const float RADIANS_PER_DEGREE = 0.0174532925f;
+    static const float DEGREES_PER_RADIAN = 57.2957795f;
+
+    inline float invSqrt(float x)
+    {
+        return 1.0f / sqrtf(x);
+    }
+
+    // Madgwick's gradient descent filter. the corrective step shares the six
+    // residuals of the gravity and field directions between the four gradient terms
+    struct Madgwick
+    {
+        float beta = 0.1f; // 2 * proportional gain
+
+        // q: current attitude, g: gyro (rad/s), a and m: normalised, m may be nullptr.
+        // returns the rate of change of q. the step length is unused, Madgwick has no integral term
+        Quaternion rate(const Quaternion &q, const float g[3], const float a[3], const float m[3], float /* dt */)
+        {
+            const float q0 = q.w, q1 = q.x, q2 = q.y, q3 = q.z;
+            Quaternion dq = {
+                0.5f * (-q1 * g[0] - q2 * g[1] - q3 * g[2]),
+                0.5f * (q0 * g[0] + q2 * g[2] - q3 * g[1]),
+                0.5f * (q0 * g[1] - q1 * g[2] + q3 * g[0]),
+                0.5f * (q0 * g[2] + q1 * g[1] - q2 * g[0]),
+            };
+            if (a == nullptr)
+                return dq;
+
+            const float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+            const float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+            const float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+            // residuals of the estimated gravity direction
+            const float fg0 = 2.0f * (q1q3 - q0q2) - a[0];
+            const float fg1 = 2.0f * (q0q1 + q2q3) - a[1];
+            const float fg2 = 1.0f - 2.0f * (q1q1 + q2q2) - a[2];
+
+            float s0, s1, s2, s3;
+            if (m == nullptr)
+            {
+                s0 = -q2 * fg0 + q1 * fg1;
+                s1 = q3 * fg0 + q0 * fg1 - 2.0f * q1 * fg2;
+                s2 = -q0 * fg0 + q3 * fg1 - 2.0f * q2 * fg2;
+                s3 = q1 * fg0 + q2 * fg1;
+            }
+            else
+            {
+                // earth's field in the earth frame, turned to have no east component (bx, 0, bz)
+                const float mx = m[0], my = m[1], mz = m[2];
+                const float hx = mx * (q0q0 + q1q1 - q2q2 - q3q3) + 2.0f * (my * (q1q2 - q0q3) + mz * (q0q2 + q1q3));
+                const float hy = 2.0f * (mx * (q0q3 + q1q2) + mz * (q2q3 - q0q1)) + my * (q0q0 - q1q1 + q2q2 - q3q3);
+                const float bx = sqrtf(hx * hx + hy * hy);
+                const float bz = 2.0f * (mx * (q1q3 - q0q2) + my * (q0q1 + q2q3)) + mz * (q0q0 - q1q1 - q2q2 + q3q3);
+
+                // residuals of the estimated field direction
+                const float fb0 = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2) - mx;
+                const float fb1 = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3) - my;
+                const float fb2 = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2) - mz;
+
+                // the gradient (J^T f) with its common factor of 2 dropped, the step is normalised
+                const float bxq0 = bx * q0, bxq1 = bx * q1, bxq2 = bx * q2, bxq3 = bx * q3;
+                const float bzq0 = bz * q0, bzq1 = bz * q1, bzq2 = bz * q2, bzq3 = bz * q3;
+                s0 = -q2 * fg0 + q1 * fg1 - 0.5f * (bzq2 * fb0 + (bxq3 - bzq1) * fb1 - bxq2 * fb2);
+                s1 = q3 * fg0 + q0 * fg1 - 2.0f * q1 * fg2 +
+                     0.5f * (bzq3 * fb0 + (bxq2 + bzq0) * fb1 + (bxq3 - 2.0f * bzq1) * fb2);
+                s2 = -q0 * fg0 + q3 * fg1 - 2.0f * q2 * fg2 +
+                     0.5f * (-(2.0f * bxq2 + bzq0) * fb0 + (bxq1 + bzq3) * fb1 + (bxq0 - 2.0f * bzq2) * fb2);
+                s3 = q1 * fg0 + q2 * fg1 + 0.5f * ((bzq1 - 2.0f * bxq3) * fb0 + (bzq2 - bxq0) * fb1 + bxq1 * fb2);
+            }
+
+            const float norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+            if (norm > 0.0f)
+            {
+                const float step = beta * invSqrt(norm);
+                dq.w -= step * s0;
+                dq.x -= step * s1;
+                dq.y -= step * s2;
+                dq.z -= step * s3;
+            }
+            return dq;
+        }
+    };
+
+    // Mahony's complementary filter: the cross product of the measured and estimated
+    // directions is fed back into the gyro rates through a PI controller
+    struct Mahony
+    {
+        float twoKp = 1.0f; // 2 * proportional gain
+        float twoKi = 0.0f; // 2 * integral gain
+        float integral[3] = {0.0f, 0.0f, 0.0f};
+
+        Quaternion rate(const Quaternion &q, const float g[3], const float a[3], const float m[3], float dt)
+        {
+            const float q0 = q.w, q1 = q.x, q2 = q.y, q3 = q.z;
+            float gx = g[0], gy = g[1], gz = g[2];
+
+            if (a != nullptr)
+            {
+                const float q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+                const float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+                const float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+                // estimated direction of gravity (half)
+                const float vx = q1q3 - q0q2;
+                const float vy = q0q1 + q2q3;
+                const float vz = 0.5f - q1q1 - q2q2;
+                float ex = a[1] * vz - a[2] * vy;
+                float ey = a[2] * vx - a[0] * vz;
+                float ez = a[0] * vy - a[1] * vx;
+
+                if (m != nullptr)
+                {
+                    const float mx = m[0], my = m[1], mz = m[2];
+                    const float hx = 2.0f * (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+                    const float hy = 2.0f * (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+                    const float bx = sqrtf(hx * hx + hy * hy);
+                    const float bz = 2.0f * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2));
+
+                    // estimated direction of the field (half)
+                    const float wx = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+                    const float wy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+                    const float wz = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2);
+                    ex += my * wz - mz * wy;
+                    ey += mz * wx - mx * wz;
+                    ez += mx * wy - my * wx;
+                }
+
+                if (twoKi > 0.0f)
+                {
+                    integral[0] += twoKi * ex * dt;
+                    integral[1] += twoKi * ey * dt;
+                    integral[2] += twoKi * ez * dt;
+                    gx += integral[0];
+                    gy += integral[1];
+                    gz += integral[2];
+                }
+                else
+                {
+                    integral[0] = integral[1] = integral[2] = 0.0f;
+                }
+                gx += twoKp * ex;
+                gy += twoKp * ey;
+                gz += twoKp * ez;
+            }
+
+            return {
+                0.5f * (-q1 * gx - q2 * gy - q3 * gz),
+                0.5f * (q0 * gx + q2 * gz - q3 * gy),
+                0.5f * (q0 * gy - q1 * gz + q3 * gx),
+                0.5f * (q0 * gz + q1 * gy - q2 * gx),
+            };
+        }
+    };
+
+    // integrates a kernel's quaternion rate. PERIOD_US fixes the sample period at
+    // compile time, 0 takes it from begin()
+    template <typename Kernel, uint32_t PERIOD_US = 0>
+    class Filter
+    {
+    public:
+        Kernel kernel; // gains
+
+        // sets the sample rate (Hz), for filters without a fixed period
+        void begin(float sampleFrequency)
+        {
+            static_assert(PERIOD_US == 0, "the sample period of this filter is fixed");
+            dt = 1.0f / sampleFrequency;
+        }
+
+        void update(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz)
+        {
+            if (mx == 0.0f && my == 0.0f && mz == 0.0f)
+            {
+                updateIMU(gx, gy, gz, ax, ay, az);
+                return;
+            }
+            float m[3] = {mx, my, mz};
+            step(gx, gy, gz, ax, ay, az, m);
+        }
+
+        void updateIMU(float gx, float gy, float gz, float ax, float ay, float az)
+        {
+            step(gx, gy, gz, ax, ay, az, nullptr);
+        }
+
+        const Quaternion &quaternion() const
+        {
+            return q;
+        }
+
+        void setQuaternion(const Quaternion &value)
+        {
+            q = value;
+            valid = 0;
+        }
+
+        // euler angles in radians, each computed on first use after an update
+        float rollRadians()
+        {
+            if (!(valid & ROLL))
+            {
+                rollAngle = atan2f(q.w * q.x + q.y * q.z, 0.5f - q.x * q.x - q.y * q.y);
+                valid |= ROLL;
+            }
+            return rollAngle;
+        }
+
+        float pitchRadians()
+        {
+            if (!(valid & PITCH))
+            {
+                pitchAngle = asinf(-2.0f * (q.x * q.z - q.w * q.y));
+                valid |= PITCH;
+            }
+            return pitchAngle;
+        }
+
+        float yawRadians()
+        {
+            if (!(valid & YAW))
+            {
+                yawAngle = atan2f(q.x * q.y + q.w * q.z, 0.5f - q.y * q.y - q.z * q.z);
+                valid |= YAW;
+            }
+            return yawAngle;
+        }
+
+        // in degrees, yaw in 0-360 like the vendored filter's getYaw()
+        float roll() { return rollRadians() * DEGREES_PER_RADIAN; }
+        float pitch() { return pitchRadians() * DEGREES_PER_RADIAN; }
+        float yaw() { return yawRadians() * DEGREES_PER_RADIAN + 180.0f; }
+
+    private:
+        enum : uint8_t
+        {
+            ROLL = 1,
+            PITCH = 2,
+            YAW = 4,
+        };
+
+        Quaternion q = {1.0f, 0.0f, 0.0f, 0.0f};
+        float dt = 1.0f / 512.0f; // the vendored filter's default rate
+        uint8_t valid = 0;        // which angles are up to date
+        float rollAngle = 0.0f, pitchAngle = 0.0f, yawAngle = 0.0f;
+
+        float period() const
+        {
+            return PERIOD_US != 0 ? PERIOD_US * 1e-6f : dt;
+        }
+
+        void step(float gx, float gy, float gz, float ax, float ay, float az, float *m)
+        {
+            const float g[3] = {gx * RADIANS_PER_DEGREE, gy * RADIANS_PER_DEGREE, gz * RADIANS_PER_DEGREE};
+            float a[3] = {ax, ay, az};
+            const float *accel = nullptr;
+            if (!(ax == 0.0f && ay == 0.0f && az == 0.0f))
+            {
+                const float r = invSqrt(ax * ax + ay * ay + az * az);
+                a[0] *= r;
+                a[1] *= r;
+                a[2] *= r;
+                accel = a;
+                if (m != nullptr)
+                {
+                    const float rm = invSqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+                    m[0] *= rm;
+                    m[1] *= rm;
+                    m[2] *= rm;
+                }
+            }
+            else
+            {
+                // the field is only used together with gravity
+                m = nullptr;
+            }
+
+            const float h = period();
+            const Quaternion dq = kernel.rate(q, g, accel, m, h);
+            q.w += dq.w * h;
+            q.x += dq.x * h;
+            q.y += dq.y * h;
+            q.z += dq.z * h;
+            const float r = invSqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+            q.w *= r;
+            q.x *= r;
+            q.y *= r;
+            q.z *= r;
+            valid = 0;
+        }
+    };
+
+}
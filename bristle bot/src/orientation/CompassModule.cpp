@@ -1,5 +1,13 @@
 #include "CompassModule.h"
 #include <Arduino.h>
+#include <Storage.h>
+#include <Trace.h>
+
+// Calibration as it is kept in flash
+struct StoredCalibration {
+    float offset[3];
+    float scale[3];
+};
 
 // Initialize the compass module
 void CompassModule::begin() {
@@ -18,9 +26,13 @@ float CompassModule::readHeading() {
     compass.read();
     
     // Get raw values
-    float mx = compass.getX();
-    float my = compass.getY();
-    float mz = compass.getZ();
+    int x = compass.getX();
+    int y = compass.getY();
+    int z = compass.getZ();
+    TRACE_MAGNETOMETER(x, y, z);
+    float mx = x;
+    float my = y;
+    float mz = z;
     
     // Apply calibration
     applyCalibration(mx, my, mz);
@@ -112,9 +124,11 @@ void CompassModule::calibrate() {
     }
     
     // Calculate offsets
-    magOffsetX = (maxX + minX) / 2.0;
-    magOffsetY = (maxY + minY) / 2.0;
-    magOffsetZ = (maxZ + minZ) / 2.0;
+    float offset[3] = {
+        (maxX + minX) / 2.0f,
+        (maxY + minY) / 2.0f,
+        (maxZ + minZ) / 2.0f
+    };
     
     // Calculate scales
     float deltaX = (maxX - minX) / 2.0;
@@ -124,9 +138,12 @@ void CompassModule::calibrate() {
     float maxDelta = max(max(deltaX, deltaY), deltaZ);
     
     // Using the maximum delta for normalization
-    magScaleX = (deltaX == 0) ? 1.0 : maxDelta / deltaX;
-    magScaleY = (deltaY == 0) ? 1.0 : maxDelta / deltaY;
-    magScaleZ = (deltaZ == 0) ? 1.0 : maxDelta / deltaZ;
+    float scale[3] = {
+        (deltaX == 0) ? 1.0f : maxDelta / deltaX,
+        (deltaY == 0) ? 1.0f : maxDelta / deltaY,
+        (deltaZ == 0) ? 1.0f : maxDelta / deltaZ
+    };
+    setCalibration(offset, scale);
     
     Serial.println("=== Calibration Complete! ===");
     printCalibrationData();
@@ -152,6 +169,44 @@ void CompassModule::printCalibrationData() {
     Serial.print("Scale Z: "); Serial.println(magScaleZ);
 }
 
+// Store the calibration in flash
+bool CompassModule::saveCalibration() {
+    StoredCalibration stored = {
+        {magOffsetX, magOffsetY, magOffsetZ},
+        {magScaleX, magScaleY, magScaleZ}
+    };
+    return Storage::save(Storage::SLOT_CALIBRATION, &stored, sizeof(stored));
+}
+
+// Load a stored calibration
+bool CompassModule::loadCalibration() {
+    StoredCalibration stored;
+    if (!Storage::load(Storage::SLOT_CALIBRATION, &stored, sizeof(stored))) {
+        return false;
+    }
+    
+    // Reject values that could not have come from calibrate()
+    for (int i = 0; i < 3; i++) {
+        if (!isfinite(stored.offset[i]) || !isfinite(stored.scale[i]) || stored.scale[i] <= 0) {
+            return false;
+        }
+    }
+    
+    setCalibration(stored.offset, stored.scale);
+    return true;
+}
+
+// Use the given calibration
+void CompassModule::setCalibration(const float offset[3], const float scale[3]) {
+    magOffsetX = offset[0];
+    magOffsetY = offset[1];
+    magOffsetZ = offset[2];
+    magScaleX = scale[0];
+    magScaleY = scale[1];
+    magScaleZ = scale[2];
+    TRACE_CALIBRATION(offset, scale);
+}
+
 // Set the declination angle (in degrees)
 void CompassModule::setDeclinationAngle(float angle) {
     declinationAngle = angle;
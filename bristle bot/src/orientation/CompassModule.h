@@ -33,6 +33,15 @@ public:
     
     // Print current calibration values
     void printCalibrationData();
+
+    // Store the calibration in flash
+    bool saveCalibration();
+
+    // Load a stored calibration, returns false if there is no valid one
+    bool loadCalibration();
+
+    // Use the given offsets and scales (x, y, z)
+    void setCalibration(const float offset[3], const float scale[3]);
     
     // Set declination angle for your location
     void setDeclinationAngle(float angle);
@@ -1,8 +1,9 @@
 #include <orientation/Orientation.h>
 #include "CompassModule.h"
 #include <Wire.h>
-#include <SparkFunLSM6DS3.h>
 #include <Communication.h>
+#include <Log.h>
+#include <Profiler.h>
 
 
 // Create the compass module instance
@@ -17,57 +18,78 @@ float heading, tiltCompHeading;
 bool continuousHeading = false;
 
 float lastHeading = 0.0;
+uint32_t lastHeadingTime = 0;
+
+// time the sensors are left to stabilise after power up before headings are used (ms)
+const uint32_t SETTLE_MILLIS = 2000;
+uint32_t settleStart = 0;
 
 float getHeading() {
   return lastHeading;
 }
 
-void setupOrientation() {
-   
+uint32_t getHeadingTime() {
+  return lastHeadingTime;
+}
+
+bool beginOrientation() {
+
   // Initialize I2C
   Wire.begin();
   
-  // Initialize the compass module
+  // Initialize the compass module, it settles while the rest of the bot starts up
   compass.begin();
-    
+  settleStart = millis();
+
+  return compass.loadCalibration();
+}
+
+void calibrateOrientation() {
+
   Serial.println("\nCommands:");
   Serial.println("c - Calibrate magnetometer");
   Serial.println("d - Print current calibration data");
   Serial.println("h - Show heading");
   Serial.println("t - Toggle continuous heading display");
 
-  // Add a 2 second delay to allow sensors to stabilize
-  delay(2000);
+  // Wait for whatever is left of the settling time
+  uint32_t settled = millis() - settleStart;
+  if (settled < SETTLE_MILLIS) {
+    delay(SETTLE_MILLIS - settled);
+  }
 
   // calibration phase
   compass.calibrate();
+  if (!compass.saveCalibration()) {
+    Serial.println("Failed to store calibration");
+  }
 
 }
 
 void displayHeading() {
  
   // Get raw heading
-  heading = compass.readHeading();
+  {
+    PROFILE_SCOPE(PROFILE_READ_HEADING);
+    heading = compass.readHeading();
+  }
   heading += 90;
 
   Comms::update_heading(map(heading, 0, 360, 0, 255));
   lastHeading = heading;
+  lastHeadingTime = micros();
   
   // Get tilt-compensated heading
   //tiltCompHeading = compass.readTiltCompensatedHeading(accelX, accelY, accelZ);
   
-  // Get direction string
-  String direction = compass.getDirection(heading);
-  
-  // Display both raw and tilt-compensated headings
-  Serial.print("Raw Heading: ");
-  Serial.print(heading, 1);
-  Serial.print("° | Direction: ");
-  Serial.println(direction);
+  LOG_DEBUG(LOG_HEADING, heading);
 
 }
 
 void updateOrientation() {
+  if (millis() - settleStart < SETTLE_MILLIS) {
+    return;
+  }
   displayHeading();
 }
 
@@ -1,6 +1,13 @@
 #pragma once
 
-void setupOrientation();
+#include <cstdint>
+
+// initialises the compass and loads the stored calibration, returns false if there is none
+bool beginOrientation();
+// runs the 60 second calibration phase and stores the result
+void calibrateOrientation();
 void updateOrientation();
 void displayHeading();
 float getHeading();
+// micros() timestamp of the last heading reading
+uint32_t getHeadingTime();
@@ -0,0 +1,95 @@
+# compares kernel benchmark results with a stored baseline. results are the json
+# written by the host benchmarks (bench/build/bench --json) or printed over serial by
+# the bench firmware (bench/TargetBench.cpp), the baselines live in bench/baselines.
+#
+#   python tools/bench_compare.py results.json bench/baselines/host.json
+#   python tools/bench_compare.py --port /dev/ttyACM0 bench/baselines/nrf52840.json
+#
+# --save writes the results as the new baseline instead of comparing.
+# a change is only reported when it is larger than --threshold and than the noise
+# (three times the summed median absolute deviations).
+
+import argparse
+import json
+import sys
+from pathlib import Path
+
+
+def extract(text):
+    # the json document may be surrounded by other serial output
+    start = text.find('{"platform"')
+    if start < 0:
+        raise ValueError("no benchmark results found")
+    result, _ = json.JSONDecoder().raw_decode(text[start:])
+    return result
+
+
+def read_port(port, baud):
+    import serial  # pyserial, only needed for the board
+
+    text = ""
+    with serial.Serial(port, baud, timeout=1) as s:
+        s.write(b"r")
+        while True:
+            text += s.read(256).decode("utf-8", errors="replace")
+            try:
+                return extract(text)
+            except ValueError:
+                continue
+
+
+def compare(results, baseline, threshold):
+    if results.get("unit") != baseline.get("unit") or results.get("platform") != baseline.get("platform"):
+        print(f"warning: comparing {results.get('platform')} ({results.get('unit')}) "
+              f"with a {baseline.get('platform')} ({baseline.get('unit')}) baseline")
+    unit = results.get("unit", "")
+    regressions = 0
+    print(f"{'benchmark':<22} {'baseline':>10} {'now':>10} {'change':>8}")
+    for name, now in results["benchmarks"].items():
+        base = baseline["benchmarks"].get(name)
+        if base is None:
+            print(f"{name:<22} {'-':>10} {now['median']:>10.2f} {'new':>8}")
+            continue
+        change = (now["median"] - base["median"]) / base["median"]
+        noise = 3.0 * (now["mad"] + base["mad"]) / base["median"]
+        verdict = ""
+        if abs(change) > max(threshold, noise):
+            verdict = "slower" if change > 0 else "faster"
+            regressions += change > 0
+        print(f"{name:<22} {base['median']:>10.2f} {now['median']:>10.2f} {change:>+8.1%} {verdict} {unit}")
+    for name in baseline["benchmarks"]:
+        if name not in results["benchmarks"]:
+            print(f"{name:<22} missing from the results")
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Bristle bot benchmark comparison")
+    parser.add_argument("results", nargs="?", help="results json (or captured serial output)")
+    parser.add_argument("baseline", help="baseline json")
+    parser.add_argument("--port", help="read the results from the bench firmware on this serial port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--threshold", type=float, default=0.05, help="smallest relative change reported")
+    parser.add_argument("--save", action="store_true", help="store the results as the baseline")
+    parser.add_argument("--fail", action="store_true", help="exit with 1 if anything got slower")
+    args = parser.parse_args()
+
+    if args.port:
+        results = read_port(args.port, args.baud)
+    elif args.results:
+        results = extract(Path(args.results).read_text())
+    else:
+        parser.error("give a results file or --port")
+
+    if args.save:
+        Path(args.baseline).write_text(json.dumps(results, indent=2) + "\n")
+        print(f"saved {len(results['benchmarks'])} results to {args.baseline}")
+        return
+
+    regressions = compare(results, json.loads(Path(args.baseline).read_text()), args.threshold)
+    if args.fail and regressions:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,147 @@
+# decodes the binary log records written by src/Log.cpp back into text.
+# plain serial text (setup messages, stats tables) is passed straight through.
+#
+#   python tools/log_decode.py --port /dev/ttyACM0
+#   python tools/log_decode.py --file capture.bin
+#
+# --save keeps the raw bytes of a live capture, e.g. an input trace for native/replay:
+#   python tools/log_decode.py --port /dev/ttyACM0 --save trace.bin
+
+import argparse
+import re
+import struct
+import sys
+from pathlib import Path
+
+FRAME_SYNC = 0xA5
+HEADER_SIZE = 7
+LEVELS = ["DEBUG", "INFO", "WARN", "ERROR"]
+
+DEFAULT_TABLE = Path(__file__).resolve().parent.parent / "src" / "LogMessages.def"
+
+
+def load_messages(path):
+    # the message ids are the position of each LOG_MESSAGE entry in the table
+    pattern = re.compile(r'^\s*LOG_MESSAGE\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+    messages = []
+    for line in Path(path).read_text().splitlines():
+        match = pattern.match(line)
+        if match:
+            messages.append((match.group(1), match.group(2)))
+    return messages
+
+
+def format_record(messages, record):
+    header = record[0]
+    level = header >> 4
+    arg_count = header & 0x0F
+    message_id, timestamp = struct.unpack_from("<HI", record, 1)
+    words = struct.unpack_from("<" + "I" * arg_count, record, HEADER_SIZE)
+
+    if message_id >= len(messages):
+        return f"[{timestamp:>10}] ???   unknown message {message_id} {list(words)}"
+    name, text = messages[message_id]
+
+    # reinterpret each word according to its conversion in the format string
+    conversions = re.findall(r"%[-+ #0]*\d*(?:\.\d+)?([diouxXfFeEgGc])", text)
+    args = []
+    for word, conversion in zip(words, conversions):
+        if conversion in "fFeEgG":
+            args.append(struct.unpack("<f", struct.pack("<I", word))[0])
+        elif conversion in "di":
+            args.append(struct.unpack("<i", struct.pack("<I", word))[0])
+        else:
+            args.append(word)
+    try:
+        body = text % tuple(args)
+    except (TypeError, ValueError):
+        body = f"{text} {list(words)}"
+
+    level_name = LEVELS[level] if level < len(LEVELS) else str(level)
+    return f"[{timestamp:>10}] {level_name:<5} {body}"
+
+
+class Decoder:
+    def __init__(self, messages, out):
+        self.messages = messages
+        self.out = out
+        self.buffer = bytearray()
+        self.text = bytearray()
+        self.bad_frames = 0
+
+    def flush_text(self):
+        if self.text:
+            self.out.write(self.text.decode("utf-8", errors="replace"))
+            self.text.clear()
+
+    def feed(self, data):
+        # walks an index over the buffer and drops what was used in one go at the end,
+        # popping byte by byte would make a whole capture quadratic
+        self.buffer.extend(data)
+        buffer = self.buffer
+        i = 0
+        while i < len(buffer):
+            if buffer[i] != FRAME_SYNC:
+                # text up to the next possible frame
+                end = buffer.find(FRAME_SYNC, i)
+                if end < 0:
+                    end = len(buffer)
+                self.text += buffer[i:end]
+                i = end
+                continue
+            if len(buffer) - i < 2:
+                break
+            length = buffer[i + 1]
+            if len(buffer) - i < length + 3:
+                break
+            record = bytes(buffer[i + 2:i + 2 + length])
+            checksum = buffer[i + 2 + length]
+            if length < HEADER_SIZE or sum(record) & 0xFF != checksum:
+                # not a real frame (a sync byte in the text): drop it and resynchronise
+                self.bad_frames += 1
+                i += 1
+                continue
+            i += length + 3
+            self.flush_text()
+            self.out.write(format_record(self.messages, record) + "\n")
+        del buffer[:i]
+        if self.text.endswith(b"\n"):
+            self.flush_text()
+        self.out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Bristle bot binary log decoder")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port to read from")
+    source.add_argument("--file", help="captured serial output to decode")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--table", default=DEFAULT_TABLE, help="path to LogMessages.def")
+    parser.add_argument("--save", help="also write the raw bytes read from the port to this file")
+    args = parser.parse_args()
+
+    decoder = Decoder(load_messages(args.table), sys.stdout)
+    if args.file:
+        decoder.feed(Path(args.file).read_bytes())
+        decoder.flush_text()
+        return
+
+    import serial  # pyserial, only needed for live capture
+
+    save = open(args.save, "wb") if args.save else None
+    with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+        try:
+            while True:
+                data = port.read(256)
+                if save:
+                    save.write(data)
+                decoder.feed(data)
+        except KeyboardInterrupt:
+            decoder.flush_text()
+        finally:
+            if save:
+                save.close()
+
+
+if __name__ == "__main__":
+    main()
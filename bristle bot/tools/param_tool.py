@@ -0,0 +1,103 @@
+# reads and changes the runtime parameters (src/Params.def) of a bot over BLE,
+# through the parameter service added by src/Params.cpp.
+#
+#   python tools/param_tool.py --address AA:BB:CC:DD:EE:FF list
+#   python tools/param_tool.py --address AA:BB:CC:DD:EE:FF set alpha 0.3
+#   python tools/param_tool.py --address AA:BB:CC:DD:EE:FF save
+#
+# the bot only accepts connections while it is advertising, so a command may
+# need a couple of seconds to connect.
+
+import argparse
+import asyncio
+import re
+import struct
+from pathlib import Path
+
+from bleak import BleakClient
+
+COMMAND_UUID = "6b1e0001-4c3a-4e5b-9c1d-2f7a8b9c0d1e"
+VALUE_UUID = "6b1e0002-4c3a-4e5b-9c1d-2f7a8b9c0d1e"
+
+CMD_SELECT = 0
+CMD_SET = 1
+CMD_SAVE = 2
+CMD_RESET = 3
+
+TYPE_FLOAT = 0
+TYPE_INT = 1
+
+DEFAULT_TABLE = Path(__file__).resolve().parent.parent / "src" / "Params.def"
+
+
+def load_params(path):
+    # the parameter ids are the position of each PARAM entry in the table
+    pattern = re.compile(r"^\s*PARAM\(\s*(\w+)\s*,\s*(\w+)\s*,")
+    params = []
+    for line in Path(path).read_text().splitlines():
+        match = pattern.match(line)
+        if match:
+            params.append((match.group(1), TYPE_INT if match.group(2) == "int32_t" else TYPE_FLOAT))
+    return params
+
+
+def decode_value(data):
+    param_id, param_type = data[0], data[1]
+    fmt = "<i" if param_type == TYPE_INT else "<f"
+    value = struct.unpack_from(fmt, data, 2)[0]
+    ok = data[6] == 1
+    return param_id, value, ok
+
+
+async def command(client, op, param_id=0, payload=b""):
+    await client.write_gatt_char(COMMAND_UUID, bytes([op, param_id]) + payload, response=True)
+    return decode_value(await client.read_gatt_char(VALUE_UUID))
+
+
+async def run(args, params):
+    names = [name for name, _ in params]
+    async with BleakClient(args.address, timeout=args.timeout) as client:
+        if args.action == "list":
+            for i, name in enumerate(names):
+                _, value, _ = await command(client, CMD_SELECT, i)
+                print(f"{name:<18} {value:g}")
+        elif args.action == "get":
+            _, value, _ = await command(client, CMD_SELECT, names.index(args.name))
+            print(f"{args.name} = {value:g}")
+        elif args.action == "set":
+            param_id = names.index(args.name)
+            if params[param_id][1] == TYPE_INT:
+                payload = struct.pack("<i", int(round(float(args.value))))
+            else:
+                payload = struct.pack("<f", float(args.value))
+            _, value, ok = await command(client, CMD_SET, param_id, payload)
+            print(f"{args.name} = {value:g}" if ok else f"{args.name}: value out of range")
+        elif args.action == "save":
+            _, _, ok = await command(client, CMD_SAVE)
+            print("saved" if ok else "saving failed")
+        elif args.action == "reset":
+            await command(client, CMD_RESET)
+            print("reset to defaults (not saved)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Bristle bot runtime parameter tool")
+    parser.add_argument("--address", required=True, help="BLE address of the bot")
+    parser.add_argument("--timeout", type=float, default=10.0)
+    parser.add_argument("--table", default=DEFAULT_TABLE, help="path to Params.def")
+    parser.add_argument("action", choices=["list", "get", "set", "save", "reset"])
+    parser.add_argument("name", nargs="?")
+    parser.add_argument("value", nargs="?")
+    args = parser.parse_args()
+
+    params = load_params(args.table)
+    if args.action in ("get", "set") and args.name not in [name for name, _ in params]:
+        parser.error(f"unknown parameter {args.name}")
+    if args.action == "set" and args.value is None:
+        parser.error("set needs a value")
+
+    asyncio.run(run(args, params))
+
+
+if __name__ == "__main__":
+    main()
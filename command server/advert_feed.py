@@ -0,0 +1,149 @@
+# simulated advert feed for the multi adapter ingestion (ingest.py): bots advertising
+# among several bluetooth adapters, each adapter hearing the bots in its range up to what
+# it can take, and the reports written out in the order the server would get them.
+# the feed replays through main.py --replay or through the merger here:
+#
+#   python3 advert_feed.py simulate --bots 300 --adapters 3 --out feed.jsonl
+#   python3 advert_feed.py evaluate feed.jsonl
+#
+# each line is an adapter's report of one advert (see ingest.read_feed), with the
+# number of the advert it came from in "advert" for evaluate to check the merging
+# against. evaluate prints how many adverts got through with the first adapter only,
+# the first two and so on, and whether the merger passed on each advert exactly once.
+
+import argparse
+import collections
+import heapq
+import json
+import math
+import random
+import statistics
+import time
+
+import ingest
+
+RSSI_AT_1M = -65.37
+PATH_LOSS = 2.68
+SENSITIVITY = -95.0
+ADVERT_SECONDS = 0.1       # a bot's advertising interval (BluetoothManager)
+ADVERT_DELAY = 0.01        # random delay the controller adds to every advert
+BOT_NAME = "BristleBot"
+
+def telemetry(bot, rng):
+    # the 0xFFFF frame as the bot advertises it: x, y, rotation, battery, sound
+    return bytes([bot["x"], bot["y"], bot["rotation"], bot["battery"], rng.randrange(256)])
+
+def simulate(args):
+    rng = random.Random(args.seed)
+    half = args.arena / 2
+    # adapters evenly along the middle of the arena, each covering its part
+    adapters = [(-half + args.arena * (a + 0.5) / args.adapters, 0.0) for a in range(args.adapters)]
+    bots = []
+    for i in range(args.bots):
+        bots.append({"address": f"AA:BB:CC:00:{i >> 8:02X}:{i & 0xFF:02X}",
+                     "px": rng.uniform(-half, half), "py": rng.uniform(-half, half),
+                     "x": rng.randrange(256), "y": rng.randrange(256), "rotation": rng.randrange(256),
+                     "battery": rng.randrange(50, 101), "next": rng.uniform(0, ADVERT_SECONDS), "payload": None,
+                     "payload_until": 0.0})
+
+    reports = []
+    sent = 0
+    # each adapter takes up to capacity reports a second, as a bucket one second deep
+    buckets = [args.capacity] * args.adapters
+    last = 0.0
+    heap = [(bot["next"], i) for i, bot in enumerate(bots)]
+    heapq.heapify(heap)
+    while heap:
+        t, i = heapq.heappop(heap)
+        if t > args.seconds:
+            break
+        bot = bots[i]
+        for a in range(args.adapters):
+            buckets[a] = min(buckets[a] + (t - last) * args.capacity, args.capacity)
+        last = t
+        if t >= bot["payload_until"]:
+            # the telemetry moves on every so often, the adverts in between repeat it
+            bot["payload"] = telemetry(bot, rng)
+            bot["payload_until"] = t + rng.expovariate(1.0 / args.payload_seconds)
+        for a, (ax, ay) in enumerate(adapters):
+            d = max(math.hypot(bot["px"] - ax, bot["py"] - ay), 0.1)
+            rssi = round(RSSI_AT_1M - 10 * PATH_LOSS * math.log10(d) + rng.gauss(0, args.noise))
+            if rssi < SENSITIVITY or rng.random() > args.reception or buckets[a] < 1:
+                continue
+            buckets[a] -= 1
+            # the host gets it after a delay of its own on every adapter
+            reports.append({"t": round(t + rng.uniform(0, args.host_delay), 4), "adapter": f"hci{a}",
+                            "address": bot["address"], "name": BOT_NAME, "rssi": rssi,
+                            "manufacturer_data": {"65535": bot["payload"].hex()}, "advert": sent})
+        sent += 1
+        heapq.heappush(heap, (t + ADVERT_SECONDS + rng.uniform(0, ADVERT_DELAY), i))
+
+    reports.sort(key=lambda report: report["t"])
+    with open(args.out, "w") as out:
+        for report in reports:
+            out.write(json.dumps(report) + "\n")
+    heard = len({report["advert"] for report in reports})
+    print(f"{args.bots} bots, {args.adapters} adapters, {args.seconds:g} s: {sent} adverts sent, {heard} heard,"
+          f" {len(reports)} reports written to {args.out}")
+
+def evaluate(args):
+    records = list(ingest.read_feed(args.feed))
+    adapters = sorted({record["adapter"] for record in records})
+    bots = {record["address"] for record in records}
+    seconds = max(record["t"] for record in records) - min(record["t"] for record in records)
+
+    print(f"{len(records)} reports of {len(bots)} bots from {len(adapters)} adapters over {seconds:.0f} s,"
+          f" dedup window {args.window * 1000:g} ms")
+    print("adapters   adverts/bot/s   passed on   copies dropped   adverts twice   adverts lost   ms/report")
+    for count in range(1, len(adapters) + 1):
+        used = set(adapters[:count])
+        passed = collections.Counter()
+        merger = ingest.AdvertMerger(lambda *report: None, args.window)
+        feed = [record for record in records if record["adapter"] in used]
+        start = time.perf_counter()
+        for record in feed:
+            if merger.report(record["adapter"], record["address"], record["name"], record["rssi"],
+                             record["manufacturer_data"], record["t"]):
+                passed[record["advert"]] += 1
+        elapsed = time.perf_counter() - start
+        heard = {record["advert"] for record in feed}
+        twice = sum(1 for times in passed.values() if times > 1)
+        lost = len(heard - set(passed))
+        print(f"{count:8d}   {len(heard) / len(bots) / seconds:13.2f}   {merger.stats['forwarded']:9d}"
+              f"   {merger.stats['duplicates']:14d}   {twice:13d}   {lost:12d}   {elapsed * 1000 / max(len(feed), 1):9.4f}")
+
+    # what each adapter makes of the bots, from the rssi the merger keeps
+    merger = ingest.AdvertMerger(lambda *report: None, args.window)
+    for record in records:
+        merger.report(record["adapter"], record["address"], record["name"], record["rssi"],
+                      record["manufacturer_data"], record["t"])
+    best = collections.Counter(max(rssi, key=rssi.get) for rssi in merger.adapter_rssi.values())
+    print("strongest adapter per bot: " + ", ".join(f"{adapter} {best[adapter]}" for adapter in adapters))
+    print(f"adapters hearing each bot: {statistics.mean(len(rssi) for rssi in merger.adapter_rssi.values()):.2f}")
+
+def main():
+    parser = argparse.ArgumentParser(description="Simulated multi adapter advert feed")
+    commands = parser.add_subparsers(dest="command", required=True)
+    sim = commands.add_parser("simulate", help="Write a simulated feed")
+    sim.add_argument("--bots", type=int, default=300)
+    sim.add_argument("--adapters", type=int, default=3)
+    sim.add_argument("--arena", type=float, default=30.0, help="Side of the square arena (m)")
+    sim.add_argument("--seconds", type=float, default=30.0)
+    sim.add_argument("--capacity", type=float, default=1000.0, help="Reports an adapter takes per second")
+    sim.add_argument("--reception", type=float, default=0.7, help="Share of the adverts in range an adapter hears")
+    sim.add_argument("--noise", type=float, default=4.0, help="Spread of the rssi (dB)")
+    sim.add_argument("--host-delay", type=float, default=0.02, help="Longest delay from an adapter to the server (s)")
+    sim.add_argument("--payload-seconds", type=float, default=0.5, help="Mean time the telemetry stays the same (s)")
+    sim.add_argument("--seed", type=int, default=1)
+    sim.add_argument("--out", type=str, default="feed.jsonl")
+    ev = commands.add_parser("evaluate", help="Run a feed through the merger")
+    ev.add_argument("feed", type=str)
+    ev.add_argument("--window", type=float, default=0.05, help="Dedup window (s)")
+    args = parser.parse_args()
+    if args.command == "simulate":
+        simulate(args)
+    else:
+        evaluate(args)
+
+if __name__ == "__main__":
+    main()
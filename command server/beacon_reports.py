@@ -0,0 +1,28 @@
+# rssi reports from the beacons' scanners (beacon/scanner.py), one udp datagram per
+# beacon and report window. the format is in frames.py
+
+import asyncio
+
+from loguru import logger
+
+from frames import decode_report
+
+DEFAULT_PORT = 8001
+
+class BeaconReportProtocol(asyncio.DatagramProtocol):
+    # hands every bot in a report to handler(beacon id, bot address, rssi, std, samples)
+    def __init__(self, handler):
+        self.handler = handler
+        self.reports = 0
+        self.malformed = 0
+
+    def datagram_received(self, data, address):
+        report = decode_report(data)
+        if report is None:
+            self.malformed += 1
+            logger.debug("Malformed beacon report from {}", address)
+            return
+        self.reports += 1
+        beacon_id, bots = report
+        for bot, rssi, std, samples in bots:
+            self.handler(beacon_id, bot, rssi, std, samples)
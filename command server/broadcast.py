@@ -0,0 +1,249 @@
+# the bot registry as pushed to the websocket clients. a publisher builds one frame per
+# change, encodes it once per format whatever the number of clients, and every client
+# gets the same bytes. a frame carries only the bots that changed since the last one
+# (a delta) or all of them (a snapshot): a client gets a snapshot when it connects, when
+# it falls too far behind to catch up frame by frame, and every keyframe interval.
+#
+# frames go out as soon as an advert changes a bot, but no closer together than the
+# minimum interval, so a burst of adverts becomes one frame.
+#
+# json (the default): {"type": "snapshot" or "delta", "seq", "timestamp", "robots":
+# [{"id", "position": {"x", "y"}, "rotation", "battery", "sound", "rssi", "connected",
+# "ground_position": {"x", "y"} if there is a fix}], "removed": [ids]}
+#
+# binary (?format=binary): type (0 snapshot, 1 delta): 1 byte, seq: 4 bytes, timestamp:
+# 8 bytes (double), robot count: 2 bytes, removed count: 2 bytes, then per robot its id,
+# x, y, rotation, battery, sound: 1 byte each, rssi: 1 byte (signed), flags (1 connected,
+# 2 ground position): 1 byte, ground x and y in cm: 2 bytes each (signed), then the
+# removed ids. an id is a length byte and that many bytes of utf-8, or 0 and the 6 bytes
+# of a bluetooth address. little endian
+
+import asyncio
+import collections
+import json
+import struct
+import time
+from urllib.parse import parse_qs, urlparse
+
+import websockets
+from loguru import logger
+
+SNAPSHOT = "snapshot"
+DELTA = "delta"
+FORMATS = ("json", "binary")
+
+HEADER = struct.Struct("<BIdHH")
+ROBOT = struct.Struct("<BBBBBbBhh")
+FLAG_CONNECTED = 0x01
+FLAG_GROUND = 0x02
+
+def encode_id(bot_id):
+    parts = bot_id.split(":")
+    if len(parts) == 6 and all(len(part) == 2 for part in parts):
+        try:
+            return b"\x00" + bytes.fromhex("".join(parts))
+        except ValueError:
+            pass
+    raw = bot_id.encode()[:255]
+    return bytes([len(raw)]) + raw
+
+def decode_id(data, offset):
+    # (id, offset after it)
+    length = data[offset]
+    if length == 0:
+        return data[offset + 1:offset + 7].hex(":").upper(), offset + 7
+    return data[offset + 1:offset + 1 + length].decode(), offset + 1 + length
+
+def encode_binary(kind, seq, timestamp, robots, removed):
+    parts = [HEADER.pack(0 if kind == SNAPSHOT else 1, seq & 0xFFFFFFFF, timestamp, len(robots), len(removed))]
+    for robot in robots:
+        ground = robot.get("ground_position")
+        flags = (FLAG_CONNECTED if robot["connected"] else 0) | (FLAG_GROUND if ground else 0)
+        parts.append(encode_id(robot["id"]))
+        parts.append(ROBOT.pack(robot["position"]["x"], robot["position"]["y"], robot["rotation"], robot["battery"],
+                                robot["sound"], max(min(robot["rssi"], 127), -128), flags,
+                                round(ground["x"] * 100) if ground else 0, round(ground["y"] * 100) if ground else 0))
+    for bot_id in removed:
+        parts.append(encode_id(bot_id))
+    return b"".join(parts)
+
+def decode_binary(data):
+    # a binary frame back into the json layout, for clients and tests in python
+    kind, seq, timestamp, count, removed_count = HEADER.unpack_from(data)
+    offset = HEADER.size
+    robots = []
+    for _ in range(count):
+        bot_id, offset = decode_id(data, offset)
+        x, y, rotation, battery, sound, rssi, flags, ground_x, ground_y = ROBOT.unpack_from(data, offset)
+        offset += ROBOT.size
+        robot = {"id": bot_id, "position": {"x": x, "y": y}, "rotation": rotation, "battery": battery,
+                 "sound": sound, "rssi": rssi, "connected": bool(flags & FLAG_CONNECTED)}
+        if flags & FLAG_GROUND:
+            robot["ground_position"] = {"x": ground_x / 100.0, "y": ground_y / 100.0}
+        robots.append(robot)
+    removed = []
+    for _ in range(removed_count):
+        bot_id, offset = decode_id(data, offset)
+        removed.append(bot_id)
+    return {"type": SNAPSHOT if kind == 0 else DELTA, "seq": seq, "timestamp": timestamp, "robots": robots,
+            "removed": removed}
+
+class Frame:
+    # one frame, encoded the first time a client wants it in a format and shared after that
+    def __init__(self, kind, seq, robots, removed):
+        self.kind = kind
+        self.seq = seq
+        self.timestamp = time.time()
+        self.robots = robots
+        self.removed = removed
+        self.encoded = {}
+
+    def encode(self, format, stats):
+        data = self.encoded.get(format)
+        if data is None:
+            start = time.perf_counter()
+            if format == "binary":
+                data = encode_binary(self.kind, self.seq, self.timestamp, self.robots, self.removed)
+            else:
+                data = json.dumps({"type": self.kind, "seq": self.seq, "timestamp": self.timestamp,
+                                   "robots": self.robots, "removed": self.removed}, separators=(",", ":"))
+            stats["encode_seconds"] += time.perf_counter() - start
+            stats["encodes"] += 1
+            self.encoded[format] = data
+        return data
+
+class Subscriber:
+    def __init__(self, connection, format):
+        self.connection = connection
+        self.format = format
+        self.queue = collections.deque()
+        self.ready = asyncio.Event()
+        # wants a snapshot before anything else in the queue
+        self.resync = True
+
+class Broadcaster:
+    def __init__(self, state_of, min_interval=0.05, keyframe_interval=5.0, max_queued=8):
+        # state_of(bot id) is the bot's robot entry as a dict, None once it is gone
+        self.state_of = state_of
+        self.min_interval = min_interval
+        self.keyframe_interval = keyframe_interval
+        self.max_queued = max_queued
+        # bot id -> when it first changed since the last frame
+        self.dirty = {}
+        self.gone = set()
+        # bot id -> its entry as of the last frame, what a snapshot is built from
+        self.published = {}
+        self.seq = 0
+        self.subscribers = set()
+        self.wake = asyncio.Event()
+        self.snapshot_frame = None
+        # seconds from a bot changing to its frame, per frame since the last read
+        self.lags = []
+        self.stats = {"frames": 0, "snapshots": 0, "encodes": 0, "encode_seconds": 0.0, "resyncs": 0}
+
+    def changed(self, bot_id):
+        self.dirty.setdefault(bot_id, time.time())
+        self.wake.set()
+
+    def removed(self, bot_id):
+        self.dirty.pop(bot_id, None)
+        self.gone.add(bot_id)
+        self.wake.set()
+
+    def publish(self):
+        # the delta since the last frame to every client, None if nothing changed
+        robots, removed = [], []
+        oldest = None
+        for bot_id, since in self.dirty.items():
+            state = self.state_of(bot_id)
+            if state is None:
+                self.gone.add(bot_id)
+                continue
+            if state != self.published.get(bot_id):
+                self.published[bot_id] = state
+                robots.append(state)
+                oldest = since if oldest is None else min(oldest, since)
+        for bot_id in self.gone:
+            if self.published.pop(bot_id, None) is not None:
+                removed.append(bot_id)
+        self.dirty.clear()
+        self.gone.clear()
+        if not robots and not removed:
+            return None
+
+        self.seq += 1
+        frame = Frame(DELTA, self.seq, robots, removed)
+        if oldest is not None:
+            self.lags.append(frame.timestamp - oldest)
+        self.stats["frames"] += 1
+        for subscriber in self.subscribers:
+            if subscriber.resync:
+                continue
+            subscriber.queue.append(frame)
+            if len(subscriber.queue) > self.max_queued:
+                # too far behind, a snapshot catches it up in one frame
+                subscriber.queue.clear()
+                subscriber.resync = True
+                self.stats["resyncs"] += 1
+            subscriber.ready.set()
+        return frame
+
+    def snapshot(self):
+        # every bot as of the last frame, shared by every client that wants one before the next
+        if self.snapshot_frame is None or self.snapshot_frame.seq != self.seq:
+            self.snapshot_frame = Frame(SNAPSHOT, self.seq, list(self.published.values()), [])
+            self.stats["snapshots"] += 1
+        return self.snapshot_frame
+
+    def keyframe(self):
+        for subscriber in self.subscribers:
+            subscriber.queue.clear()
+            subscriber.resync = True
+            subscriber.ready.set()
+
+    async def run(self):
+        logger.debug("Starting broadcast loop")
+        last_frame = 0.0
+        next_keyframe = time.monotonic() + self.keyframe_interval
+        while True:
+            try:
+                await asyncio.wait_for(self.wake.wait(), max(next_keyframe - time.monotonic(), 0.0))
+            except asyncio.TimeoutError:
+                pass
+            # adverts that come in while this waits go in the same frame
+            wait = last_frame + self.min_interval - time.monotonic()
+            if wait > 0:
+                await asyncio.sleep(wait)
+            self.wake.clear()
+            if self.publish() is not None:
+                last_frame = time.monotonic()
+            if time.monotonic() >= next_keyframe:
+                self.keyframe()
+                next_keyframe = time.monotonic() + self.keyframe_interval
+
+    async def serve(self, connection):
+        # the websocket handler, one per client
+        query = parse_qs(urlparse(connection.request.path).query)
+        format = query.get("format", ["json"])[0]
+        if format not in FORMATS:
+            format = "json"
+        subscriber = Subscriber(connection, format)
+        subscriber.ready.set()
+        self.subscribers.add(subscriber)
+        logger.info("Got connection to server! ({} clients, {})", len(self.subscribers), format)
+        try:
+            while True:
+                await subscriber.ready.wait()
+                subscriber.ready.clear()
+                if subscriber.resync:
+                    # anything queued is in the snapshot already
+                    subscriber.resync = False
+                    subscriber.queue.clear()
+                    await connection.send(self.snapshot().encode(format, self.stats))
+                while subscriber.queue and not subscriber.resync:
+                    await connection.send(subscriber.queue.popleft().encode(format, self.stats))
+        except websockets.exceptions.ConnectionClosed:
+            pass
+        finally:
+            self.subscribers.discard(subscriber)
+            logger.info("Connection closed ({} clients)", len(self.subscribers))
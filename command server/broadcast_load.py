@@ -0,0 +1,186 @@
+# load generator for the websocket push (broadcast.py): simulated bots advertising into
+# a real Broadcaster on a local websocket server, and clients in a second process counting
+# what they get. runs the old per-client loop (every bot as json once a second per
+# client) and the broadcaster in json and binary for comparison.
+#
+#   python3 broadcast_load.py --bots 500 --clients 20 --seconds 10
+#
+# prints frames and bytes per client per second, the server's cpu, how long from the
+# oldest advert in a frame to the frame going out and from a frame going out to a client
+# reading it, and any client that saw a delta out of order.
+
+import argparse
+import asyncio
+import json
+import multiprocessing
+import random
+import statistics
+import sys
+import time
+
+from websockets.asyncio.client import connect
+from websockets.asyncio.server import serve
+import websockets
+from loguru import logger
+
+import broadcast
+
+class SimBot:
+    def __init__(self, index, rng):
+        self.id = f"AA:BB:CC:00:{index >> 8:02X}:{index & 0xFF:02X}"
+        self.x = rng.randrange(256)
+        self.y = rng.randrange(256)
+        self.rotation = rng.randrange(256)
+        self.battery = rng.randrange(50, 101)
+        self.sound = 0
+        self.rssi = -60
+        self.connected = True
+
+    def advert(self, rng):
+        # a slow walk, the rssi wanders every advert and the rest changes now and again
+        if rng.random() < 0.3:
+            self.x = min(max(self.x + rng.choice((-1, 1)), 0), 255)
+            self.y = min(max(self.y + rng.choice((-1, 1)), 0), 255)
+            self.rotation = (self.rotation + rng.randrange(-3, 4)) % 256
+        self.sound = rng.randrange(10)
+        self.rssi = -60 + rng.randrange(-4, 5)
+
+    def state(self):
+        return {"id": self.id, "position": {"x": self.x, "y": self.y}, "rotation": self.rotation,
+                "battery": self.battery, "sound": self.sound, "rssi": self.rssi, "connected": self.connected}
+
+async def advertise(bots, rate, on_advert):
+    # every bot advertises at rate per second on average, at random times like the radio
+    rng = random.Random(2)
+    interval = 1.0 / (rate * len(bots))
+    next_advert = time.monotonic()
+    while True:
+        next_advert += rng.expovariate(1.0) * interval
+        delay = next_advert - time.monotonic()
+        if delay > 0:
+            await asyncio.sleep(delay)
+        bot = rng.choice(bots)
+        bot.advert(rng)
+        on_advert(bot.id)
+
+async def legacy_handler(websocket, bots):
+    # what the command server did before broadcast.py
+    try:
+        while True:
+            json_output = f"{{ \"timestamp\": {time.time()}, \"robots\": ["
+            for bot in bots.values():
+                json_output += f"{{\"id\": \"{bot.id}\","
+                json_output += f"\"position\": {{\"x\": {bot.x}, \"y\": {bot.y}}},"
+                json_output += "},"
+            json_output += "]}"
+            await websocket.send(json_output)
+            await asyncio.sleep(1)
+    except websockets.exceptions.ConnectionClosed:
+        pass
+
+async def run_clients(port, count, format, seconds):
+    received = {"frames": 0, "bytes": 0, "latencies": [], "out_of_order": 0}
+
+    async def client():
+        async with connect(f"ws://localhost:{port}/?format={format}", max_size=None, compression=None) as websocket:
+            seq = None
+            end = time.monotonic() + seconds
+            while time.monotonic() < end:
+                try:
+                    data = await asyncio.wait_for(websocket.recv(), end - time.monotonic())
+                except asyncio.TimeoutError:
+                    break
+                now = time.time()
+                if isinstance(data, bytes):
+                    kind, frame_seq, timestamp, _, _ = broadcast.HEADER.unpack_from(data)
+                    kind = broadcast.SNAPSHOT if kind == 0 else broadcast.DELTA
+                else:
+                    # the old frames are not strict json, the timestamp is at the front
+                    if format == "legacy":
+                        kind, frame_seq = None, None
+                        timestamp = float(data.split(",", 1)[0].split(":", 1)[1])
+                    else:
+                        # only the head, decoding every frame in full would load the machine more than the server
+                        head = json.loads(data[:data.index(',"robots"')] + "}")
+                        kind, frame_seq, timestamp = head["type"], head["seq"], head["timestamp"]
+                # a delta has to follow the frame before it, a snapshot can start anywhere
+                if kind == broadcast.DELTA and seq is not None and frame_seq != seq + 1:
+                    received["out_of_order"] += 1
+                seq = frame_seq
+                received["frames"] += 1
+                received["bytes"] += len(data)
+                received["latencies"].append(now - timestamp)
+
+    await asyncio.gather(*(client() for _ in range(count)))
+    return received
+
+def client_process(port, count, format, seconds, results):
+    results.put(asyncio.run(run_clients(port, count, format, seconds)))
+
+async def run_server(args, format, results):
+    rng = random.Random(1)
+    bots = {bot.id: bot for bot in (SimBot(i, rng) for i in range(args.bots))}
+    broadcaster = broadcast.Broadcaster(lambda bot_id: bots[bot_id].state() if bot_id in bots else None,
+                                        args.push_interval, args.keyframe_interval)
+    for bot_id in bots:
+        broadcaster.changed(bot_id)
+
+    if format == "legacy":
+        handler = lambda websocket: legacy_handler(websocket, bots)
+        tasks = [asyncio.create_task(advertise(list(bots.values()), args.advert_hz, lambda bot_id: None))]
+    else:
+        handler = broadcaster.serve
+        tasks = [asyncio.create_task(broadcaster.run()),
+                 asyncio.create_task(advertise(list(bots.values()), args.advert_hz, broadcaster.changed))]
+
+    async with serve(handler, "localhost", 0, compression=None) as server:
+        port = server.sockets[0].getsockname()[1]
+        clients = multiprocessing.Process(target=client_process,
+                                          args=(port, args.clients, format, args.seconds, results))
+        clients.start()
+        # once the clients are in, so the cpu is only the steady state
+        await asyncio.sleep(1.0)
+        broadcaster.lags.clear()
+        cpu, wall = time.process_time(), time.monotonic()
+        received = await asyncio.get_running_loop().run_in_executor(None, results.get)
+        cpu, wall = time.process_time() - cpu, time.monotonic() - wall
+        clients.join()
+    for task in tasks:
+        task.cancel()
+    return received, cpu / wall, broadcaster
+
+def percentile(values, share):
+    values = sorted(values)
+    return values[min(int(len(values) * share), len(values) - 1)] if values else 0.0
+
+def main():
+    parser = argparse.ArgumentParser(description="Websocket push load generator")
+    parser.add_argument("--bots", type=int, default=500)
+    parser.add_argument("--clients", type=int, default=20)
+    parser.add_argument("--seconds", type=float, default=10.0)
+    parser.add_argument("--advert-hz", type=float, default=5.0, help="Adverts per bot per second")
+    parser.add_argument("--push-interval", type=float, default=0.05)
+    parser.add_argument("--keyframe-interval", type=float, default=5.0)
+    parser.add_argument("--formats", type=str, default="legacy,json,binary")
+    args = parser.parse_args()
+    logger.remove()
+    logger.add(sys.stderr, level="WARNING")
+
+    print(f"{args.bots} bots advertising at {args.advert_hz:g} Hz, {args.clients} clients, {args.seconds:g} s")
+    print("format     frames/s  kB/s/client  server cpu  encodes/s  advert->out ms (mean/p99)  out->client ms (mean/p99)"
+          "  out of order")
+    for format in args.formats.split(","):
+        results = multiprocessing.Queue()
+        received, cpu, broadcaster = asyncio.run(run_server(args, format, results))
+        per_client = args.clients * args.seconds
+        latencies = [latency * 1000.0 for latency in received["latencies"]]
+        lags = [lag * 1000.0 for lag in broadcaster.lags]
+        advert = (f"{statistics.mean(lags):8.1f} / {percentile(lags, 0.99):6.1f}" if lags and format != "legacy"
+                  else f"{'~500 / 1000':>17}")
+        print(f"{format:<8} {received['frames'] / per_client:9.1f} {received['bytes'] / per_client / 1000:12.1f}"
+              f" {cpu * 100:10.0f}% {broadcaster.stats['encodes'] / args.seconds:10.1f}"
+              f"          {advert}          {statistics.mean(latencies):8.1f} / {percentile(latencies, 0.99):6.1f}"
+              f"  {received['out_of_order']:12d}")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,34 @@
+#include "BatchLocaliser.h"
+
+// plain C entry points into the batch localiser, loaded with ctypes by
+// ground_localiser.py in the command server
+extern "C"
+{
+
+    void bl_defaults(BatchLocaliser::Settings *settings)
+    {
+        *settings = BatchLocaliser::defaults();
+    }
+
+    void bl_init(int capacity, const BatchLocaliser::Settings *settings)
+    {
+        BatchLocaliser::init(capacity, *settings);
+    }
+
+    void bl_forget(int slot)
+    {
+        BatchLocaliser::forget(slot);
+    }
+
+    void bl_solve(int count, const int32_t *slots, const BatchLocaliser::Observation *observations, double now,
+                  BatchLocaliser::Fix *fixes)
+    {
+        BatchLocaliser::solve(count, slots, observations, now, fixes);
+    }
+
+    int bl_max_beacons()
+    {
+        return BatchLocaliser::MAX_BEACONS;
+    }
+
+}
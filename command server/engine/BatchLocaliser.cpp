@@ -0,0 +1,271 @@
+#include "BatchLocaliser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace BatchLocaliser
+{
+
+    // closest a bot is taken to be to a beacon (m^2), the model has no answer at 0
+    static const float MIN_RANGE2 = 0.01f;
+    // longest Levenberg-Marquardt step (m)
+    static const float MAX_STEP = 1.0f;
+    // pull towards the first guess (1/m^2), only there so the normal equations always have an answer
+    static const float REGULARISATION = 1e-3f;
+    static const float LAMBDA_START = 1e-2f, LAMBDA_MIN = 1e-6f, LAMBDA_MAX = 1e6f;
+
+    struct History
+    {
+        float x, y, varX, covXY, varY;
+        double time;
+        bool valid;
+    };
+
+    static Settings settings;
+    static std::vector<History> history;
+
+    // the batch, beacon major: entry k * count + i is bot i's k-th beacon
+    static std::vector<float> beaconX, beaconY, rssiAt1m, slope, rssi, weight;
+    // per bot: position, prior, normal equations, cost, damping
+    static std::vector<float> posX, posY, candX, candY, priorX, priorY, infoXX, infoXY, infoYY;
+    static std::vector<float> hXX, hXY, hYY, gX, gY, cost, candCost, lambda;
+    static std::vector<int32_t> beaconCount;
+
+    Settings defaults()
+    {
+        Settings defaults;
+        defaults.shadowingDb = 4.0f;
+        defaults.minStdDb = 1.0f;
+        defaults.diffusion = 0.05f;
+        defaults.historySeconds = 30.0f;
+        defaults.iterations = 20;
+        return defaults;
+    }
+
+    void init(int capacity, const Settings &newSettings)
+    {
+        settings = newSettings;
+        history.assign(capacity, History{0, 0, 0, 0, 0, 0.0, false});
+    }
+
+    void forget(int slot)
+    {
+        if (slot >= 0 && slot < (int)history.size())
+            history[slot].valid = false;
+    }
+
+    static void resize(int count)
+    {
+        for (std::vector<float> *batch : {&beaconX, &beaconY, &rssiAt1m, &slope, &rssi, &weight})
+            batch->resize((size_t)count * MAX_BEACONS);
+        for (std::vector<float> *bots : {&posX, &posY, &candX, &candY, &priorX, &priorY, &infoXX, &infoXY, &infoYY,
+                                         &hXX, &hXY, &hYY, &gX, &gY, &cost, &candCost, &lambda})
+            bots->resize(count);
+        beaconCount.resize(count);
+    }
+
+    // the residual passes take one beacon of every bot at a time, with restrict pointers
+    // as arguments so the loops over the bots vectorise
+
+    static void addCost(int count, const float *__restrict x, const float *__restrict y, const float *__restrict bX,
+                        const float *__restrict bY, const float *__restrict at1m, const float *__restrict bSlope,
+                        const float *__restrict bRSSI, const float *__restrict bWeight, float *__restrict out)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            float dx = x[i] - bX[i], dy = y[i] - bY[i];
+            float range2 = std::max(dx * dx + dy * dy, MIN_RANGE2);
+            float err = bRSSI[i] - (at1m[i] - bSlope[i] * std::log(range2));
+            out[i] += bWeight[i] * err * err;
+        }
+    }
+
+    static void addNormal(int count, const float *__restrict x, const float *__restrict y, const float *__restrict bX,
+                          const float *__restrict bY, const float *__restrict at1m, const float *__restrict bSlope,
+                          const float *__restrict bRSSI, const float *__restrict bWeight, float *__restrict xx,
+                          float *__restrict xy, float *__restrict yy, float *__restrict gx, float *__restrict gy)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            float dx = x[i] - bX[i], dy = y[i] - bY[i];
+            float range2 = std::max(dx * dx + dy * dy, MIN_RANGE2);
+            float err = bRSSI[i] - (at1m[i] - bSlope[i] * std::log(range2));
+            // derivative of the residual, the predicted rssi falls with distance
+            float scale = 2.0f * bSlope[i] / range2;
+            float jX = scale * dx, jY = scale * dy;
+            float w = bWeight[i];
+            xx[i] += w * jX * jX;
+            xy[i] += w * jX * jY;
+            yy[i] += w * jY * jY;
+            gx[i] += w * err * jX;
+            gy[i] += w * err * jY;
+        }
+    }
+
+    // weighted sum of squared rssi residuals plus the prior, for every bot at (x, y)
+    static void evaluate(int count, const float *x, const float *y, float *out)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            float dx = x[i] - priorX[i], dy = y[i] - priorY[i];
+            out[i] = infoXX[i] * dx * dx + 2.0f * infoXY[i] * dx * dy + infoYY[i] * dy * dy;
+        }
+        for (int k = 0; k < MAX_BEACONS; k++)
+        {
+            const size_t base = (size_t)k * count;
+            addCost(count, x, y, &beaconX[base], &beaconY[base], &rssiAt1m[base], &slope[base], &rssi[base],
+                    &weight[base], out);
+        }
+    }
+
+    // gradient and Gauss-Newton hessian of the cost at the current positions
+    static void normalEquations(int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            float dx = posX[i] - priorX[i], dy = posY[i] - priorY[i];
+            hXX[i] = infoXX[i];
+            hXY[i] = infoXY[i];
+            hYY[i] = infoYY[i];
+            gX[i] = infoXX[i] * dx + infoXY[i] * dy;
+            gY[i] = infoXY[i] * dx + infoYY[i] * dy;
+        }
+        for (int k = 0; k < MAX_BEACONS; k++)
+        {
+            const size_t base = (size_t)k * count;
+            addNormal(count, posX.data(), posY.data(), &beaconX[base], &beaconY[base], &rssiAt1m[base], &slope[base],
+                      &rssi[base], &weight[base], hXX.data(), hXY.data(), hYY.data(), gX.data(), gY.data());
+        }
+    }
+
+    // copies the batch in beacon major, works out the weights, the priors and the first guesses
+    static void prepare(int count, const int32_t *slots, const Observation *observations, double now)
+    {
+        const float floor2 = settings.minStdDb * settings.minStdDb;
+        const float shadowing2 = settings.shadowingDb * settings.shadowingDb;
+        for (int i = 0; i < count; i++)
+        {
+            float sumW = 0.0f, sumX = 0.0f, sumY = 0.0f;
+            int beacons = 0;
+            for (int k = 0; k < MAX_BEACONS; k++)
+            {
+                const Observation &o = observations[(size_t)i * MAX_BEACONS + k];
+                const size_t at = (size_t)k * count + i;
+                bool used = o.samples >= 1.0f;
+                beaconX[at] = o.beaconX;
+                beaconY[at] = o.beaconY;
+                rssiAt1m[at] = o.rssiAt1m;
+                slope[at] = 5.0f * o.pathLossExponent / (float)M_LN10;
+                rssi[at] = o.rssi;
+                // the mean is off by the shadowing plus its own sampling error
+                float std2 = std::max(o.rssiStd * o.rssiStd, floor2);
+                weight[at] = used ? 1.0f / (shadowing2 + std2 / o.samples) : 0.0f;
+                if (!used)
+                    continue;
+                beacons++;
+                // the first guess leans to the beacons that sound closest, by 1/d^2
+                float w = std::pow(10.0f, (o.rssi - o.rssiAt1m) / (5.0f * o.pathLossExponent));
+                sumW += w;
+                sumX += w * o.beaconX;
+                sumY += w * o.beaconY;
+            }
+            beaconCount[i] = beacons;
+            posX[i] = sumW > 0.0f ? sumX / sumW : 0.0f;
+            posY[i] = sumW > 0.0f ? sumY / sumW : 0.0f;
+            priorX[i] = posX[i];
+            priorY[i] = posY[i];
+            infoXX[i] = REGULARISATION;
+            infoXY[i] = 0.0f;
+            infoYY[i] = REGULARISATION;
+            lambda[i] = LAMBDA_START;
+
+            const History &h = history[slots[i]];
+            float age = (float)(now - h.time);
+            if (!h.valid || age > settings.historySeconds)
+                continue;
+            // the last fix spread out by how far the bot could have gone since, as an information matrix
+            float grown = settings.diffusion * std::max(age, 0.0f);
+            float a = h.varX + grown, b = h.covXY, c = h.varY + grown;
+            float det = a * c - b * b;
+            if (det <= 0.0f)
+                continue;
+            posX[i] = priorX[i] = h.x;
+            posY[i] = priorY[i] = h.y;
+            infoXX[i] = c / det + REGULARISATION;
+            infoXY[i] = -b / det;
+            infoYY[i] = a / det + REGULARISATION;
+        }
+    }
+
+    void solve(int count, const int32_t *slots, const Observation *observations, double now, Fix *fixes)
+    {
+        if (count <= 0)
+            return;
+        resize(count);
+        prepare(count, slots, observations, now);
+        evaluate(count, posX.data(), posY.data(), cost.data());
+
+        for (int iter = 0; iter < settings.iterations; iter++)
+        {
+            normalEquations(count);
+            for (int i = 0; i < count; i++)
+            {
+                // damped normal equations, solved in closed form
+                float a = hXX[i] * (1.0f + lambda[i]), b = hXY[i], c = hYY[i] * (1.0f + lambda[i]);
+                float det = a * c - b * b;
+                float inv = det > 0.0f ? 1.0f / det : 0.0f;
+                float stepX = -(c * gX[i] - b * gY[i]) * inv;
+                float stepY = -(a * gY[i] - b * gX[i]) * inv;
+                float length = std::sqrt(stepX * stepX + stepY * stepY);
+                float shrink = length > MAX_STEP ? MAX_STEP / length : 1.0f;
+                candX[i] = posX[i] + stepX * shrink;
+                candY[i] = posY[i] + stepY * shrink;
+            }
+            evaluate(count, candX.data(), candY.data(), candCost.data());
+            for (int i = 0; i < count; i++)
+            {
+                bool better = candCost[i] < cost[i];
+                posX[i] = better ? candX[i] : posX[i];
+                posY[i] = better ? candY[i] : posY[i];
+                cost[i] = better ? candCost[i] : cost[i];
+                lambda[i] = better ? std::max(lambda[i] * 0.3f, LAMBDA_MIN) : std::min(lambda[i] * 10.0f, LAMBDA_MAX);
+            }
+        }
+
+        // the covariance is the inverse of the hessian at the answer
+        normalEquations(count);
+        for (int i = 0; i < count; i++)
+        {
+            Fix &fix = fixes[i];
+            History &h = history[slots[i]];
+            bool prior = h.valid && now - h.time <= settings.historySeconds;
+            float det = hXX[i] * hYY[i] - hXY[i] * hXY[i];
+            fix.x = posX[i];
+            fix.y = posY[i];
+            fix.varX = det > 0.0f ? hYY[i] / det : 0.0f;
+            fix.covXY = det > 0.0f ? -hXY[i] / det : 0.0f;
+            fix.varY = det > 0.0f ? hXX[i] / det : 0.0f;
+            fix.beacons = beaconCount[i];
+            // three beacons pin a position down, with a recent fix fewer do
+            fix.valid = det > 0.0f && (beaconCount[i] >= 3 || (prior && beaconCount[i] >= 1));
+
+            float sum = 0.0f;
+            for (int k = 0; k < MAX_BEACONS; k++)
+            {
+                const size_t at = (size_t)k * count + i;
+                if (weight[at] == 0.0f)
+                    continue;
+                float dx = posX[i] - beaconX[at], dy = posY[i] - beaconY[at];
+                float range2 = std::max(dx * dx + dy * dy, MIN_RANGE2);
+                float err = rssi[at] - (rssiAt1m[at] - slope[at] * std::log(range2));
+                sum += err * err;
+            }
+            fix.residual = beaconCount[i] > 0 ? std::sqrt(sum / beaconCount[i]) : 0.0f;
+
+            if (fix.valid)
+                h = History{fix.x, fix.y, fix.varX, fix.covXY, fix.varY, now, true};
+        }
+    }
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+// ground station localisation: every bot's position worked out in one batch from the
+// per beacon rssi statistics the bots forward (FRAME_RSSI_STATS, Params localisationMode).
+//
+// each bot is a maximum likelihood fit of its position to the log-distance path loss
+// model, with the rssi residuals weighted by how sure their means are, solved with
+// Levenberg-Marquardt. the bot's last fix, spread out by how far it could have moved
+// since, is a prior on the position, so two beacons are enough once a bot has a fix.
+// the batch is laid out beacon major (all bots' first beacon, then all bots' second...)
+// so every pass over the bots is a flat loop the compiler vectorises.
+namespace BatchLocaliser
+{
+
+    // most beacons per bot in a batch
+    static const int MAX_BEACONS = 8;
+
+    struct Settings
+    {
+        float shadowingDb;  // standard deviation of the path loss model around a beacon's mean (dB)
+        float minStdDb;     // floor on a beacon's reported rssi standard deviation (dB)
+        float diffusion;    // how far a bot's position can drift, variance per second (m^2/s)
+        float historySeconds; // fixes older than this are not used as a prior
+        int32_t iterations; // Levenberg-Marquardt iterations per batch
+    };
+
+    // what a bot heard of one beacon, samples 0 for an unused entry
+    struct Observation
+    {
+        float beaconX, beaconY;   // beacon position (m)
+        float rssiAt1m;           // beacon calibration (dBm)
+        float pathLossExponent;
+        float rssi;               // mean rssi (dBm)
+        float rssiStd;            // standard deviation of the samples behind it (dB)
+        float samples;
+    };
+
+    struct Fix
+    {
+        float x, y;
+        float varX, covXY, varY; // covariance of the position (m^2)
+        float residual;          // rms rssi residual (dB)
+        int32_t beacons;         // beacons it is from
+        int32_t valid;           // 0 if there was too little to go on, the bot's history is unchanged
+    };
+
+    Settings defaults();
+
+    // room for slots 0..capacity-1, one per bot, and forgets every bot's history
+    void init(int capacity, const Settings &settings);
+    // forgets a bot's history, for a slot that is handed to a new bot
+    void forget(int slot);
+
+    // works out count bots' positions. observations has MAX_BEACONS entries per bot,
+    // bot by bot, and slots says which bot each one is. now is in seconds
+    void solve(int count, const int32_t *slots, const Observation *observations, double now, Fix *fixes);
+
+}
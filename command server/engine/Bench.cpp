@@ -0,0 +1,219 @@
+// per tick latency and accuracy of the batch localiser: a swarm of bots wandering an
+// arena of beacons, each forwarding what FRAME_RSSI_STATS would carry (its strongest
+// beacons' mean rssi, standard deviation and sample count, in the frame's resolution),
+// solved in one batch per tick.
+//
+//   ./build/bench --bots 1000 --ticks 200
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BatchLocaliser.h"
+
+namespace Bench
+{
+
+    struct Options
+    {
+        int bots = 1000;
+        int ticks = 200;
+        int beacons = 8;
+        float arena = 10.0f;      // side of the square arena (m)
+        float tickHz = 2.0f;
+        float shadowing = 4.0f;   // spread of a beacon's mean rssi at a bot (dB)
+        float sampleNoise = 2.0f; // spread of single samples around it (dB)
+        int window = 7;           // samples behind each mean, Params rssiWindow
+        int frameBeacons = 5;     // beacons in the frame, MAX_STATS_BEACONS in the firmware
+        uint32_t seed = 1;
+    };
+
+    static const float RSSI_AT_1M = -65.37f;
+    static const float PATH_LOSS = 2.68f;
+    static const float SENSITIVITY = -95.0f;
+    static const float BOT_SPEED = 0.1f; // m/s
+    // ticks left out of the latency figures while the caches warm up
+    static const int WARMUP_TICKS = 5;
+
+    struct Bot
+    {
+        float x, y, heading;
+    };
+
+    struct Result
+    {
+        std::vector<double> tickMicros;
+        double sumError2 = 0.0;
+        long fixes = 0, attempts = 0;
+    };
+
+    static void usage(const char *name)
+    {
+        fprintf(stderr, "usage: %s [--bots N] [--ticks N] [--beacons N] [--arena M] [--tick-hz HZ] [--seed N]\n", name);
+    }
+
+    static bool parseOptions(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (i + 1 >= argc)
+                return false;
+            const char *value = argv[++i];
+            if (arg == "--bots")
+                options.bots = atoi(value);
+            else if (arg == "--ticks")
+                options.ticks = atoi(value);
+            else if (arg == "--beacons")
+                options.beacons = atoi(value);
+            else if (arg == "--arena")
+                options.arena = atof(value);
+            else if (arg == "--tick-hz")
+                options.tickHz = atof(value);
+            else if (arg == "--seed")
+                options.seed = strtoul(value, nullptr, 10);
+            else
+                return false;
+        }
+        return options.bots > 0 && options.ticks > WARMUP_TICKS && options.beacons >= 3 && options.tickHz > 0.0f;
+    }
+
+    // beacons evenly round the arena, just inside its edge
+    static std::vector<std::pair<float, float>> placeBeacons(const Options &options)
+    {
+        std::vector<std::pair<float, float>> beacons;
+        float radius = options.arena * 0.45f;
+        for (int b = 0; b < options.beacons; b++)
+        {
+            float angle = 2.0f * (float)M_PI * b / options.beacons;
+            beacons.push_back({radius * std::cos(angle), radius * std::sin(angle)});
+        }
+        return beacons;
+    }
+
+    static Result run(const Options &options, const BatchLocaliser::Settings &settings)
+    {
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<float> uniform(-0.5f, 0.5f);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        const auto beacons = placeBeacons(options);
+        const float half = options.arena * 0.5f;
+        const float dt = 1.0f / options.tickHz;
+
+        std::vector<Bot> bots(options.bots);
+        for (Bot &bot : bots)
+            bot = {uniform(rng) * options.arena, uniform(rng) * options.arena, uniform(rng) * 2.0f * (float)M_PI};
+
+        BatchLocaliser::init(options.bots, settings);
+        std::vector<int32_t> slots(options.bots);
+        for (int i = 0; i < options.bots; i++)
+            slots[i] = i;
+        std::vector<BatchLocaliser::Observation> observations((size_t)options.bots * BatchLocaliser::MAX_BEACONS);
+        std::vector<BatchLocaliser::Fix> fixes(options.bots);
+        std::vector<std::pair<float, int>> heard;
+        Result result;
+
+        for (int tick = 0; tick < options.ticks; tick++)
+        {
+            for (int i = 0; i < options.bots; i++)
+            {
+                Bot &bot = bots[i];
+                bot.heading += normal(rng) * 0.5f;
+                bot.x = std::min(std::max(bot.x + BOT_SPEED * dt * std::cos(bot.heading), -half), half);
+                bot.y = std::min(std::max(bot.y + BOT_SPEED * dt * std::sin(bot.heading), -half), half);
+
+                // every beacon's window mean and spread, then the strongest go in the frame
+                heard.clear();
+                for (int b = 0; b < options.beacons; b++)
+                {
+                    float dx = bot.x - beacons[b].first, dy = bot.y - beacons[b].second;
+                    float d = std::max(std::sqrt(dx * dx + dy * dy), 0.1f);
+                    float mean = RSSI_AT_1M - 10.0f * PATH_LOSS * std::log10(d) + normal(rng) * options.shadowing;
+                    if (mean > SENSITIVITY)
+                        heard.push_back({mean, b});
+                }
+                std::sort(heard.begin(), heard.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+                BatchLocaliser::Observation *entries = &observations[(size_t)i * BatchLocaliser::MAX_BEACONS];
+                for (int k = 0; k < BatchLocaliser::MAX_BEACONS; k++)
+                {
+                    BatchLocaliser::Observation &o = entries[k];
+                    memset(&o, 0, sizeof(o));
+                    if (k >= options.frameBeacons || k >= (int)heard.size())
+                        continue;
+                    double sum = 0.0, sum2 = 0.0;
+                    for (int s = 0; s < options.window; s++)
+                    {
+                        float sample = std::round(heard[k].first + normal(rng) * options.sampleNoise);
+                        sum += sample;
+                        sum2 += sample * sample;
+                    }
+                    double mean = sum / options.window;
+                    double var = std::max((sum2 - sum * mean) / (options.window - 1), 0.0);
+                    const auto &beacon = beacons[heard[k].second];
+                    o = {beacon.first, beacon.second, RSSI_AT_1M, PATH_LOSS,
+                         std::round((float)mean * 10.0f) / 10.0f, std::round((float)std::sqrt(var) * 10.0f) / 10.0f,
+                         (float)options.window};
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            BatchLocaliser::solve(options.bots, slots.data(), observations.data(), tick * dt, fixes.data());
+            auto end = std::chrono::steady_clock::now();
+            if (tick >= WARMUP_TICKS)
+                result.tickMicros.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+
+            for (int i = 0; i < options.bots; i++)
+            {
+                result.attempts++;
+                if (!fixes[i].valid)
+                    continue;
+                float dx = fixes[i].x - bots[i].x, dy = fixes[i].y - bots[i].y;
+                result.sumError2 += dx * dx + dy * dy;
+                result.fixes++;
+            }
+        }
+        return result;
+    }
+
+    static void report(const char *name, Result result)
+    {
+        std::vector<double> &t = result.tickMicros;
+        std::sort(t.begin(), t.end());
+        double mean = 0.0;
+        for (double v : t)
+            mean += v / t.size();
+        printf("%-12s tick mean %8.1f us  median %8.1f  p99 %8.1f  max %8.1f | rms error %.2f m, %.1f%% valid\n", name,
+               mean, t[t.size() / 2], t[std::min(t.size() - 1, t.size() * 99 / 100)], t.back(),
+               result.fixes ? std::sqrt(result.sumError2 / result.fixes) : 0.0, 100.0 * result.fixes / result.attempts);
+    }
+
+    static int main(int argc, char **argv)
+    {
+        Options options;
+        if (!parseOptions(argc, argv, options))
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        printf("%d bots, %d beacons in a %.0f m arena, %d ticks at %.1f Hz\n", options.bots, options.beacons,
+               options.arena, options.ticks, options.tickHz);
+
+        BatchLocaliser::Settings settings = BatchLocaliser::defaults();
+        report("history", run(options, settings));
+        settings.historySeconds = 0.0f;
+        report("no history", run(options, settings));
+        return 0;
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    return Bench::main(argc, argv);
+}
@@ -0,0 +1,125 @@
+# decoders for what the bots and the beacons send the command server, the bots'
+# extended telemetry frames and the beacons' rssi reports. standard library only, so
+# the offline sims decode the same way as main.py without the server's dependencies
+
+import struct
+
+# extended telemetry frames arrive in the scan response under this company id,
+# the first byte is the frame type (see Comms::FrameType in the firmware)
+EXTENDED_FRAME_ID = 0xFFFE
+FRAME_DIAGNOSTICS = 0
+FRAME_SOUND = 1
+FRAME_SOUND_STATS = 2
+FRAME_SOUND_CLASS = 3
+FRAME_SOUND_BEARING = 4
+FRAME_RSSI_STATS = 5
+SOUND_LABELS = ["ambient", "target", "motors", "speech"]
+PROFILE_ZONES = ["trilateration", "ble_poll", "read_heading", "sound_average", "sound_classify"]
+
+def decode_diagnostics(payload):
+    # zone count, then mean and max time in us per zone (little endian uint16)
+    zones = {}
+    count = payload[0] if payload else 0
+    for i in range(count):
+        offset = 1 + i * 4
+        if offset + 4 > len(payload):
+            break
+        name = PROFILE_ZONES[i] if i < len(PROFILE_ZONES) else f"zone{i}"
+        zones[name] = {
+            "mean_us": int.from_bytes(payload[offset:offset + 2], "little"),
+            "max_us": int.from_bytes(payload[offset + 2:offset + 4], "little"),
+        }
+    return zones
+
+def decode_sound(payload):
+    # level in 0.01 dB re full scale at unity mic gain (little endian int16), the
+    # PDM gain it was measured at (0.5 dB steps, 40 = 0 dB) and flags
+    if len(payload) < 4:
+        return {}
+    return {
+        "level_db": int.from_bytes(payload[0:2], "little", signed=True) / 100.0,
+        "gain": payload[2],
+        "clipped": bool(payload[3] & 0x01),
+        "fixed_gain": bool(payload[3] & 0x02),
+    }
+
+def decode_sound_stats(payload):
+    # L10, L50, L90 and peak of the last interval in 0.01 dB on the same scale
+    # (little endian int16 each), then the number of levels behind them (uint16)
+    if len(payload) < 10:
+        return {}
+    names = ["l10_db", "l50_db", "l90_db", "peak_db"]
+    stats = {name: int.from_bytes(payload[i * 2:i * 2 + 2], "little", signed=True) / 100.0
+             for i, name in enumerate(names)}
+    stats["count"] = int.from_bytes(payload[8:10], "little")
+    return stats
+
+def decode_sound_class(payload):
+    # label, then the probability of every label in 1/255
+    if len(payload) < 1 + len(SOUND_LABELS):
+        return {}
+    label = payload[0]
+    return {
+        "label": SOUND_LABELS[label] if label < len(SOUND_LABELS) else str(label),
+        "probabilities": {name: payload[1 + i] / 255.0 for i, name in enumerate(SOUND_LABELS)},
+    }
+
+def decode_sound_bearing(payload):
+    # bearing and its standard error in 0.01 degrees (little endian uint16, 0xFFFF
+    # when the sweep gave no bearing), response depth in 0.01 dB (int16), the
+    # number of levels (uint16) and how long the sweep took in seconds
+    if len(payload) < 9:
+        return {}
+    bearing = int.from_bytes(payload[0:2], "little")
+    error = int.from_bytes(payload[2:4], "little")
+    valid = bearing != 0xFFFF
+    return {
+        "bearing_deg": bearing / 100.0 if valid else None,
+        "error_deg": error / 100.0 if valid else None,
+        "depth_db": int.from_bytes(payload[4:6], "little", signed=True) / 100.0,
+        "count": int.from_bytes(payload[6:8], "little"),
+        "seconds": payload[8],
+    }
+
+def decode_rssi_stats(payload):
+    # 5 bytes per beacon, strongest first: beacon id, mean rssi in 0.1 dBm (little
+    # endian int16), its standard deviation in 0.1 dB, then the samples behind them less
+    # one in the low nibble and the samples the bot has heard, modulo 16, in the high one
+    return [{
+        "beacon": payload[i],
+        "rssi_dbm": int.from_bytes(payload[i + 1:i + 3], "little", signed=True) / 10.0,
+        "std_db": payload[i + 3] / 10.0,
+        "samples": (payload[i + 4] & 0x0F) + 1,
+        "heard": payload[i + 4] >> 4,
+    } for i in range(0, len(payload) - 4, 5)]
+
+FRAME_DECODERS = {
+    FRAME_DIAGNOSTICS: ("diagnostics", decode_diagnostics),
+    FRAME_SOUND: ("sound", decode_sound),
+    FRAME_SOUND_STATS: ("sound_stats", decode_sound_stats),
+    FRAME_SOUND_CLASS: ("sound_class", decode_sound_class),
+    FRAME_SOUND_BEARING: ("sound_bearing", decode_sound_bearing),
+    FRAME_RSSI_STATS: ("rssi_stats", decode_rssi_stats),
+}
+
+# rssi reports from the beacons' scanners (beacon/scanner.py): each beacon measures the
+# bots' adverts and sends the statistics per report window as a udp datagram. version,
+# beacon id, bot count, then per bot its address (6 bytes, most significant first), mean
+# rssi in 0.1 dBm (int16), its standard deviation in 0.1 dB and the sample count, little endian
+REPORT_VERSION = 1
+ENTRY_SIZE = 10
+
+def decode_report(data):
+    # (beacon id, [(bot address, mean rssi, standard deviation, samples)]), None if malformed
+    if len(data) < 3 or data[0] != REPORT_VERSION:
+        return None
+    _, beacon_id, count = struct.unpack_from("<BBB", data)
+    if len(data) < 3 + count * ENTRY_SIZE:
+        return None
+    bots = []
+    for i in range(count):
+        offset = 3 + i * ENTRY_SIZE
+        address = data[offset:offset + 6].hex(":").upper()
+        mean, std, samples = struct.unpack_from("<hBB", data, offset + 6)
+        bots.append((address, mean / 10.0, std / 10.0, samples))
+    return beacon_id, bots
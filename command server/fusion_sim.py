@@ -0,0 +1,201 @@
+# simulated packet feed for the ground localisation: bots wandering among beacons,
+# swapping between scan and advertise phases like the firmware. what each bot hears of
+# the beacons goes out as FRAME_RSSI_STATS in its advertise phases, what each beacon hears
+# of the bots' adverts goes out as beacon/scanner.py's reports, and both go through the
+# same decoders as the real packets into GroundLocaliser. the link shadowing is shared by
+# both ends, as on a real link.
+#
+#   python3 fusion_sim.py --bots 200 --seconds 60
+#
+# prints the position error and how often each bot gets a fix with the bots' frames, the
+# beacons' reports and both. with --udp HOST:PORT the beacon reports go to a running
+# command server instead, in real time.
+
+import argparse
+import collections
+import math
+import random
+import socket
+import statistics
+import struct
+import sys
+import time
+from pathlib import Path
+
+import ground_localiser
+from frames import decode_report, decode_rssi_stats
+
+sys.path.append(str(Path(__file__).parent.parent / "beacon"))
+from scanner import BotStats, encode_reports
+
+RSSI_AT_1M = -65.37
+PATH_LOSS = 2.68
+SENSITIVITY = -95.0
+BOT_SPEED = 0.1            # m/s
+SWAP_SECONDS = 1.0         # Params swapInterval
+ADVERT_SECONDS = 0.1       # a bot's advertising interval (BluetoothManager)
+BEACON_SETS = 4            # beacon/setup.py's sets, a bot hears each once per scan phase
+RSSI_WINDOW = 7            # Params rssiWindow
+STATS_BEACONS = 5          # MAX_STATS_BEACONS in the firmware
+REPORT_SECONDS = 0.25      # beacon/scanner.py's report window
+STEP_SECONDS = 0.05
+
+class Bot:
+    def __init__(self, name, half, rng):
+        self.name = name
+        self.x = rng.uniform(-half, half)
+        self.y = rng.uniform(-half, half)
+        self.heading = rng.uniform(0, 2 * math.pi)
+        # scan and advertise phases start at a random point, like bots powered on at different times
+        self.phase_offset = rng.uniform(0, 2 * SWAP_SECONDS)
+        self.windows = collections.defaultdict(lambda: collections.deque(maxlen=RSSI_WINDOW))
+        # samples put in each window, and how many of them the ground station had been sent
+        self.heard = collections.defaultdict(int)
+        self.reported = {}
+        self.was_advertising = False
+        self.phases = 0
+
+    def advertising(self, now):
+        return (now + self.phase_offset) % (2 * SWAP_SECONDS) >= SWAP_SECONDS
+
+def stats_frame(bot):
+    # FRAME_RSSI_STATS as sendRSSIStats() packs it, and the samples in it no frame sent before had
+    means = []
+    for beacon_id, window in bot.windows.items():
+        if window:
+            means.append((sum(window) / len(window), beacon_id, window))
+    means.sort(reverse=True)
+    payload = b""
+    distinct = 0
+    for mean, beacon_id, window in means[:STATS_BEACONS]:
+        std = statistics.stdev(window) if len(window) > 1 else 0.0
+        heard = bot.heard[beacon_id]
+        payload += struct.pack("<BhBB", beacon_id, round(mean * 10), min(round(std * 10), 255),
+                               (len(window) - 1) | (heard & 0x0F) << 4)
+        distinct += min(heard - bot.reported.get(beacon_id, 0), len(window))
+        bot.reported[beacon_id] = heard
+    return payload, distinct
+
+def run(args, sources, udp=None):
+    rng = random.Random(args.seed)
+    half = args.arena / 2
+    radius = args.arena * 0.45
+    beacons = [(radius * math.cos(2 * math.pi * b / args.beacons), radius * math.sin(2 * math.pi * b / args.beacons))
+               for b in range(args.beacons)]
+    bots = [Bot(f"AA:BB:CC:00:{i >> 8:02X}:{i & 0xFF:02X}", half, rng) for i in range(args.bots)]
+    # shadowing of every link, a slowly wandering offset shared by both ends
+    shadowing = [[rng.gauss(0, args.shadowing) for _ in beacons] for _ in bots]
+
+    localiser = ground_localiser.GroundLocaliser(capacity=max(args.bots, 1))
+    for b, (x, y) in enumerate(beacons):
+        frame = struct.pack("<BBhhhH", 1, b, round(x * 100), round(y * 100), round(RSSI_AT_1M * 100), round(PATH_LOSS * 100))
+        localiser.beacon_heard("RasPiX", {ground_localiser.BEACON_FRAME_ID: frame})
+
+    reports = [dict() for _ in beacons]
+    errors, tick_ms = [], []
+    # distinct samples in the statistics frames the ground station got
+    distinct = 0
+    fixes = 0
+    steps = int(args.seconds / STEP_SECONDS)
+    decay = math.exp(-STEP_SECONDS / args.shadowing_seconds)
+    start = time.monotonic()
+    for step in range(1, steps + 1):
+        now = step * STEP_SECONDS
+        for i, bot in enumerate(bots):
+            bot.heading += rng.gauss(0, 0.3)
+            bot.x = min(max(bot.x + BOT_SPEED * STEP_SECONDS * math.cos(bot.heading), -half), half)
+            bot.y = min(max(bot.y + BOT_SPEED * STEP_SECONDS * math.sin(bot.heading), -half), half)
+            link_means = []
+            for b, (bx, by) in enumerate(beacons):
+                shadowing[i][b] = decay * shadowing[i][b] + math.sqrt(1 - decay * decay) * rng.gauss(0, args.shadowing)
+                d = max(math.hypot(bot.x - bx, bot.y - by), 0.1)
+                link_means.append(RSSI_AT_1M - 10 * PATH_LOSS * math.log10(d) + shadowing[i][b])
+
+            advertising = bot.advertising(now)
+            if not advertising:
+                # scanning: each of a beacon's sets is heard once per scan phase, spread over it
+                if rng.random() < BEACON_SETS * STEP_SECONDS / SWAP_SECONDS:
+                    for b, mean in enumerate(link_means):
+                        rssi = round(mean + rng.gauss(0, args.noise))
+                        if rssi > SENSITIVITY:
+                            bot.windows[b].append(rssi)
+                            bot.heard[b] += 1
+            if advertising and not bot.was_advertising and "bot" in sources:
+                # the statistics frame goes out with this advertise phase's scan response, every
+                # phase in localisationMode 2 and every other one in mode 1 (Comms::set_frame_share)
+                bot.phases += 1
+                if args.localisation_mode == 2 or bot.phases % 2 == 0:
+                    payload, fresh = stats_frame(bot)
+                    if payload:
+                        distinct += fresh
+                        localiser.observe(bot.name, decode_rssi_stats(payload))
+            if advertising and rng.random() < STEP_SECONDS / ADVERT_SECONDS:
+                # an advert, each beacon hears it or misses it
+                for b, mean in enumerate(link_means):
+                    rssi = round(mean + rng.gauss(0, args.noise))
+                    if rssi > SENSITIVITY and rng.random() < args.reception:
+                        reports[b].setdefault(bot.name, BotStats()).add(rssi)
+            bot.was_advertising = advertising
+
+        if step % round(REPORT_SECONDS / STEP_SECONDS) == 0 and ("beacon" in sources or udp is not None):
+            for b in range(len(beacons)):
+                for datagram in encode_reports(b, reports[b]):
+                    if udp is not None:
+                        udp[0].sendto(datagram, udp[1])
+                        continue
+                    beacon_id, heard = decode_report(datagram)
+                    for name, rssi, std, samples in heard:
+                        localiser.beacon_report(beacon_id, name, rssi, std, samples)
+                reports[b] = {}
+            if udp is not None:
+                time.sleep(max(start + now - time.monotonic(), 0.0))
+
+        if udp is None and step % round(1.0 / (args.tick_hz * STEP_SECONDS)) == 0:
+            results = localiser.tick(now)
+            tick_ms.append(localiser.last_tick_ms)
+            positions = {bot.name: bot for bot in bots}
+            for name, fix in results.items():
+                bot = positions[name]
+                errors.append(math.hypot(fix["x"] - bot.x, fix["y"] - bot.y))
+            fixes += len(results)
+    # each sample counted once at most: fewer only where more than 15 came between two frames
+    assert localiser.bot_samples <= distinct, f"{localiser.bot_samples} bot samples counted, {distinct} sent"
+    return errors, fixes, tick_ms, (localiser.bot_samples, distinct)
+
+def main():
+    parser = argparse.ArgumentParser(description="Ground localisation fusion on a simulated packet feed")
+    parser.add_argument("--bots", type=int, default=200)
+    parser.add_argument("--beacons", type=int, default=4)
+    parser.add_argument("--arena", type=float, default=4.0, help="Side of the square arena (m)")
+    parser.add_argument("--seconds", type=float, default=60.0)
+    parser.add_argument("--tick-hz", type=float, default=2.0, help="Ground localisation ticks per second")
+    parser.add_argument("--shadowing", type=float, default=4.0, help="Spread of a link's mean rssi (dB)")
+    parser.add_argument("--shadowing-seconds", type=float, default=5.0, help="How long a link's shadowing lasts (s)")
+    parser.add_argument("--noise", type=float, default=2.0, help="Spread of single samples around the mean (dB)")
+    parser.add_argument("--reception", type=float, default=0.8, help="Share of a bot's adverts a beacon receives")
+    parser.add_argument("--localisation-mode", type=int, default=2, choices=(1, 2), help="The bots' Params localisationMode")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--udp", type=str, help="HOST:PORT of a command server to send the beacon reports to")
+    args = parser.parse_args()
+
+    if args.udp:
+        host, port = args.udp.rsplit(":", 1)
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        print(f"Sending beacon reports of {args.bots} bots to {host}:{port} for {args.seconds:.0f} s")
+        run(args, {"beacon"}, (sock, (host, int(port))))
+        return
+
+    print(f"{args.bots} bots, {args.beacons} beacons in a {args.arena:.0f} m arena, {args.seconds:.0f} s")
+    print("sources        rms error   p90 error   fixes/bot/s   tick ms   bot samples counted/sent")
+    for name, sources in (("bots", {"bot"}), ("beacons", {"beacon"}), ("both", {"bot", "beacon"})):
+        errors, fixes, tick_ms, (counted, sent) = run(args, sources)
+        if not errors:
+            print(f"{name:<12}   no fixes")
+            continue
+        errors.sort()
+        rms = math.sqrt(sum(e * e for e in errors) / len(errors))
+        print(f"{name:<12} {rms:9.2f} m {errors[len(errors) * 9 // 10]:9.2f} m {fixes / args.bots / args.seconds:11.2f}"
+              f"   {statistics.mean(tick_ms):7.2f}   {counted:>12d} / {sent}")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,184 @@
+# ground station localisation: bots in Params localisationMode 1 or 2 forward per beacon
+# rssi statistics (FRAME_RSSI_STATS) instead of only their own position, and every bot's
+# position is worked out in one batch per tick by the engine in engine/ (make -C engine).
+# the beacons are learnt from their own adverts, the same way the bots learn them.
+#
+# the beacons can measure the bots too (beacon/scanner.py, beacon_reports.py). a link is
+# the same path loss whichever end measures it, so the samples from both ends of a link
+# are pooled into one mean before the solve, and a tick has a fix for every bot that
+# either end heard since the last one.
+
+import array
+import ctypes
+import struct
+import time
+from pathlib import Path
+
+DEFAULT_LIBRARY = Path(__file__).parent / "engine" / "build" / "libbatchloc.so"
+
+# beacon frames (src/BeaconRegistry.h in the firmware): version, id, x and y in cm, rssi
+# at 1 m in 0.01 dBm and the path loss exponent in 0.01, little endian
+BEACON_FRAME_ID = 0xFFFD
+BEACON_FRAME_VERSION = 1
+# beacons that only advertise a name: id, x and y at the firmware's defaults (src/Params.def)
+NAMED_BEACONS = {"RasPi1": (0, 0.0, 1.0), "RasPi2": (1, -0.75, 0.0), "RasPi3": (2, 0.75, 0.0)}
+DEFAULT_RSSI_AT_1M = -65.37
+DEFAULT_PATH_LOSS_EXPONENT = 2.68
+
+class Settings(ctypes.Structure):
+    _fields_ = [("shadowing_db", ctypes.c_float), ("min_std_db", ctypes.c_float), ("diffusion", ctypes.c_float),
+                ("history_seconds", ctypes.c_float), ("iterations", ctypes.c_int32)]
+
+class Observation(ctypes.Structure):
+    _fields_ = [("beacon_x", ctypes.c_float), ("beacon_y", ctypes.c_float), ("rssi_at_1m", ctypes.c_float),
+                ("path_loss_exponent", ctypes.c_float), ("rssi", ctypes.c_float), ("rssi_std", ctypes.c_float),
+                ("samples", ctypes.c_float)]
+
+class Fix(ctypes.Structure):
+    _fields_ = [("x", ctypes.c_float), ("y", ctypes.c_float), ("var_x", ctypes.c_float), ("cov_xy", ctypes.c_float),
+                ("var_y", ctypes.c_float), ("residual", ctypes.c_float), ("beacons", ctypes.c_int32),
+                ("valid", ctypes.c_int32)]
+
+class GroundLocaliser:
+    def __init__(self, library=DEFAULT_LIBRARY, capacity=1024, **settings):
+        self.lib = ctypes.CDLL(str(library))
+        self.lib.bl_defaults.argtypes = [ctypes.POINTER(Settings)]
+        self.lib.bl_init.argtypes = [ctypes.c_int, ctypes.POINTER(Settings)]
+        self.lib.bl_forget.argtypes = [ctypes.c_int]
+        self.lib.bl_solve.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_int32), ctypes.POINTER(Observation),
+                                      ctypes.c_double, ctypes.POINTER(Fix)]
+        self.lib.bl_max_beacons.restype = ctypes.c_int
+
+        self.settings = Settings()
+        self.lib.bl_defaults(ctypes.byref(self.settings))
+        for name, value in settings.items():
+            setattr(self.settings, name, value)
+        self.lib.bl_init(capacity, ctypes.byref(self.settings))
+        self.max_beacons = self.lib.bl_max_beacons()
+        self.started = time.monotonic()
+
+        # beacon id -> (x, y, rssi at 1 m, path loss exponent)
+        self.beacons = {}
+        # bot id -> engine slot, each slot keeps its bot's history
+        self.slots = {}
+        self.free_slots = list(range(capacity - 1, -1, -1))
+        # bot id -> beacon id -> samples of the link since the last tick
+        self.pending = {}
+        # bot id -> beacon id -> the heard count of its last statistics frame
+        self.last_heard = {}
+        # samples taken from the bots' statistics frames, each sample once
+        self.bot_samples = 0
+        self.last_tick_ms = 0.0
+        # pending bots dropped by tick() for not being known
+        self.unknown_dropped = 0
+
+    def beacon_heard(self, name, manufacturer_data):
+        # learns a beacon from its advert, returns whether the advert was a beacon's
+        frame = manufacturer_data.get(BEACON_FRAME_ID)
+        if frame is not None and len(frame) >= 10 and frame[0] == BEACON_FRAME_VERSION:
+            _, beacon_id, x, y, rssi_at_1m, path_loss = struct.unpack_from("<BBhhhH", frame)
+            self.beacons[beacon_id] = (x / 100.0, y / 100.0, rssi_at_1m / 100.0, path_loss / 100.0)
+            return True
+        if name in NAMED_BEACONS:
+            beacon_id, x, y = NAMED_BEACONS[name]
+            self.beacons.setdefault(beacon_id, (x, y, DEFAULT_RSSI_AT_1M, DEFAULT_PATH_LOSS_EXPONENT))
+            return True
+        return False
+
+    def _add_samples(self, bot_id, beacon_id, mean, std, samples, source):
+        # count, sum and sum of squares of the link's samples, and how many came from each end
+        if samples < 1:
+            return
+        link = self.pending.setdefault(bot_id, {}).setdefault(beacon_id, [0, 0.0, 0.0, 0, 0])
+        link[0] += samples
+        link[1] += samples * mean
+        link[2] += (samples - 1) * std * std + samples * mean * mean
+        link[3 if source == "bot" else 4] += samples
+
+    def observe(self, bot_id, stats):
+        # a bot's decoded rssi statistics frame. each frame has the statistics of the bot's
+        # whole window, which it mostly shares with the frame before, and the scan response
+        # repeats until there are new ones: only the samples heard since the last frame
+        # count, at the window's mean and spread. more than 15 new samples between two
+        # frames read as fewer, never as more
+        last = self.last_heard.setdefault(bot_id, {})
+        for stat in stats:
+            previous = last.get(stat["beacon"])
+            fresh = stat["samples"] if previous is None else min((stat["heard"] - previous) % 16, stat["samples"])
+            last[stat["beacon"]] = stat["heard"]
+            self.bot_samples += fresh
+            self._add_samples(bot_id, stat["beacon"], stat["rssi_dbm"], stat["std_db"], fresh, "bot")
+
+    def beacon_report(self, beacon_id, bot_id, rssi, std, samples):
+        # a bot's adverts as a beacon measured them (BeaconReportProtocol's handler)
+        self._add_samples(bot_id, beacon_id, rssi, std, samples, "beacon")
+
+    def forget(self, bot_id):
+        self.pending.pop(bot_id, None)
+        self.last_heard.pop(bot_id, None)
+        slot = self.slots.pop(bot_id, None)
+        if slot is not None:
+            self.lib.bl_forget(slot)
+            self.free_slots.append(slot)
+
+    def tick(self, now=None, known=None):
+        # solves every bot with new samples in one batch, returns bot id -> fix. now is in
+        # seconds, the time since this localiser started by default. with known (the bot
+        # ids the caller keeps, e.g. its registry) the samples of any other address are
+        # dropped: it gets no slot, which only forget() would give back
+        if now is None:
+            now = time.monotonic() - self.started
+        bots = []
+        for bot_id in list(self.pending):
+            if known is not None and bot_id not in known:
+                self.pending.pop(bot_id)
+                self.unknown_dropped += 1
+                continue
+            if bot_id not in self.slots:
+                if not self.free_slots:
+                    self.pending.pop(bot_id)
+                    continue
+                self.slots[bot_id] = self.free_slots.pop()
+            bots.append(bot_id)
+        if not bots:
+            return {}
+
+        count = len(bots)
+        slots = (ctypes.c_int32 * count)(*(self.slots[bot_id] for bot_id in bots))
+        # observations as a flat float array, built as a list first: far quicker than a structure each
+        fields = len(Observation._fields_)
+        values = []
+        sources = []
+        for bot_id in bots:
+            links = []
+            for beacon_id, (samples, total, total2, from_bot, from_beacon) in self.pending.pop(bot_id).items():
+                beacon = self.beacons.get(beacon_id)
+                if beacon is None:
+                    continue
+                mean = total / samples
+                std = (max(total2 - total * mean, 0.0) / (samples - 1)) ** 0.5 if samples > 1 else 0.0
+                links.append((mean, std, samples, beacon, from_bot, from_beacon))
+            # the strongest links if there are more than the engine takes
+            links.sort(key=lambda link: link[0], reverse=True)
+            links = links[:self.max_beacons]
+            for mean, std, samples, beacon, _, _ in links:
+                values.extend(beacon)
+                values.extend((mean, std, samples))
+            values.extend([0.0] * (fields * (self.max_beacons - len(links))))
+            sources.append((sum(link[4] for link in links), sum(link[5] for link in links)))
+        observations = array.array("f", values)
+        observations_pointer = ctypes.cast((ctypes.c_float * len(observations)).from_buffer(observations),
+                                           ctypes.POINTER(Observation))
+        fixes = (Fix * count)()
+
+        start = time.perf_counter()
+        self.lib.bl_solve(count, slots, observations_pointer, now, fixes)
+        self.last_tick_ms = (time.perf_counter() - start) * 1000.0
+
+        results = {}
+        for bot_id, fix, (from_bot, from_beacons) in zip(bots, fixes, sources):
+            if fix.valid:
+                results[bot_id] = {"x": fix.x, "y": fix.y, "var_x": fix.var_x, "cov_xy": fix.cov_xy,
+                                   "var_y": fix.var_y, "residual_db": fix.residual, "beacons": fix.beacons,
+                                   "bot_samples": from_bot, "beacon_samples": from_beacons}
+        return results
@@ -0,0 +1,191 @@
+# per bot history for trajectory and sound replay. every bot has three rings of fixed
+# size: every advert as it came (raw), and means over 1 s and 10 s, so a long range is
+# read from a coarse ring instead of a long list of adverts. each ring is columnar, a
+# time column and one array per field, and an append writes one slot in each without
+# moving anything. a bot's memory is fixed by the ring sizes, whatever it sends.
+#
+# a query takes the finest ring that still reaches back to its start and has no more
+# points in the range than asked for, and finds the range by bisecting the times. a bot
+# younger than the range only has to be covered from its first advert. if no ring reaches
+# back far enough it takes the one that reaches back furthest. a coarse ring's answer
+# ends with the bucket still being filled, as its mean so far, and an answer longer than
+# max_points is thinned to every n-th point.
+
+import array
+import math
+import time
+
+FIELDS = ("x", "y", "rotation", "battery", "sound", "rssi", "ground_x", "ground_y")
+# the bot's heading in 256 steps wraps, a mean would point the wrong way: the last one
+LAST_FIELDS = ("rotation",)
+# (name, bucket seconds, slots), the finest first. raw holds a little over a minute of
+# adverts at 10 Hz, so the default minute of /history is raw on a bot that has run longer
+LEVELS = (("raw", 0.0, 720), ("1s", 1.0, 900), ("10s", 10.0, 1080))
+
+class Ring:
+    def __init__(self, capacity):
+        self.capacity = capacity
+        self.time = array.array("d", [0.0]) * capacity
+        self.columns = {field: array.array("f", [math.nan]) * capacity for field in FIELDS}
+        # slot of the oldest entry and the number of entries
+        self.start = 0
+        self.count = 0
+
+    def append(self, t, values):
+        slot = (self.start + self.count) % self.capacity
+        if self.count == self.capacity:
+            self.start = (self.start + 1) % self.capacity
+        else:
+            self.count += 1
+        self.time[slot] = t
+        for field in FIELDS:
+            self.columns[field][slot] = values[field]
+
+    def oldest(self):
+        return self.time[self.start] if self.count else math.inf
+
+    def _bisect(self, t):
+        # the first entry at or after t, counted from the oldest
+        low, high = 0, self.count
+        while low < high:
+            middle = (low + high) // 2
+            if self.time[(self.start + middle) % self.capacity] < t:
+                low = middle + 1
+            else:
+                high = middle
+        return low
+
+    def span(self, start, end):
+        # entries from start to end inclusive, counted from the oldest
+        return self._bisect(start), self._bisect(math.nextafter(end, math.inf))
+
+    def read(self, first, last, fields):
+        slots = [(self.start + i) % self.capacity for i in range(first, last)]
+        result = {"t": [self.time[slot] for slot in slots]}
+        for field in fields:
+            column = self.columns[field]
+            # nan, a field the bot had no value for, goes out as None
+            result[field] = [None if math.isnan(column[slot]) else round(column[slot], 3) for slot in slots]
+        return result
+
+class Level:
+    # one ring and the bucket it is filling, the raw level has no bucket
+    def __init__(self, name, seconds, capacity):
+        self.name = name
+        self.seconds = seconds
+        self.ring = Ring(capacity)
+        self.bucket = None
+        self.count = 0
+        self.sums = dict.fromkeys(FIELDS, 0.0)
+        self.counts = dict.fromkeys(FIELDS, 0)
+        self.last = {}
+        self.last_time = 0.0
+
+    def add(self, t, values):
+        if self.seconds == 0.0:
+            self.ring.append(t, values)
+            return
+        bucket = math.floor(t / self.seconds)
+        if self.bucket is not None and bucket != self.bucket:
+            self.flush()
+        self.bucket = bucket
+        for field in FIELDS:
+            value = values[field]
+            if math.isnan(value):
+                continue
+            self.sums[field] += value
+            self.counts[field] += 1
+        self.last = values
+        self.last_time = t
+
+    def means(self):
+        means = {field: self.sums[field] / self.counts[field] if self.counts[field] else math.nan for field in FIELDS}
+        for field in LAST_FIELDS:
+            means[field] = self.last[field]
+        return means
+
+    def flush(self):
+        # the bucket's mean into the ring, stamped with the middle of the bucket
+        self.ring.append((self.bucket + 0.5) * self.seconds, self.means())
+        self.sums = dict.fromkeys(FIELDS, 0.0)
+        self.counts = dict.fromkeys(FIELDS, 0)
+
+    def partial(self):
+        # (time, means) of the bucket being filled, stamped with the middle of what it
+        # covers so far, None for the raw level or before the first value
+        if self.seconds == 0.0 or self.bucket is None:
+            return None
+        return (self.bucket * self.seconds + self.last_time) / 2, self.means()
+
+class BotHistory:
+    def __init__(self, levels=LEVELS):
+        self.levels = [Level(name, seconds, capacity) for name, seconds, capacity in levels]
+        self.first = None
+
+    def append(self, t, values):
+        if self.first is None:
+            self.first = t
+        for level in self.levels:
+            level.add(t, values)
+
+    def query(self, start, end, fields=FIELDS, max_points=None, resolution=None):
+        levels = [level for level in self.levels if resolution is None or level.name == resolution]
+        if not levels or self.first is None:
+            return None
+        # a bot younger than the range is covered from its first advert, a coarse ring's
+        # first point is up to a bucket after it
+        since = max(start, self.first)
+        spans = []
+        for level in levels:
+            first, last = level.ring.span(start, end)
+            partial = level.partial()
+            if partial is not None and not start <= partial[0] <= end:
+                partial = None
+            spans.append((level, first, last, partial))
+
+        def fits(span):
+            return max_points is None or span[2] - span[1] + (span[3] is not None) <= max_points
+
+        # the finest ring that reaches back to the start and is not too long, else the one
+        # with points in the range that reaches back furthest, the finer of two that do
+        chosen = next((span for span in spans
+                       if span[0].ring.oldest() <= since + span[0].seconds and fits(span)), None)
+        if chosen is None:
+            filled = [span for span in spans if span[2] > span[1] or span[3] is not None] or spans
+            chosen = min(filled, key=lambda span: span[0].ring.oldest())
+        level, first, last, partial = chosen
+        result = level.ring.read(first, last, fields)
+        if partial is not None:
+            t, means = partial
+            result["t"].append(t)
+            for field in fields:
+                result[field].append(None if math.isnan(means[field]) else round(means[field], 3))
+        result["resolution"] = level.name
+        if max_points is not None and len(result["t"]) > max_points:
+            # every n-th point when even the ring that reaches back far enough has too many
+            stride = -(-len(result["t"]) // max_points)
+            for key in ["t", *fields]:
+                result[key] = result[key][::stride]
+            result["stride"] = stride
+        return result
+
+class HistoryStore:
+    def __init__(self, levels=LEVELS):
+        self.level_spec = levels
+        self.bots = {}
+
+    def append(self, bot_id, values, t=None):
+        # values: a number (or nan) for each of FIELDS
+        if t is None:
+            t = time.time()
+        history = self.bots.get(bot_id)
+        if history is None:
+            history = self.bots[bot_id] = BotHistory(self.level_spec)
+        history.append(t, values)
+
+    def forget(self, bot_id):
+        self.bots.pop(bot_id, None)
+
+    def query(self, bot_id, start, end, fields=FIELDS, max_points=None, resolution=None):
+        history = self.bots.get(bot_id)
+        return history.query(start, end, fields, max_points, resolution) if history is not None else None
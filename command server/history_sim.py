@@ -0,0 +1,80 @@
+# synthetic check of the telemetry history (history.py): bots advertising at a steady
+# rate for different lengths of time, and the /history queries the dashboard makes of
+# them, with the ring each answer came from and how many points it has.
+#
+#   python3 history_sim.py --seconds 1000 --hz 10
+#
+# prints one line per query and fails on an answer from the wrong ring, one longer than
+# max_points, or a coarse answer that misses the newest bucket. then the time an append
+# and a query take.
+
+import argparse
+import random
+import time
+
+import history
+
+def advertise(store, bot_id, start, end, hz, rng):
+    t = start
+    while t < end:
+        store.append(bot_id, {field: rng.uniform(0, 255) for field in history.FIELDS}, t)
+        t += 1.0 / hz
+
+def check(store, bot_id, name, start, end, expected, max_points=None, resolution=None):
+    result = store.query(bot_id, start, end, max_points=max_points, resolution=resolution)
+    points = len(result["t"])
+    print(f"{name:<44} {result['resolution']:>4} {points:7d}  {result.get('stride', 1):6d}")
+    assert result["resolution"] == expected, f"{name}: {result['resolution']}, not {expected}"
+    assert points > 0, f"{name}: no points"
+    assert max_points is None or points <= max_points, f"{name}: {points} points, max_points {max_points}"
+    seconds = {level: seconds for level, seconds, _ in history.LEVELS}[result["resolution"]]
+    if seconds > 0 and "stride" not in result:
+        # the bucket still being filled is the last point
+        assert end - result["t"][-1] < seconds, f"{name}: newest bucket missing"
+
+def main():
+    parser = argparse.ArgumentParser(description="Synthetic check of the telemetry history")
+    parser.add_argument("--seconds", type=float, default=1000.0, help="How long the long-running bot has advertised")
+    parser.add_argument("--hz", type=float, default=10.0, help="Adverts per bot per second")
+    parser.add_argument("--window", type=float, default=60.0, help="The default /history range (s)")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+    rng = random.Random(args.seed)
+
+    # times as main.py stamps them, the bots stop a little before now
+    now = 1.7e9 + 0.37
+    store = history.HistoryStore()
+    advertise(store, "old", now - args.seconds, now, args.hz, rng)
+    advertise(store, "young", now - 5.0, now, args.hz, rng)
+    advertise(store, "half", now - args.window / 2, now, args.hz, rng)
+
+    # raw only while its ring holds the whole default range at this rate
+    window_ring = "raw" if args.hz * args.window < history.LEVELS[0][2] else "1s"
+    print(f"bots advertising at {args.hz:g} Hz, {args.seconds:g} s for the oldest")
+    print("query                                        ring  points  stride")
+    check(store, "young", f"5 s old bot, last {args.window:g} s", now - args.window, now, "raw", 1000)
+    check(store, "half", f"{args.window / 2:g} s old bot, last {args.window:g} s", now - args.window, now, "raw", 1000)
+    check(store, "old", f"last {args.window:g} s", now - args.window, now, window_ring, 1000)
+    check(store, "old", "last 10 s", now - 10.0, now, "raw", 1000)
+    check(store, "old", "last 100 s, max_points 120", now - 100.0, now, "1s", 120)
+    check(store, "old", "whole range", now - args.seconds, now, "10s", 1000)
+    check(store, "old", "whole range, max_points 10", now - args.seconds, now, "10s", 10)
+    check(store, "old", "last 100 s at 10s", now - 100.0, now, "10s", resolution="10s")
+    check(store, "old", "last 100 s at 1s", now - 100.0, now, "1s", resolution="1s")
+
+    values = {field: 1.0 for field in history.FIELDS}
+    count = 10000
+    start = time.perf_counter()
+    t = now
+    for _ in range(count):
+        t += 1.0 / args.hz
+        store.append("old", values, t)
+    append_us = (time.perf_counter() - start) / count * 1e6
+    start = time.perf_counter()
+    for _ in range(100):
+        store.query("old", t - args.window, t, max_points=1000)
+    query_ms = (time.perf_counter() - start) / 100 * 1000
+    print(f"append {append_us:.1f} us, query of the last {args.window:g} s {query_ms:.2f} ms")
+
+if __name__ == "__main__":
+    main()
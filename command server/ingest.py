@@ -0,0 +1,83 @@
+# adverts from several bluetooth adapters merged into one stream. each adapter hears
+# its own share of the swarm, and where their ranges overlap the same advert arrives
+# once per adapter. a report is a copy of one already passed on if it has the same bot
+# and payload, came from another adapter, and arrived within the dedup window of the
+# first copy. a second report from the same adapter is always a new advert, so the
+# window only has to cover the spread between adapters, well under the bots'
+# advertising interval.
+#
+# the first copy goes on at once with its adapter's rssi. the rssi of every copy is kept
+# per bot and adapter, to tell which adapter covers which bots.
+
+import asyncio
+import collections
+import json
+import time
+
+class AdvertMerger:
+    def __init__(self, handler, window=0.05):
+        # handler(address, local name, rssi, manufacturer data, adapter) gets every advert once
+        self.handler = handler
+        self.window = window
+        # (address, payload) -> (time of the first copy, adapters that reported it)
+        self.recent = {}
+        # (time, key) of the entries in recent, oldest first
+        self.expiry = collections.deque()
+        # address -> adapter -> rssi of the last report through that adapter
+        self.adapter_rssi = {}
+        self.stats = {"reports": 0, "forwarded": 0, "duplicates": 0}
+        self.adapter_reports = collections.Counter()
+
+    @staticmethod
+    def payload(local_name, manufacturer_data):
+        return local_name, tuple(sorted((company, bytes(data)) for company, data in manufacturer_data.items()))
+
+    def report(self, adapter, address, local_name, rssi, manufacturer_data, now=None):
+        # returns whether the report was passed on
+        if now is None:
+            now = time.monotonic()
+        while self.expiry and self.expiry[0][0] + self.window < now:
+            _, key = self.expiry.popleft()
+            entry = self.recent.get(key)
+            if entry is not None and entry[0] + self.window < now:
+                del self.recent[key]
+
+        self.stats["reports"] += 1
+        self.adapter_reports[adapter] += 1
+        self.adapter_rssi.setdefault(address, {})[adapter] = rssi
+        key = (address, self.payload(local_name, manufacturer_data))
+        entry = self.recent.get(key)
+        if entry is not None and entry[0] + self.window >= now and adapter not in entry[1]:
+            entry[1].add(adapter)
+            self.stats["duplicates"] += 1
+            return False
+
+        self.recent[key] = (now, {adapter})
+        self.expiry.append((now, key))
+        self.stats["forwarded"] += 1
+        self.handler(address, local_name, rssi, manufacturer_data, adapter)
+        return True
+
+    def forget(self, address):
+        self.adapter_rssi.pop(address, None)
+
+def read_feed(path):
+    # a feed of adverts, one json object per line: t (seconds from the start), adapter,
+    # address, name, rssi and manufacturer_data (company id -> hex)
+    with open(path) as feed:
+        for line in feed:
+            if not line.strip():
+                continue
+            record = json.loads(line)
+            record["manufacturer_data"] = {int(company): bytes.fromhex(data)
+                                           for company, data in record["manufacturer_data"].items()}
+            yield record
+
+async def replay(path, merger, speed=1.0):
+    # feeds the merger as the adapters would have, in real time divided by speed
+    start = time.monotonic()
+    for record in read_feed(path):
+        delay = start + record["t"] / speed - time.monotonic()
+        if delay > 0:
+            await asyncio.sleep(delay)
+        merger.report(record["adapter"], record["address"], record["name"], record["rssi"], record["manufacturer_data"])
@@ -4,18 +4,34 @@ import yaml
 from pathlib import Path
 import bleak
 from websockets.asyncio.server import serve
-import websockets
 import argparse
 import json
+import math
+from http import HTTPStatus
+from urllib.parse import parse_qs, urlparse
 
 from loguru import logger
 
+import beacon_reports
+import broadcast
+import frames
+import ingest
+import ground_localiser
+import history
+
 bot_disconnect_timeout = 10
 bot_remove_timeout = 60
 webserver_port = 8000
+localise_hz = 2.0
+beacon_port = beacon_reports.DEFAULT_PORT
+adapters = [None]
+replay_path = None
 
 company_ids = {}
 
+# the batch localiser for bots that forward rssi statistics, None if the engine is not built
+localiser: ground_localiser.GroundLocaliser | None = None
+
 class Bot:
     def __init__(self, bot_id, bluetooth_mac, name, rssi, manuf_data):
         logger.info(f"Creating new Bot entry: id:{{{bot_id}}} name: {{{name}}} rssi: {{{rssi}}} manf: {{{manuf_data}}}")
@@ -37,7 +53,20 @@ class Bot:
         dataID += 1
         self.status["Sound_Level"] = raw_data[dataID]
         dataID += 1
+        self.read_extended_frame(manuf_data)
     
+    def read_extended_frame(self, manuf_data):
+        frame = manuf_data.get(frames.EXTENDED_FRAME_ID)
+        if not frame:
+            return
+        decoder = frames.FRAME_DECODERS.get(frame[0])
+        if decoder is None:
+            return
+        name, decode = decoder
+        self.status[name] = decode(frame[1:])
+        if frame[0] == frames.FRAME_RSSI_STATS and localiser is not None:
+            localiser.observe(self.id, self.status[name])
+
     def refresh_data(self, rssi, manuf_data):
         self.status["connected"] = True
         self.last_seen = time.time()
@@ -55,50 +84,96 @@ class Bot:
         dataID += 1
         self.status["Sound_Level"] = raw_data[dataID]
         dataID += 1
+        self.read_extended_frame(manuf_data)
     
     def __str__(self):
         return f"{{{self.name}  id:{{{self.id}}} rssi: {{{self.status["rssi"]}}} manuf_data: {{{bytes.hex(self.status["manuf_data"])}}}}}"
 
 bot_registry: dict[str, Bot] = {}
 
-async def scan_loop():
-    logger.debug("Setting up BLE scanner")
+def robot_state(bot_id):
+    # a bot as the websocket clients see it (broadcast.py), None once it is gone
+    bot = bot_registry.get(bot_id)
+    if bot is None:
+        return None
+    state = {
+        "id": bot.id,
+        "position": {"x": bot.x_position, "y": bot.y_position},
+        "rotation": bot.rotation,
+        "battery": bot.status["Battery_level"],
+        "sound": bot.status["Sound_Level"],
+        "rssi": bot.status["rssi"],
+        "connected": bot.status["connected"],
+    }
+    fix = bot.status.get("ground_position")
+    if fix is not None:
+        state["ground_position"] = {"x": round(fix["x"], 2), "y": round(fix["y"], 2)}
+    return state
+
+broadcaster = broadcast.Broadcaster(robot_state)
+
+# every bot's recent telemetry for replay, served as /history on the websocket port
+history_store = history.HistoryStore()
+
+def record_history(bot):
+    fix = bot.status.get("ground_position")
+    history_store.append(bot.id, {
+        "x": bot.x_position, "y": bot.y_position, "rotation": bot.rotation,
+        "battery": bot.status["Battery_level"], "sound": bot.status["Sound_Level"], "rssi": bot.status["rssi"],
+        "ground_x": fix["x"] if fix is not None else math.nan, "ground_y": fix["y"] if fix is not None else math.nan,
+    })
+
+def handle_advert(address, local_name, rssi, manufacturer_data, adapter):
+    # every advert once, whichever adapters heard it (ingest.AdvertMerger)
+    ble_id = address
+    bot_id = address
+    #logger.debug(f"Found Device: {{{ble_id}}} {local_name} {manufacturer_data} on {adapter}")
     
-    async def detection_callback(device: bleak.BLEDevice, adv_data: bleak.AdvertisementData):
-        ble_id = device.address
-        bot_id = device.address
-        #logger.debug(f"Found Device: {{{ble_id}}} {device.metadata} {adv_data}")
-        
-        #if (adv_data.rssi > -50):
-        #    return
-        
-        manuf_name = adv_data.manufacturer_data
-        # ignore Apple
-        # try: 
-        #     key = list(manuf_name.keys())[0]
-        #     if (key == 76):
-        #         return
-        #     manuf_name = company_ids[key]
-        # except:
-        #     pass
-        
-        # if adv_data.local_name != None:
-        #     logger.debug(adv_data.local_name)
-        if adv_data.local_name != "BristleBot":
-            return
-        # logger.warning("Found!")
-        # logger.error("{}", adv_data)
+    #if (rssi > -50):
+    #    return
+    
+    manuf_name = manufacturer_data
+    # ignore Apple
+    # try: 
+    #     key = list(manuf_name.keys())[0]
+    #     if (key == 76):
+    #         return
+    #     manuf_name = company_ids[key]
+    # except:
+    #     pass
+    
+    # if local_name != None:
+    #     logger.debug(local_name)
+    if localiser is not None and localiser.beacon_heard(local_name, manufacturer_data):
+        return
+    if local_name != "BristleBot":
+        return
+    # logger.warning("Found!")
 
-        # Decode data into the Bot
-        if (bot_id not in bot_registry.keys()):
-            bot_registry[bot_id] = Bot(bot_id, ble_id, adv_data.local_name, adv_data.rssi, adv_data.manufacturer_data)
-        else:
-            bot_registry[bot_id].refresh_data(adv_data.rssi, adv_data.manufacturer_data)
-            logger.debug("refresh: {} {}", bot_id, bot_registry[bot_id])
+    # Decode data into the Bot
+    if (bot_id not in bot_registry.keys()):
+        bot_registry[bot_id] = Bot(bot_id, ble_id, local_name, rssi, manufacturer_data)
+    else:
+        bot_registry[bot_id].refresh_data(rssi, manufacturer_data)
+        logger.debug("refresh: {} {}", bot_id, bot_registry[bot_id])
+    # the rssi at each adapter, the merger keeps it up to date with every copy
+    bot_registry[bot_id].status["adapter_rssi"] = merger.adapter_rssi.get(address, {})
+    record_history(bot_registry[bot_id])
+    broadcaster.changed(bot_id)
+
+merger = ingest.AdvertMerger(handle_advert)
+
+async def scan_loop(adapter=None):
+    # one scanner per adapter (hci0, hci1, ...), the default adapter if None
+    name = adapter or "default"
+    logger.debug("Setting up BLE scanner on {}", name)
+    
+    def detection_callback(device: bleak.BLEDevice, adv_data: bleak.AdvertisementData):
+        merger.report(name, device.address, adv_data.local_name, adv_data.rssi, adv_data.manufacturer_data)
     
-    scanner = bleak.BleakScanner(detection_callback)
+    scanner = bleak.BleakScanner(detection_callback, adapter=adapter)
     await scanner.start()
-    logger.info("BLE Scanner Started")
+    logger.info("BLE Scanner Started on {}", name)
     
     try:
         while True:
@@ -106,6 +181,12 @@ async def scan_loop():
     finally:
         await scanner.stop()
 
+async def replay_loop(path):
+    # a recorded or simulated feed (advert_feed.py) instead of the scanners
+    logger.info("Replaying adverts from {}", path)
+    await ingest.replay(path, merger)
+    logger.info("Replay finished")
+
 async def timeout_loop():
     logger.debug("Starting timeout Loop")
     count_at_0 = 0
@@ -116,12 +197,15 @@ async def timeout_loop():
             # timeout
             if (bot.last_seen + bot_disconnect_timeout < now):
                 #logger.warning(f"Bot {{{bot.id}}} not seen for more than {bot_disconnect_timeout} seconds.")
+                if bot.status["connected"]:
+                    broadcaster.changed(bot.id)
                 bot.status["connected"] = False
             else:
                 count += 1
         if len(bot_registry) > 0:
             count_at_0 = 0
             logger.info("Known connected devices: {}/{}", count, len(bot_registry))
+            logger.info("Adverts: {} passed on, {} copies from other adapters, per adapter: {}", merger.stats["forwarded"], merger.stats["duplicates"], dict(merger.adapter_reports))
             for bot in bot_registry.values():
                 if bot.status["connected"]:
                     logger.info("id: {} last seen: {} battery: {} x: {} y: {} rotation: {} sound: {}", bot.id, bot.last_seen, bot.status["Battery_level"], bot.x_position, bot.y_position, bot.rotation, bot.status["Sound_Level"])
@@ -145,29 +229,77 @@ async def cleanup():
                 delete_queue.append(bot.id)
         for to_delete in delete_queue:
             bot_registry.pop(to_delete)
+            merger.forget(to_delete)
+            history_store.forget(to_delete)
+            broadcaster.removed(to_delete)
+            if localiser is not None:
+                localiser.forget(to_delete)
         await asyncio.sleep(1)
 
-async def get_data(websocket):
-    logger.info("Got connection to server!")
+async def localise_loop():
+    logger.debug("Starting ground localisation loop")
+    while True:
+        # only the bots in the registry, cleanup() hands their slots back when they go
+        fixes = localiser.tick(known=bot_registry)
+        for bot_id, fix in fixes.items():
+            if bot_id in bot_registry:
+                bot_registry[bot_id].status["ground_position"] = fix
+                broadcaster.changed(bot_id)
+        if fixes:
+            logger.debug("Ground localisation: {} bots in {:.2f} ms", len(fixes), localiser.last_tick_ms)
+        await asyncio.sleep(1.0 / localise_hz)
+
+async def beacon_report_listener():
+    # the beacons' own measurements of the bots (beacon/scanner.py), fused with the bots' in the localiser
+    logger.info("Listening for beacon reports on port {}", beacon_port)
+    loop = asyncio.get_running_loop()
+    transport, _ = await loop.create_datagram_endpoint(
+        lambda: beacon_reports.BeaconReportProtocol(localiser.beacon_report), local_addr=("0.0.0.0", beacon_port))
     try:
-        while True:
-            #do something
-            logger.debug("Gathering data")
-            # Generate JSOn data
-            json_output = f"{{ \"timestamp\": {time.time()}, \"robots\": ["
-            for bot in bot_registry.values():
-                json_output += f"{{\"id\": \"{bot.id}\","
-                json_output += f"\"position\": {{\"x\": {bot.x_position}, \"y\": {bot.y_position}}},"
-                json_output += "},"
-            json_output += "]}"
-            await websocket.send(json_output)
-            await asyncio.sleep(1)
-    except websockets.exceptions.ConnectionClosed:
-        pass
+        await asyncio.Future()
+    finally:
+        transport.close()
+
+def history_request(connection, request):
+    # GET /history?bot=ID&start=T&end=T&fields=x,y,sound&max_points=N&resolution=raw|1s|10s
+    # as plain http on the websocket port. times are unix seconds, the last minute by
+    # default, and without bot every bot is in the answer. anything else is a websocket
+    url = urlparse(request.path)
+    if url.path != "/history":
+        return None
+    query = parse_qs(url.query)
+    try:
+        end = float(query.get("end", [time.time()])[0])
+        start = float(query.get("start", [end - 60.0])[0])
+        fields = query["fields"][0].split(",") if "fields" in query else list(history.FIELDS)
+        max_points = int(query.get("max_points", [1000])[0])
+        resolution = query.get("resolution", [None])[0]
+        if any(field not in history.FIELDS for field in fields):
+            raise ValueError(f"fields are {','.join(history.FIELDS)}")
+        levels = [name for name, _, _ in history.LEVELS]
+        if resolution is not None and resolution not in levels:
+            raise ValueError(f"resolution is one of {','.join(levels)}")
+        if max_points < 1:
+            raise ValueError("max_points is at least 1")
+    except (ValueError, KeyError) as e:
+        return connection.respond(HTTPStatus.BAD_REQUEST, f"{e}\n")
+    bots = query.get("bot", list(history_store.bots))
+    answer = {}
+    for bot_id in bots:
+        series = history_store.query(bot_id, start, end, fields, max_points, resolution)
+        if series is not None:
+            answer[bot_id] = series
+    response = connection.respond(HTTPStatus.OK, json.dumps({"start": start, "end": end, "bots": answer}))
+    del response.headers["Content-Type"]
+    response.headers["Content-Type"] = "application/json"
+    response.headers["Access-Control-Allow-Origin"] = "*"
+    return response
 
 async def manage_webserver():
     logger.info("Starting server on port {}", webserver_port)
-    async with serve(get_data, "localhost", webserver_port) as server:
+    # no per message compression, it would compress every frame again for every client
+    async with serve(broadcaster.serve, "localhost", webserver_port, compression=None,
+                     process_request=history_request) as server:
         await server.serve_forever()
 
 async def main():
@@ -176,15 +308,42 @@ async def main():
     for d in indata:
         company_ids[d["value"]] = d["name"]
     #logger.debug(company_ids)
+    global localiser
+    if replay_path is not None:
+        loops = [replay_loop(replay_path)]
+    else:
+        loops = [scan_loop(adapter) for adapter in adapters]
+    loops += [timeout_loop(), cleanup(), manage_webserver(), broadcaster.run()]
+    try:
+        localiser = ground_localiser.GroundLocaliser()
+        loops.append(localise_loop())
+        loops.append(beacon_report_listener())
+    except OSError as e:
+        logger.warning("Ground localisation off, build it with make -C engine ({})", e)
     try:
-        await asyncio.gather(scan_loop(), timeout_loop(), cleanup(), manage_webserver())
+        await asyncio.gather(*loops)
     except asyncio.exceptions.CancelledError:
         logger.error("Cancelled, now exiting...")
 
 if __name__ == "__main__":
     parser = argparse.ArgumentParser("Command Server")
     parser.add_argument("--port", help="Which port to run the webserver on (default: 8000)", default=8000, type=int)
+    parser.add_argument("--localise-hz", help="Ground localisation ticks per second (default: 2)", default=2.0, type=float)
+    parser.add_argument("--beacon-port", help="UDP port the beacons report to (default: 8001)", default=beacon_reports.DEFAULT_PORT, type=int)
+    parser.add_argument("--push-interval", help="Shortest time between websocket frames in seconds (default: 0.05)", default=0.05, type=float)
+    parser.add_argument("--keyframe-interval", help="Seconds between full snapshots to every websocket client (default: 5)", default=5.0, type=float)
+    parser.add_argument("--adapters", help="Comma separated bluetooth adapters to scan on, e.g. hci0,hci1 (default: the default adapter)", default=None, type=str)
+    parser.add_argument("--dedup-window", help="Seconds within which the same advert from another adapter is a copy (default: 0.05)", default=0.05, type=float)
+    parser.add_argument("--replay", help="Replay a feed of adverts (advert_feed.py) instead of scanning", default=None, type=str)
     args = parser.parse_args()
     logger.info(args)
     webserver_port = args.port
+    localise_hz = args.localise_hz
+    beacon_port = args.beacon_port
+    broadcaster.min_interval = args.push_interval
+    broadcaster.keyframe_interval = args.keyframe_interval
+    if args.adapters:
+        adapters = args.adapters.split(",")
+    merger.window = args.dedup_window
+    replay_path = args.replay
     asyncio.run(main())
\ No newline at end of file